@@ -40,10 +40,8 @@
 #define AT45DB_CHIP_ERASE_ADDR 0x94809A /* Magic address. See usage. */
 #define AT45DB_BUFFER1_WRITE 0x84
 #define AT45DB_BUFFER1_PAGE_PROGRAM 0x88
-/* Buffer 2 is unused yet.
 #define AT45DB_BUFFER2_WRITE 0x87
 #define AT45DB_BUFFER2_PAGE_PROGRAM 0x89
-*/
 
 static uint8_t at45db_read_status_register(struct flashctx *flash, uint8_t *status)
 {
@@ -453,7 +451,12 @@ int spi_erase_at45cs_sector(struct flashctx *flash, unsigned int addr, unsigned
 	return at45db_erase(flash, opcode, at45db_convert_addr(addr, page_size), 200000, 100);
 }
 
-static int at45db_fill_buffer1(struct flashctx *flash, const uint8_t *bytes, unsigned int off, unsigned int len)
+static const uint8_t at45db_buffer_write[] = { AT45DB_BUFFER1_WRITE, AT45DB_BUFFER2_WRITE };
+static const uint8_t at45db_buffer_program[] = { AT45DB_BUFFER1_PAGE_PROGRAM, AT45DB_BUFFER2_PAGE_PROGRAM };
+
+/* Filling a buffer is allowed while the chip is busy programming the page from the other one. */
+static int at45db_fill_buffer(struct flashctx *flash, unsigned int buffer, const uint8_t *bytes,
+			      unsigned int off, unsigned int len)
 {
 	const unsigned int page_size = flash->chip->page_size;
 	if ((off + len) > page_size) {
@@ -462,13 +465,13 @@ static int at45db_fill_buffer1(struct flashctx *flash, const uint8_t *bytes, uns
 		return 1;
 	}
 
-	/* Create a suitable buffer to store opcode, address and data chunks for buffer1. */
+	/* Create a suitable buffer to store opcode, address and data chunks for the buffer. */
 	const unsigned int max_data_write = flash->mst->spi.max_data_write;
 	const unsigned int max_chunk = max_data_write > 4 && max_data_write - 4 <= page_size ?
 				       max_data_write - 4 : page_size;
 	uint8_t buf[4 + max_chunk];
 
-	buf[0] = AT45DB_BUFFER1_WRITE;
+	buf[0] = at45db_buffer_write[buffer];
 	while (off < page_size) {
 		unsigned int cur_chunk = min(max_chunk, page_size - off);
 		buf[1] = (off >> 16) & 0xff;
@@ -485,10 +488,11 @@ static int at45db_fill_buffer1(struct flashctx *flash, const uint8_t *bytes, uns
 	return 0;
 }
 
-static int at45db_commit_buffer1(struct flashctx *flash, unsigned int at45db_addr)
+/* Starts programming a page from the buffer, the caller has to wait for completion. */
+static int at45db_commit_buffer(struct flashctx *flash, unsigned int buffer, unsigned int at45db_addr)
 {
 	const uint8_t cmd[] = {
-		AT45DB_BUFFER1_PAGE_PROGRAM,
+		at45db_buffer_program[buffer],
 		(at45db_addr >> 16) & 0xff,
 		(at45db_addr >> 8) & 0xff,
 		(at45db_addr >> 0) & 0xff
@@ -501,31 +505,17 @@ static int at45db_commit_buffer1(struct flashctx *flash, unsigned int at45db_add
 		return ret;
 	}
 
-	/* Wait for completion (typically a few ms). */
-	ret = at45db_wait_ready(flash, 250, 200); // 50 ms
-	if (ret != 0) {
-		msg_cerr("%s: chip did not become ready again!\n", __func__);
-		return ret;
-	}
-
 	return 0;
 }
 
-static int at45db_program_page(struct flashctx *flash, const uint8_t *buf, unsigned int at45db_addr)
+static int at45db_wait_program_done(struct flashctx *flash)
 {
-	int ret = at45db_fill_buffer1(flash, buf, 0, flash->chip->page_size);
-	if (ret != 0) {
-		msg_cerr("%s: filling the buffer failed!\n", __func__);
-		return ret;
-	}
-
-	ret = at45db_commit_buffer1(flash, at45db_addr);
-	if (ret != 0) {
-		msg_cerr("%s: committing page failed!\n", __func__);
-		return ret;
-	}
+	/* Wait for completion (typically a few ms). */
+	int ret = at45db_wait_ready(flash, 250, 200); // 50 ms
+	if (ret != 0)
+		msg_cerr("%s: chip did not become ready again!\n", __func__);
 
-	return 0;
+	return ret;
 }
 
 int spi_write_at45db(struct flashctx *flash, const uint8_t *buf, unsigned int start, unsigned int len)
@@ -544,13 +534,35 @@ int spi_write_at45db(struct flashctx *flash, const uint8_t *buf, unsigned int st
 		return 1;
 	}
 
-	unsigned int i;
-	for (i = 0; i < len; i += page_size) {
-		if (at45db_program_page(flash, buf + i, at45db_convert_addr(start + i, page_size)) != 0) {
-			msg_cerr("Writing page %u failed!\n", i);
-			return 1;
+	/*
+	 * Alternate between both SRAM buffers: the next page is transferred into
+	 * one buffer while the chip is still programming the previous page from
+	 * the other.
+	 */
+	unsigned int i, buffer = 0;
+	for (i = 0; i < len; i += page_size, buffer ^= 1) {
+		if (at45db_fill_buffer(flash, buffer, buf + i, 0, page_size) != 0) {
+			msg_cerr("%s: filling the buffer failed!\n", __func__);
+			goto error;
+		}
+		/* The previous page has to be done before the next one can start. */
+		if (i > 0 && at45db_wait_program_done(flash) != 0) {
+			i -= page_size;
+			goto error;
+		}
+		if (at45db_commit_buffer(flash, buffer, at45db_convert_addr(start + i, page_size)) != 0) {
+			msg_cerr("%s: committing page failed!\n", __func__);
+			goto error;
 		}
 		update_progress(flash, FLASHROM_PROGRESS_WRITE, i + page_size, len);
 	}
+	if (len > 0 && at45db_wait_program_done(flash) != 0) {
+		i -= page_size;
+		goto error;
+	}
 	return 0;
+
+error:
+	msg_cerr("Writing page %u failed!\n", i);
+	return 1;
 }
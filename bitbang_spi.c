@@ -66,7 +66,18 @@ static int bitbang_spi_set_sck_get_miso(const struct bitbang_spi_master * const
 	return master->get_miso(spi_data);
 }
 
-static uint8_t bitbang_spi_read_byte(const struct bitbang_spi_master *master, void *spi_data)
+/*
+ * The byte functions are always inlined, so that the delays vanish
+ * entirely when they are called with a constant half_period of 0.
+ */
+static inline void bitbang_spi_delay(unsigned int half_period)
+{
+	if (half_period)
+		programmer_delay(half_period);
+}
+
+static inline __attribute__((always_inline)) uint8_t bitbang_spi_read_byte(
+		const struct bitbang_spi_master *master, unsigned int half_period, void *spi_data)
 {
 	uint8_t ret = 0;
 	int i;
@@ -76,23 +87,62 @@ static uint8_t bitbang_spi_read_byte(const struct bitbang_spi_master *master, vo
 			bitbang_spi_set_sck_set_mosi(master, 0, 0, spi_data);
 		else
 			bitbang_spi_set_sck(master, 0, spi_data);
-		programmer_delay(master->half_period);
+		bitbang_spi_delay(half_period);
 		ret <<= 1;
 		ret |= bitbang_spi_set_sck_get_miso(master, 1, spi_data);
-		programmer_delay(master->half_period);
+		bitbang_spi_delay(half_period);
 	}
 	return ret;
 }
 
-static void bitbang_spi_write_byte(const struct bitbang_spi_master *master, uint8_t val, void *spi_data)
+static inline __attribute__((always_inline)) void bitbang_spi_write_byte(
+		const struct bitbang_spi_master *master, uint8_t val, unsigned int half_period, void *spi_data)
 {
 	int i;
 
 	for (i = 7; i >= 0; i--) {
 		bitbang_spi_set_sck_set_mosi(master, 0, (val >> i) & 1, spi_data);
-		programmer_delay(master->half_period);
+		bitbang_spi_delay(half_period);
 		bitbang_spi_set_sck(master, 1, spi_data);
-		programmer_delay(master->half_period);
+		bitbang_spi_delay(half_period);
+	}
+}
+
+static void bitbang_spi_write_bytes(const struct bitbang_spi_master *master, const uint8_t *buf,
+				    unsigned int len, void *spi_data)
+{
+	unsigned int i;
+
+	if (master->shift_out_bytes) {
+		master->shift_out_bytes(buf, len, spi_data);
+		return;
+	}
+
+	if (master->half_period == 0) {
+		for (i = 0; i < len; i++)
+			bitbang_spi_write_byte(master, buf[i], 0, spi_data);
+	} else {
+		for (i = 0; i < len; i++)
+			bitbang_spi_write_byte(master, buf[i], master->half_period, spi_data);
+	}
+}
+
+static void bitbang_spi_read_bytes(const struct bitbang_spi_master *master, uint8_t *buf,
+				   unsigned int len, void *spi_data)
+{
+	unsigned int i;
+
+	if (master->shift_in_bytes) {
+		master->shift_in_bytes(buf, len, spi_data);
+		return;
+	}
+
+	if (master->half_period == 0) {
+		for (i = 0; i < len; i++)
+			buf[i] = bitbang_spi_read_byte(master, 0, spi_data);
+	} else {
+		for (i = 0; i < len; i++)
+			buf[i] = bitbang_spi_read_byte(master, master->half_period, spi_data);
 	}
 }
 
@@ -106,7 +156,6 @@ static int bitbang_spi_send_command(const struct flashctx *flash,
 				    const unsigned char *writearr,
 				    unsigned char *readarr)
 {
-	unsigned int i;
 	const struct bitbang_spi_master_data *data = flash->mst->spi.data;
 	const struct bitbang_spi_master *master = data->master;
 
@@ -116,15 +165,13 @@ static int bitbang_spi_send_command(const struct flashctx *flash,
 	 */
 	bitbang_spi_request_bus(master, data->spi_data);
 	bitbang_spi_set_cs(master, 0, data->spi_data);
-	for (i = 0; i < writecnt; i++)
-		bitbang_spi_write_byte(master, writearr[i], data->spi_data);
-	for (i = 0; i < readcnt; i++)
-		readarr[i] = bitbang_spi_read_byte(master, data->spi_data);
+	bitbang_spi_write_bytes(master, writearr, writecnt, data->spi_data);
+	bitbang_spi_read_bytes(master, readarr, readcnt, data->spi_data);
 
 	bitbang_spi_set_sck(master, 0, data->spi_data);
-	programmer_delay(master->half_period);
+	bitbang_spi_delay(master->half_period);
 	bitbang_spi_set_cs(master, 1, data->spi_data);
-	programmer_delay(master->half_period);
+	bitbang_spi_delay(master->half_period);
 	/* FIXME: Run bitbang_spi_release_bus here or in programmer init? */
 	bitbang_spi_release_bus(master, data->spi_data);
 
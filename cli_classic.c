@@ -18,6 +18,7 @@
  */
 
 #include <errno.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <fcntl.h>
 #include <sys/stat.h>
@@ -47,7 +48,8 @@ static void cli_classic_usage(const char *name)
 	       "\t\t [-E|-x|(-r|-w|-v) [<file>]]\n"
 	       "\t\t [(-l <layoutfile>|--ifd|--fmap|--fmap-file <fmapfile>) [-i <region>[:<file>]]...]\n"
 	       "\t\t [-n] [-N] [-f])]\n"
-	       "\t[-V[V[V]]] [-o <logfile>]\n\n", name);
+	       "\t[-V[V[V]]] [-o <logfile>]\n"
+	       "\t[--daemon <socket> | --connect <socket>]\n\n", name);
 
 	printf(" -h | --help                        print this help text\n"
 	       " -R | --version                     print version (release)\n"
@@ -85,6 +87,11 @@ static void cli_classic_usage(const char *name)
 	       " -z | --list-supported-wiki         print supported devices in wiki syntax\n"
 #endif
 	       "      --progress                    show progress percentage on the standard output\n"
+	       "      --timing-report[=json]        print the time spent in each phase at exit\n"
+	       "      --record <file>               record the programmer session to <file>\n"
+	       "      --daemon <socket>             keep the programmer open and serve requests\n"
+	       "                                    of clients on <socket>\n"
+	       "      --connect <socket>            run the operation in the daemon on <socket>\n"
 	       " -p | --programmer <name>[:<param>] specify the programmer device. One of\n");
 	list_programmers_linebreak(4, 80, 0);
 	printf(".\n\nYou can specify one of -h, -R, -L, "
@@ -95,30 +102,24 @@ static void cli_classic_usage(const char *name)
 	       "If no operation is specified, flashrom will only probe for flash chips.\n");
 }
 
-static void cli_classic_abort_usage(const char *msg)
+/* Reports an invalid command line, the caller fails with the returned 1. */
+static int cli_classic_usage_error(const char *msg)
 {
 	if (msg)
-		fprintf(stderr, "%s", msg);
-	printf("Please run \"flashrom --help\" for usage info.\n");
-	exit(1);
-}
-
-static void cli_classic_validate_singleop(int *operation_specified)
-{
-	if (++(*operation_specified) > 1) {
-		cli_classic_abort_usage("More than one operation specified. Aborting.\n");
-	}
+		msg_gerr("%s", msg);
+	msg_ginfo("Please run \"flashrom --help\" for usage info.\n");
+	return 1;
 }
 
 static int check_filename(char *filename, const char *type)
 {
 	if (!filename || (filename[0] == '\0')) {
-		fprintf(stderr, "Error: No %s file specified.\n", type);
+		msg_gerr("Error: No %s file specified.\n", type);
 		return 1;
 	}
 	/* Not an error, but maybe the user intended to specify a CLI option instead of a file name. */
 	if (filename[0] == '-' && filename[1] != '\0')
-		fprintf(stderr, "Warning: Supplied %s file name starts with -\n", type);
+		msg_gwarn("Warning: Supplied %s file name starts with -\n", type);
 	return 0;
 }
 
@@ -392,6 +393,117 @@ static char *get_optional_filename(char *argv[])
 	return filename;
 }
 
+enum timing_report_format {
+	TIMING_REPORT_NONE,
+	TIMING_REPORT_TEXT,
+	TIMING_REPORT_JSON,
+};
+
+/* Phases timed by the CLI itself, the image operations are timed by libflashrom. */
+enum cli_phase {
+	CLI_PHASE_CALIBRATION,
+	CLI_PHASE_PROGRAMMER_INIT,
+	CLI_PHASE_PROBE,
+	CLI_PHASE_LAYOUT,
+	CLI_PHASE_NR,
+};
+
+static const char *const cli_phase_names[CLI_PHASE_NR] = {
+	[CLI_PHASE_CALIBRATION]		= "calibration",
+	[CLI_PHASE_PROGRAMMER_INIT]	= "programmer_init",
+	[CLI_PHASE_PROBE]		= "probe",
+	[CLI_PHASE_LAYOUT]		= "layout",
+};
+
+static const char *const lib_phase_names[FLASHROM_STATS_PHASE_NR] = {
+	[FLASHROM_STATS_PHASE_READ]	= "read",
+	[FLASHROM_STATS_PHASE_PRE_READ]	= "pre_read",
+	[FLASHROM_STATS_PHASE_PLANNING]	= "planning",
+	[FLASHROM_STATS_PHASE_ERASE]	= "erase",
+	[FLASHROM_STATS_PHASE_WRITE]	= "write",
+	[FLASHROM_STATS_PHASE_VERIFY]	= "verify",
+};
+
+static uint64_t cli_phase_us[CLI_PHASE_NR];
+
+static void cli_phase_end(enum cli_phase phase, uint64_t start_ns)
+{
+	cli_phase_us[phase] += (internal_clock_ns() - start_ns) / 1000;
+}
+
+static void print_timing_phase(enum timing_report_format format, bool first,
+			       const char *name, uint64_t us, uint64_t bytes)
+{
+	const double kib_per_s = us ? (double)bytes * 1000000 / 1024 / us : 0;
+
+	if (format == TIMING_REPORT_JSON) {
+		printf("%s\n    {\"name\": \"%s\", \"us\": %" PRIu64 ", \"bytes\": %" PRIu64
+		       ", \"kib_per_s\": %.1f}", first ? "" : ",", name, us, bytes, kib_per_s);
+	} else if (bytes) {
+		printf("  %-16s %12.3f %12" PRIu64 " %12.1f\n", name, us / 1000.0, bytes, kib_per_s);
+	} else {
+		printf("  %-16s %12.3f\n", name, us / 1000.0);
+	}
+}
+
+/*
+ * Prints the wall time, bytes and throughput of each phase, and which block
+ * erasers were used. `flash` may be NULL if no chip was found.
+ */
+static void print_timing_report(enum timing_report_format format,
+				const struct flashctx *flash, uint64_t total_us)
+{
+	const struct flashrom_stats *const stats = flash ? flashrom_stats_get(flash) : NULL;
+	const bool json = format == TIMING_REPORT_JSON;
+	bool first = true;
+	int i;
+
+	if (json)
+		printf("{\n  \"total_us\": %" PRIu64 ",\n  \"phases\": [", total_us);
+	else
+		printf("Timing report:\n  %-16s %12s %12s %12s\n", "phase", "time [ms]", "bytes", "KiB/s");
+
+	for (i = 0; i < CLI_PHASE_NR; i++, first = false)
+		print_timing_phase(format, first, cli_phase_names[i], cli_phase_us[i], 0);
+	for (i = 0; stats && i < FLASHROM_STATS_PHASE_NR; i++)
+		print_timing_phase(format, false, lib_phase_names[i],
+				   stats->phases[i].total_us, stats->phases[i].bytes);
+
+	if (json)
+		printf("\n  ],\n  \"erasers\": [");
+	else
+		printf("  %-16s %12.3f\n", "total", total_us / 1000.0);
+
+	first = true;
+	for (i = 0; stats && i < FLASHROM_STATS_ERASERS; i++) {
+		const struct flashrom_stats_eraser_counter *const eraser = &stats->erasers[i];
+		const struct eraseblock *const blocks = flash->chip->block_erasers[i].eraseblocks;
+		/* Only uniform erasers have a single block size to show. */
+		const unsigned int block_size = blocks[1].size ? 0 : blocks[0].size;
+
+		if (!eraser->count)
+			continue;
+		if (json) {
+			printf("%s\n    {\"index\": %d, \"block_size\": %u, \"count\": %" PRIu64
+			       ", \"bytes\": %" PRIu64 "}", first ? "" : ",", i, block_size,
+			       eraser->count, eraser->bytes);
+		} else {
+			if (first)
+				printf("Erasers used:\n");
+			printf("  eraser %d: %" PRIu64 " erases, %" PRIu64 " bytes", i,
+			       eraser->count, eraser->bytes);
+			if (block_size)
+				printf(", %u byte blocks\n", block_size);
+			else
+				printf(", non-uniform blocks\n");
+		}
+		first = false;
+	}
+
+	if (json)
+		printf("%s]\n}\n", first ? "" : "\n  ");
+}
+
 static int flashrom_layout_read_fmap_from_file(struct flashrom_layout **layout,
 					       struct flashrom_flashctx *flashctx, const char *fmapfile)
 {
@@ -431,6 +543,7 @@ static int do_read(struct flashctx *const flash, const char *const filename)
 	ret = flashrom_image_read(flash, buf, size);
 	if (ret > 0)
 		goto free_out;
+	cli_daemon_cache_update(flash, buf);
 
 	if (write_buf_to_include_args(get_layout(flash), buf)) {
 		ret = 1;
@@ -450,6 +563,123 @@ static int do_extract(struct flashctx *const flash)
 	return do_read(flash, NULL);
 }
 
+/*
+ * A write erases whole blocks, and writes the bytes of them outside the
+ * included regions back from the old contents. Reads these bytes of
+ * `contents` from the chip, as cached contents may be stale.
+ */
+static int read_partial_erase_blocks(struct flashctx *const flash, uint8_t *const contents)
+{
+	const size_t flash_size = flashrom_flash_getsize(flash);
+	const struct flashrom_layout *const layout = flash->layout;
+	const struct romentry *entry = NULL;
+	struct flashrom_layout *gaps = NULL;
+	unsigned int block_size = 0, gap_count = 0, i, j;
+	size_t start, end;
+	int ret = 1;
+
+	/*
+	 * Any eraser may be picked, so this covers the blocks of the largest one, to
+	 * which the smaller blocks are aligned. It usually is the whole chip.
+	 */
+	for (i = 0; i < NUM_ERASEFUNCTIONS; i++) {
+		if (!flash->chip->block_erasers[i].block_erase)
+			continue;
+		for (j = 0; j < NUM_ERASEREGIONS; j++)
+			block_size = max(block_size, flash->chip->block_erasers[i].eraseblocks[j].size);
+	}
+	if (!block_size)
+		return 0;
+
+	/* 0 for bytes the write keeps as they are, 1 for included ones and 2 for those to read. */
+	uint8_t *const map = calloc(flash_size, 1);
+	if (!map || flashrom_layout_new(&gaps)) {
+		msg_gerr("Out of memory!\n");
+		goto _free_ret;
+	}
+	while ((entry = layout_next_included(get_layout(flash), entry)))
+		memset(map + entry->start, 1, entry->end - entry->start + 1);
+	entry = NULL;
+	while ((entry = layout_next_included(get_layout(flash), entry))) {
+		end = (entry->end / block_size + 1) * block_size;
+		for (start = entry->start / block_size * block_size; start < end && start < flash_size; start++) {
+			if (!map[start])
+				map[start] = 2;
+		}
+	}
+
+	for (start = 0; start < flash_size; start = end) {
+		for (end = start; end < flash_size && map[end] == map[start]; end++)
+			;
+		if (map[start] != 2)
+			continue;
+		char name[16];
+		snprintf(name, sizeof(name), "gap%u", gap_count++);
+		if (flashrom_layout_add_region(gaps, start, end - 1, name) ||
+		    flashrom_layout_include_region(gaps, name))
+			goto _free_ret;
+	}
+	if (!gap_count) {
+		ret = 0;
+		goto _free_ret;
+	}
+
+	flashrom_layout_set(flash, gaps);
+	ret = flashrom_image_read(flash, contents, flash_size);
+	if (!ret)
+		cli_daemon_cache_update(flash, contents);
+	flashrom_layout_set(flash, layout);
+
+_free_ret:
+	flashrom_layout_release(gaps);
+	free(map);
+	return ret;
+}
+
+/*
+ * A daemon knows the contents from earlier operations. As they may be stale,
+ * the partially written erase blocks are read from the chip, and the write
+ * is always verified, also if it found nothing to write.
+ */
+static int write_with_cached_contents(struct flashctx *const flash, uint8_t *const newcontents,
+				      const uint8_t *const cached)
+{
+	const size_t flash_size = flashrom_flash_getsize(flash);
+	const struct flashrom_layout *const layout = flash->layout;
+	const struct romentry *entry = NULL;
+	int ret = 1;
+
+	uint8_t *const refcontents = malloc(flash_size);
+	if (!refcontents) {
+		msg_gerr("Out of memory!\n");
+		return 1;
+	}
+	memcpy(refcontents, cached, flash_size);
+	if (read_partial_erase_blocks(flash, refcontents))
+		goto _free_ret;
+
+	flashrom_flag_set(flash, FLASHROM_FLAG_VERIFY_AFTER_WRITE, false);
+	ret = flashrom_image_write(flash, newcontents, flash_size, refcontents);
+	flashrom_flag_set(flash, FLASHROM_FLAG_VERIFY_AFTER_WRITE, true);
+	if (ret)
+		goto _free_ret;
+
+	if (flashrom_flag_get(flash, FLASHROM_FLAG_VERIFY_WHOLE_CHIP)) {
+		while ((entry = layout_next_included(get_layout(flash), entry)))
+			memcpy(refcontents + entry->start, newcontents + entry->start,
+			       entry->end - entry->start + 1);
+		flashrom_layout_set(flash, NULL);
+		ret = flashrom_image_verify(flash, refcontents, flash_size);
+		flashrom_layout_set(flash, layout);
+	} else {
+		ret = flashrom_image_verify(flash, newcontents, flash_size);
+	}
+
+_free_ret:
+	free(refcontents);
+	return ret;
+}
+
 static int do_write(struct flashctx *const flash, const char *const filename, const char *const referencefile)
 {
 	const size_t flash_size = flashrom_flash_getsize(flash);
@@ -480,7 +710,19 @@ static int do_write(struct flashctx *const flash, const char *const filename, co
 			goto _free_ret;
 	}
 
-	ret = flashrom_image_write(flash, newcontents, flash_size, refcontents);
+	/* Cached contents are only trusted if the write gets verified. */
+	const uint8_t *cached = NULL;
+	if (!referencefile && flashrom_flag_get(flash, FLASHROM_FLAG_VERIFY_AFTER_WRITE))
+		cached = cli_daemon_cache_get(flash);
+
+	if (cached)
+		ret = write_with_cached_contents(flash, newcontents, cached);
+	else
+		ret = flashrom_image_write(flash, newcontents, flash_size, refcontents);
+	if (!ret && flashrom_flag_get(flash, FLASHROM_FLAG_VERIFY_AFTER_WRITE))
+		cli_daemon_cache_update(flash, newcontents);
+	else
+		cli_daemon_cache_invalidate();
 
 _free_ret:
 	free(refcontents);
@@ -512,33 +754,53 @@ static int do_verify(struct flashctx *const flash, const char *const filename)
 		goto _free_ret;
 
 	ret = flashrom_image_verify(flash, newcontents, flash_size);
+	if (ret)
+		cli_daemon_cache_invalidate();
+	else
+		cli_daemon_cache_update(flash, newcontents);
 
 _free_ret:
 	free(newcontents);
 	return ret;
 }
 
-int main(int argc, char *argv[])
-{
-	const struct flashchip *chip = NULL;
-	/* Probe for up to eight flash chips. */
-	struct flashctx flashes[8] = {{0}};
-	struct flashctx *fill_flash;
-	const char *name;
-	int namelen, opt, i, j;
-	int startchip = -1, chipcount = 0, option_index = 0, force = 0, ifd = 0, fmap = 0;
+/* The options of a command line, see cli_classic_usage(). */
+struct cli_options {
+	const struct programmer_entry *prog;
+	char *pparam;
+	char *filename;
+	char *referencefile;
+	char *layoutfile;
+	char *fmapfile;
+	char *logfile;
+	char *recordfile;
+	char *daemon_socket;
+	char *connect_socket;
+	char *wp_region;
+	struct layout_include_args *include_args;
+	int force, ifd, fmap;
 #if CONFIG_PRINT_WIKI == 1
-	int list_supported_wiki = 0;
+	int list_supported_wiki;
 #endif
-	int flash_name = 0, flash_size = 0;
-	int enable_wp = 0, disable_wp = 0, print_wp_status = 0;
-	int set_wp_range = 0, set_wp_region = 0, print_wp_ranges = 0;
-	uint32_t wp_start = 0, wp_len = 0;
-	int read_it = 0, extract_it = 0, write_it = 0, erase_it = 0, verify_it = 0;
-	int dont_verify_it = 0, dont_verify_all = 0, list_supported = 0, operation_specified = 0;
-	int show_progress = 0;
-	struct flashrom_layout *layout = NULL;
-	static const struct programmer_entry *prog = NULL;
+	int flash_name, flash_size;
+	int enable_wp, disable_wp, print_wp_status;
+	int set_wp_range, set_wp_region, print_wp_ranges;
+	uint32_t wp_start, wp_len;
+	int read_it, extract_it, write_it, erase_it, verify_it;
+	int dont_verify_it, dont_verify_all, list_supported, operation_specified;
+	int show_progress, show_help, show_version;
+	enum timing_report_format timing_report;
+};
+
+/*
+ * Parses a command line into `opts`, which the caller frees with free_options()
+ * also on failure. A daemon parses the command lines of its clients, so this
+ * must not exit.
+ */
+static int parse_options(int argc, char *argv[], struct cli_options *opts)
+{
+	const char *name;
+	int namelen, opt, option_index = 0;
 	enum {
 		OPTION_IFD = 0x0100,
 		OPTION_FMAP,
@@ -554,8 +816,11 @@ int main(int argc, char *argv[])
 		OPTION_WP_LIST,
 		OPTION_DO_NOT_DIFF,
 		OPTION_PROGRESS,
+		OPTION_TIMING_REPORT,
+		OPTION_RECORD,
+		OPTION_DAEMON,
+		OPTION_CONNECT,
 	};
-	int ret = 0;
 
 	static const char optstring[] = "r::Rw::v::nNVEfc:l:i:p:Lzho:x";
 	static const struct option long_options[] = {
@@ -591,75 +856,50 @@ int main(int argc, char *argv[])
 		{"version",		0, NULL, 'R'},
 		{"output",		1, NULL, 'o'},
 		{"progress",		0, NULL, OPTION_PROGRESS},
+		{"timing-report",	2, NULL, OPTION_TIMING_REPORT},
+		{"record",		1, NULL, OPTION_RECORD},
+		{"daemon",		1, NULL, OPTION_DAEMON},
+		{"connect",		1, NULL, OPTION_CONNECT},
 		{NULL,			0, NULL, 0},
 	};
 
-	char *filename = NULL;
-	char *referencefile = NULL;
-	char *layoutfile = NULL;
-	char *fmapfile = NULL;
-	char *logfile = NULL;
-	char *tempstr = NULL;
-	char *pparam = NULL;
-	struct layout_include_args *include_args = NULL;
-	char *wp_region = NULL;
-
-	/*
-	 * Safety-guard against a user who has (mistakenly) closed
-	 * stdout or stderr before exec'ing flashrom.  We disable
-	 * logging in this case to prevent writing log data to a flash
-	 * chip when a flash device gets opened with fd 1 or 2.
-	 */
-	if (check_file(stdout) && check_file(stderr)) {
-		flashrom_set_log_callback(
-			(flashrom_log_callback *)&flashrom_print_cb);
-	}
-
-	print_version();
-	print_banner();
-
-	/* FIXME: Delay calibration should happen in programmer code. */
-	if (flashrom_init(1))
-		exit(1);
-
-	setbuf(stdout, NULL);
-	/* FIXME: Delay all operation_specified checks until after command
-	 * line parsing to allow --help overriding everything else.
-	 */
+	/* FIXME: Allow --help to override everything else. */
 	while ((opt = getopt_long(argc, argv, optstring,
 				  long_options, &option_index)) != EOF) {
 		switch (opt) {
 		case 'r':
-			cli_classic_validate_singleop(&operation_specified);
-			filename = get_optional_filename(argv);
-			read_it = 1;
+			opts->operation_specified++;
+			opts->filename = get_optional_filename(argv);
+			opts->read_it = 1;
 			break;
 		case 'w':
-			cli_classic_validate_singleop(&operation_specified);
-			filename = get_optional_filename(argv);
-			write_it = 1;
+			opts->operation_specified++;
+			opts->filename = get_optional_filename(argv);
+			opts->write_it = 1;
 			break;
 		case 'v':
 			//FIXME: gracefully handle superfluous -v
-			cli_classic_validate_singleop(&operation_specified);
-			if (dont_verify_it) {
-				cli_classic_abort_usage("--verify and --noverify are mutually exclusive. Aborting.\n");
+			opts->operation_specified++;
+			if (opts->dont_verify_it) {
+				return cli_classic_usage_error("--verify and --noverify are mutually exclusive. "
+							       "Aborting.\n");
 			}
-			filename = get_optional_filename(argv);
-			verify_it = 1;
+			opts->filename = get_optional_filename(argv);
+			opts->verify_it = 1;
 			break;
 		case 'n':
-			if (verify_it) {
-				cli_classic_abort_usage("--verify and --noverify are mutually exclusive. Aborting.\n");
+			if (opts->verify_it) {
+				return cli_classic_usage_error("--verify and --noverify are mutually exclusive. "
+							       "Aborting.\n");
 			}
-			dont_verify_it = 1;
+			opts->dont_verify_it = 1;
 			break;
 		case 'N':
-			dont_verify_all = 1;
+			opts->dont_verify_all = 1;
 			break;
 		case 'x':
-			cli_classic_validate_singleop(&operation_specified);
-			extract_it = 1;
+			opts->operation_specified++;
+			opts->extract_it = 1;
 			break;
 		case 'c':
 			chip_to_probe = strdup(optarg);
@@ -670,109 +910,118 @@ int main(int argc, char *argv[])
 				verbose_logfile = verbose_screen;
 			break;
 		case 'E':
-			cli_classic_validate_singleop(&operation_specified);
-			erase_it = 1;
+			opts->operation_specified++;
+			opts->erase_it = 1;
 			break;
 		case 'f':
-			force = 1;
+			opts->force = 1;
 			break;
 		case 'l':
-			if (layoutfile)
-				cli_classic_abort_usage("Error: --layout specified more than once. Aborting.\n");
-			if (ifd)
-				cli_classic_abort_usage("Error: --layout and --ifd both specified. Aborting.\n");
-			if (fmap)
-				cli_classic_abort_usage("Error: --layout and --fmap-file both specified. Aborting.\n");
-			layoutfile = strdup(optarg);
+			if (opts->layoutfile)
+				return cli_classic_usage_error("Error: --layout specified more than once. "
+							       "Aborting.\n");
+			if (opts->ifd)
+				return cli_classic_usage_error("Error: --layout and --ifd both specified. "
+							       "Aborting.\n");
+			if (opts->fmap)
+				return cli_classic_usage_error("Error: --layout and --fmap-file both specified. "
+							       "Aborting.\n");
+			opts->layoutfile = strdup(optarg);
 			break;
 		case OPTION_IFD:
-			if (layoutfile)
-				cli_classic_abort_usage("Error: --layout and --ifd both specified. Aborting.\n");
-			if (fmap)
-				cli_classic_abort_usage("Error: --fmap-file and --ifd both specified. Aborting.\n");
-			ifd = 1;
+			if (opts->layoutfile)
+				return cli_classic_usage_error("Error: --layout and --ifd both specified. "
+							       "Aborting.\n");
+			if (opts->fmap)
+				return cli_classic_usage_error("Error: --fmap-file and --ifd both specified. "
+							       "Aborting.\n");
+			opts->ifd = 1;
 			break;
 		case OPTION_FMAP_FILE:
-			if (fmap)
-				cli_classic_abort_usage("Error: --fmap or --fmap-file specified "
-					"more than once. Aborting.\n");
-			if (ifd)
-				cli_classic_abort_usage("Error: --fmap-file and --ifd both specified. Aborting.\n");
-			if (layoutfile)
-				cli_classic_abort_usage("Error: --fmap-file and --layout both specified. Aborting.\n");
-			fmapfile = strdup(optarg);
-			fmap = 1;
+			if (opts->fmap)
+				return cli_classic_usage_error("Error: --fmap or --fmap-file specified "
+							       "more than once. Aborting.\n");
+			if (opts->ifd)
+				return cli_classic_usage_error("Error: --fmap-file and --ifd both specified. "
+							       "Aborting.\n");
+			if (opts->layoutfile)
+				return cli_classic_usage_error("Error: --fmap-file and --layout both specified. "
+							       "Aborting.\n");
+			opts->fmapfile = strdup(optarg);
+			opts->fmap = 1;
 			break;
 		case OPTION_FMAP:
-			if (fmap)
-				cli_classic_abort_usage("Error: --fmap or --fmap-file specified "
-					"more than once. Aborting.\n");
-			if (ifd)
-				cli_classic_abort_usage("Error: --fmap and --ifd both specified. Aborting.\n");
-			if (layoutfile)
-				cli_classic_abort_usage("Error: --layout and --fmap both specified. Aborting.\n");
-			fmap = 1;
+			if (opts->fmap)
+				return cli_classic_usage_error("Error: --fmap or --fmap-file specified "
+							       "more than once. Aborting.\n");
+			if (opts->ifd)
+				return cli_classic_usage_error("Error: --fmap and --ifd both specified. "
+							       "Aborting.\n");
+			if (opts->layoutfile)
+				return cli_classic_usage_error("Error: --layout and --fmap both specified. "
+							       "Aborting.\n");
+			opts->fmap = 1;
 			break;
 		case 'i':
-			if (register_include_arg(&include_args, optarg))
-				cli_classic_abort_usage(NULL);
+			if (register_include_arg(&opts->include_args, optarg))
+				return cli_classic_usage_error(NULL);
 			break;
 		case OPTION_FLASH_CONTENTS:
-			if (referencefile)
-				cli_classic_abort_usage("Error: --flash-contents specified more than once."
-							"Aborting.\n");
-			referencefile = strdup(optarg);
+			if (opts->referencefile)
+				return cli_classic_usage_error("Error: --flash-contents specified more than once."
+							       "Aborting.\n");
+			opts->referencefile = strdup(optarg);
 			break;
 		case OPTION_FLASH_NAME:
-			cli_classic_validate_singleop(&operation_specified);
-			flash_name = 1;
+			opts->operation_specified++;
+			opts->flash_name = 1;
 			break;
 		case OPTION_FLASH_SIZE:
-			cli_classic_validate_singleop(&operation_specified);
-			flash_size = 1;
+			opts->operation_specified++;
+			opts->flash_size = 1;
 			break;
 		case OPTION_WP_STATUS:
-			print_wp_status = 1;
+			opts->print_wp_status = 1;
 			break;
 		case OPTION_WP_LIST:
-			print_wp_ranges = 1;
+			opts->print_wp_ranges = 1;
 			break;
 		case OPTION_WP_SET_RANGE:
-			if (parse_wp_range(&wp_start, &wp_len) < 0)
-				cli_classic_abort_usage("Incorrect wp-range arguments provided.\n");
+			if (parse_wp_range(&opts->wp_start, &opts->wp_len) < 0)
+				return cli_classic_usage_error("Incorrect wp-range arguments provided.\n");
 
-			set_wp_range = 1;
+			opts->set_wp_range = 1;
 			break;
 		case OPTION_WP_SET_REGION:
-			set_wp_region = 1;
-			wp_region = strdup(optarg);
+			opts->set_wp_region = 1;
+			opts->wp_region = strdup(optarg);
 			break;
 		case OPTION_WP_ENABLE:
-			enable_wp = 1;
+			opts->enable_wp = 1;
 			break;
 		case OPTION_WP_DISABLE:
-			disable_wp = 1;
+			opts->disable_wp = 1;
 			break;
 		case 'L':
-			cli_classic_validate_singleop(&operation_specified);
-			list_supported = 1;
+			opts->operation_specified++;
+			opts->list_supported = 1;
 			break;
 		case 'z':
 #if CONFIG_PRINT_WIKI == 1
-			cli_classic_validate_singleop(&operation_specified);
-			list_supported_wiki = 1;
+			opts->operation_specified++;
+			opts->list_supported_wiki = 1;
 #else
-			cli_classic_abort_usage("Error: Wiki output was not "
-					"compiled in. Aborting.\n");
+			return cli_classic_usage_error("Error: Wiki output was not "
+						       "compiled in. Aborting.\n");
 #endif
 			break;
 		case 'p':
-			if (prog != NULL) {
-				cli_classic_abort_usage("Error: --programmer specified "
-					"more than once. You can separate "
-					"multiple\nparameters for a programmer "
-					"with \",\". Please see the man page "
-					"for details.\n");
+			if (opts->prog != NULL) {
+				return cli_classic_usage_error("Error: --programmer specified "
+							       "more than once. You can separate "
+							       "multiple\nparameters for a programmer "
+							       "with \",\". Please see the man page "
+							       "for details.\n");
 			}
 			size_t p;
 			for (p = 0; p < programmer_table_size; p++) {
@@ -781,15 +1030,15 @@ int main(int argc, char *argv[])
 				if (strncmp(optarg, name, namelen) == 0) {
 					switch (optarg[namelen]) {
 					case ':':
-						pparam = strdup(optarg + namelen + 1);
-						if (!strlen(pparam)) {
-							free(pparam);
-							pparam = NULL;
+						opts->pparam = strdup(optarg + namelen + 1);
+						if (!strlen(opts->pparam)) {
+							free(opts->pparam);
+							opts->pparam = NULL;
 						}
-						prog = programmer_table[p];
+						opts->prog = programmer_table[p];
 						break;
 					case '\0':
-						prog = programmer_table[p];
+						opts->prog = programmer_table[p];
 						break;
 					default:
 						/* The continue refers to the
@@ -802,67 +1051,479 @@ int main(int argc, char *argv[])
 					break;
 				}
 			}
-			if (prog == NULL) {
-				fprintf(stderr, "Error: Unknown programmer \"%s\". Valid choices are:\n",
-					optarg);
+			if (opts->prog == NULL) {
+				msg_gerr("Error: Unknown programmer \"%s\". Valid choices are:\n", optarg);
 				list_programmers_linebreak(0, 80, 0);
 				msg_ginfo(".\n");
-				cli_classic_abort_usage(NULL);
+				return cli_classic_usage_error(NULL);
 			}
 			break;
 		case 'R':
-			/* print_version() is always called during startup. */
-			cli_classic_validate_singleop(&operation_specified);
-			exit(0);
+			opts->operation_specified++;
+			opts->show_version = 1;
 			break;
 		case 'h':
-			cli_classic_validate_singleop(&operation_specified);
-			cli_classic_usage(argv[0]);
-			exit(0);
+			opts->operation_specified++;
+			opts->show_help = 1;
 			break;
 		case 'o':
-			if (logfile) {
-				fprintf(stderr, "Warning: -o/--output specified multiple times.\n");
-				free(logfile);
+			if (opts->logfile) {
+				msg_gwarn("Warning: -o/--output specified multiple times.\n");
+				free(opts->logfile);
 			}
 
-			logfile = strdup(optarg);
-			if (logfile[0] == '\0') {
-				cli_classic_abort_usage("No log filename specified.\n");
+			opts->logfile = strdup(optarg);
+			if (opts->logfile[0] == '\0') {
+				return cli_classic_usage_error("No log filename specified.\n");
 			}
 			break;
 		case OPTION_PROGRESS:
-			show_progress = 1;
+			opts->show_progress = 1;
 			break;
-		default:
-			cli_classic_abort_usage(NULL);
+		case OPTION_TIMING_REPORT:
+			if (!optarg || !strcmp(optarg, "text"))
+				opts->timing_report = TIMING_REPORT_TEXT;
+			else if (!strcmp(optarg, "json"))
+				opts->timing_report = TIMING_REPORT_JSON;
+			else
+				return cli_classic_usage_error("Error: Unknown timing report format. "
+							       "Aborting.\n");
+			break;
+		case OPTION_RECORD:
+			if (opts->recordfile) {
+				msg_gwarn("Warning: --record specified multiple times.\n");
+				free(opts->recordfile);
+			}
+			opts->recordfile = strdup(optarg);
 			break;
+		case OPTION_DAEMON:
+			if (opts->daemon_socket)
+				return cli_classic_usage_error("Error: --daemon specified more than once. "
+							       "Aborting.\n");
+			opts->daemon_socket = strdup(optarg);
+			break;
+		case OPTION_CONNECT:
+			if (opts->connect_socket)
+				return cli_classic_usage_error("Error: --connect specified more than once. "
+							       "Aborting.\n");
+			opts->connect_socket = strdup(optarg);
+			break;
+		default:
+			return cli_classic_usage_error(NULL);
 		}
 	}
 
+	if (opts->operation_specified > 1)
+		return cli_classic_usage_error("More than one operation specified. Aborting.\n");
 	if (optind < argc)
-		cli_classic_abort_usage("Error: Extra parameter found.\n");
-	if (filename && check_filename(filename, "image"))
-		cli_classic_abort_usage(NULL);
-	if (layoutfile && check_filename(layoutfile, "layout"))
-		cli_classic_abort_usage(NULL);
-	if (fmapfile && check_filename(fmapfile, "fmap"))
-		cli_classic_abort_usage(NULL);
-	if (referencefile && check_filename(referencefile, "reference"))
-		cli_classic_abort_usage(NULL);
-	if (logfile && check_filename(logfile, "log"))
-		cli_classic_abort_usage(NULL);
-	if (logfile && open_logfile(logfile))
-		cli_classic_abort_usage(NULL);
+		return cli_classic_usage_error("Error: Extra parameter found.\n");
+	if (opts->filename && check_filename(opts->filename, "image"))
+		return cli_classic_usage_error(NULL);
+	if (opts->layoutfile && check_filename(opts->layoutfile, "layout"))
+		return cli_classic_usage_error(NULL);
+	if (opts->fmapfile && check_filename(opts->fmapfile, "fmap"))
+		return cli_classic_usage_error(NULL);
+	if (opts->referencefile && check_filename(opts->referencefile, "reference"))
+		return cli_classic_usage_error(NULL);
+	if (opts->logfile && check_filename(opts->logfile, "log"))
+		return cli_classic_usage_error(NULL);
+	if (opts->recordfile && check_filename(opts->recordfile, "recording"))
+		return cli_classic_usage_error(NULL);
+	if (opts->daemon_socket && check_filename(opts->daemon_socket, "socket"))
+		return cli_classic_usage_error(NULL);
+	if (opts->connect_socket && check_filename(opts->connect_socket, "socket"))
+		return cli_classic_usage_error(NULL);
+
+	if (opts->daemon_socket) {
+		if (opts->connect_socket)
+			return cli_classic_usage_error("Error: --daemon and --connect both specified. "
+						       "Aborting.\n");
+		if (opts->operation_specified || opts->enable_wp || opts->disable_wp ||
+		    opts->print_wp_status || opts->print_wp_ranges || opts->set_wp_range ||
+		    opts->set_wp_region)
+			return cli_classic_usage_error("Error: --daemon doesn't take an operation, "
+						       "run it with --connect instead. Aborting.\n");
+	}
+	if (opts->connect_socket) {
+		/* The daemon owns the programmer, and can't read the standard input of the client. */
+		if (opts->prog)
+			return cli_classic_usage_error("Error: --connect and --programmer both specified. "
+						       "Aborting.\n");
+		if (opts->timing_report || opts->recordfile)
+			return cli_classic_usage_error("Error: --timing-report and --record are not available "
+						       "with --connect. Aborting.\n");
+		if (opts->filename && !strcmp(opts->filename, "-"))
+			return cli_classic_usage_error("Error: Images from the standard input are not available "
+						       "with --connect. Aborting.\n");
+	}
+	return 0;
+}
+
+static void free_options(struct cli_options *opts)
+{
+	cleanup_include_args(&opts->include_args);
+	free(opts->filename);
+	free(opts->fmapfile);
+	free(opts->referencefile);
+	free(opts->layoutfile);
+	free(opts->pparam);
+	free(opts->wp_region);
+	free(opts->logfile);
+	free(opts->recordfile);
+	free(opts->daemon_socket);
+	free(opts->connect_socket);
+}
+
+static int load_layout(struct cli_options *opts, struct flashrom_layout **layout)
+{
+	const uint64_t phase_start = internal_clock_ns();
+
+	if (opts->layoutfile && layout_from_file(layout, opts->layoutfile))
+		return 1;
+	cli_phase_end(CLI_PHASE_LAYOUT, phase_start);
+
+	/* If the user specifies a -i argument and no layout, then we do fmap
+	 * parsing. */
+	if ((opts->include_args || opts->extract_it) && !opts->layoutfile && !opts->ifd) {
+		msg_gdbg("-i argument specified, set fmap.\n");
+		opts->fmap = 1;
+	}
+
+	if (!opts->ifd && !opts->fmap && process_include_args(*layout, opts->include_args))
+		return 1;
+	return 0;
+}
+
+/* In a daemon, layouts in the flash are parsed from the cached contents if possible. */
+static int layout_read_from_ifd(struct flashrom_layout **layout, struct flashctx *flash)
+{
+	const uint8_t *const cached = cli_daemon_cache_get(flash);
+
+	return flashrom_layout_read_from_ifd(layout, flash, cached,
+					     cached ? flashrom_flash_getsize(flash) : 0);
+}
+
+static int layout_read_fmap_from_rom(struct flashrom_layout **layout, struct flashctx *flash)
+{
+	const size_t size = flashrom_flash_getsize(flash);
+	const uint8_t *const cached = cli_daemon_cache_get(flash);
+
+	if (cached && !flashrom_layout_read_fmap_from_buffer(layout, flash, cached, size))
+		return 0;
+	return flashrom_layout_read_fmap_from_rom(layout, flash, 0, size);
+}
+
+/*
+ * Runs the operations of the command line on the probed chip. Takes over
+ * `layout`, which is only set on `fill_flash` for the time of the operations.
+ */
+static int run_operations(struct flashctx *fill_flash, struct cli_options *opts,
+			  struct flashrom_layout *layout)
+{
+	uint64_t phase_start;
+	int ret = 0;
+
+	unsigned int progress_user_data[FLASHROM_PROGRESS_NR];
+	struct flashrom_progress progress_state = {
+		 .user_data = progress_user_data,
+		 .interval_ms = 250,
+	};
+	if (opts->show_progress)
+		flashrom_set_progress_callback(fill_flash, &flashrom_progress_cb, &progress_state);
+
+	const bool any_wp_op =
+		opts->set_wp_range || opts->set_wp_region || opts->enable_wp ||
+		opts->disable_wp || opts->print_wp_status || opts->print_wp_ranges;
+
+	const bool any_op = opts->read_it || opts->write_it || opts->verify_it || opts->erase_it ||
+		opts->flash_name || opts->flash_size || opts->extract_it || any_wp_op;
+
+	if (!any_op) {
+		msg_ginfo("No operations were specified.\n");
+		goto out;
+	}
+
+	if (opts->enable_wp && opts->disable_wp) {
+		msg_ginfo("Error: --wp-enable and --wp-disable are mutually exclusive\n");
+		ret = 1;
+		goto out;
+	}
+	if (opts->set_wp_range && opts->set_wp_region) {
+		msg_gerr("Error: Cannot use both --wp-range and --wp-region simultaneously.\n");
+		ret = 1;
+		goto out;
+	}
+
+	/*
+	 * FIXME(b/240080820): Some cros code just uses `--wp-disable` to
+	 * disable writeprotect, but linux_mtd WP code requires an empty range
+	 * to be specified as well (i.e. `--wp-range 0,0`). To avoid breaking
+	 * cros flashrom users for now, implicitly set an empty range if
+	 * --wp-disable is used without --wp-range/--wp-region.
+	 */
+#if !(defined (__i386__) || defined (__x86_64__) || defined(__amd64__))
+	if (opts->disable_wp && !opts->set_wp_range && !opts->set_wp_region) {
+		opts->wp_start = 0;
+		opts->wp_len = 0;
+		opts->set_wp_range = true;
+	}
+#endif
+
+	/*
+	 * Common rules for -r/-w/-v syntax parsing:
+	 * - If no filename is specified at all, quit.
+	 * - If no filename is specified for -r/-w/-v, but files are specified
+	 *   for -i, then the number of file arguments for -i options must be
+	 *   equal to the total number of -i options.
+	 *
+	 * Rules for reading:
+	 * - If files are specified for -i args but not -r, do partial reads for
+	 *   each -i arg, creating a new file for each region. Each -i option
+	 *   must specify a filename.
+	 * - If filenames are specified for -r and -i args, then:
+	 *     - Do partial read for each -i arg, creating a new file for
+	 *       each region where a filename is provided (-i region:filename).
+	 *     - Create a ROM-sized file with partially filled content. For each
+	 *       -i arg, fill the corresponding offset with content from ROM.
+	 *
+	 * Rules for writing and verifying:
+	 * - If files are specified for both -w/-v and -i args, -i files take
+	 *   priority.
+	 * - If file is specified for -w/-v and no files are specified with -i
+	 *   args, then the file is to be used for writing/verifying the entire
+	 *   ROM.
+	 * - If files are specified for -i args but not -w, do partial writes
+	 *   for each -i arg. Likewise for -v and -i args. All -i args must
+	 *   supply a filename. Any omission is considered ambiguous.
+	 * - Regions with a filename associated must not overlap. This is also
+	 *   considered ambiguous. Note: This is checked later since it requires
+	 *   processing the layout/fmap first.
+	 */
+	if ((opts->read_it | opts->write_it | opts->verify_it) && !opts->filename) {
+		if (!opts->include_args) {
+			msg_gerr("Error: No image file specified.\n");
+			ret = 1;
+			goto out;
+		}
+
+		if (check_include_args_filename(opts->include_args)) {
+			ret = 1;
+			goto out;
+		}
+	}
+
+	if (opts->flash_name) {
+		if (fill_flash->chip->vendor && fill_flash->chip->name) {
+			msg_ginfo("vendor=\"%s\" name=\"%s\"\n",
+				  fill_flash->chip->vendor,
+				  fill_flash->chip->name);
+		} else {
+			ret = -1;
+		}
+		goto out;
+	}
+
+	if (opts->flash_size) {
+		msg_ginfo("%zu\n", flashrom_flash_getsize(fill_flash));
+		goto out;
+	}
+
+	phase_start = internal_clock_ns();
+	if (opts->ifd && (layout_read_from_ifd(&layout, fill_flash) ||
+			  process_include_args(layout, opts->include_args))) {
+		ret = 1;
+		goto out;
+	} else if (opts->fmap && opts->fmapfile &&
+		   (flashrom_layout_read_fmap_from_file(&layout, fill_flash, opts->fmapfile) ||
+		    process_include_args(layout, opts->include_args))) {
+		ret = 1;
+		goto out;
+	} else if (!opts->ifd && opts->fmap &&
+		   ((flashrom_layout_read_fmap_from_file(&layout, fill_flash, opts->filename) &&
+		     layout_read_fmap_from_rom(&layout, fill_flash)) ||
+		    process_include_args(layout, opts->include_args))) {
+		ret = 1;
+		goto out;
+	}
+	cli_phase_end(CLI_PHASE_LAYOUT, phase_start);
+	flashrom_layout_set(fill_flash, layout);
+
+	if (any_wp_op) {
+		if (opts->set_wp_region && opts->wp_region) {
+			ret = flashrom_layout_get_region_range(layout, opts->wp_region,
+							       &opts->wp_start, &opts->wp_len);
+			if (ret)
+				goto out;
+			opts->set_wp_range = true;
+		}
+		ret = wp_cli(
+			fill_flash,
+			opts->enable_wp,
+			opts->disable_wp,
+			opts->print_wp_status,
+			opts->print_wp_ranges,
+			opts->set_wp_range,
+			opts->wp_start,
+			opts->wp_len
+		);
+		if (ret)
+			goto out;
+	}
+
+	flashrom_flag_set(fill_flash, FLASHROM_FLAG_FORCE, !!opts->force);
+#if CONFIG_INTERNAL == 1
+	flashrom_flag_set(fill_flash, FLASHROM_FLAG_FORCE_BOARDMISMATCH, !!force_boardmismatch);
+#endif
+	flashrom_flag_set(fill_flash, FLASHROM_FLAG_VERIFY_AFTER_WRITE, !opts->dont_verify_it);
+	flashrom_flag_set(fill_flash, FLASHROM_FLAG_VERIFY_WHOLE_CHIP, !opts->dont_verify_all);
+
+	/* FIXME: We should issue an unconditional chip reset here. This can be
+	 * done once we have a .reset function in struct flashchip.
+	 * Give the chip time to settle.
+	 */
+	programmer_delay(100000);
+	if (opts->read_it)
+		ret = do_read(fill_flash, opts->filename);
+	else if (opts->extract_it)
+		ret = do_extract(fill_flash);
+	else if (opts->erase_it) {
+		ret = flashrom_flash_erase(fill_flash);
+		/*
+		 * FIXME: Do we really want the scary warning if erase failed?
+		 * After all, after erase the chip is either blank or partially
+		 * blank or it has the old contents. A blank chip won't boot,
+		 * so if the user wanted erase and reboots afterwards, the user
+		 * knows very well that booting won't work.
+		 */
+		if (ret) {
+			cli_daemon_cache_invalidate();
+			emergency_help_message();
+		} else {
+			cli_daemon_cache_erase(fill_flash);
+		}
+	}
+	else if (opts->write_it)
+		ret = do_write(fill_flash, opts->filename, opts->referencefile);
+	else if (opts->verify_it)
+		ret = do_verify(fill_flash, opts->filename);
+
+	msg_ginfo("%s\n", ret ? "FAILED" : "SUCCESS");
+
+out:
+	flashrom_layout_set(fill_flash, NULL);
+	flashrom_layout_release(layout);
+	flashrom_set_progress_callback(fill_flash, NULL, NULL);
+	return ret;
+}
+
+/* Runs the command line of a client on the chip of the daemon, see cli_daemon.c. */
+static int cli_classic_serve_request(struct flashctx *flash, int argc, char *argv[])
+{
+	const enum flashrom_log_level screen = verbose_screen, logfile = verbose_logfile;
+	const char *const daemon_chip = chip_to_probe;
+	struct flashrom_layout *layout = NULL;
+	struct cli_options opts = { 0 };
+	int ret = 1;
+
+	/* Reset getopt, the command line of each client is parsed from the start. */
+#ifdef __linux__
+	optind = 0;
+#else
+	optreset = 1;
+	optind = 1;
+#endif
+	chip_to_probe = NULL;
+	if (parse_options(argc, argv, &opts))
+		goto out;
+	/* The client has answered these itself. */
+	if (opts.show_help || opts.show_version) {
+		ret = 0;
+		goto out;
+	}
+
+	/* As seen by scripts parsing the output of a CLI which probes. */
+	char *const buses = flashbuses_to_text(flash->chip->bustype);
+	msg_cinfo("Found %s flash chip \"%s\" (%d kB, %s).\n",
+		  flash->chip->vendor, flash->chip->name, flash->chip->total_size, buses);
+	free(buses);
+
+	if (chip_to_probe && strcmp(chip_to_probe, flash->chip->name)) {
+		msg_cerr("Error: The daemon serves chip \"%s\", not \"%s\".\n",
+			 flash->chip->name, chip_to_probe);
+	} else if (load_layout(&opts, &layout)) {
+		flashrom_layout_release(layout);
+	} else {
+		ret = run_operations(flash, &opts, layout);
+	}
+
+out:
+	free_options(&opts);
+	free((char *)chip_to_probe); /* Silence! Freeing is not modifying contents. */
+	chip_to_probe = daemon_chip;
+	verbose_screen = screen;
+	verbose_logfile = logfile;
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	const struct flashchip *chip = NULL;
+	/* Probe for up to eight flash chips. */
+	struct flashctx flashes[8] = {{0}};
+	struct flashctx *fill_flash = NULL;
+	int i, j;
+	int startchip = -1, chipcount = 0;
+	const uint64_t run_start = internal_clock_ns();
+	uint64_t phase_start;
+	struct flashrom_layout *layout = NULL;
+	struct cli_options opts = { 0 };
+	int ret = 0;
+
+	char *tempstr = NULL;
+
+	/*
+	 * Safety-guard against a user who has (mistakenly) closed
+	 * stdout or stderr before exec'ing flashrom.  We disable
+	 * logging in this case to prevent writing log data to a flash
+	 * chip when a flash device gets opened with fd 1 or 2.
+	 */
+	if (check_file(stdout) && check_file(stderr)) {
+		flashrom_set_log_callback(
+			(flashrom_log_callback *)&flashrom_print_cb);
+	}
+
+	print_version();
+	print_banner();
+
+	/* FIXME: Delay calibration should happen in programmer code. */
+	phase_start = internal_clock_ns();
+	if (flashrom_init(1))
+		exit(1);
+	cli_phase_end(CLI_PHASE_CALIBRATION, phase_start);
+
+	setbuf(stdout, NULL);
+	if (parse_options(argc, argv, &opts))
+		exit(1);
+	if (opts.show_help) {
+		cli_classic_usage(argv[0]);
+		exit(0);
+	}
+	/* print_version() is always called during startup. */
+	if (opts.show_version)
+		exit(0);
+	if (opts.logfile && open_logfile(opts.logfile)) {
+		cli_classic_usage_error(NULL);
+		exit(1);
+	}
 
 #if CONFIG_PRINT_WIKI == 1
-	if (list_supported_wiki) {
+	if (opts.list_supported_wiki) {
 		print_supported_wiki();
 		goto out;
 	}
 #endif
 
-	if (list_supported) {
+	if (opts.list_supported) {
 		if (print_supported())
 			ret = 1;
 		goto out;
@@ -877,19 +1538,15 @@ int main(int argc, char *argv[])
 	}
 	msg_gdbg("\n");
 
-	if (layoutfile && layout_from_file(&layout, layoutfile)) {
-		ret = 1;
-		goto out;
+	if (opts.connect_socket) {
+		enum flashrom_log_level max_level = verbose_screen;
+		if (opts.logfile && verbose_logfile > max_level)
+			max_level = verbose_logfile;
+		ret = cli_daemon_connect(opts.connect_socket, argc, argv, max_level);
+		goto out_client;
 	}
 
-	/* If the user specifies a -i argument and no layout, then we do fmap
-	 * parsing. */
-	if ((include_args || extract_it) && !layoutfile && !ifd) {
-		msg_gdbg("-i argument specified, set fmap.\n");
-		fmap = 1;
-	}
-
-	if (!ifd && !fmap && process_include_args(layout, include_args)) {
+	if (load_layout(&opts, &layout)) {
 		ret = 1;
 		goto out;
 	}
@@ -907,15 +1564,15 @@ int main(int argc, char *argv[])
 		/* Keep chip around for later usage in case a forced read is requested. */
 	}
 
-	if (prog == NULL) {
+	if (opts.prog == NULL) {
 		const struct programmer_entry *const default_programmer = CONFIG_DEFAULT_PROGRAMMER_NAME;
 
 		if (default_programmer) {
-			prog = default_programmer;
+			opts.prog = default_programmer;
 			/* We need to strdup here because we free(pparam) unconditionally later. */
-			pparam = strdup(CONFIG_DEFAULT_PROGRAMMER_ARGS);
+			opts.pparam = strdup(CONFIG_DEFAULT_PROGRAMMER_ARGS);
 			msg_pinfo("Using default programmer \"%s\" with arguments \"%s\".\n",
-				  default_programmer->name, pparam);
+				  default_programmer->name, opts.pparam);
 		} else {
 			msg_perr("Please select a programmer with the --programmer parameter.\n"
 #if CONFIG_INTERNAL == 1
@@ -940,16 +1597,24 @@ int main(int argc, char *argv[])
 	msg_gdbg("Lock acquired.\n");
 #endif
 
-	if (programmer_init(prog, pparam)) {
+	if (opts.recordfile && flashrom_record_start(opts.recordfile)) {
+		ret = 1;
+		goto out;
+	}
+
+	phase_start = internal_clock_ns();
+	if (programmer_init(opts.prog, opts.pparam)) {
 		msg_perr("Error: Programmer initialization failed.\n");
 		ret = 1;
 		goto out_shutdown;
 	}
+	cli_phase_end(CLI_PHASE_PROGRAMMER_INIT, phase_start);
 	tempstr = flashbuses_to_text(get_buses_supported());
 	msg_pdbg("The following protocols are supported: %s.\n", tempstr);
 	free(tempstr);
 	tempstr = NULL;
 
+	phase_start = internal_clock_ns();
 	for (j = 0; j < registered_master_count; j++) {
 		startchip = 0;
 		while (chipcount < (int)ARRAY_SIZE(flashes)) {
@@ -960,6 +1625,7 @@ int main(int argc, char *argv[])
 			startchip++;
 		}
 	}
+	cli_phase_end(CLI_PHASE_PROBE, phase_start);
 
 	if (chipcount > 1) {
 		msg_cinfo("Multiple flash chip definitions match the detected chip(s): \"%s\"",
@@ -971,11 +1637,11 @@ int main(int argc, char *argv[])
 		goto out_shutdown;
 	} else if (!chipcount) {
 		msg_cinfo("No EEPROM/flash device found.\n");
-		if (!force || !chip_to_probe) {
+		if (!opts.force || !chip_to_probe) {
 			msg_cinfo("Note: flashrom can never write if the flash chip isn't found "
 				  "automatically.\n");
 		}
-		if (force && read_it && chip_to_probe) {
+		if (opts.force && opts.read_it && chip_to_probe) {
 			struct registered_master *mst;
 			int compatible_masters = 0;
 			msg_cinfo("Force read (-f -r -c) requested, pretending the chip is there:\n");
@@ -1007,8 +1673,8 @@ int main(int argc, char *argv[])
 				goto out_shutdown;
 			}
 			msg_cinfo("Please note that forced reads most likely contain garbage.\n");
-			flashrom_flag_set(&flashes[0], FLASHROM_FLAG_FORCE, !!force);
-			ret = do_read(&flashes[0], filename);
+			flashrom_flag_set(&flashes[0], FLASHROM_FLAG_FORCE, !!opts.force);
+			ret = do_read(&flashes[0], opts.filename);
 			free(flashes[0].chip);
 			goto out_shutdown;
 		}
@@ -1023,18 +1689,15 @@ int main(int argc, char *argv[])
 	}
 
 	fill_flash = &flashes[0];
-
-	unsigned int progress_user_data[FLASHROM_PROGRESS_NR];
-	struct flashrom_progress progress_state = {
-		 .user_data = progress_user_data
-	};
-	if (show_progress)
-		flashrom_set_progress_callback(fill_flash, &flashrom_progress_cb, &progress_state);
+	if (opts.timing_report && flashrom_stats_enable(fill_flash, true)) {
+		ret = 1;
+		goto out_shutdown;
+	}
 
 	print_chip_support_status(fill_flash->chip);
 
 	unsigned int limitexceeded = count_max_decode_exceedings(fill_flash);
-	if (limitexceeded > 0 && !force) {
+	if (limitexceeded > 0 && !opts.force) {
 		enum chipbustype commonbuses = fill_flash->mst->buses_supported & fill_flash->chip->bustype;
 
 		/* Sometimes chip and programmer have more than one bus in common,
@@ -1049,183 +1712,21 @@ int main(int argc, char *argv[])
 		goto out_shutdown;
 	}
 
-	const bool any_wp_op =
-		set_wp_range || set_wp_region || enable_wp ||
-		disable_wp || print_wp_status || print_wp_ranges;
-
-	const bool any_op = read_it || write_it || verify_it || erase_it ||
-		flash_name || flash_size || extract_it || any_wp_op;
-
-	if (!any_op) {
-		msg_ginfo("No operations were specified.\n");
+	if (opts.daemon_socket) {
+		ret = cli_daemon_serve(opts.daemon_socket, fill_flash, cli_classic_serve_request);
 		goto out_shutdown;
 	}
 
-	if (enable_wp && disable_wp) {
-		msg_ginfo("Error: --wp-enable and --wp-disable are mutually exclusive\n");
-		ret = 1;
-		goto out_shutdown;
-	}
-	if (set_wp_range && set_wp_region) {
-		msg_gerr("Error: Cannot use both --wp-range and --wp-region simultaneously.\n");
-		ret = 1;
-		goto out_shutdown;
-	}
-
-	/*
-	 * FIXME(b/240080820): Some cros code just uses `--wp-disable` to
-	 * disable writeprotect, but linux_mtd WP code requires an empty range
-	 * to be specified as well (i.e. `--wp-range 0,0`). To avoid breaking
-	 * cros flashrom users for now, implicitly set an empty range if
-	 * --wp-disable is used without --wp-range/--wp-region.
-	 */
-#if !(defined (__i386__) || defined (__x86_64__) || defined(__amd64__))
-	if (disable_wp && !set_wp_range && !set_wp_region) {
-		wp_start = 0;
-		wp_len = 0;
-		set_wp_range = true;
-	}
-#endif
+	ret = run_operations(fill_flash, &opts, layout);
+	layout = NULL;
 
-	/*
-	 * Common rules for -r/-w/-v syntax parsing:
-	 * - If no filename is specified at all, quit.
-	 * - If no filename is specified for -r/-w/-v, but files are specified
-	 *   for -i, then the number of file arguments for -i options must be
-	 *   equal to the total number of -i options.
-	 *
-	 * Rules for reading:
-	 * - If files are specified for -i args but not -r, do partial reads for
-	 *   each -i arg, creating a new file for each region. Each -i option
-	 *   must specify a filename.
-	 * - If filenames are specified for -r and -i args, then:
-	 *     - Do partial read for each -i arg, creating a new file for
-	 *       each region where a filename is provided (-i region:filename).
-	 *     - Create a ROM-sized file with partially filled content. For each
-	 *       -i arg, fill the corresponding offset with content from ROM.
-	 *
-	 * Rules for writing and verifying:
-	 * - If files are specified for both -w/-v and -i args, -i files take
-	 *   priority.
-	 * - If file is specified for -w/-v and no files are specified with -i
-	 *   args, then the file is to be used for writing/verifying the entire
-	 *   ROM.
-	 * - If files are specified for -i args but not -w, do partial writes
-	 *   for each -i arg. Likewise for -v and -i args. All -i args must
-	 *   supply a filename. Any omission is considered ambiguous.
-	 * - Regions with a filename associated must not overlap. This is also
-	 *   considered ambiguous. Note: This is checked later since it requires
-	 *   processing the layout/fmap first.
-	 */
-	if ((read_it | write_it | verify_it) && !filename) {
-		if (!include_args) {
-			msg_gerr("Error: No image file specified.\n");
-			ret = 1;
-			goto out_shutdown;
-		}
-
-		if (check_include_args_filename(include_args)) {
-			ret = 1;
-			goto out_shutdown;
-		}
-	}
-
-	if (flash_name) {
-		if (fill_flash->chip->vendor && fill_flash->chip->name) {
-			printf("vendor=\"%s\" name=\"%s\"\n",
-				fill_flash->chip->vendor,
-				fill_flash->chip->name);
-		} else {
-			ret = -1;
-		}
-		goto out_shutdown;
-	}
-
-	if (flash_size) {
-		printf("%zu\n", flashrom_flash_getsize(fill_flash));
-		goto out_shutdown;
-	}
-
-	if (ifd && (flashrom_layout_read_from_ifd(&layout, fill_flash, NULL, 0) ||
-			   process_include_args(layout, include_args))) {
-		ret = 1;
-		goto out_shutdown;
-	} else if (fmap && fmapfile &&
-		   (flashrom_layout_read_fmap_from_file(&layout, fill_flash, fmapfile) ||
-		    process_include_args(layout, include_args))) {
-		ret = 1;
-		goto out_shutdown;
-	} else if (!ifd && fmap &&
-		   ((flashrom_layout_read_fmap_from_file(&layout, fill_flash, filename) &&
-		     flashrom_layout_read_fmap_from_rom(&layout, fill_flash, 0,
-							flashrom_flash_getsize(fill_flash))) ||
-		    process_include_args(layout, include_args))) {
-		ret = 1;
-		goto out_shutdown;
-	}
-	flashrom_layout_set(fill_flash, layout);
-
-	if (any_wp_op) {
-		if (set_wp_region && wp_region) {
-			ret = flashrom_layout_get_region_range(layout, wp_region, &wp_start, &wp_len);
-			if (ret)
-				goto out_release;
-			set_wp_range = true;
-		}
-		ret = wp_cli(
-			fill_flash,
-			enable_wp,
-			disable_wp,
-			print_wp_status,
-			print_wp_ranges,
-			set_wp_range,
-			wp_start,
-			wp_len
-		);
-		if (ret)
-			goto out_release;
-	}
-
-	flashrom_flag_set(fill_flash, FLASHROM_FLAG_FORCE, !!force);
-#if CONFIG_INTERNAL == 1
-	flashrom_flag_set(fill_flash, FLASHROM_FLAG_FORCE_BOARDMISMATCH, !!force_boardmismatch);
-#endif
-	flashrom_flag_set(fill_flash, FLASHROM_FLAG_VERIFY_AFTER_WRITE, !dont_verify_it);
-	flashrom_flag_set(fill_flash, FLASHROM_FLAG_VERIFY_WHOLE_CHIP, !dont_verify_all);
-
-	/* FIXME: We should issue an unconditional chip reset here. This can be
-	 * done once we have a .reset function in struct flashchip.
-	 * Give the chip time to settle.
-	 */
-	programmer_delay(100000);
-	if (read_it)
-		ret = do_read(fill_flash, filename);
-	else if (extract_it)
-		ret = do_extract(fill_flash);
-	else if (erase_it) {
-		ret = flashrom_flash_erase(fill_flash);
-		/*
-		 * FIXME: Do we really want the scary warning if erase failed?
-		 * After all, after erase the chip is either blank or partially
-		 * blank or it has the old contents. A blank chip won't boot,
-		 * so if the user wanted erase and reboots afterwards, the user
-		 * knows very well that booting won't work.
-		 */
-		if (ret)
-			emergency_help_message();
-	}
-	else if (write_it)
-		ret = do_write(fill_flash, filename, referencefile);
-	else if (verify_it)
-		ret = do_verify(fill_flash, filename);
-
-	msg_ginfo("%s\n", ret ? "FAILED" : "SUCCESS");
-
-out_release:
-	flashrom_layout_release(layout);
 out_shutdown:
 	flashrom_programmer_shutdown(NULL);
 out:
+	if (flashrom_record_stop()) {
+		msg_gerr("Writing the recording failed.\n");
+		ret = 1;
+	}
 
 #if USE_BIG_LOCK == 1
 	release_big_lock();
@@ -1234,22 +1735,21 @@ out:
 		msg_gerr("Unable to re-enable power management\n");
 		ret |= 1;
 	}
+out_client:
+	if (opts.timing_report)
+		print_timing_report(opts.timing_report, fill_flash, (internal_clock_ns() - run_start) / 1000);
+	if (fill_flash)
+		flashrom_stats_enable(fill_flash, false);
 	for (i = 0; i < chipcount; i++) {
 		flashrom_layout_release(flashes[i].default_layout);
 		free(flashes[i].chip);
 	}
 
-	cleanup_include_args(&include_args);
-	free(filename);
-	free(fmapfile);
-	free(referencefile);
-	free(layoutfile);
-	free(pparam);
-	free(wp_region);
+	flashrom_layout_release(layout);
+	free_options(&opts);
 	/* clean up global variables */
 	free((char *)chip_to_probe); /* Silence! Freeing is not modifying contents. */
 	chip_to_probe = NULL;
-	free(logfile);
 	ret |= close_logfile();
 	return ret;
 }
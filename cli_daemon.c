@@ -0,0 +1,567 @@
+/*
+ * This file is part of the flashrom project.
+ *
+ * Copyright 2026 Google LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Daemon mode of the CLI.
+ *
+ * `flashrom -p <programmer> --daemon <socket>` initializes the programmer and
+ * probes the chip once, then serves the requests of clients on a Unix socket,
+ * one at a time. `flashrom --connect <socket> <options>` sends its command
+ * line to the daemon, which runs it like a command line of its own, and
+ * prints the messages relayed back to it.
+ *
+ * The daemon caches the chip contents it has read, written or verified. A
+ * write uses them instead of reading the chip first, and layouts in the chip
+ * are parsed from them. The daemon must be the only one accessing the chip.
+ */
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flash.h"
+#include "layout.h"
+
+static struct {
+	uint8_t *contents;
+	uint8_t *valid;		/* one bit per byte of contents */
+	size_t size;
+} cache;
+
+static void cache_mark(size_t start, size_t len, bool valid)
+{
+	for (; len && start % 8; start++, len--) {
+		if (valid)
+			cache.valid[start / 8] |= 1 << start % 8;
+		else
+			cache.valid[start / 8] &= ~(1 << start % 8);
+	}
+	memset(cache.valid + start / 8, valid ? 0xff : 0x00, len / 8);
+	start += len / 8 * 8;
+	for (len %= 8; len; start++, len--) {
+		if (valid)
+			cache.valid[start / 8] |= 1 << start % 8;
+		else
+			cache.valid[start / 8] &= ~(1 << start % 8);
+	}
+}
+
+/* Returns the cached contents of the chip if all of them are known, NULL otherwise. */
+const uint8_t *cli_daemon_cache_get(const struct flashctx *flash)
+{
+	size_t i;
+
+	if (!cache.contents || cache.size != flashrom_flash_getsize(flash))
+		return NULL;
+	for (i = 0; i < cache.size / 8; i++) {
+		if (cache.valid[i] != 0xff)
+			return NULL;
+	}
+	for (i = cache.size / 8 * 8; i < cache.size; i++) {
+		if (!(cache.valid[i / 8] & 1 << i % 8))
+			return NULL;
+	}
+	msg_gdbg("Using the cached flash contents.\n");
+	return cache.contents;
+}
+
+/* Updates the cache with the included regions of `contents`, which are now in the chip. */
+void cli_daemon_cache_update(const struct flashctx *flash, const uint8_t *contents)
+{
+	const struct romentry *entry = NULL;
+
+	if (!cache.contents)
+		return;
+	while ((entry = layout_next_included(get_layout(flash), entry))) {
+		const size_t len = entry->end - entry->start + 1;
+		memcpy(cache.contents + entry->start, contents + entry->start, len);
+		cache_mark(entry->start, len, true);
+	}
+}
+
+/* Updates the cache after the included regions were erased. */
+void cli_daemon_cache_erase(const struct flashctx *flash)
+{
+	const struct romentry *entry = NULL;
+
+	if (!cache.contents)
+		return;
+	while ((entry = layout_next_included(get_layout(flash), entry))) {
+		const size_t len = entry->end - entry->start + 1;
+		memset(cache.contents + entry->start, ERASED_VALUE(flash), len);
+		cache_mark(entry->start, len, true);
+	}
+}
+
+/* Forgets the cached contents, e.g. after a failed write left the chip in an unknown state. */
+void cli_daemon_cache_invalidate(void)
+{
+	if (cache.contents)
+		cache_mark(0, cache.size, false);
+}
+
+/* Starts caching the contents of a chip of `size` bytes, none of which are known yet. */
+int cli_daemon_cache_init(size_t size)
+{
+	cache.size = size;
+	cache.contents = malloc(size);
+	cache.valid = calloc((size + 7) / 8, 1);
+	if (!cache.contents || !cache.valid) {
+		msg_gerr("Out of memory!\n");
+		cli_daemon_cache_release();
+		return 1;
+	}
+	return 0;
+}
+
+void cli_daemon_cache_release(void)
+{
+	free(cache.contents);
+	free(cache.valid);
+	memset(&cache, 0, sizeof(cache));
+}
+
+#if IS_WINDOWS
+int cli_daemon_serve(const char *path, struct flashctx *flash, cli_daemon_handler *handler)
+{
+	msg_gerr("Error: --daemon is not supported on this platform.\n");
+	return 1;
+}
+
+int cli_daemon_connect(const char *path, int argc, char *argv[], enum flashrom_log_level max_level)
+{
+	msg_gerr("Error: --connect is not supported on this platform.\n");
+	return 1;
+}
+#else
+
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+/*
+ * A request is a struct daemon_request followed by the working directory of
+ * the client and its arguments, each as a uint32_t length and the characters
+ * without a terminating NUL. The daemon answers with frames, a DAEMON_MSG
+ * for each message and a DAEMON_EXIT with the int32_t exit status at last.
+ */
+#define DAEMON_MAGIC		0x46524431	/* "FRD1" */
+#define DAEMON_MAX_ARGS		256
+#define DAEMON_MAX_STRING	PATH_MAX
+#define DAEMON_TIMEOUT_S	10
+
+struct daemon_request {
+	uint32_t magic;
+	int32_t max_level;
+	uint32_t argc;
+};
+
+enum daemon_frame_type {
+	DAEMON_MSG,
+	DAEMON_EXIT,
+};
+
+struct daemon_frame {
+	uint8_t type;
+	uint8_t level;
+	uint16_t reserved;
+	uint32_t len;
+};
+
+static int write_all(int fd, const void *buf, size_t len)
+{
+	const uint8_t *p = buf;
+
+	while (len) {
+		const ssize_t ret = write(fd, p, len);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			return 1;
+		p += ret;
+		len -= ret;
+	}
+	return 0;
+}
+
+static volatile sig_atomic_t stop_requested;
+
+static void stop_handler(int sig)
+{
+	stop_requested = 1;
+}
+
+/* Fails on a timeout of the socket, and if the daemon is told to stop while waiting. */
+static int read_all(int fd, void *buf, size_t len)
+{
+	uint8_t *p = buf;
+
+	while (len) {
+		const ssize_t ret = read(fd, p, len);
+		if (ret < 0 && errno == EINTR && !stop_requested)
+			continue;
+		if (ret <= 0)
+			return 1;
+		p += ret;
+		len -= ret;
+	}
+	return 0;
+}
+
+static int write_string(int fd, const char *str)
+{
+	const uint32_t len = strlen(str);
+
+	return write_all(fd, &len, sizeof(len)) || write_all(fd, str, len);
+}
+
+static char *read_string(int fd)
+{
+	uint32_t len;
+	char *str;
+
+	if (read_all(fd, &len, sizeof(len)) || len > DAEMON_MAX_STRING)
+		return NULL;
+	str = malloc(len + 1);
+	if (!str)
+		return NULL;
+	if (read_all(fd, str, len)) {
+		free(str);
+		return NULL;
+	}
+	str[len] = '\0';
+	return str;
+}
+
+static int write_frame(int fd, enum daemon_frame_type type, enum flashrom_log_level level,
+		       const void *payload, uint32_t len)
+{
+	const struct daemon_frame frame = { .type = type, .level = level, .len = len };
+
+	return write_all(fd, &frame, sizeof(frame)) || write_all(fd, payload, len);
+}
+
+static int unix_socket(const char *path, struct sockaddr_un *addr)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr->sun_path)) {
+		msg_gerr("Error: Socket path %s is too long.\n", path);
+		return -1;
+	}
+	strcpy(addr->sun_path, path);
+
+	const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		msg_gerr("Error: Creating a socket failed: %s\n", strerror(errno));
+		return -1;
+	}
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+	return fd;
+}
+
+/* The connection of the request being served, -1 if there's none or the client went away. */
+static int client_fd = -1;
+static enum flashrom_log_level client_level;
+
+static int daemon_log_cb(enum flashrom_log_level level, const char *fmt, va_list ap)
+{
+	char buf[1024];
+	char *msg = buf;
+	va_list args;
+	int len;
+
+	if (client_fd < 0 || level > client_level)
+		return 0;
+
+	va_copy(args, ap);
+	len = vsnprintf(buf, sizeof(buf), fmt, args);
+	va_end(args);
+	if (len < 0)
+		return len;
+	if ((size_t)len >= sizeof(buf)) {
+		msg = malloc(len + 1);
+		if (!msg)
+			return -1;
+		vsnprintf(msg, len + 1, fmt, ap);
+	}
+
+	/* A client which went away doesn't stop the operation, a chip half written would be worse. */
+	if (write_frame(client_fd, DAEMON_MSG, level, msg, len))
+		client_fd = -1;
+
+	if (msg != buf)
+		free(msg);
+	return len;
+}
+
+/*
+ * Signals stop the daemon, which interrupts waiting for clients and their
+ * requests. An operation on the chip isn't interrupted, the system calls
+ * of the programmer are restarted.
+ */
+static void restart_after_signals(bool restart)
+{
+	struct sigaction sa;
+
+	/* Only if the daemon is serving, and not for a request served on its own. */
+	if (sigaction(SIGINT, NULL, &sa) || sa.sa_handler != stop_handler)
+		return;
+	sa.sa_flags = restart ? SA_RESTART : 0;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+}
+
+void cli_daemon_serve_request(int fd, struct flashctx *flash, cli_daemon_handler *handler)
+{
+	struct daemon_request req;
+	char **argv = NULL;
+	char *cwd = NULL;
+	int32_t ret = 1;
+	uint32_t i, argc = 0;
+	int old_cwd = -1;
+
+	if (read_all(fd, &req, sizeof(req)) || req.magic != DAEMON_MAGIC ||
+	    req.argc == 0 || req.argc > DAEMON_MAX_ARGS) {
+		msg_gwarn("Ignoring a malformed or incomplete request.\n");
+		return;
+	}
+	cwd = read_string(fd);
+	argv = calloc(req.argc + 1, sizeof(*argv));
+	if (!cwd || !argv) {
+		msg_gwarn("Ignoring a malformed or incomplete request.\n");
+		goto out;
+	}
+	for (argc = 0; argc < req.argc; argc++) {
+		argv[argc] = read_string(fd);
+		if (!argv[argc]) {
+			msg_gwarn("Ignoring a malformed or incomplete request.\n");
+			goto out;
+		}
+	}
+
+	msg_gdbg("Serving a request:");
+	for (i = 0; i < argc; i++)
+		msg_gdbg(" %s", argv[i]);
+	msg_gdbg("\n");
+
+	client_fd = fd;
+	client_level = req.max_level;
+	flashrom_set_log_callback(daemon_log_cb);
+	restart_after_signals(true);
+
+	/* Relative paths are relative to the client. */
+	old_cwd = open(".", O_RDONLY);
+	if (old_cwd < 0 || chdir(cwd)) {
+		msg_gerr("Error: Can't change to the directory %s of the client: %s\n",
+			 cwd, strerror(errno));
+	} else {
+		ret = handler(flash, argc, argv);
+	}
+	if (old_cwd >= 0) {
+		if (fchdir(old_cwd))
+			msg_gwarn("Can't change back to the directory of the daemon: %s\n", strerror(errno));
+		close(old_cwd);
+	}
+
+	restart_after_signals(false);
+	flashrom_set_log_callback((flashrom_log_callback *)&flashrom_print_cb);
+	if (client_fd >= 0)
+		write_frame(client_fd, DAEMON_EXIT, FLASHROM_MSG_INFO, &ret, sizeof(ret));
+	else
+		msg_gwarn("The client went away before its request finished.\n");
+	client_fd = -1;
+	msg_ginfo("Request finished: %s\n", ret ? "FAILED" : "SUCCESS");
+out:
+	for (i = 0; i < argc; i++)
+		free(argv[i]);
+	free(argv);
+	free(cwd);
+}
+
+int cli_daemon_serve(const char *path, struct flashctx *flash, cli_daemon_handler *handler)
+{
+	/* Clients which stall can't hold up the daemon. */
+	const struct timeval timeout = { .tv_sec = DAEMON_TIMEOUT_S };
+	struct sigaction sa = { .sa_handler = stop_handler };
+	struct sigaction old_int, old_term, old_pipe;
+	struct sockaddr_un addr;
+	struct stat st;
+	int ret = 1;
+
+	const int fd = unix_socket(path, &addr);
+	if (fd < 0)
+		return 1;
+
+	/* Replace the socket of a daemon which is gone, but not that of a running one. */
+	if (!lstat(path, &st)) {
+		if (!S_ISSOCK(st.st_mode)) {
+			msg_gerr("Error: %s exists and is not a socket.\n", path);
+			close(fd);
+			return 1;
+		}
+		if (!connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+			msg_gerr("Error: Another daemon is serving on %s.\n", path);
+			close(fd);
+			return 1;
+		}
+		if (errno == ECONNREFUSED)
+			unlink(path);
+	}
+
+	/* Only the user running the daemon may connect. */
+	const mode_t old_umask = umask(0177);
+	const int bound = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+	umask(old_umask);
+	if (bound || listen(fd, 8)) {
+		msg_gerr("Error: Listening on %s failed: %s\n", path, strerror(errno));
+		close(fd);
+		return 1;
+	}
+
+	if (cli_daemon_cache_init(flashrom_flash_getsize(flash)))
+		goto out;
+
+	stop_requested = 0;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGINT, &sa, &old_int);
+	sigaction(SIGTERM, &sa, &old_term);
+	sa.sa_handler = SIG_IGN;
+	sigaction(SIGPIPE, &sa, &old_pipe);
+
+	msg_ginfo("Serving requests on %s.\n", path);
+	while (!stop_requested) {
+		struct pollfd pfd = { .fd = fd, .events = POLLIN };
+
+		if (poll(&pfd, 1, -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			msg_gerr("Error: Waiting for clients failed: %s\n", strerror(errno));
+			break;
+		}
+		const int client = accept(fd, NULL, NULL);
+		if (client < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			msg_gerr("Error: Accepting a client failed: %s\n", strerror(errno));
+			break;
+		}
+		fcntl(client, F_SETFD, FD_CLOEXEC);
+		setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+		cli_daemon_serve_request(client, flash, handler);
+		close(client);
+	}
+	if (stop_requested) {
+		msg_ginfo("Shutting down.\n");
+		ret = 0;
+	}
+
+	sigaction(SIGINT, &old_int, NULL);
+	sigaction(SIGTERM, &old_term, NULL);
+	sigaction(SIGPIPE, &old_pipe, NULL);
+	cli_daemon_cache_release();
+out:
+	close(fd);
+	unlink(path);
+	return ret;
+}
+
+int cli_daemon_send_request(int fd, int argc, char *argv[], enum flashrom_log_level max_level)
+{
+	const struct daemon_request req = { .magic = DAEMON_MAGIC, .max_level = max_level, .argc = argc };
+	char cwd[PATH_MAX];
+	int i;
+
+	if (!getcwd(cwd, sizeof(cwd))) {
+		msg_gerr("Error: Can't get the working directory: %s\n", strerror(errno));
+		return 1;
+	}
+	if (argc > DAEMON_MAX_ARGS) {
+		msg_gerr("Error: Too many arguments for the daemon.\n");
+		return 1;
+	}
+
+	bool failed = write_all(fd, &req, sizeof(req)) || write_string(fd, cwd);
+	for (i = 0; i < argc && !failed; i++)
+		failed = write_string(fd, argv[i]);
+	if (failed) {
+		msg_gerr("Error: Sending the request to the daemon failed.\n");
+		return 1;
+	}
+	return 0;
+}
+
+/* Prints the messages of the daemon, and returns the exit status of the request. */
+int cli_daemon_relay_answer(int fd)
+{
+	int32_t ret = 1;
+
+	/* The daemon serves one request at a time, so this waits for the requests before. */
+	while (true) {
+		struct daemon_frame frame;
+
+		if (read_all(fd, &frame, sizeof(frame))) {
+			msg_gerr("Error: The daemon closed the connection.\n");
+			return 1;
+		}
+		if (frame.type == DAEMON_EXIT && frame.len == sizeof(ret)) {
+			if (read_all(fd, &ret, sizeof(ret)))
+				return 1;
+			return ret;
+		}
+		if (frame.type != DAEMON_MSG || frame.len > DAEMON_MAX_STRING * 16) {
+			msg_gerr("Error: Unexpected answer from the daemon.\n");
+			return 1;
+		}
+
+		char *msg = malloc(frame.len + 1);
+		if (!msg || read_all(fd, msg, frame.len)) {
+			free(msg);
+			msg_gerr("Error: The daemon closed the connection.\n");
+			return 1;
+		}
+		msg[frame.len] = '\0';
+		print(frame.level, "%s", msg);
+		free(msg);
+	}
+}
+
+int cli_daemon_connect(const char *path, int argc, char *argv[], enum flashrom_log_level max_level)
+{
+	struct sockaddr_un addr;
+	int ret = 1;
+
+	const int fd = unix_socket(path, &addr);
+	if (fd < 0)
+		return 1;
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)))
+		msg_gerr("Error: Connecting to the daemon on %s failed: %s\n", path, strerror(errno));
+	else if (!cli_daemon_send_request(fd, argc, argv, max_level))
+		ret = cli_daemon_relay_answer(fd);
+	close(fd);
+	return ret;
+}
+#endif
@@ -72,6 +72,8 @@ static const char *flashrom_progress_stage_to_string(enum flashrom_progress_stag
 		return "WRITE";
 	if (stage == FLASHROM_PROGRESS_ERASE)
 		return "ERASE";
+	if (stage == FLASHROM_PROGRESS_VERIFY)
+		return "VERIFY";
 	return "UNKNOWN";
 }
 
@@ -85,7 +87,12 @@ void flashrom_progress_cb(struct flashrom_flashctx *flashctx)
 		     ((unsigned long long) progress_state->total * 100llu);
 	if (percentages[progress_state->stage] != pc) {
 		percentages[progress_state->stage] = pc;
-		msg_ginfo("[%s] %u%% complete... ", flashrom_progress_stage_to_string(progress_state->stage), pc);
+		msg_ginfo("[%s] %u%% complete", flashrom_progress_stage_to_string(progress_state->stage), pc);
+		if (progress_state->rate)
+			msg_ginfo(", %llu KiB/s", (unsigned long long)progress_state->rate / 1024);
+		if (progress_state->eta_ms && progress_state->eta_ms != UINT64_MAX)
+			msg_ginfo(", %llu s left", (unsigned long long)(progress_state->eta_ms + 999) / 1000);
+		msg_ginfo("... ");
 	}
 }
 
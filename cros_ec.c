@@ -52,9 +52,24 @@ struct cros_ec_priv *cros_ec_priv;
 /* For region larger use async version for FLASH_ERASE */
 #define FLASH_SMALL_REGION_THRESHOLD (16 * 1024)
 
+/* How long the last async erase took, in us per KiB. */
+static unsigned int erase_us_per_kib;
+
 /* 1 if we want the flashrom to call erase_and_write_flash() again. */
 static int need_2nd_pass = 0;
 
+/*
+ * Ranges denied during the 1st pass, i.e. the only ranges whose contents the
+ * 2nd pass doesn't know. Adjacent and overlapping ranges are merged, and once
+ * the table is full the last entry grows to cover any further range.
+ */
+#define MAX_DENIED_RANGES 16
+static struct {
+	unsigned int start;
+	unsigned int len;
+} denied_ranges[MAX_DENIED_RANGES];
+static size_t num_denied_ranges;
+
 /* 1 if EC firmware has RWSIG enabled. */
 static int rwsig_enabled = 0;
 
@@ -86,6 +101,41 @@ static struct ec_response_flash_region_info regions[EC_FLASH_REGION_COUNT];
  */
 #define EC_RWSIG_JUMP_TO_RW_DELAY 3000000
 
+static void cros_ec_record_denied_range(unsigned int addr, unsigned int len)
+{
+	size_t i;
+
+	for (i = 0; i < num_denied_ranges; i++) {
+		const unsigned int start = denied_ranges[i].start;
+		const unsigned int end = start + denied_ranges[i].len;
+
+		if ((addr <= end && addr + len >= start) || i == MAX_DENIED_RANGES - 1) {
+			denied_ranges[i].start = min(start, addr);
+			denied_ranges[i].len = max(end, addr + len) - denied_ranges[i].start;
+			return;
+		}
+	}
+
+	denied_ranges[num_denied_ranges].start = addr;
+	denied_ranges[num_denied_ranges].len = len;
+	num_denied_ranges++;
+}
+
+static void cros_ec_forget_denied_ranges(void)
+{
+	num_denied_ranges = 0;
+}
+
+int cros_ec_denied_range(size_t i, unsigned int *start, unsigned int *len)
+{
+	if (i >= num_denied_ranges)
+		return 1;
+
+	*start = denied_ranges[i].start;
+	*len = denied_ranges[i].len;
+	return 0;
+}
+
 /* Given the range not able to update, mark the corresponding
  * firmware as old.
  */
@@ -93,6 +143,8 @@ static void cros_ec_invalidate_copy(unsigned int addr, unsigned int len)
 {
 	unsigned i;
 
+	cros_ec_record_denied_range(addr, len);
+
 	for (i = EC_IMAGE_RO; i < ARRAY_SIZE(fwcopy); i++) {
 		struct fmap_area *fw = &fwcopy[i];
 		if ((addr >= fw->offset && (addr < fw->offset + fw->size)) ||
@@ -382,6 +434,8 @@ int cros_ec_prepare(struct flashctx *flash, uint8_t *image, int size)
 
 	if (!(cros_ec_priv && cros_ec_priv->detected)) return 0;
 
+	cros_ec_forget_denied_ranges();
+
 	if (ec_check_features(EC_FEATURE_RWSIG) > 0) {
 		rwsig_enabled = 1;
 		msg_pdbg("EC has RWSIG enabled.\n");
@@ -502,6 +556,8 @@ int cros_ec_finish(void)
 	if (!(cros_ec_priv && cros_ec_priv->detected))
           return 0;
 
+	cros_ec_forget_denied_ranges();
+
 	/* For EC with RWSIG enabled. We need a cold reboot to enable
 	 * EC_FLASH_PROTECT_ALL_NOW and make sure RWSIG check is performed.
 	 */
@@ -524,7 +580,6 @@ int cros_ec_read(struct flashctx *flash, uint8_t *readarr,
 	int rc = 0;
 	struct ec_params_flash_read p;
 	int maxlen = flash->mst->opaque.max_data_read;
-	uint8_t buf[maxlen];
 	unsigned offset = 0, count;
 
 	while (offset < readcnt) {
@@ -532,7 +587,7 @@ int cros_ec_read(struct flashctx *flash, uint8_t *readarr,
 		p.offset = blockaddr + offset;
 		p.size = count;
 		rc = cros_ec_priv->ec_command(EC_CMD_FLASH_READ,
-					0, &p, sizeof(p), buf, count);
+					0, &p, sizeof(p), readarr + offset, count);
 		if (rc < 0) {
 			msg_perr("CROS_EC: Flash read error at offset 0x%x\n",
 			         blockaddr + offset);
@@ -541,7 +596,6 @@ int cros_ec_read(struct flashctx *flash, uint8_t *readarr,
 			rc = EC_RES_SUCCESS;
 		}
 
-		memcpy(readarr + offset, buf, count);
 		offset += count;
 	}
 
@@ -581,6 +635,7 @@ int cros_ec_block_erase(struct flashctx *flash, unsigned int blockaddr,
 	struct ec_params_flash_erase_v1 erase;
 	uint32_t mask;
 	int rc, cmd_version, timeout=0;
+	unsigned int wait;
 
 	if (ec_check_features(EC_FEATURE_EXEC_IN_RAM) <= 0 &&
 			in_current_image(blockaddr, len)) {
@@ -646,12 +701,22 @@ int cros_ec_block_erase(struct flashctx *flash, unsigned int blockaddr,
 
 /* wait up to 10s to erase a flash sector */
 #define CROS_EC_ERASE_ASYNC_TIMEOUT 10000000
-/* wait .5 second between queries. */
-#define CROS_EC_ERASE_ASYNC_WAIT 500000
+/* bounds of the wait between queries, it doubles after every query. */
+#define CROS_EC_ERASE_ASYNC_WAIT_MIN 10000
+#define CROS_EC_ERASE_ASYNC_WAIT_MAX 500000
+
+	/*
+	 * The EC doesn't tell how long an erase takes, so start slightly below
+	 * what the previous erases took. Once the first query succeeds right
+	 * away, the estimate keeps shrinking until it's just too short.
+	 */
+	wait = (uint64_t)erase_us_per_kib * len / KiB * 3 / 4;
+	wait = min(max(wait, CROS_EC_ERASE_ASYNC_WAIT_MIN), CROS_EC_ERASE_ASYNC_TIMEOUT);
 
 	while (rc < 0 && timeout < CROS_EC_ERASE_ASYNC_TIMEOUT) {
-		usleep(CROS_EC_ERASE_ASYNC_WAIT);
-		timeout += CROS_EC_ERASE_ASYNC_WAIT;
+		usleep(wait);
+		timeout += wait;
+		wait = min(wait * 2, CROS_EC_ERASE_ASYNC_WAIT_MAX);
 		erase.cmd = FLASH_ERASE_GET_RESULT;
 		rc = cros_ec_priv->ec_command(EC_CMD_FLASH_ERASE, cmd_version,
 				&erase, sizeof(erase), NULL, 0);
@@ -661,6 +726,8 @@ int cros_ec_block_erase(struct flashctx *flash, unsigned int blockaddr,
 		         blockaddr, rc);
 		return rc;
 	}
+	erase_us_per_kib = (uint64_t)timeout * KiB / len;
+	msg_pspew("CROS_EC: Erased 0x%x bytes in about %d us\n", len, timeout);
 
 end_flash_erase:
 	if (rc > 0) {
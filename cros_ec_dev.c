@@ -390,29 +390,36 @@ static void cros_ec_set_max_size(struct cros_ec_priv *priv, struct opaque_master
 			      &info, sizeof(info));
 	msg_pdbg("%s: rc:%d\n", __func__, rc);
 
+	/* ECs which only speak protocol v2 don't know the command, keep the defaults. */
+	if (rc != sizeof(info))
+		return;
+
+	/* Allow overriding the max response size in case EC is incorrect */
+	if (priv->max_response_size)
+		info.max_response_packet_size = priv->max_response_size;
+
+	op->max_data_write = info.max_request_packet_size -
+		sizeof(struct ec_host_request);
+	op->max_data_read = info.max_response_packet_size -
+		sizeof(struct ec_host_response);
+
 	/*
-	 * Use V3 large size only if v2 protocol is not supported.
 	 * When v2 is supported, we may be using a kernel without v3 support,
-	 * leading to sending larger commands the kernel can support.
+	 * which can't pass on more than a v2 packet.
 	 */
-	if (rc == sizeof(info) && ((info.protocol_versions & (1<<2)) == 0)) {
-		/* Allow overriding the max response size in case EC is incorrect */
-		if (priv->max_response_size)
-			info.max_response_packet_size = priv->max_response_size;
-
-		op->max_data_write = info.max_request_packet_size -
-			sizeof(struct ec_host_request);
-		op->max_data_read = info.max_response_packet_size -
-			sizeof(struct ec_host_response);
-		/*
-		 * Due to a bug in NPCX SPI code (chromium:725580),
-		 * The EC may responds 163 when it meant 160; it should not
-		 * have included header and footer.
-		 */
-		op->max_data_read &= ~3;
-		msg_pdbg("%s: max_write:%d max_read:%d\n", __func__,
-			 op->max_data_write, op->max_data_read);
+	if (info.protocol_versions & (1<<2)) {
+		op->max_data_write = min(op->max_data_write, EC_PROTO2_MAX_PARAM_SIZE);
+		op->max_data_read = min(op->max_data_read, EC_PROTO2_MAX_PARAM_SIZE);
 	}
+
+	/*
+	 * Due to a bug in NPCX SPI code (chromium:725580),
+	 * The EC may responds 163 when it meant 160; it should not
+	 * have included header and footer.
+	 */
+	op->max_data_read &= ~3;
+	msg_pdbg("%s: max_write:%d max_read:%d\n", __func__,
+		 op->max_data_write, op->max_data_read);
 }
 
 /*
@@ -532,6 +539,8 @@ static struct cros_ec_priv cros_ec_dev_priv = {
 static struct opaque_master opaque_master_cros_ec_dev = {
 	.max_data_read	= 128,
 	.max_data_write	= 128,
+	/* Keep each erase well within the async erase timeout */
+	.max_data_erase	= 128 * KiB,
 	.probe		= cros_ec_probe_size,
 	.read		= cros_ec_read,
 	.write		= cros_ec_write,
@@ -26,6 +26,7 @@
 #include "chipdrivers.h"
 #include "programmer.h"
 #include "spi.h"
+#include "usb_device.h"
 
 /* LIBUSB_CALL ensures the right calling conventions on libusb callbacks.
  * However, the macro is not defined everywhere. m(
@@ -199,40 +200,6 @@ static enum protocol protocol(const struct dediprog_data *dp_data)
 	}
 }
 
-struct dediprog_transfer_status {
-	int error; /* OK if 0, ERROR else */
-	unsigned int queued_idx;
-	unsigned int finished_idx;
-};
-
-static void LIBUSB_CALL dediprog_bulk_read_cb(struct libusb_transfer *const transfer)
-{
-	struct dediprog_transfer_status *const status = (struct dediprog_transfer_status *)transfer->user_data;
-	if (transfer->status != LIBUSB_TRANSFER_COMPLETED) {
-		status->error = 1;
-		msg_perr("SPI bulk read failed!\n");
-	}
-	++status->finished_idx;
-}
-
-static int dediprog_bulk_read_poll(struct libusb_context *usb_ctx,
-				   const struct dediprog_transfer_status *const status,
-				   const int finish)
-{
-	if (status->finished_idx >= status->queued_idx)
-		return 0;
-
-	do {
-		struct timeval timeout = { 10, 0 };
-		const int ret = libusb_handle_events_timeout(usb_ctx, &timeout);
-		if (ret < 0) {
-			msg_perr("Polling read events failed: %i %s!\n", ret, libusb_error_name(ret));
-			return 1;
-		}
-	} while (finish && (status->finished_idx < status->queued_idx));
-	return 0;
-}
-
 static int dediprog_read(libusb_device_handle *dediprog_handle,
 			 enum dediprog_cmds cmd, unsigned int value, unsigned int idx,
 			 uint8_t *bytes, size_t size)
@@ -449,9 +416,7 @@ static int dediprog_spi_bulk_read(struct flashctx *flash, uint8_t *buf, unsigned
 	const unsigned int chunksize = 512;
 	const unsigned int count = len / chunksize;
 
-	struct dediprog_transfer_status status = { 0, 0, 0 };
-	struct libusb_transfer *transfers[DEDIPROG_ASYNC_TRANSFERS] = { NULL, };
-	struct libusb_transfer *transfer;
+	struct usb_async_queue *queue;
 
 	if (len == 0)
 		return 0;
@@ -488,56 +453,28 @@ static int dediprog_spi_bulk_read(struct flashctx *flash, uint8_t *buf, unsigned
 		return 1;
 	}
 
-	/*
-	 * Ring buffer of bulk transfers.
-	 * Poll until at least one transfer is ready,
-	 * schedule next transfers until buffer is full.
-	 */
+	/* Keep DEDIPROG_ASYNC_TRANSFERS chunks in flight while reaping them in order. */
+	queue = usb_async_queue_new(dp_data->usb_ctx, dp_data->handle, 0x80 | dp_data->in_endpoint,
+				    DEDIPROG_ASYNC_TRANSFERS, 0, DEFAULT_TIMEOUT);
+	if (!queue)
+		return 1;
 
-	/* Allocate bulk transfers. */
 	unsigned int i;
-	for (i = 0; i < MIN(DEDIPROG_ASYNC_TRANSFERS, count); ++i) {
-		transfers[i] = libusb_alloc_transfer(0);
-		if (!transfers[i]) {
-			msg_perr("Allocating libusb transfer %i failed: %s!\n", i, libusb_error_name(ret));
+	for (i = 0; i < count; ++i) {
+		if (usb_async_submit(queue, buf + i * chunksize, chunksize, false)) {
+			msg_perr("SPI bulk read of chunk %i failed!\n", i);
 			goto err_free;
 		}
 	}
-
-	/* Now transfer requested chunks using libusb's asynchronous interface. */
-	while (!status.error && (status.queued_idx < count)) {
-		while ((status.queued_idx < count) &&
-		       (status.queued_idx - status.finished_idx) < DEDIPROG_ASYNC_TRANSFERS)
-		{
-			transfer = transfers[status.queued_idx % DEDIPROG_ASYNC_TRANSFERS];
-			libusb_fill_bulk_transfer(transfer, dp_data->handle, 0x80 | dp_data->in_endpoint,
-					(unsigned char *)buf + status.queued_idx * chunksize, chunksize,
-					dediprog_bulk_read_cb, &status, DEFAULT_TIMEOUT);
-			transfer->flags |= LIBUSB_TRANSFER_SHORT_NOT_OK;
-			ret = libusb_submit_transfer(transfer);
-			if (ret < 0) {
-				msg_perr("Submitting SPI bulk read %i failed: %s!\n",
-					 status.queued_idx, libusb_error_name(ret));
-				goto err_free;
-			}
-			++status.queued_idx;
-		}
-		if (dediprog_bulk_read_poll(dp_data->usb_ctx, &status, 0))
-			goto err_free;
-	}
-	/* Wait for transfers to finish. */
-	if (dediprog_bulk_read_poll(dp_data->usb_ctx, &status, 1))
-		goto err_free;
-	/* Check if everything has been transmitted. */
-	if ((status.finished_idx < count) || status.error)
+	if (usb_async_wait_all(queue)) {
+		msg_perr("SPI bulk read failed!\n");
 		goto err_free;
+	}
 
 	err = 0;
 
 err_free:
-	dediprog_bulk_read_poll(dp_data->usb_ctx, &status, 1);
-	for (i = 0; i < DEDIPROG_ASYNC_TRANSFERS; ++i)
-		if (transfers[i]) libusb_free_transfer(transfers[i]);
+	usb_async_queue_free(queue);
 	return err;
 }
 
@@ -646,22 +583,39 @@ static int dediprog_spi_bulk_write(struct flashctx *flash, const uint8_t *buf, u
 		return 1;
 	}
 
+	/* The queue owns one 512 byte buffer per transfer in flight, so no transfer outlives its buffer. */
+	struct usb_async_queue *queue = usb_async_queue_new(dp_data->usb_ctx, dp_data->handle,
+							    dp_data->out_endpoint, DEDIPROG_ASYNC_TRANSFERS,
+							    512, DEFAULT_TIMEOUT);
+	if (!queue)
+		return 1;
+
 	unsigned int i;
+	int err = 1;
 	for (i = 0; i < count; i++) {
-		unsigned char usbbuf[512];
+		if (usb_async_pending(queue) == DEDIPROG_ASYNC_TRANSFERS && usb_async_wait(queue, NULL)) {
+			msg_perr("SPI bulk write failed!\n");
+			goto err_free;
+		}
+		unsigned char *usbbuf = usb_async_buffer(queue);
 		memcpy(usbbuf, buf + i * chunksize, chunksize);
-		memset(usbbuf + chunksize, 0xff, sizeof(usbbuf) - chunksize); // fill up with 0xFF
-		int transferred;
-		ret = libusb_bulk_transfer(dp_data->handle, dp_data->out_endpoint, usbbuf, 512, &transferred,
-					   DEFAULT_TIMEOUT);
-		if ((ret < 0) || (transferred != 512)) {
-			msg_perr("SPI bulk write failed, expected %i, got %s!\n", 512, libusb_error_name(ret));
-			return 1;
+		memset(usbbuf + chunksize, 0xff, 512 - chunksize); // fill up with 0xFF
+		if (usb_async_submit(queue, usbbuf, 512, false)) {
+			msg_perr("SPI bulk write of chunk %i failed!\n", i);
+			goto err_free;
 		}
 		update_progress(flash, FLASHROM_PROGRESS_WRITE, i + 1, count);
 	}
+	if (usb_async_wait_all(queue)) {
+		msg_perr("SPI bulk write failed!\n");
+		goto err_free;
+	}
 
-	return 0;
+	err = 0;
+
+err_free:
+	usb_async_queue_free(queue);
+	return err;
 }
 
 static int dediprog_spi_write(struct flashctx *flash, const uint8_t *buf,
@@ -19,6 +19,7 @@
 #include <stdio.h>
 #include <ctype.h>
 #include <errno.h>
+#include <limits.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include "flash.h"
@@ -39,6 +40,82 @@ enum emu_chip {
 	EMULATE_VARIABLE_SIZE,
 };
 
+/*
+ * Duration of a program, erase or status register write command of an
+ * emulated chip in microseconds, approximating the typical and maximum
+ * values of its datasheet.
+ */
+struct emu_op_timing {
+	uint8_t opcode;
+	unsigned int typ_us;
+	unsigned int max_us;
+};
+
+static const struct emu_op_timing m25p10_timing[] = {
+	{ JEDEC_WRSR,		5000,		15000 },
+	{ JEDEC_BYTE_PROGRAM,	1400,		5000 },
+	{ JEDEC_BE_D8,		650000,		3000000 },
+	{ JEDEC_CE_C7,		1000000,	3000000 },
+	{ 0 },
+};
+
+static const struct emu_op_timing sst25vf040_timing[] = {
+	{ JEDEC_BYTE_PROGRAM,	14,		20 },
+	{ JEDEC_SE,		18000,		25000 },
+	{ JEDEC_BE_52,		18000,		25000 },
+	{ JEDEC_CE_60,		70000,		100000 },
+	{ 0 },
+};
+
+static const struct emu_op_timing sst25vf032b_timing[] = {
+	{ JEDEC_BYTE_PROGRAM,	7,		10 },
+	{ JEDEC_AAI_WORD_PROGRAM, 7,		10 },
+	{ JEDEC_SE,		18000,		25000 },
+	{ JEDEC_BE_52,		18000,		25000 },
+	{ JEDEC_BE_D8,		18000,		25000 },
+	{ JEDEC_CE_60,		35000,		50000 },
+	{ JEDEC_CE_C7,		35000,		50000 },
+	{ 0 },
+};
+
+static const struct emu_op_timing mx25l6436_timing[] = {
+	{ JEDEC_WRSR,		40000,		100000 },
+	{ JEDEC_BYTE_PROGRAM,	1400,		5000 },
+	{ JEDEC_SE,		60000,		300000 },
+	{ JEDEC_BE_52,		500000,		2000000 },
+	{ JEDEC_BE_D8,		700000,		2000000 },
+	{ JEDEC_CE_60,		50000000,	80000000 },
+	{ JEDEC_CE_C7,		50000000,	80000000 },
+	{ 0 },
+};
+
+/* Also used for the VARIABLE_SIZE chip. */
+static const struct emu_op_timing w25q128fv_timing[] = {
+	{ JEDEC_WRSR,		10000,		15000 },
+	{ JEDEC_WRSR2,		10000,		15000 },
+	{ JEDEC_WRSR3,		10000,		15000 },
+	{ JEDEC_BYTE_PROGRAM,	700,		3000 },
+	{ JEDEC_SE,		45000,		400000 },
+	{ JEDEC_BE_52,		120000,		1600000 },
+	{ JEDEC_BE_D8,		150000,		2000000 },
+	{ JEDEC_CE_60,		40000000,	200000000 },
+	{ JEDEC_CE_C7,		40000000,	200000000 },
+	{ 0 },
+};
+
+static const struct emu_op_timing s25fl128l_timing[] = {
+	{ JEDEC_WRSR,		2000,		15000 },
+	{ JEDEC_WRSR2,		2000,		15000 },
+	{ JEDEC_WRSR3,		2000,		15000 },
+	{ JEDEC_BYTE_PROGRAM,	450,		1350 },
+	{ JEDEC_SE,		45000,		300000 },
+	{ JEDEC_BE_52,		150000,		600000 },
+	{ JEDEC_BE_D8,		250000,		1100000 },
+	{ JEDEC_CE_60,		55000000,	150000000 },
+	{ JEDEC_CE_C7,		55000000,	150000000 },
+	{ 0 },
+};
+
 struct emu_data {
 	enum emu_chip emu_chip;
 	char *emu_persistent_image;
@@ -53,8 +130,17 @@ struct emu_data {
 	uint8_t emu_status[3];
 	uint8_t emu_status_len;	/* number of emulated status registers */
 	/* If "freq" parameter is passed in from command line, commands will delay
-	 * for this period before returning. */
-	unsigned long int delay_us;
+	 * for the time their bytes take on the bus before returning. */
+	uint64_t byte_time_ns;
+	/* Added to every transaction, "latency" parameter. */
+	unsigned int latency_us;
+	/* Bus time below 1us not delayed yet. */
+	unsigned int delay_remainder_ns;
+	/* Program and erase durations, "timing" parameter. NULL if not emulated. */
+	const struct emu_op_timing *timing;
+	bool timing_max;
+	/* While WIP is set, the time at which the running operation finishes. */
+	uint64_t busy_until_us;
 	unsigned int emu_max_byteprogram_size;
 	unsigned int emu_max_aai_size;
 	unsigned int emu_jedec_se_size;
@@ -102,6 +188,49 @@ static const uint8_t sfdp_table[] = {
 	0xFF, 0xFF, 0xFF, 0xFF, // @0x54: Macronix parameter table end
 };
 
+/* Returns how long the emulated chip is busy after the command `opcode`. */
+static unsigned int emu_op_duration(const struct emu_data *data, uint8_t opcode)
+{
+	const struct emu_op_timing *op;
+
+	if (!data->timing)
+		return 0;
+
+	for (op = data->timing; op->typ_us; op++) {
+		if (op->opcode == opcode)
+			return data->timing_max ? op->max_us : op->typ_us;
+	}
+	return 0;
+}
+
+/* Returns whether the emulated chip is still busy, clearing WIP once it is done. */
+static bool emu_busy(struct emu_data *data)
+{
+	if (!(data->emu_status[0] & SPI_SR_WIP))
+		return false;
+
+	if (internal_clock_ns() / 1000 < data->busy_until_us)
+		return true;
+
+	data->emu_status[0] &= ~SPI_SR_WIP;
+	return false;
+}
+
+/* Long emulated operations are clamped to what programmer_delay() takes. */
+static void emu_delay(uint64_t us)
+{
+	programmer_delay(us > UINT_MAX ? UINT_MAX : us);
+}
+
+/* Spends the time a transaction of `bytes` bytes takes on the emulated link. */
+static void emu_transaction_delay(struct emu_data *data, unsigned int bytes)
+{
+	const uint64_t ns = (uint64_t)bytes * data->byte_time_ns + data->delay_remainder_ns;
+
+	data->delay_remainder_ns = ns % 1000;
+	emu_delay(ns / 1000 + data->latency_us);
+}
+
 static void *dummy_map(const char *descr, uintptr_t phys_addr, size_t len)
 {
 	msg_pspew("%s: Mapping %s, 0x%zx bytes at 0x%0*" PRIxPTR "\n",
@@ -171,19 +300,26 @@ static int probe_variable_size(struct flashctx *flash)
 
 static int dummy_opaque_read(struct flashctx *flash, uint8_t *buf, unsigned int start, unsigned int len)
 {
-	const struct emu_data *emu_data = flash->mst->opaque.data;
+	struct emu_data *emu_data = flash->mst->opaque.data;
 
 	memcpy(buf, emu_data->flashchip_contents + start, len);
+	emu_transaction_delay(emu_data, len);
 
 	return 0;
 }
 
+/*
+ * Opaque masters wait for the chip themselves, so the timing model is applied
+ * synchronously: 256 byte pages are programmed and 4 KiB sectors erased.
+ */
 static int dummy_opaque_write(struct flashctx *flash, const uint8_t *buf, unsigned int start, unsigned int len)
 {
 	struct emu_data *emu_data = flash->mst->opaque.data;
 
 	memcpy(emu_data->flashchip_contents + start, buf, len);
 	emu_data->emu_modified = 1;
+	emu_transaction_delay(emu_data, len);
+	emu_delay(((uint64_t)len + 255) / 256 * emu_op_duration(emu_data, JEDEC_BYTE_PROGRAM));
 
 	return 0;
 }
@@ -194,6 +330,8 @@ static int dummy_opaque_erase(struct flashctx *flash, unsigned int blockaddr, un
 
 	memset(emu_data->flashchip_contents + blockaddr, emu_data->erase_to_zero ? 0x00 : 0xff, blocklen);
 	emu_data->emu_modified = 1;
+	emu_transaction_delay(emu_data, 0);
+	emu_delay(((uint64_t)blocklen + 4 * KiB - 1) / (4 * KiB) * emu_op_duration(emu_data, JEDEC_SE));
 
 	return 0;
 }
@@ -393,6 +531,8 @@ static int emulate_spi_chip_response(unsigned int writecnt,
 	const unsigned char sst25vf032b_rems_response[2] = {0xbf, 0x4a};
 	const unsigned char mx25l6436_rems_response[2] = {0xc2, 0x16};
 	const unsigned char w25q128fv_rems_response[2] = {0xef, 0x17};
+	unsigned int busy_us;
+	bool wel;
 
 	if (writecnt == 0) {
 		msg_perr("No command sent to the chip!\n");
@@ -417,6 +557,14 @@ static int emulate_spi_chip_response(unsigned int writecnt,
 		}
 	}
 
+	/* A busy chip only answers status register reads. */
+	if (emu_busy(data) && writearr[0] != JEDEC_RDSR &&
+	    writearr[0] != JEDEC_RDSR2 && writearr[0] != JEDEC_RDSR3) {
+		msg_pdbg("Ignoring SPI command 0x%02x while the chip is busy\n", writearr[0]);
+		return 0;
+	}
+	wel = data->emu_status[0] & SPI_SR_WEL;
+
 	if (data->emu_max_aai_size && (data->emu_status[0] & SPI_SR_AAI)) {
 		if (writearr[0] != JEDEC_AAI_WORD_PROGRAM &&
 		    writearr[0] != JEDEC_WRDI &&
@@ -849,6 +997,14 @@ static int emulate_spi_chip_response(unsigned int writecnt,
 		/* No special response. */
 		break;
 	}
+
+	/* Program, erase and status register writes need WEL, AAI sequences keep it implicitly. */
+	busy_us = emu_op_duration(data, writearr[0]);
+	if (busy_us && (wel || (data->emu_status[0] & SPI_SR_AAI))) {
+		data->emu_status[0] |= SPI_SR_WIP;
+		data->busy_until_us = internal_clock_ns() / 1000 + busy_us;
+	}
+
 	if (writearr[0] != JEDEC_WREN && writearr[0] != JEDEC_EWSR)
 		data->emu_status[0] &= ~SPI_SR_WEL;
 	return 0;
@@ -896,7 +1052,7 @@ static int dummy_spi_send_command(const struct flashctx *flash, unsigned int wri
 		msg_pspew(" 0x%02x", readarr[i]);
 	msg_pspew("\n");
 
-	programmer_delay((writecnt + readcnt) * emu_data->delay_us);
+	emu_transaction_delay(emu_data, writecnt + readcnt);
 	return 0;
 }
 
@@ -942,6 +1098,7 @@ static const struct par_master par_master_dummyflasher = {
 };
 
 static const struct opaque_master opaque_master_dummyflasher = {
+	.max_data_erase	= MAX_DATA_ERASE_UNLIMITED,
 	.probe	= probe_variable_size,
 	.read	= dummy_opaque_read,
 	.write	= dummy_opaque_write,
@@ -956,6 +1113,7 @@ static int init_data(struct emu_data *data, enum chipbustype *dummy_buses_suppor
 	char *endptr;
 	char *status = NULL;
 	int size = -1;  /* size for VARIABLE_SIZE chip device */
+	const struct emu_op_timing *chip_timing = NULL;
 
 	bustext = extract_programmer_param_str("bus");
 	msg_pdbg("Requested buses are: %s\n", bustext ? bustext : "default");
@@ -1119,7 +1277,20 @@ static int init_data(struct emu_data *data, enum chipbustype *dummy_buses_suppor
 			return 1;
 		}
 		/* Assume we only work with bytes and transfer at 1 bit/Hz */
-		data->delay_us = (1000000 * 8) / freq;
+		data->byte_time_ns = 8000000000ULL / freq;
+	}
+	free(tmp);
+
+	/* Link latency per transaction in microseconds, e.g. of a USB programmer. */
+	tmp = extract_programmer_param_str("latency");
+	if (tmp) {
+		errno = 0;
+		data->latency_us = strtoul(tmp, &endptr, 0);
+		if (errno || *endptr != '\0' || endptr == tmp) {
+			msg_perr("%s: invalid latency \"%s\"\n", __func__, tmp);
+			free(tmp);
+			return 1;
+		}
 	}
 	free(tmp);
 
@@ -1163,6 +1334,7 @@ static int init_data(struct emu_data *data, enum chipbustype *dummy_buses_suppor
 
 	if (!strcmp(tmp, "M25P10.RES")) {
 		data->emu_chip = EMULATE_ST_M25P10_RES;
+		chip_timing = m25p10_timing;
 		data->emu_chip_size = 128 * 1024;
 		data->emu_max_byteprogram_size = 128;
 		data->emu_max_aai_size = 0;
@@ -1177,6 +1349,7 @@ static int init_data(struct emu_data *data, enum chipbustype *dummy_buses_suppor
 	}
 	if (!strcmp(tmp, "SST25VF040.REMS")) {
 		data->emu_chip = EMULATE_SST_SST25VF040_REMS;
+		chip_timing = sst25vf040_timing;
 		data->emu_chip_size = 512 * 1024;
 		data->emu_max_byteprogram_size = 1;
 		data->emu_max_aai_size = 0;
@@ -1191,6 +1364,7 @@ static int init_data(struct emu_data *data, enum chipbustype *dummy_buses_suppor
 	}
 	if (!strcmp(tmp, "SST25VF032B")) {
 		data->emu_chip = EMULATE_SST_SST25VF032B;
+		chip_timing = sst25vf032b_timing;
 		data->emu_chip_size = 4 * 1024 * 1024;
 		data->emu_max_byteprogram_size = 1;
 		data->emu_max_aai_size = 2;
@@ -1205,6 +1379,7 @@ static int init_data(struct emu_data *data, enum chipbustype *dummy_buses_suppor
 	}
 	if (!strcmp(tmp, "MX25L6436")) {
 		data->emu_chip = EMULATE_MACRONIX_MX25L6436;
+		chip_timing = mx25l6436_timing;
 		data->emu_chip_size = 8 * 1024 * 1024;
 		data->emu_max_byteprogram_size = 256;
 		data->emu_max_aai_size = 0;
@@ -1219,6 +1394,7 @@ static int init_data(struct emu_data *data, enum chipbustype *dummy_buses_suppor
 	}
 	if (!strcmp(tmp, "W25Q128FV")) {
 		data->emu_chip = EMULATE_WINBOND_W25Q128FV;
+		chip_timing = w25q128fv_timing;
 		data->emu_wrsr_ext2 = true;
 		data->emu_chip_size = 16 * 1024 * 1024;
 		data->emu_max_byteprogram_size = 256;
@@ -1233,6 +1409,7 @@ static int init_data(struct emu_data *data, enum chipbustype *dummy_buses_suppor
 	}
 	if (!strcmp(tmp, "S25FL128L")) {
 		data->emu_chip = EMULATE_SPANSION_S25FL128L;
+		chip_timing = s25fl128l_timing;
 		data->emu_wrsr_ext2 = true;
 		data->emu_wrsr_ext3 = true;
 		data->emu_chip_size = 16 * 1024 * 1024;
@@ -1257,6 +1434,7 @@ static int init_data(struct emu_data *data, enum chipbustype *dummy_buses_suppor
 			return 1;
 		}
 		data->emu_chip = EMULATE_VARIABLE_SIZE;
+		chip_timing = w25q128fv_timing;
 		data->emu_chip_size = size;
 		msg_pdbg("Emulating generic SPI flash chip (size=%d bytes)\n",
 		         data->emu_chip_size);
@@ -1273,6 +1451,23 @@ static int init_data(struct emu_data *data, enum chipbustype *dummy_buses_suppor
 	}
 	free(tmp);
 
+	/* Emulate program and erase durations (typ/max)? */
+	tmp = extract_programmer_param_str("timing");
+	if (tmp) {
+		if (!strcmp(tmp, "typ")) {
+			msg_pdbg("Emulating typical program and erase durations\n");
+		} else if (!strcmp(tmp, "max")) {
+			msg_pdbg("Emulating maximum program and erase durations\n");
+			data->timing_max = true;
+		} else {
+			msg_perr("timing can be \"typ\" or \"max\"\n");
+			free(tmp);
+			return 1;
+		}
+		data->timing = chip_timing;
+	}
+	free(tmp);
+
 	/* Should emulated flash erase to zero (yes/no)? */
 	tmp = extract_programmer_param_str("erase_to_zero");
 	if (tmp) {
@@ -1348,7 +1543,6 @@ static int dummy_init(void)
 		return 1;
 	}
 	data->emu_chip = EMULATE_NONE;
-	data->delay_us = 0;
 	data->spi_write_256_chunksize = 256;
 
 	msg_pspew("%s\n", __func__);
@@ -505,8 +505,8 @@ static int need_erase_gran_bytes(const uint8_t *have, const uint8_t *want, unsig
  * @gran	write granularity (enum, not count)
  * @return      0 if no erase is needed, 1 otherwise
  */
-static int need_erase(const uint8_t *have, const uint8_t *want, unsigned int len,
-               enum write_granularity gran, const uint8_t erased_value)
+int need_erase(const uint8_t *have, const uint8_t *want, unsigned int len,
+	       enum write_granularity gran, const uint8_t erased_value)
 {
 	int result = 0;
 	unsigned int i;
@@ -581,9 +581,9 @@ static int need_erase(const uint8_t *have, const uint8_t *want, unsigned int len
  * in relation to the max write length of the programmer and the max write
  * length of the chip.
  */
-static unsigned int get_next_write(const uint8_t *have, const uint8_t *want, unsigned int len,
-			  unsigned int *first_start,
-			  enum write_granularity gran)
+unsigned int get_next_write(const uint8_t *have, const uint8_t *want, unsigned int len,
+			    unsigned int *first_start,
+			    enum write_granularity gran)
 {
 	int need_write = 0;
 	unsigned int rel_start = 0, first_len = 0;
@@ -985,7 +985,9 @@ static int read_flash(struct flashctx *flash, uint8_t *buf,
 
 	msg_cdbg("%#06x-%#06x:R ", start, start + len - 1);
 
+	progress_call_begin(flash, FLASHROM_PROGRESS_READ, len);
 	ret = flash->chip->read(flash, buf, start, len);
+	progress_call_end(flash);
 	if (ret) {
 		if (ret == SPI_ACCESS_DENIED) {
 			msg_gdbg("ignoring error when reading 0x%x-0x%x\n",
@@ -1017,7 +1019,10 @@ static int write_flash(struct flashctx *flash, const uint8_t *buf,
 	if (!flash || !flash->chip->write)
 		return -1;
 
-	return flash->chip->write(flash, buf, start, len);
+	progress_call_begin(flash, FLASHROM_PROGRESS_WRITE, len);
+	const int ret = flash->chip->write(flash, buf, start, len);
+	progress_call_end(flash);
+	return ret;
 }
 
 /*
@@ -1078,17 +1083,32 @@ static int round_to_erasable_block_boundary(const int required_erase_size,
 	if (len_align)
 		*rounded_len = *rounded_len + required_erase_size - len_align;
 
-	if (start_align || len_align) {
-		msg_gdbg("\n%s: Re-aligned partial read due to eraseable "
-			 "block size requirement:\n\tstart: 0x%06x, "
-			 "len: 0x%06x, aligned start: 0x%06x, len: 0x%06x\n",
-			 __func__, entry->start, entry->end - entry->start + 1,
-			 *rounded_start, *rounded_len);
-	}
-
 	return 0;
 }
 
+/*
+ * Plans the bytes read_by_layout() or verify_by_layout() will access in the
+ * progress totals of the running image operation.
+ */
+static void progress_plan_layout(struct flashctx *const flashctx, const struct flashrom_layout *const layout,
+				 enum flashrom_progress_stage stage, bool align_to_erasable_block_boundary)
+{
+	const struct romentry *entry = NULL;
+	const int required_erase_size =
+		align_to_erasable_block_boundary ? get_required_erase_size(flashctx) : 0;
+
+	while ((entry = layout_next_included(layout, entry))) {
+		chipoff_t region_start	= entry->start;
+		chipsize_t region_len	= entry->end - entry->start + 1;
+
+		if (align_to_erasable_block_boundary &&
+		    round_to_erasable_block_boundary(required_erase_size, entry,
+						     &region_start, &region_len))
+			return;
+		progress_add_total(flashctx, stage, region_len);
+	}
+}
+
 /**
  * @brief Reads the included layout regions into a buffer.
  *
@@ -1097,15 +1117,19 @@ static int round_to_erasable_block_boundary(const int required_erase_size,
  *
  * @param flashctx Flash context to be used.
  * @param buffer   Buffer of full chip size to read into.
+ * @param phase    Phase to account the read to in the statistics.
  * @return 0 on success,
  *	   1 if any read fails.
  */
 static int read_by_layout(struct flashctx *const flashctx, uint8_t *const buffer,
-			  bool align_to_erasable_block_boundary)
+			  bool align_to_erasable_block_boundary, enum flashrom_stats_phase phase)
 {
 	const struct flashrom_layout *const layout = get_layout(flashctx);
 	const struct romentry *entry = NULL;
 	int required_erase_size = get_required_erase_size(flashctx);
+	const uint64_t phase_start = stats_phase_start(flashctx);
+	unsigned int bytes = 0;
+	int ret = 0;
 
 	while ((entry = layout_next_included(layout, entry))) {
 		chipoff_t region_start	= entry->start;
@@ -1113,12 +1137,25 @@ static int read_by_layout(struct flashctx *const flashctx, uint8_t *const buffer
 
 		if (align_to_erasable_block_boundary &&
 		    round_to_erasable_block_boundary(required_erase_size, entry,
-						     &region_start, &region_len))
-			return 1;
-		if (read_flash(flashctx, buffer + region_start, region_start, region_len))
-			return 1;
+						     &region_start, &region_len)) {
+			ret = 1;
+			break;
+		}
+		if (region_start != entry->start || region_len != entry->end - entry->start + 1) {
+			msg_gdbg("\n%s: Re-aligned partial read due to eraseable "
+				 "block size requirement:\n\tstart: 0x%06x, "
+				 "len: 0x%06x, aligned start: 0x%06x, len: 0x%06x\n",
+				 __func__, entry->start, entry->end - entry->start + 1,
+				 region_start, region_len);
+		}
+		if (read_flash(flashctx, buffer + region_start, region_start, region_len)) {
+			ret = 1;
+			break;
+		}
+		bytes += region_len;
 	}
-	return 0;
+	stats_phase_end(flashctx, phase, phase_start, bytes);
+	return ret;
 }
 
 /* Even if an error is found, the function will keep going and check the rest. */
@@ -1217,9 +1254,113 @@ struct walk_info {
 	const uint8_t *newcontents;
 	chipoff_t erase_start;
 	chipoff_t erase_end;
+	unsigned int block_eraser_index;
 };
 typedef int (*per_blockfn_t)(struct flashctx *, const struct walk_info *, erasefn_t);
 
+/*
+ * Hands the range [base, base + len) to per_blockfn as a single unit.
+ */
+static int walk_range(struct flashctx *flash, const per_blockfn_t per_blockfn,
+		      struct action_descriptor *descriptor, unsigned int block_eraser_index,
+		      unsigned int base, unsigned int len)
+{
+	static int print_comma;
+
+	if (print_comma)
+		msg_cdbg(", ");
+	else
+		print_comma = 1;
+
+	msg_cdbg("0x%06x-0x%06x", base, base + len - 1);
+
+	struct walk_info info = {
+		.curcontents = (uint8_t *)descriptor->oldcontents + base,
+		.newcontents = (uint8_t *)descriptor->newcontents + base,
+		.erase_start = base,
+		.erase_end   = base + len - 1,
+		.block_eraser_index = block_eraser_index,
+	};
+	return per_blockfn(flash, &info, flash->chip->block_erasers[block_eraser_index].block_erase);
+}
+
+/*
+ * Returns the index of the eraser with the smallest blocks which tile the block
+ * at base with smaller ones, or -1 if there is none.
+ */
+static int find_smaller_eraser(const struct flashctx *flash, unsigned int base, unsigned int len,
+			       unsigned int *block_size)
+{
+	int k, found = -1;
+
+	for (k = 0; k < NUM_ERASEFUNCTIONS; k++) {
+		const struct block_eraser *const eraser = &flash->chip->block_erasers[k];
+		unsigned int addr = 0;
+		int j;
+
+		if (check_block_eraser(flash, k, 0))
+			continue;
+		for (j = 0; j < NUM_ERASEREGIONS && eraser->eraseblocks[j].count; j++) {
+			const unsigned int size = eraser->eraseblocks[j].size;
+			const unsigned int end = addr + size * eraser->eraseblocks[j].count;
+
+			if (base >= addr && base + len <= end && size < len && (base - addr) % size == 0 &&
+			    len % size == 0 && (found < 0 || size < *block_size)) {
+				found = k;
+				*block_size = size;
+			}
+			addr = end;
+		}
+	}
+	return found;
+}
+
+/*
+ * A block which is denied as a whole, e.g. because it spans flash regions with
+ * different permissions, is processed again in the smallest blocks another
+ * eraser has, so that only the denied parts of it are skipped.
+ */
+static int walk_smaller_blocks(struct flashctx *flash, const per_blockfn_t per_blockfn,
+			       struct action_descriptor *descriptor, unsigned int base, unsigned int len)
+{
+	unsigned int block_size = 0, off;
+	const int k = find_smaller_eraser(flash, base, len, &block_size);
+	int rc = SPI_ACCESS_DENIED;
+
+	if (k < 0)
+		return rc;
+
+	for (off = base; off < base + len; off += block_size) {
+		rc = walk_range(flash, per_blockfn, descriptor, k, off, block_size);
+		if (rc && rc != SPI_ACCESS_DENIED)
+			return rc;
+	}
+	return rc;
+}
+
+/*
+ * Returns the length of the run of blocks starting at base that can be
+ * processed in one go: adjacent blocks which either all need an erase or all
+ * don't, at most max_len bytes long. The run always covers at least one block.
+ */
+static unsigned int coalesce_blocks(const struct flashctx *flash,
+				    const struct action_descriptor *descriptor,
+				    unsigned int base, unsigned int top,
+				    unsigned int block_size, unsigned int max_len)
+{
+	const uint8_t *const have = descriptor->oldcontents;
+	const uint8_t *const want = descriptor->newcontents;
+	const enum write_granularity gran = flash->chip->gran;
+	const int first = need_erase(have + base, want + base, block_size, gran, 0xff);
+	unsigned int len = block_size;
+
+	while (base + len < top && len + block_size <= max_len &&
+	       need_erase(have + base + len, want + base + len, block_size, gran, 0xff) == first)
+		len += block_size;
+
+	return len;
+}
+
 /*
  * Function to process processing units accumulated in the action descriptor.
  *
@@ -1233,6 +1374,9 @@ typedef int (*per_blockfn_t)(struct flashctx *, const struct walk_info *, erasef
  * @descriptor    action descriptor including pointers to before and after
  *		  contents and an array of processing actions to take.
  *
+ * Opaque masters which set max_data_erase get runs of adjacent blocks in a
+ * single call, see coalesce_blocks().
+ *
  * Returns zero on success or an error code.
  */
 static int walk_eraseregions(struct flashctx *flash,
@@ -1240,30 +1384,36 @@ static int walk_eraseregions(struct flashctx *flash,
 			     struct action_descriptor *descriptor)
 {
 	struct processing_unit *pu;
+	const unsigned int max_len = (flash->mst->buses_supported & BUS_PROG) ?
+				     flash->mst->opaque.max_data_erase : 0;
 	int rc = 0;
-	static int print_comma;
 
 	for (pu = descriptor->processing_units; pu->num_blocks; pu++) {
 		unsigned base = pu->offset;
 		unsigned top = pu->offset + pu->block_size * pu->num_blocks;
-		struct block_eraser *const eraser = &flash->chip->block_erasers[pu->block_eraser_index];
 
 		while (base < top) {
-
-			if (print_comma)
-				msg_cdbg(", ");
-			else
-				print_comma = 1;
-
-			msg_cdbg("0x%06x-0x%06zx", base, base + pu->block_size - 1);
-
-			struct walk_info info = {
-				.curcontents = descriptor->oldcontents + base,
-				.newcontents = descriptor->newcontents + base,
-				.erase_start = base,
-				.erase_end   = base + pu->block_size - 1,
-			};
-			rc = per_blockfn(flash, &info, eraser->block_erase);
+			const unsigned int len = coalesce_blocks(flash, descriptor, base, top,
+								 pu->block_size, max_len);
+
+			rc = walk_range(flash, per_blockfn, descriptor, pu->block_eraser_index, base, len);
+
+			/* Retry block by block, so that only the denied blocks are skipped. */
+			if (rc == SPI_ACCESS_DENIED && len > pu->block_size) {
+				unsigned int off;
+
+				for (off = base; off < base + len; off += pu->block_size) {
+					rc = walk_range(flash, per_blockfn, descriptor,
+							pu->block_eraser_index, off, pu->block_size);
+					if (rc == SPI_ACCESS_DENIED)
+						rc = walk_smaller_blocks(flash, per_blockfn, descriptor,
+									 off, pu->block_size);
+					if (rc && rc != SPI_ACCESS_DENIED)
+						return rc;
+				}
+			} else if (rc == SPI_ACCESS_DENIED) {
+				rc = walk_smaller_blocks(flash, per_blockfn, descriptor, base, len);
+			}
 
 			if (rc) {
 				if (rc == SPI_ACCESS_DENIED)
@@ -1271,7 +1421,7 @@ static int walk_eraseregions(struct flashctx *flash,
 				else
 					return rc;
 			}
-			base += pu->block_size;
+			base += len;
 		}
 	}
 	msg_cdbg("\n");
@@ -1292,7 +1442,12 @@ static int erase_and_write_block_helper(struct flashctx *const flash,
 	if (need_erase(info->curcontents, info->newcontents, erase_len, gran, 0xff)) {
 		all_skipped = false;
 		msg_cdbg(" E");
+		const uint64_t erase_phase_start = stats_phase_start(flash);
+		progress_call_begin(flash, FLASHROM_PROGRESS_ERASE, erase_len);
 		ret = erasefn(flash, info->erase_start, erase_len);
+		progress_call_end(flash);
+		stats_phase_end(flash, FLASHROM_STATS_PHASE_ERASE, erase_phase_start, erase_len);
+		stats_eraser_used(flash, info->block_eraser_index, erase_len);
 		if (ret) {
 			if (ret == SPI_ACCESS_DENIED)
 				msg_cdbg(" DENIED");
@@ -1321,8 +1476,10 @@ static int erase_and_write_block_helper(struct flashctx *const flash,
 		if (!writecount++)
 			msg_cdbg(" W");
 		/* Needs the partial write function signature. */
+		const uint64_t write_phase_start = stats_phase_start(flash);
 		ret = write_flash(flash, (uint8_t *)info->newcontents + starthere,
 				   info->erase_start + starthere, lenhere);
+		stats_phase_end(flash, FLASHROM_STATS_PHASE_WRITE, write_phase_start, lenhere);
 		if (ret) {
 			if (ret == SPI_ACCESS_DENIED)
 				msg_cdbg(" DENIED");
@@ -1350,12 +1507,55 @@ static int erase_and_write_block_helper(struct flashctx *const flash,
 	return ret;
 }
 
+/*
+ * Plans the bytes erase_and_write_block_helper() will erase and write in the
+ * progress totals of the running image operation.
+ */
+static void progress_plan_erase_write(struct flashctx *flash,
+				      const struct action_descriptor *descriptor)
+{
+	const uint8_t *const have = descriptor->oldcontents;
+	const uint8_t *const want = descriptor->newcontents;
+	const enum write_granularity gran = flash->chip->gran;
+	const struct processing_unit *pu;
+	size_t erase_bytes = 0, write_bytes = 0;
+
+	if (flash->progress_callback == NULL)
+		return;
+
+	for (pu = descriptor->processing_units; pu->num_blocks; pu++) {
+		const size_t top = pu->offset + pu->block_size * pu->num_blocks;
+		size_t base, i;
+
+		for (base = pu->offset; base < top; base += pu->block_size) {
+			unsigned int start = 0, len;
+
+			if (need_erase(have + base, want + base, pu->block_size, gran, 0xff)) {
+				erase_bytes += pu->block_size;
+				for (i = base; i < base + pu->block_size; i++)
+					write_bytes += want[i] != ERASED_VALUE(flash);
+				continue;
+			}
+			while ((len = get_next_write(have + base + start, want + base + start,
+						     pu->block_size - start, &start, gran))) {
+				write_bytes += len;
+				start += len;
+			}
+		}
+	}
+	progress_add_total(flash, FLASHROM_PROGRESS_ERASE, erase_bytes);
+	progress_add_total(flash, FLASHROM_PROGRESS_WRITE, write_bytes);
+}
+
 static int erase_and_write_flash(struct flashctx *flash,
 				 void *const curcontents, void *const newcontents)
 {
 	int ret = 1;
+	const uint64_t planning_start = stats_phase_start(flash);
 	struct action_descriptor *descriptor =
 		prepare_action_descriptor(flash, curcontents, newcontents);
+	stats_phase_end(flash, FLASHROM_STATS_PHASE_PLANNING, planning_start, 0);
+	progress_plan_erase_write(flash, descriptor);
 
 	msg_cinfo("Erasing and writing flash chip... ");
 
@@ -1391,16 +1591,26 @@ static int verify_by_layout(
 		void *const curcontents, const uint8_t *const newcontents)
 {
 	const struct romentry *entry = NULL;
+	const uint64_t phase_start = stats_phase_start(flashctx);
+	unsigned int bytes = 0;
 	int ret = 0;
 
 	while ((entry = layout_next_included(layout, entry))) {
 		const chipoff_t region_start	= entry->start;
 		const chipsize_t region_len	= entry->end - entry->start + 1;
 
-		if ((ret = verify_range(flashctx, newcontents + region_start,
-					region_start, region_len)))
+		/*
+		 * Only this is planned as VERIFY work. verify_range() also checks erases
+		 * and writes of paranoid programmers, which belong to those stages.
+		 */
+		progress_call_begin(flashctx, FLASHROM_PROGRESS_VERIFY, region_len);
+		ret = verify_range(flashctx, newcontents + region_start, region_start, region_len);
+		progress_call_end(flashctx);
+		if (ret)
 			break;
+		bytes += region_len;
 	}
+	stats_phase_end(flashctx, FLASHROM_STATS_PHASE_VERIFY, phase_start, bytes);
 
 	if (ret) {
 		msg_gdbg("Could not fully verify due to error, ");
@@ -1831,14 +2041,22 @@ static int setup_curcontents(struct flashctx *flashctx, void *curcontents,
 		 * takes time as well.
 		 */
 		msg_cinfo("Reading old flash chip contents... ");
+		if (verify_all)
+			progress_add_total(flashctx, FLASHROM_PROGRESS_READ, flash_size);
+		else
+			progress_plan_layout(flashctx, get_layout(flashctx), FLASHROM_PROGRESS_READ, true);
 		if (verify_all) {
-			if (read_flash(flashctx, curcontents, 0, flash_size)) {
+			const uint64_t phase_start = stats_phase_start(flashctx);
+			const int ret = read_flash(flashctx, curcontents, 0, flash_size);
+			stats_phase_end(flashctx, FLASHROM_STATS_PHASE_PRE_READ, phase_start,
+					ret ? 0 : flash_size);
+			if (ret) {
 				msg_cinfo("FAILED.\n");
 				return 1;
 			}
 		} else {
 			/* WARNING: See FIXME on get_required_erase_size() */
-			if (read_by_layout(flashctx, curcontents, true)) {
+			if (read_by_layout(flashctx, curcontents, true, FLASHROM_STATS_PHASE_PRE_READ)) {
 				msg_cinfo("FAILED.\n");
 				return 1;
 			}
@@ -1851,6 +2069,32 @@ static int setup_curcontents(struct flashctx *flashctx, void *curcontents,
 static void combine_image_by_layout(const struct flashctx *const flashctx,
 				    uint8_t *const newcontents, const uint8_t *const oldcontents);
 
+/*
+ * Everything that was not denied during the 1st pass now holds the new
+ * contents, so only the denied ranges have to be read back.
+ */
+static int setup_curcontents_2nd_pass(struct flashctx *flashctx, void *curcontents,
+				      const void *newcontents)
+{
+	const size_t flash_size = flashctx->chip->total_size * 1024;
+	unsigned int start, len;
+	size_t i;
+
+	memcpy(curcontents, newcontents, flash_size);
+
+	msg_cinfo("Reading flash chip contents denied in the 1st pass... ");
+	for (i = 0; !cros_ec_denied_range(i, &start, &len); i++) {
+		const uint64_t phase_start = stats_phase_start(flashctx);
+		if (read_flash(flashctx, (uint8_t *)curcontents + start, start, len)) {
+			msg_cinfo("FAILED.\n");
+			return 1;
+		}
+		stats_phase_end(flashctx, FLASHROM_STATS_PHASE_PRE_READ, phase_start, len);
+	}
+	msg_cinfo("done.\n");
+	return 0;
+}
+
 int flashrom_flash_erase(struct flashctx *const flashctx)
 {
 	const size_t flash_size = flashctx->chip->total_size * 1024;
@@ -1866,6 +2110,7 @@ int flashrom_flash_erase(struct flashctx *const flashctx)
 
 	if (prepare_flash_access(flashctx, false, false, true, false))
 		goto _free_ret;
+	progress_start(flashctx);
 
 	if (setup_curcontents(flashctx, curcontents, true, NULL))
 		goto _finalize_ret;
@@ -1876,6 +2121,7 @@ int flashrom_flash_erase(struct flashctx *const flashctx)
 	ret = erase_and_write_flash(flashctx, curcontents, newcontents);
 
 _finalize_ret:
+	progress_finish(flashctx);
 	finalize_flash_access(flashctx);
 _free_ret:
 	free(curcontents);
@@ -1892,11 +2138,13 @@ int flashrom_image_read(struct flashctx *const flashctx, void *const buffer, con
 
 	if (prepare_flash_access(flashctx, true, false, false, false))
 		return 1;
+	progress_start(flashctx);
+	progress_plan_layout(flashctx, get_layout(flashctx), FLASHROM_PROGRESS_READ, false);
 
 	msg_cinfo("Reading flash... ");
 
 	int ret = 1;
-	if (read_by_layout(flashctx, buffer, false)) {
+	if (read_by_layout(flashctx, buffer, false, FLASHROM_STATS_PHASE_READ)) {
 		msg_cerr("Read operation failed!\n");
 		msg_cinfo("FAILED.\n");
 		goto _finalize_ret;
@@ -1905,6 +2153,7 @@ int flashrom_image_read(struct flashctx *const flashctx, void *const buffer, con
 	ret = 0;
 
 _finalize_ret:
+	progress_finish(flashctx);
 	finalize_flash_access(flashctx);
 	return ret;
 }
@@ -1971,6 +2220,9 @@ int flashrom_image_write(struct flashctx *const flashctx, void *const buffer, co
 
 	if (prepare_flash_access(flashctx, false, true, false, verify))
 		goto _free_ret;
+	progress_start(flashctx);
+	if (verify)
+		progress_plan_layout(flashctx, verify_layout, FLASHROM_PROGRESS_VERIFY, false);
 
 	if (setup_curcontents(flashctx, curcontents, false, refbuffer))
 		goto _finalize_ret;
@@ -2017,7 +2269,7 @@ int flashrom_image_write(struct flashctx *const flashctx, void *const buffer, co
 	} else if (tmp > 0) {
 		// Need 2nd pass. Get the just written content.
 		msg_pdbg("CROS_EC needs 2nd pass.\n");
-		if (setup_curcontents(flashctx, curcontents, false, NULL)) {
+		if (setup_curcontents_2nd_pass(flashctx, curcontents, newcontents)) {
 			emergency_help_message();
 			goto _finalize_ret;
 		}
@@ -2058,6 +2310,7 @@ int flashrom_image_write(struct flashctx *const flashctx, void *const buffer, co
 	}
 
 _finalize_ret:
+	progress_finish(flashctx);
 	finalize_flash_access(flashctx);
 _free_ret:
 	free(oldcontents);
@@ -2085,12 +2338,15 @@ int flashrom_image_verify(struct flashctx *const flashctx, const void *const buf
 
 	if (prepare_flash_access(flashctx, false, false, false, true))
 		goto _free_ret;
+	progress_start(flashctx);
+	progress_plan_layout(flashctx, layout, FLASHROM_PROGRESS_VERIFY, false);
 
 	msg_cinfo("Verifying flash... ");
 	ret = verify_by_layout(flashctx, layout, curcontents, newcontents);
 	if (!ret)
 		msg_cinfo("VERIFIED.\n");
 
+	progress_finish(flashctx);
 	finalize_flash_access(flashctx);
 _free_ret:
 	free(curcontents);
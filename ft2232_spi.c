@@ -20,6 +20,7 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include "flash.h"
+#include "chipdrivers.h"
 #include "programmer.h"
 #include "spi.h"
 #include <ftdi.h>
@@ -119,6 +120,7 @@ struct ft2232_data {
 	uint8_t cs_bits;
 	uint8_t aux_bits;
 	uint8_t pindir;
+	bool fast_read;
 	struct ftdi_context ftdic_context;
 };
 
@@ -290,13 +292,92 @@ static int ft2232_spi_send_multicommand(const struct flashctx *flash, struct spi
 	return ret ? -1 : 0;
 }
 
+/*
+ * Queue the MPSSE commands for one chunk of a read. The data is not
+ * drained here, see ft2232_spi_read().
+ */
+static int ft2232_spi_queue_read(struct flashctx *flash, unsigned int addr, unsigned int len)
+{
+	struct ft2232_data *spi_data = flash->mst->spi.data;
+	unsigned char buf[3 + 3 + JEDEC_MAX_READ_CMD_LEN + 3 + 3];
+	uint8_t cmd[JEDEC_MAX_READ_CMD_LEN];
+	size_t i = 0;
+
+	const int cmd_len = spi_prepare_read_cmd(flash, cmd, addr, spi_data->fast_read);
+	if (cmd_len < 0)
+		return SPI_GENERIC_ERROR;
+
+	buf[i++] = SET_BITS_LOW;
+	buf[i++] = spi_data->aux_bits;
+	buf[i++] = spi_data->pindir;
+
+	buf[i++] = MPSSE_DO_WRITE | MPSSE_WRITE_NEG;
+	buf[i++] = (cmd_len - 1) & 0xff;
+	buf[i++] = ((cmd_len - 1) >> 8) & 0xff;
+	memcpy(buf + i, cmd, cmd_len);
+	i += cmd_len;
+
+	buf[i++] = MPSSE_DO_READ;
+	buf[i++] = (len - 1) & 0xff;
+	buf[i++] = ((len - 1) >> 8) & 0xff;
+
+	buf[i++] = SET_BITS_LOW;
+	buf[i++] = spi_data->cs_bits | spi_data->aux_bits;
+	buf[i++] = spi_data->pindir;
+
+	return send_buf(&spi_data->ftdic_context, buf, i);
+}
+
+/*
+ * Read in chunks of max_data_read bytes, but queue the MPSSE commands
+ * for the next chunk before draining the data of the current one. This
+ * way the FTDI chip never idles while we wait for the USB turnaround.
+ */
+static int ft2232_spi_read(struct flashctx *flash, uint8_t *buf, unsigned int start, unsigned int len)
+{
+	struct ft2232_data *spi_data = flash->mst->spi.data;
+	struct ftdi_context *ftdic = &spi_data->ftdic_context;
+	const unsigned int chunksize = flash->mst->spi.max_data_read;
+	const unsigned int start_address = start;
+	const unsigned int total = len;
+	uint8_t *pending_buf = NULL;
+	unsigned int pending_len = 0;
+	unsigned int done = 0;
+
+	while (len || pending_len) {
+		const unsigned int to_read = min(chunksize, len);
+
+		if (to_read) {
+			if (ft2232_spi_queue_read(flash, start, to_read)) {
+				msg_perr("%s: failed to queue read at 0x%06x\n", __func__, start);
+				return SPI_GENERIC_ERROR;
+			}
+		}
+
+		if (pending_len) {
+			if (get_buf(ftdic, pending_buf, pending_len)) {
+				msg_perr("%s: failed to read data\n", __func__);
+				return SPI_GENERIC_ERROR;
+			}
+			done += pending_len;
+			update_progress(flash, FLASHROM_PROGRESS_READ, done, total);
+		}
+
+		pending_buf = buf + (start - start_address);
+		pending_len = to_read;
+		start += to_read;
+		len -= to_read;
+	}
+	return 0;
+}
+
 static const struct spi_master spi_master_ft2232 = {
 	.features	= SPI_MASTER_4BA,
 	.max_data_read	= 64 * 1024,
 	.max_data_write	= 256,
 	.command	= default_spi_send_command,
 	.multicommand	= ft2232_spi_send_multicommand,
-	.read		= default_spi_read,
+	.read		= ft2232_spi_read,
 	.write_256	= default_spi_write_256,
 	.write_aai	= default_spi_write_aai,
 	.shutdown	= ft2232_shutdown,
@@ -585,6 +666,19 @@ format_error:
 		return -2;
 	}
 
+	bool fast_read = false;
+	arg = extract_programmer_param_str("fastread");
+	if (arg) {
+		if (!strcasecmp(arg, "on")) {
+			fast_read = true;
+		} else if (strcasecmp(arg, "off")) {
+			msg_perr("Error: Invalid fastread state \"%s\", valid are \"on\" and \"off\".\n", arg);
+			free(arg);
+			return -2;
+		}
+	}
+	free(arg);
+
 	msg_pdbg("Using device type %s %s ",
 		 get_ft2232_vendorname(ft2232_vid, ft2232_type),
 		 get_ft2232_devicename(ft2232_vid, ft2232_type));
@@ -693,6 +787,7 @@ format_error:
 	spi_data->cs_bits = cs_bits;
 	spi_data->aux_bits = aux_bits;
 	spi_data->pindir = pindir;
+	spi_data->fast_read = fast_read;
 	spi_data->ftdic_context = ftdic;
 
 	return register_spi_master(&spi_master_ft2232, spi_data);
@@ -150,3 +150,131 @@ int i2c_write(int fd, uint16_t addr, const i2c_buffer_t *buf)
 
 	return write(fd, buf->buf, buf->len);
 }
+
+void i2c_batch_init(struct i2c_batch *batch)
+{
+	batch->count = 0;
+	batch->data_len = 0;
+	batch->error = 0;
+}
+
+static int i2c_batch_add(struct i2c_batch *batch, uint16_t addr, bool read, void *buf, uint16_t len)
+{
+	if (batch->count == I2C_BATCH_MAX_MSGS) {
+		msg_perr("%s: Too many messages in I2C transaction.\n", __func__);
+		batch->error = -1;
+		return -1;
+	}
+
+	batch->msgs[batch->count].addr = addr;
+	batch->msgs[batch->count].read = read;
+	batch->msgs[batch->count].len = len;
+	batch->msgs[batch->count].buf = buf;
+	batch->count++;
+	return 0;
+}
+
+static uint8_t *i2c_batch_alloc(struct i2c_batch *batch, size_t len)
+{
+	if (len > sizeof(batch->data) - batch->data_len) {
+		msg_perr("%s: Too much data in I2C transaction.\n", __func__);
+		batch->error = -1;
+		return NULL;
+	}
+
+	uint8_t *const data = batch->data + batch->data_len;
+	batch->data_len += len;
+	return data;
+}
+
+int i2c_batch_write(struct i2c_batch *batch, uint16_t addr, const void *buf, uint16_t len)
+{
+	uint8_t *const data = i2c_batch_alloc(batch, len);
+	if (!data)
+		return -1;
+
+	memcpy(data, buf, len);
+	return i2c_batch_add(batch, addr, false, data, len);
+}
+
+int i2c_batch_write_reg(struct i2c_batch *batch, uint16_t addr, uint8_t reg,
+			const void *buf, uint16_t len)
+{
+	uint8_t *const data = i2c_batch_alloc(batch, len + 1);
+	if (!data)
+		return -1;
+
+	data[0] = reg;
+	memcpy(data + 1, buf, len);
+	return i2c_batch_add(batch, addr, false, data, len + 1);
+}
+
+int i2c_batch_read(struct i2c_batch *batch, uint16_t addr, void *buf, uint16_t len)
+{
+	return i2c_batch_add(batch, addr, true, buf, len);
+}
+
+int i2c_batch_read_reg(struct i2c_batch *batch, uint16_t addr, uint8_t reg,
+		       void *buf, uint16_t len)
+{
+	if (i2c_batch_write(batch, addr, &reg, 1))
+		return -1;
+
+	return i2c_batch_read(batch, addr, buf, len);
+}
+
+/* Fallback for adapters which only implement plain reads and writes. */
+static int i2c_batch_submit_single(int fd, const struct i2c_batch *batch)
+{
+	unsigned int i;
+
+	for (i = 0; i < batch->count; i++) {
+		i2c_buffer_t buf;
+		int ret;
+
+		if (i2c_buffer_t_fill(&buf, batch->msgs[i].buf, batch->msgs[i].len))
+			return -1;
+
+		if (batch->msgs[i].read)
+			ret = i2c_read(fd, batch->msgs[i].addr, &buf);
+		else
+			ret = i2c_write(fd, batch->msgs[i].addr, &buf);
+		if (ret != batch->msgs[i].len)
+			return -1;
+	}
+
+	return 0;
+}
+
+int i2c_batch_submit(int fd, struct i2c_batch *batch)
+{
+	struct i2c_msg msgs[I2C_BATCH_MAX_MSGS];
+	struct i2c_rdwr_ioctl_data data = { .msgs = msgs, .nmsgs = batch->count };
+	unsigned int i;
+	int ret = batch->error;
+
+	if (ret || !batch->count)
+		goto out;
+
+	for (i = 0; i < batch->count; i++) {
+		msgs[i].addr = batch->msgs[i].addr;
+		msgs[i].flags = batch->msgs[i].read ? I2C_M_RD : 0;
+		msgs[i].len = batch->msgs[i].len;
+		msgs[i].buf = batch->msgs[i].buf;
+	}
+
+	ret = ioctl(fd, I2C_RDWR, &data);
+	if (ret < 0 && errno == EOPNOTSUPP) {
+		ret = i2c_batch_submit_single(fd, batch);
+	} else if (ret != (int)batch->count) {
+		msg_perr("I2C transaction of %u messages failed: %s.\n",
+			 batch->count, ret < 0 ? strerror(errno) : "short transfer");
+		ret = -1;
+	} else {
+		ret = 0;
+	}
+
+out:
+	i2c_batch_init(batch);
+	return ret;
+}
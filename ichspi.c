@@ -61,6 +61,7 @@
 #define PCH100_HSFC_FCYCLE_BIT_WIDTH	0xf
 #define PCH100_HSFC_FCYCLE_OFF	(17 - 16)	/* 1-4: FLASH Cycle */
 #define PCH100_HSFC_FCYCLE	HSFC_FCYCLE_MASK(PCH100_HSFC_FCYCLE_BIT_WIDTH)
+#define PCH100_HSFC_CYCLE_BLOCK_ERASE_64K	HSFC_FCYCLE_MASK(4)
 /* New HSFC Control bit */
 #define PCH100_HSFC_WET_OFF	(21 - 16)	/* 5: Write Enable Type */
 #define PCH100_HSFC_WET		(0x1 << PCH100_HSFC_WET_OFF)
@@ -859,6 +860,68 @@ static void ich_read_data(uint8_t *data, int len, int reg0_off)
 	}
 }
 
+/*
+ * Typical duration and timeout of a controller cycle. The typical durations
+ * are those of common SPI flash chips; the timeouts also cover the bus being
+ * busy with operations of other masters.
+ */
+struct ich_cycle_timing {
+	unsigned int typical_us;
+	unsigned int timeout_us;
+};
+
+static const struct ich_cycle_timing ich_timing_short     = {      0, 10 * 1000 * 1000 };
+static const struct ich_cycle_timing ich_timing_program   = {    300, 10 * 1000 * 1000 };
+static const struct ich_cycle_timing ich_timing_wrsr      = {  10000, 10 * 1000 * 1000 };
+static const struct ich_cycle_timing ich_timing_erase_4k  = {  45000, 30 * 1000 * 1000 };
+static const struct ich_cycle_timing ich_timing_erase_32k = { 120000, 30 * 1000 * 1000 };
+static const struct ich_cycle_timing ich_timing_erase_64k = { 150000, 30 * 1000 * 1000 };
+/* Non-atomic swseq cycles don't wait for the chip, just for the bus. */
+static const struct ich_cycle_timing ich_timing_swseq     = {      0,      60 * 1000 };
+
+#define ICH_SLEEP_MIN_US	100	/* Shorter delays are busy-waited. */
+#define ICH_POLL_MAX_US		10000
+
+static void ich_cycle_delay(unsigned int usecs)
+{
+	if (usecs >= ICH_SLEEP_MIN_US)
+		internal_sleep(usecs);
+	else
+		programmer_delay(usecs);
+}
+
+/*
+ * Waits until any of the `done` bits is set in the 32-bit register at `reg`
+ * and returns its last value. Sleeps through half of the typical cycle
+ * duration first, then polls at an eighth of the time waited so far: short
+ * cycles are noticed within a few microseconds, long ones don't keep a CPU
+ * core busy. Sets `timed_out` if the bits did not show up in time.
+ */
+static uint32_t ich_wait_for_cycle(int reg, uint32_t done,
+				   const struct ich_cycle_timing *timing, bool *timed_out)
+{
+	unsigned int waited = 0, interval;
+	uint32_t status;
+
+	if (timing->typical_us >= ICH_SLEEP_MIN_US) {
+		waited = timing->typical_us / 2;
+		ich_cycle_delay(waited);
+	}
+
+	*timed_out = false;
+	while (!((status = REGREAD32(reg)) & done)) {
+		if (waited >= timing->timeout_us) {
+			*timed_out = true;
+			break;
+		}
+		interval = min(max(waited / 8, 1), ICH_POLL_MAX_US);
+		ich_cycle_delay(interval);
+		waited += interval;
+	}
+
+	return status;
+}
+
 static int ich7_run_opcode(OPCODE op, uint32_t offset,
 			   uint8_t datalength, uint8_t * data, int maxdata)
 {
@@ -976,11 +1039,38 @@ static int ich7_run_opcode(OPCODE op, uint32_t offset,
 	return 0;
 }
 
+/* Returns the expected timing of a swseq cycle running the given opcode. */
+static const struct ich_cycle_timing *ich9_swseq_timing(OPCODE op)
+{
+	static const struct ich_cycle_timing atomic = { 0, 60 * 1000 * 1000 };
+
+	/* Only atomic cycles wait for the chip to finish. */
+	if (!op.atomic)
+		return &ich_timing_swseq;
+
+	switch (op.opcode) {
+	case JEDEC_BYTE_PROGRAM:
+		return &ich_timing_program;
+	case JEDEC_WRSR:
+		return &ich_timing_wrsr;
+	case JEDEC_SE:
+		return &ich_timing_erase_4k;
+	case JEDEC_BE_52:
+		return &ich_timing_erase_32k;
+	case JEDEC_BE_D8:
+		return &ich_timing_erase_64k;
+	default:
+		/* This must be sufficient for chip erase of slow high-capacity chips. */
+		return &atomic;
+	}
+}
+
 static int ich9_run_opcode(OPCODE op, uint32_t offset,
 			   uint8_t datalength, uint8_t * data)
 {
 	int write_cmd = 0;
 	int timeout;
+	bool timed_out;
 	uint32_t temp32;
 	uint64_t opmenu;
 	int opcode_index;
@@ -1044,13 +1134,10 @@ static int ich9_run_opcode(OPCODE op, uint32_t offset,
 	}
 	temp32 |= ((uint32_t) (opcode_index & 0x07)) << (8 + 4);
 
-	timeout = 100 * 60;	/* 60 ms are 9.6 million cycles at 16 MHz. */
 	/* Handle Atomic. Atomic commands include three steps:
 	    - sending the preop (mainly EWSR or WREN)
 	    - sending the main command
 	    - waiting for the busy bit (WIP) to be cleared
-	   This means the timeout must be sufficient for chip erase
-	   of slow high-capacity chips.
 	 */
 	switch (op.atomic) {
 	case 2:
@@ -1060,7 +1147,6 @@ static int ich9_run_opcode(OPCODE op, uint32_t offset,
 	case 1:
 		/* Atomic command (preop+op) */
 		temp32 |= SSFC_ACS;
-		timeout = 100 * 1000 * 60;	/* 60 seconds */
 		break;
 	}
 
@@ -1071,12 +1157,10 @@ static int ich9_run_opcode(OPCODE op, uint32_t offset,
 	REGWRITE32(swseq_data.reg_ssfsc, temp32);
 
 	/* Wait for Cycle Done Status or Flash Cycle Error. */
-	while (((REGREAD32(swseq_data.reg_ssfsc) & (SSFS_FDONE | SSFS_FCERR)) == 0) &&
-	       --timeout) {
-		programmer_delay(10);
-	}
-	if (!timeout) {
-		msg_perr("timeout, REG_SSFS=0x%08x\n", REGREAD32(swseq_data.reg_ssfsc));
+	temp32 = ich_wait_for_cycle(swseq_data.reg_ssfsc, SSFS_FDONE | SSFS_FCERR,
+				    ich9_swseq_timing(op), &timed_out);
+	if (timed_out) {
+		msg_perr("timeout, REG_SSFS=0x%08x\n", temp32);
 		return 1;
 	}
 
@@ -1361,7 +1445,13 @@ static struct hwseq_data {
 	uint32_t size_comp1;
 	uint32_t addr_mask;
 	bool only_4k;
+	bool has_64k_erase;
 	uint32_t hsfc_fcycle;
+	/* Memory-mapped part of the BIOS region, see ich_hwseq_map_bios_region(). */
+	uint8_t *bios_mmap;
+	uint32_t bios_mmap_start;
+	uint32_t bios_mmap_len;
+	bool bios_mmap_dirty;
 } hwseq_data;
 
 /* Sets FLA in FADDR to (addr & hwseq_data.addr_mask) without touching other bits. */
@@ -1397,28 +1487,21 @@ static uint32_t ich_hwseq_get_erase_block_size(unsigned int addr)
 	return dec_berase[enc_berase];
 }
 
-/* Polls for Cycle Done Status, Flash Cycle Error or timeout in 8 us intervals.
+/* Waits for Cycle Done Status, Flash Cycle Error or timeout, see ich_wait_for_cycle().
    Resets all error flags in HSFS.
    Returns 0 if the cycle completes successfully without errors within
-   timeout us, 1 on errors. */
-static int ich_hwseq_wait_for_cycle_complete(unsigned int len, enum ich_chipset ich_gen)
+   the timeout of the cycle type, 1 on errors. */
+static int ich_hwseq_wait_for_cycle_complete(unsigned int len, const struct ich_cycle_timing *timing,
+					     enum ich_chipset ich_gen)
 {
-	/*
-	 * The SPI bus may be busy due to performing operations from other masters, hence
-	 * introduce the long timeout of 30s to cover the worst case scenarios as well.
-	 */
-	unsigned int timeout_us = 30 * 1000 * 1000;
+	bool timed_out;
 	uint16_t hsfs;
 	uint32_t addr;
 
-	timeout_us /= 8; /* scale timeout duration to counter */
-	while ((((hsfs = REGREAD16(ICH9_REG_HSFS)) &
-		 (HSFS_FDONE | HSFS_FCERR)) == 0) &&
-	       --timeout_us) {
-		programmer_delay(8);
-	}
+	/* HSFC is in the upper half, HSFS in the lower one. */
+	hsfs = ich_wait_for_cycle(ICH9_REG_HSFS, HSFS_FDONE | HSFS_FCERR, timing, &timed_out) & 0xffff;
 	REGWRITE16(ICH9_REG_HSFS, REGREAD16(ICH9_REG_HSFS));
-	if (!timeout_us) {
+	if (timed_out) {
 		addr = REGREAD32(ICH9_REG_FADDR) & hwseq_data.addr_mask;
 		msg_perr("Timeout error between offset 0x%08x and "
 			 "0x%08x (= 0x%08x + %d)!\n",
@@ -1483,7 +1566,7 @@ static int ich_hwseq_read_status(const struct flashctx *flash, enum flash_reg re
 	hsfc |= HSFC_FGO; /* start */
 	REGWRITE16(ICH9_REG_HSFC, hsfc);
 
-	if (ich_hwseq_wait_for_cycle_complete(len, ich_generation)) {
+	if (ich_hwseq_wait_for_cycle_complete(len, &ich_timing_short, ich_generation)) {
 		msg_perr("Reading Status register failed\n!!");
 		return -1;
 	}
@@ -1520,7 +1603,7 @@ static int ich_hwseq_write_status(const struct flashctx *flash, enum flash_reg r
 	hsfc |= HSFC_FGO; /* start */
 	REGWRITE16(ICH9_REG_HSFC, hsfc);
 
-	if (ich_hwseq_wait_for_cycle_complete(len, ich_generation)) {
+	if (ich_hwseq_wait_for_cycle_complete(len, &ich_timing_wrsr, ich_generation)) {
 		msg_perr("Writing Status register failed\n!!");
 		return -1;
 	}
@@ -1546,7 +1629,7 @@ static int ich_hwseq_get_flash_id(struct flashctx *flash, enum ich_chipset ich_g
 	hsfc |= HSFC_CYCLE_RDID | HSFC_FGO;
 	REGWRITE16(ICH9_REG_HSFC, hsfc);
 
-	if (ich_hwseq_wait_for_cycle_complete(len, ich_gen)) {
+	if (ich_hwseq_wait_for_cycle_complete(len, &ich_timing_short, ich_gen)) {
 		msg_perr("Timed out waiting for RDID to complete.\n");
 		return 0;
 	}
@@ -1643,6 +1726,20 @@ static int ich_hwseq_probe(struct flashctx *flash)
 		msg_cdbg("In that range are %d erase blocks with %d B each.\n",
 			 size_high / erase_size_high, erase_size_high);
 	}
+
+	/*
+	 * The 64 KiB erase cycle works across the whole address space, offer it as a second eraser.
+	 * A 64 KiB block reaching into a region which may not be written is denied as a whole, and
+	 * flashrom processes it again with the 4 KiB blocks of the first eraser.
+	 */
+	if (hwseq_data.has_64k_erase && total_size % (64 * KiB) == 0) {
+		eraser = &(flash->chip->block_erasers[1]);
+		eraser->eraseblocks[0].size = 64 * KiB;
+		eraser->eraseblocks[0].count = total_size / (64 * KiB);
+		eraser->block_erase = flash->chip->block_erasers[0].block_erase;
+		msg_cdbg2("There are also %d erase blocks with %d B each.\n",
+			  total_size / (64 * KiB), 64 * KiB);
+	}
 	flash->chip->tested = TEST_OK_PREW;
 	return 1;
 }
@@ -1651,12 +1748,17 @@ static int ich_hwseq_block_erase(struct flashctx *flash, unsigned int addr,
 				 unsigned int len)
 {
 	uint32_t erase_block;
-	uint16_t hsfc;
+	uint16_t hsfc, erase_cycle = HSFC_CYCLE_BLOCK_ERASE;
+	const struct ich_cycle_timing *erase_timing;
 
 	if (is_dry_run())
 		return 0;
 
 	erase_block = ich_hwseq_get_erase_block_size(addr);
+	if (hwseq_data.has_64k_erase && len == 64 * KiB) {
+		erase_block = len;
+		erase_cycle = PCH100_HSFC_CYCLE_BLOCK_ERASE_64K;
+	}
 	if (len != erase_block) {
 		msg_cerr("Erase block size for address 0x%06x is %d B, "
 			 "but requested erase block size is %d B. "
@@ -1685,6 +1787,7 @@ static int ich_hwseq_block_erase(struct flashctx *flash, unsigned int addr,
 		return result;
 
 	msg_pdbg("Erasing %d bytes starting at 0x%06x.\n", len, addr);
+	hwseq_data.bios_mmap_dirty = true;
 	ich_hwseq_set_addr(addr);
 
 	/* make sure FDONE, FCERR, AEL are cleared by writing 1 to them */
@@ -1697,22 +1800,57 @@ static int ich_hwseq_block_erase(struct flashctx *flash, unsigned int addr,
 
 	hsfc = REGREAD16(ICH9_REG_HSFC);
 	hsfc &= ~hwseq_data.hsfc_fcycle; /* clear operation */
-	hsfc |= HSFC_CYCLE_BLOCK_ERASE; /* set erase operation */
+	hsfc |= erase_cycle; /* set erase operation */
 	hsfc |= HSFC_FGO; /* start */
 	msg_pdbg("HSFC used for block erasing: ");
 	prettyprint_ich9_reg_hsfc(hsfc, ich_generation);
 	REGWRITE16(ICH9_REG_HSFC, hsfc);
 
-	if (ich_hwseq_wait_for_cycle_complete(len, ich_generation))
+	erase_timing = len >= 64 * KiB ? &ich_timing_erase_64k : &ich_timing_erase_4k;
+	if (ich_hwseq_wait_for_cycle_complete(len, erase_timing, ich_generation))
+		return -1;
+	return 0;
+}
+
+/* Reads a single block of at most 64 bytes through a hardware sequencing cycle. */
+static int ich_hwseq_read_block(uint8_t *buf, unsigned int addr, uint8_t block_len)
+{
+	uint16_t hsfc;
+
+	ich_hwseq_set_addr(addr);
+
+	if (REGREAD8(ICH9_REG_HSFS) & HSFS_SCIP) {
+		msg_perr("Error: SCIP bit is unexpectedly set.\n");
 		return -1;
+	}
+
+	hsfc = REGREAD16(ICH9_REG_HSFC);
+	hsfc &= ~hwseq_data.hsfc_fcycle; /* set read operation */
+	hsfc &= ~HSFC_FDBC; /* clear byte count */
+	hsfc |= HSFC_CYCLE_READ; /* set read operation */
+	/* set byte count */
+	hsfc |= HSFC_FDBC_VAL(block_len - 1);
+	hsfc |= HSFC_FGO; /* start */
+	REGWRITE16(ICH9_REG_HSFC, hsfc);
+
+	if (ich_hwseq_wait_for_cycle_complete(block_len, &ich_timing_short, ich_generation))
+		return 1;
+	ich_read_data(buf, block_len, ICH9_REG_FDATA0);
 	return 0;
 }
 
+/* Returns true if addr lies within the memory-mapped part of the BIOS region. */
+static bool ich_hwseq_is_mapped(unsigned int addr)
+{
+	return hwseq_data.bios_mmap && !hwseq_data.bios_mmap_dirty &&
+	       addr >= hwseq_data.bios_mmap_start &&
+	       addr - hwseq_data.bios_mmap_start < hwseq_data.bios_mmap_len;
+}
+
 static int ich_hwseq_read(struct flashctx *flash, uint8_t *buf,
 			  unsigned int addr, unsigned int len)
 {
-	uint16_t hsfc;
-	uint8_t block_len;
+	unsigned int block_len;
 	int result = 0, chunk_status = 0;
 
 	if (addr + len > flash->chip->total_size * 1024) {
@@ -1726,10 +1864,20 @@ static int ich_hwseq_read(struct flashctx *flash, uint8_t *buf,
 	REGWRITE16(ICH9_REG_HSFS, REGREAD16(ICH9_REG_HSFS));
 
 	while (len > 0) {
-		/* Obey programmer limit... */
-		block_len = min(len, flash->mst->opaque.max_data_read);
-		/* as well as flash chip page borders as demanded in the Intel datasheets. */
-		block_len = min(block_len, 256 - (addr & 0xFF));
+		const bool mapped = ich_hwseq_is_mapped(addr);
+
+		if (mapped) {
+			/* Copy everything up to the end of the mapped window at once... */
+			block_len = min(len, hwseq_data.bios_mmap_start + hwseq_data.bios_mmap_len - addr);
+		} else {
+			/* Obey programmer limit... */
+			block_len = min(len, flash->mst->opaque.max_data_read);
+			/* as well as flash chip page borders as demanded in the Intel datasheets. */
+			block_len = min(block_len, 256 - (addr & 0xFF));
+			/* ...and switch over to the mapped window as soon as it starts. */
+			if (hwseq_data.bios_mmap && !hwseq_data.bios_mmap_dirty && addr < hwseq_data.bios_mmap_start)
+				block_len = min(block_len, hwseq_data.bios_mmap_start - addr);
+		}
 
 		/* Check flash region permissions before reading */
 		chunk_status = check_fd_permissions(ich_generation, NULL, SPI_OPCODE_TYPE_READ_NO_ADDRESS, addr, block_len);
@@ -1742,26 +1890,12 @@ static int ich_hwseq_read(struct flashctx *flash, uint8_t *buf,
 			} else {
 				return chunk_status;
 			}
+		} else if (mapped) {
+			mmio_readn(hwseq_data.bios_mmap + (addr - hwseq_data.bios_mmap_start), buf, block_len);
 		} else {
-			ich_hwseq_set_addr(addr);
-
-			if (REGREAD8(ICH9_REG_HSFS) & HSFS_SCIP) {
-				msg_perr("Error: SCIP bit is unexpectedly set.\n");
-				return -1;
-			}
-
-			hsfc = REGREAD16(ICH9_REG_HSFC);
-			hsfc &= ~hwseq_data.hsfc_fcycle; /* set read operation */
-			hsfc &= ~HSFC_FDBC; /* clear byte count */
-			hsfc |= HSFC_CYCLE_READ; /* set read operation */
-			/* set byte count */
-			hsfc |= HSFC_FDBC_VAL(block_len - 1);
-			hsfc |= HSFC_FGO; /* start */
-			REGWRITE16(ICH9_REG_HSFC, hsfc);
-
-			if (ich_hwseq_wait_for_cycle_complete(block_len, ich_generation))
-				return 1;
-			ich_read_data(buf, block_len, ICH9_REG_FDATA0);
+			chunk_status = ich_hwseq_read_block(buf, addr, block_len);
+			if (chunk_status)
+				return chunk_status;
 		}
 		addr += block_len;
 		buf += block_len;
@@ -1782,6 +1916,7 @@ static int ich_hwseq_write(struct flashctx *flash, const uint8_t *buf, unsigned
 	}
 
 	msg_pdbg("Writing %d bytes starting at 0x%06x.\n", len, addr);
+	hwseq_data.bios_mmap_dirty = true;
 	/* clear FDONE, FCERR, AEL by writing 1 to them (if they are set) */
 	REGWRITE16(ICH9_REG_HSFS, REGREAD16(ICH9_REG_HSFS));
 
@@ -1811,7 +1946,7 @@ static int ich_hwseq_write(struct flashctx *flash, const uint8_t *buf, unsigned
 		hsfc |= HSFC_FGO; /* start */
 		REGWRITE16(ICH9_REG_HSFC, hsfc);
 
-		if (ich_hwseq_wait_for_cycle_complete(block_len, ich_generation))
+		if (ich_hwseq_wait_for_cycle_complete(block_len, &ich_timing_program, ich_generation))
 			return -1;
 		addr += block_len;
 		buf += block_len;
@@ -2072,6 +2207,71 @@ static const struct opaque_master opaque_master_ich_hwseq = {
 	.check_access	= ich_hwseq_check_access,
 };
 
+/* Compare 64 bytes at offset `off` of the mapped window against hardware sequencing. */
+static bool ich_hwseq_bios_mmap_matches(const uint8_t *virt, uint32_t flash_start, uint32_t off)
+{
+	uint8_t check_hwseq[64], check_mmap[64];
+
+	if (ich_hwseq_read_block(check_hwseq, flash_start + off, sizeof(check_hwseq)))
+		return false;
+	mmio_readn(virt + off, check_mmap, sizeof(check_mmap));
+	return !memcmp(check_hwseq, check_mmap, sizeof(check_hwseq));
+}
+
+/*
+ * The top of the BIOS region is memory-mapped right below 4 GiB. Reading it
+ * through the mapping is orders of magnitude faster than hardware sequencing,
+ * which only transfers 64 bytes per cycle. The chipset decodes at most 16 MiB,
+ * anything below that is still read through hardware sequencing.
+ *
+ * After the first erase or write, the mapping is no longer used: the direct
+ * read path of the SPI controller may have prefetched stale contents.
+ */
+static void ich_hwseq_map_bios_region(void)
+{
+	const struct fd_region *const bios = &fd_regions[1];
+	const uint32_t max_window = 16 * MiB;
+	uint32_t len;
+
+	hwseq_data.bios_mmap = NULL;
+	hwseq_data.bios_mmap_dirty = false;
+
+	if (bios->base > bios->limit) {
+		msg_pdbg("BIOS region is unused, not mapping it.\n");
+		return;
+	}
+	len = min(bios->limit - bios->base + 1, max_window);
+
+	if (check_fd_permissions(ich_generation, NULL, SPI_OPCODE_TYPE_READ_NO_ADDRESS,
+				 bios->limit + 1 - len, len)) {
+		msg_pdbg("BIOS region is read protected, not mapping it.\n");
+		return;
+	}
+
+	void *const virt = rphysmap("ICH BIOS region", (uintptr_t)(0x100000000ULL - len), len);
+	if (virt == ERROR_PTR) {
+		msg_pdbg("Could not map BIOS region, reading it through hwseq.\n");
+		return;
+	}
+
+	/*
+	 * Make sure the chipset actually decodes the whole window where we expect it:
+	 * a smaller decode range would still match at the top, but not at the bottom.
+	 */
+	REGWRITE16(ICH9_REG_HSFS, REGREAD16(ICH9_REG_HSFS));
+	if (!ich_hwseq_bios_mmap_matches(virt, bios->limit + 1 - len, 0) ||
+	    !ich_hwseq_bios_mmap_matches(virt, bios->limit + 1 - len, len - 64)) {
+		msg_pdbg("Memory-mapped BIOS region does not match flash contents, not using it.\n");
+		return;
+	}
+
+	hwseq_data.bios_mmap = virt;
+	hwseq_data.bios_mmap_start = bios->limit + 1 - len;
+	hwseq_data.bios_mmap_len = len;
+	msg_pdbg("Reading 0x%06x - 0x%06x through the memory-mapped BIOS region.\n",
+		 hwseq_data.bios_mmap_start, bios->limit);
+}
+
 static int init_ich7_spi(void *spibar, enum ich_chipset ich_gen)
 {
 	unsigned int i;
@@ -2163,6 +2363,7 @@ static void init_chipset_properties(struct swseq_data *swseq, struct hwseq_data
 		swseq->reg_opmenu	= PCH100_REG_OPMENU;
 		hwseq->addr_mask	= PCH100_FADDR_FLA;
 		hwseq->only_4k		= true;
+		hwseq->has_64k_erase	= true;
 		hwseq->hsfc_fcycle	= PCH100_HSFC_FCYCLE;
 		break;
 	default:
@@ -2174,6 +2375,7 @@ static void init_chipset_properties(struct swseq_data *swseq, struct hwseq_data
 		swseq->reg_opmenu	= ICH9_REG_OPMENU;
 		hwseq->addr_mask	= ICH9_FADDR_FLA;
 		hwseq->only_4k		= false;
+		hwseq->has_64k_erase	= false;
 		hwseq->hsfc_fcycle	= HSFC_FCYCLE;
 		break;
 	}
@@ -2442,6 +2644,8 @@ static int init_ich_default(void *spibar, enum ich_chipset ich_gen)
 		}
 		hwseq_data.size_comp1 = tmpi;
 
+		ich_hwseq_map_bios_region();
+
 		register_opaque_master(&opaque_master_ich_hwseq, NULL);
 	} else {
 		register_spi_master(&spi_master_ich9, NULL);
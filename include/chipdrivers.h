@@ -55,6 +55,8 @@ int spi_block_erase_dc(struct flashctx *flash, unsigned int addr, unsigned int b
 erasefunc_t *spi_get_erasefn_from_opcode(uint8_t opcode);
 uint8_t spi_get_opcode_from_erasefn(erasefunc_t *func);
 int spi_chip_write_1(struct flashctx *flash, const uint8_t *buf, unsigned int start, unsigned int len);
+int spi_prepare_read_cmd(struct flashctx *flash, uint8_t cmd[], unsigned int addr, bool fast);
+int spi_prepare_program_cmd(struct flashctx *flash, uint8_t cmd[], unsigned int addr);
 int spi_nbyte_read(struct flashctx *flash, unsigned int addr, uint8_t *bytes, unsigned int len);
 int spi_read_chunked(struct flashctx *flash, uint8_t *buf, unsigned int start, unsigned int len, unsigned int chunksize);
 int spi_write_chunked(struct flashctx *flash, const uint8_t *buf, unsigned int start, unsigned int len, unsigned int chunksize);
@@ -322,6 +322,32 @@ struct flashchip {
 
 typedef int (*chip_restore_fn_cb_t)(struct flashctx *flash, uint8_t status);
 
+/* Progress of the running image operation, see progress.c. */
+struct progress_engine {
+	bool active;
+	size_t stage_total[FLASHROM_PROGRESS_NR];
+	size_t stage_done[FLASHROM_PROGRESS_NR];
+	/* The chip access wrapped by progress_call_begin(), nested ones are not counted. */
+	unsigned int depth;
+	enum flashrom_progress_stage stage;
+	size_t call_len;
+	size_t call_done;
+	uint64_t call_start_ns;
+	/* The part of the access a driver reports on, see progress_segment_begin(). */
+	size_t segment_offset;
+	size_t segment_len;
+	size_t segment_total;
+	/* Throughput estimation */
+	uint64_t stage_ns[FLASHROM_PROGRESS_NR];
+	uint64_t start_ns;
+	uint64_t sample_ns;
+	size_t sample_bytes;
+	double rate;
+	/* Rate limiting of the callback */
+	uint64_t last_report_ns;
+	unsigned int reported_stages;
+};
+
 /* struct flashctx must always contain struct flashchip at the beginning. */
 struct flashrom_flashctx {
 	struct flashchip *chip;
@@ -359,6 +385,9 @@ struct flashrom_flashctx {
 	/* Progress reporting */
 	flashrom_progress_callback *progress_callback;
 	struct flashrom_progress *progress_state;
+	struct progress_engine progress;
+	/* Statistics and tracing, NULL while both are disabled */
+	struct stats_state *stats;
 };
 
 /* Timing used in probe routines. ZERO is -2 to differentiate between an unset
@@ -434,6 +463,10 @@ int write_buf_to_file(const unsigned char *buf, unsigned long size, const char *
 int write_buf_to_include_args(const struct flashrom_layout *const layout, unsigned char *buf);
 int prepare_flash_access(struct flashctx *, bool read_it, bool write_it, bool erase_it, bool verify_it);
 void finalize_flash_access(struct flashctx *);
+int need_erase(const uint8_t *have, const uint8_t *want, unsigned int len,
+	       enum write_granularity gran, const uint8_t erased_value);
+unsigned int get_next_write(const uint8_t *have, const uint8_t *want, unsigned int len,
+			    unsigned int *first_start, enum write_granularity gran);
 
 int register_chip_restore(chip_restore_fn_cb_t func, struct flashctx *flash, uint8_t status);
 
@@ -453,6 +486,20 @@ int register_chip_restore(chip_restore_fn_cb_t func, struct flashctx *flash, uin
 /* cli_common.c */
 void print_chip_support_status(const struct flashchip *chip);
 
+/* cli_daemon.c */
+typedef int (cli_daemon_handler)(struct flashctx *flash, int argc, char *argv[]);
+int cli_daemon_serve(const char *path, struct flashctx *flash, cli_daemon_handler *handler);
+int cli_daemon_connect(const char *path, int argc, char *argv[], enum flashrom_log_level max_level);
+void cli_daemon_serve_request(int fd, struct flashctx *flash, cli_daemon_handler *handler);
+int cli_daemon_send_request(int fd, int argc, char *argv[], enum flashrom_log_level max_level);
+int cli_daemon_relay_answer(int fd);
+int cli_daemon_cache_init(size_t size);
+void cli_daemon_cache_release(void);
+const uint8_t *cli_daemon_cache_get(const struct flashctx *flash);
+void cli_daemon_cache_update(const struct flashctx *flash, const uint8_t *contents);
+void cli_daemon_cache_erase(const struct flashctx *flash);
+void cli_daemon_cache_invalidate(void);
+
 /* cli_output.c */
 extern enum flashrom_log_level verbose_screen;
 extern enum flashrom_log_level verbose_logfile;
@@ -489,7 +536,29 @@ __attribute__((format(printf, 2, 3)));
 #define msg_gspew(...)	print(FLASHROM_MSG_SPEW, __VA_ARGS__)	/* general debug spew  */
 #define msg_pspew(...)	print(FLASHROM_MSG_SPEW, __VA_ARGS__)	/* programmer debug spew  */
 #define msg_cspew(...)	print(FLASHROM_MSG_SPEW, __VA_ARGS__)	/* chip debug spew  */
+
+/* progress.c */
 void update_progress(struct flashctx *flash, enum flashrom_progress_stage stage, size_t current, size_t total);
+void progress_start(struct flashctx *flash);
+void progress_add_total(struct flashctx *flash, enum flashrom_progress_stage stage, size_t bytes);
+void progress_call_begin(struct flashctx *flash, enum flashrom_progress_stage stage, size_t len);
+void progress_call_end(struct flashctx *flash);
+void progress_segment_begin(struct flashctx *flash, size_t offset, size_t len, size_t total);
+void progress_segment_end(struct flashctx *flash);
+void progress_finish(struct flashctx *flash);
+
+/* stats.c */
+struct spi_command;
+int stats_spi_send_command(const struct flashctx *flash, unsigned int writecnt, unsigned int readcnt,
+			   const unsigned char *writearr, unsigned char *readarr);
+int stats_spi_send_multicommand(const struct flashctx *flash, struct spi_command *cmds);
+int stats_read_opaque(struct flashctx *flash, uint8_t *buf, unsigned int start, unsigned int len);
+int stats_write_opaque(struct flashctx *flash, const uint8_t *buf, unsigned int start, unsigned int len);
+int stats_erase_opaque(struct flashctx *flash, unsigned int blockaddr, unsigned int blocklen);
+uint64_t stats_phase_start(const struct flashctx *flash);
+void stats_phase_end(struct flashctx *flash, enum flashrom_stats_phase phase, uint64_t start, unsigned int bytes);
+void stats_eraser_used(struct flashctx *flash, unsigned int eraser, unsigned int len);
+void stats_release(struct flashctx *flash);
 
 /* spi.c */
 struct spi_command {
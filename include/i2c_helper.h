@@ -18,6 +18,8 @@
 #define I2C_HELPER_H
 
 #include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
 
 /**
  * An convenient structure that contains the buffer size and the buffer
@@ -126,4 +128,105 @@ int i2c_read(int fd, uint16_t addr, i2c_buffer_t *buf_read);
  */
 int i2c_write(int fd, uint16_t addr, const i2c_buffer_t *buf_write);
 
+/* Maximum number of messages the kernel accepts in one transaction. */
+#define I2C_BATCH_MAX_MSGS	42
+/* Storage for written data, fits a 256-byte page plus register programming. */
+#define I2C_BATCH_DATA_SIZE	512
+
+/**
+ * A sequence of I2C messages that is submitted to the adapter in a single
+ * transaction, joined by repeated starts instead of stop conditions. Data
+ * to be written is copied into the batch when the message is added, data
+ * to be read is stored into the caller's buffer on submission.
+ *
+ * Errors while building the batch are latched, so callers may add all
+ * messages and only check the result of i2c_batch_submit.
+ */
+struct i2c_batch {
+	unsigned int count;
+	struct {
+		uint16_t addr;
+		bool read;
+		uint16_t len;
+		void *buf;
+	} msgs[I2C_BATCH_MAX_MSGS];
+	uint8_t data[I2C_BATCH_DATA_SIZE];
+	size_t data_len;
+	int error;
+};
+
+/**
+ * i2c_batch_init - resets a batch to contain no messages
+ *
+ * @batch:	batch to be initialized.
+ */
+void i2c_batch_init(struct i2c_batch *batch);
+
+/**
+ * i2c_batch_write - appends a write message to the batch
+ *
+ * @batch:	batch to append to.
+ * @addr:	I2C slave address of the target device.
+ * @buf:	data to write, copied into the batch.
+ * @len:	length of the data.
+ *
+ * returns 0 on success, <0 if the batch is full
+ */
+int i2c_batch_write(struct i2c_batch *batch, uint16_t addr, const void *buf, uint16_t len);
+
+/**
+ * i2c_batch_write_reg - appends a write of a register offset and its data
+ *
+ * @batch:	batch to append to.
+ * @addr:	I2C slave address of the target device.
+ * @reg:	register offset, sent as the first byte of the message.
+ * @buf:	data to write after the offset, copied into the batch.
+ * @len:	length of the data.
+ *
+ * This is meant for both single register writes and page bursts.
+ *
+ * returns 0 on success, <0 if the batch is full
+ */
+int i2c_batch_write_reg(struct i2c_batch *batch, uint16_t addr, uint8_t reg,
+			const void *buf, uint16_t len);
+
+/**
+ * i2c_batch_read - appends a read message to the batch
+ *
+ * @batch:	batch to append to.
+ * @addr:	I2C slave address of the target device.
+ * @buf:	buffer the data is read into on submission.
+ * @len:	length of the data.
+ *
+ * returns 0 on success, <0 if the batch is full
+ */
+int i2c_batch_read(struct i2c_batch *batch, uint16_t addr, void *buf, uint16_t len);
+
+/**
+ * i2c_batch_read_reg - appends a register offset write followed by a read
+ *
+ * @batch:	batch to append to.
+ * @addr:	I2C slave address of the target device.
+ * @reg:	register offset to read from.
+ * @buf:	buffer the data is read into on submission.
+ * @len:	length of the data.
+ *
+ * returns 0 on success, <0 if the batch is full
+ */
+int i2c_batch_read_reg(struct i2c_batch *batch, uint16_t addr, uint8_t reg,
+		       void *buf, uint16_t len);
+
+/**
+ * i2c_batch_submit - transfers all messages of the batch
+ *
+ * @fd:		file descriptor of the target device.
+ * @batch:	batch to submit.
+ *
+ * Adapters that can't do combined transactions get the messages one by
+ * one instead. The batch is empty afterwards and can be reused.
+ *
+ * returns 0 on success, <0 to indicate failure
+ */
+int i2c_batch_submit(int fd, struct i2c_batch *batch);
+
 #endif /* !I2C_HELPER_H */
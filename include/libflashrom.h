@@ -73,13 +73,38 @@ enum flashrom_progress_stage {
 	FLASHROM_PROGRESS_READ,
 	FLASHROM_PROGRESS_WRITE,
 	FLASHROM_PROGRESS_ERASE,
+	FLASHROM_PROGRESS_VERIFY,
 	FLASHROM_PROGRESS_NR,
 };
+/**
+ * @brief Progress state handed to the progress callback.
+ *
+ * During flashrom_image_read(), flashrom_image_write(), flashrom_image_verify()
+ * and flashrom_flash_erase(), `current` and `total` count the bytes of the
+ * current stage over the whole operation, and `op_current` and `op_total` the
+ * bytes of all stages together. Totals are planned up front and may grow once
+ * the erase and write work is known. Outside of these operations, the values
+ * describe the single chip access in progress.
+ */
 struct flashrom_progress {
 	enum flashrom_progress_stage stage;
 	size_t current;
 	size_t total;
 	void *user_data;
+	size_t op_current;
+	size_t op_total;
+	/** Smoothed throughput in bytes per second, 0 until measured. */
+	uint64_t rate;
+	/** Time since the operation started. */
+	uint64_t elapsed_ms;
+	/** Estimated time to completion, UINT64_MAX while unknown. */
+	uint64_t eta_ms;
+	/**
+	 * Minimum time between two callbacks, set by the frontend. The first
+	 * and the last update of each stage are always reported. 0 reports
+	 * every update.
+	 */
+	unsigned int interval_ms;
 };
 struct flashrom_flashctx;
 typedef void(flashrom_progress_callback)(struct flashrom_flashctx *flashctx);
@@ -581,4 +606,193 @@ void flashrom_wp_ranges_release(struct flashrom_wp_ranges *ranges);
 
 /** @} */ /* end flashrom-wp */
 
+/**
+ * @defgroup flashrom-stats Statistics
+ * @{
+ */
+
+/**
+ * Number of latency buckets. Bucket n counts operations that took
+ * [2^n, 2^(n+1)) microseconds, bucket 0 also those below 1us and the
+ * last bucket everything longer.
+ */
+#define FLASHROM_STATS_LATENCY_BUCKETS 24
+
+struct flashrom_stats_counter {
+	/** Number of operations. */
+	uint64_t count;
+	/** Bytes sent, for SPI including opcode and address. */
+	uint64_t bytes_out;
+	/** Bytes received. */
+	uint64_t bytes_in;
+	/** Number of operations the latency fields account for. */
+	uint64_t timed;
+	uint64_t total_us;
+	uint64_t max_us;
+	uint64_t latency[FLASHROM_STATS_LATENCY_BUCKETS];
+};
+
+enum flashrom_stats_opaque_op {
+	FLASHROM_STATS_OPAQUE_READ,
+	FLASHROM_STATS_OPAQUE_WRITE,
+	FLASHROM_STATS_OPAQUE_ERASE,
+	FLASHROM_STATS_OPAQUE_NR,
+};
+
+/** Phases of the image operations, see struct flashrom_stats_phase_counter. */
+enum flashrom_stats_phase {
+	/** Reading the image in flashrom_image_read(). */
+	FLASHROM_STATS_PHASE_READ,
+	/** Reading the current contents before an erase or write. */
+	FLASHROM_STATS_PHASE_PRE_READ,
+	/** Choosing the erasers and blocks to process. */
+	FLASHROM_STATS_PHASE_PLANNING,
+	FLASHROM_STATS_PHASE_ERASE,
+	FLASHROM_STATS_PHASE_WRITE,
+	FLASHROM_STATS_PHASE_VERIFY,
+	FLASHROM_STATS_PHASE_NR,
+};
+
+struct flashrom_stats_phase_counter {
+	/** Wall time spent in the phase. */
+	uint64_t total_us;
+	/** Bytes read, erased, written or verified. */
+	uint64_t bytes;
+};
+
+/** Number of block erasers a flash chip can have. */
+#define FLASHROM_STATS_ERASERS 8
+
+struct flashrom_stats_eraser_counter {
+	/** Number of erase operations using this eraser. */
+	uint64_t count;
+	/** Bytes erased with this eraser. */
+	uint64_t bytes;
+};
+
+/**
+ * SPI commands are accounted by their opcode. When a master sends several
+ * commands in one go (e.g. WREN followed by a page program), the time is
+ * accounted to the last command only, the others are counted untimed.
+ *
+ * Erasers are accounted by their index in the chip's list of block erasers.
+ */
+struct flashrom_stats {
+	struct flashrom_stats_counter spi[256];
+	struct flashrom_stats_counter opaque[FLASHROM_STATS_OPAQUE_NR];
+	struct flashrom_stats_phase_counter phases[FLASHROM_STATS_PHASE_NR];
+	struct flashrom_stats_eraser_counter erasers[FLASHROM_STATS_ERASERS];
+};
+
+enum flashrom_trace_type {
+	FLASHROM_TRACE_SPI = 1,
+	FLASHROM_TRACE_OPAQUE_READ,
+	FLASHROM_TRACE_OPAQUE_WRITE,
+	FLASHROM_TRACE_OPAQUE_ERASE,
+	/* The types below only appear in recordings. */
+	/** A master was registered, see struct record_master in the sources. */
+	FLASHROM_TRACE_REGISTER_MASTER,
+	FLASHROM_TRACE_SPI_READ,
+	FLASHROM_TRACE_SPI_WRITE_256,
+	FLASHROM_TRACE_SPI_WRITE_AAI,
+	/** The opcode was checked for support, the result is the answer. */
+	FLASHROM_TRACE_SPI_PROBE_OPCODE,
+	/** An opaque master probed, the chip it found follows. */
+	FLASHROM_TRACE_OPAQUE_PROBE,
+};
+
+/** Magic at the start of a trace file, followed by records. */
+#define FLASHROM_TRACE_MAGIC "FRTRACE2"
+/**
+ * Magic at the start of a recording. Like in a trace, records follow, but
+ * each is followed by its payload: first the bytes_out bytes sent to the
+ * programmer, then the bytes_in bytes it returned.
+ */
+#define FLASHROM_RECORD_MAGIC "FRREC002"
+
+/** A trace record, written in host byte order. */
+struct flashrom_trace_record {
+	/** Start of the operation in ns, relative to the start of the trace. */
+	uint64_t timestamp_ns;
+	uint64_t duration_ns;
+	/** One of enum flashrom_trace_type. */
+	uint8_t type;
+	/** SPI opcode, 0 for opaque operations. */
+	uint8_t opcode;
+	/** Return value of the operation, clamped to the int16_t range. */
+	int16_t result;
+	/** Start address of opaque operations. */
+	uint32_t addr;
+	uint32_t bytes_out;
+	uint32_t bytes_in;
+	/** Index of the registered master, only set in recordings. */
+	uint32_t master;
+	/** Always zero, pads the record to a multiple of 8 bytes. */
+	uint32_t reserved;
+};
+
+/**
+ * @brief Enable or disable statistics collection for a flash context.
+ *
+ * Enabling resets all counters. While disabled, the instrumentation
+ * costs a single pointer check per operation.
+ *
+ * @param flashctx The flash context to collect statistics for.
+ * @param enable Whether to collect statistics.
+ * @return 0 on success
+ */
+int flashrom_stats_enable(struct flashrom_flashctx *flashctx, bool enable);
+/**
+ * @brief Get the statistics collected for a flash context.
+ *
+ * @param flashctx The flash context to query.
+ * @return Pointer to the statistics, valid until they are disabled or
+ *         the context is released. NULL if statistics are disabled.
+ */
+const struct flashrom_stats *flashrom_stats_get(const struct flashrom_flashctx *flashctx);
+/**
+ * @brief Reset all counters of a flash context to zero.
+ *
+ * @param flashctx The flash context to reset the statistics for.
+ */
+void flashrom_stats_reset(struct flashrom_flashctx *flashctx);
+/**
+ * @brief Record every operation of a flash context into a binary trace file.
+ *
+ * The file starts with FLASHROM_TRACE_MAGIC, followed by one
+ * struct flashrom_trace_record per operation. A running trace is stopped
+ * first.
+ *
+ * @param flashctx The flash context to trace.
+ * @param path Path of the trace file, truncated if it exists.
+ * @return 0 on success
+ */
+int flashrom_trace_start(struct flashrom_flashctx *flashctx, const char *path);
+/**
+ * @brief Stop tracing and close the trace file.
+ *
+ * @param flashctx The flash context to stop tracing for.
+ * @return 0 on success, 1 if writing the trace failed
+ */
+int flashrom_trace_stop(struct flashrom_flashctx *flashctx);
+/**
+ * @brief Record all traffic with the programmer into a file.
+ *
+ * Unlike a trace, a recording covers every master registered after this
+ * call, including its probing, and it keeps the payloads. The `replay`
+ * programmer plays it back. Call it before flashrom_programmer_init().
+ *
+ * @param path Path of the recording, truncated if it exists.
+ * @return 0 on success
+ */
+int flashrom_record_start(const char *path);
+/**
+ * @brief Stop recording and close the file.
+ *
+ * @return 0 on success, 1 if writing the recording failed
+ */
+int flashrom_record_stop(void);
+
+/** @} */ /* end flashrom-stats */
+
 #endif				/* !__LIBFLASHROM_H__ */
@@ -20,6 +20,7 @@
 #ifndef __PROGRAMMER_H__
 #define __PROGRAMMER_H__ 1
 
+#include <limits.h>
 #include <stdint.h>
 
 #include "flash.h"	/* for chipaddr and flashctx */
@@ -106,6 +107,7 @@ extern const struct programmer_entry programmer_pony_spi;
 extern const struct programmer_entry programmer_raiden_debug_spi;
 extern const struct programmer_entry programmer_rayer_spi;
 extern const struct programmer_entry programmer_realtek_mst_i2c_spi;
+extern const struct programmer_entry programmer_replay;
 extern const struct programmer_entry programmer_satamv;
 extern const struct programmer_entry programmer_satasii;
 extern const struct programmer_entry programmer_serprog;
@@ -128,6 +130,13 @@ struct bitbang_spi_master {
 	/* optional functions to optimize xfers */
 	void (*set_sck_set_mosi) (int sck, int mosi, void *spi_data);
 	int (*set_sck_get_miso) (int sck, void *spi_data);
+	/*
+	 * optional functions to shift whole bytes MSB first, with CS# already
+	 * asserted. SCK may be high or low on entry. These have to honour
+	 * half_period themselves.
+	 */
+	void (*shift_out_bytes) (const uint8_t *buf, unsigned int len, void *spi_data);
+	void (*shift_in_bytes) (uint8_t *buf, unsigned int len, void *spi_data);
 	/* Length of half a clock period in usecs. */
 	unsigned int half_period;
 };
@@ -230,6 +239,7 @@ void myusec_delay(unsigned int usecs);
 void myusec_calibrate_delay(void);
 void internal_sleep(unsigned int usecs);
 void internal_delay(unsigned int usecs);
+uint64_t internal_clock_ns(void);
 
 #if CONFIG_INTERNAL == 1
 /* board_enable.c */
@@ -310,6 +320,7 @@ char *extract_programmer_param_str(const char *param_name);
 /* spi.c */
 #define MAX_DATA_UNSPECIFIED 0
 #define MAX_DATA_READ_UNLIMITED 64 * 1024
+#define MAX_DATA_ERASE_UNLIMITED INT_MAX
 #define MAX_DATA_WRITE_UNLIMITED 256
 
 #define SPI_MASTER_4BA			(1U << 0)  /**< Can handle 4-byte addresses */
@@ -414,6 +425,11 @@ int wbsio_check_for_spi(void);
 struct opaque_master {
 	int max_data_read;
 	int max_data_write;
+	/*
+	 * Largest run of adjacent, same-size erase blocks (in bytes) that the
+	 * erase function handles in one call. Zero means one block at a time.
+	 */
+	int max_data_erase;
 	/* Specific functions for this master */
 	int (*probe) (struct flashctx *flash);
 	int (*read) (struct flashctx *flash, uint8_t *buf, unsigned int start, unsigned int len);
@@ -468,10 +484,34 @@ struct registered_master {
 		struct opaque_master opaque;
 	};
 };
+/* The limit of 4 is totally arbitrary. */
+#define MASTERS_MAX 4
 extern struct registered_master registered_masters[];
 extern int registered_master_count;
 int register_master(const struct registered_master *mst);
 
+/* record.c */
+/* Payload of FLASHROM_TRACE_REGISTER_MASTER records. */
+struct record_master {
+	uint32_t buses_supported;
+	uint32_t spi_features;
+	uint32_t spi_max_data_read;
+	uint32_t spi_max_data_write;
+	int32_t opaque_max_data_read;
+	int32_t opaque_max_data_write;
+	int32_t opaque_max_data_erase;
+	uint32_t reserved;
+};
+/* Payload of FLASHROM_TRACE_OPAQUE_PROBE records, the chip as the master probed it. */
+struct record_opaque_chip {
+	uint32_t total_size;
+	uint32_t page_size;
+	int32_t feature_bits;
+	/* Regions of the first block eraser, size and count. */
+	uint32_t eraseblocks[NUM_ERASEREGIONS][2];
+};
+void record_register_master(struct registered_master *mst, unsigned int index);
+
 
 
 /* serial.c */
@@ -491,6 +531,11 @@ typedef int fdtype;
  */
 int cros_ec_probe_dev(void);
 int cros_ec_need_2nd_pass(void);
+/*
+ * Returns the i-th range that was denied during the 1st pass in start/len,
+ * non-zero if there are no more ranges.
+ */
+int cros_ec_denied_range(size_t i, unsigned int *start, unsigned int *len);
 int cros_ec_finish(void);
 int cros_ec_prepare(struct flashctx *flash, uint8_t *image, int size);
 
@@ -500,6 +545,7 @@ extern fdtype sp_fd;
 int serialport_config(fdtype fd, int baud);
 int serialport_shutdown(void *data);
 int serialport_write(const unsigned char *buf, unsigned int writecnt);
+int serialport_write_buffered(const unsigned char *buf, unsigned int writecnt);
 int serialport_write_nonblock(const unsigned char *buf, unsigned int writecnt, unsigned int timeout, unsigned int *really_wrote);
 int serialport_read(unsigned char *buf, unsigned int readcnt);
 int serialport_read_nonblock(unsigned char *c, unsigned int readcnt, unsigned int timeout, unsigned int *really_read);
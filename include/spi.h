@@ -189,6 +189,9 @@
 /* Read the memory (with delay after sending address) */
 #define JEDEC_READ_FAST		0x0b
 
+/* Longest read instruction: opcode, 4-byte address and one dummy byte */
+#define JEDEC_MAX_READ_CMD_LEN	(1 + JEDEC_MAX_ADDR_LEN + 1)
+
 /* Write memory byte */
 #define JEDEC_BYTE_PROGRAM		0x02
 #define JEDEC_BYTE_PROGRAM_OUTSIZE	0x05
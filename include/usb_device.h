@@ -178,4 +178,76 @@ int usb_device_claim(struct usb_device *device);
  */
 struct usb_device *usb_device_free(struct usb_device *device);
 
+/*
+ * Asynchronous bulk transfer queue
+ *
+ * A usb_async_queue keeps up to a fixed number of bulk transfers in flight on
+ * a single endpoint, so that the device doesn't have to wait for the host
+ * between two transfers.  Transfers are submitted with usb_async_submit() and
+ * reaped in submission order with usb_async_wait().  The buffers passed to
+ * usb_async_submit() must stay valid until their transfer was reaped, which
+ * buffers owned by the queue (see usb_async_buffer()) always do.
+ *
+ * All functions returning int return 0 on success and a flashrom error code
+ * (see LIBUSB_ERROR) on failure.
+ */
+struct usb_async_queue;
+
+/*
+ * Allocate a queue for up to depth concurrent transfers on endpoint.  The
+ * endpoint's direction bit determines the direction of the transfers.  Every
+ * transfer times out after timeout_ms milliseconds.  Unless buffer_size is 0,
+ * every transfer slot gets a buffer of buffer_size bytes along with the queue.
+ *
+ * Return:
+ *     The new queue or NULL if it could not be allocated.
+ */
+struct usb_async_queue *usb_async_queue_new(libusb_context *context,
+					    libusb_device_handle *handle,
+					    unsigned char endpoint,
+					    unsigned int depth,
+					    unsigned int buffer_size,
+					    unsigned int timeout_ms);
+
+/*
+ * Return the buffer of the slot the next usb_async_submit() uses.  The slot
+ * must be free, i.e. usb_async_pending() below the depth of the queue.
+ */
+unsigned char *usb_async_buffer(struct usb_async_queue *queue);
+
+/*
+ * Submit a transfer of length bytes from or to buffer.  If the queue is full,
+ * the oldest transfer is reaped first.  Unless short_ok is set, a transfer
+ * that moved less than length bytes is treated as failed.
+ */
+int usb_async_submit(struct usb_async_queue *queue, unsigned char *buffer,
+		     int length, bool short_ok);
+
+/*
+ * Return the number of submitted transfers that were not reaped yet.
+ */
+unsigned int usb_async_pending(struct usb_async_queue const *queue);
+
+/*
+ * Wait for the oldest pending transfer to finish and reap it.  If
+ * actual_length is not NULL it is set to the number of bytes transferred.
+ */
+int usb_async_wait(struct usb_async_queue *queue, int *actual_length);
+
+/*
+ * Wait for all pending transfers to finish and reap them.  All transfers are
+ * reaped even if one of them failed, the first error is returned.
+ */
+int usb_async_wait_all(struct usb_async_queue *queue);
+
+/*
+ * Cancel all pending transfers and wait until libusb gave them back.
+ */
+void usb_async_cancel(struct usb_async_queue *queue);
+
+/*
+ * Cancel all pending transfers and free the queue with its buffers.
+ */
+void usb_async_queue_free(struct usb_async_queue *queue);
+
 #endif /* USB_DEVICE_H */
@@ -261,6 +261,7 @@ static int it8716f_spi_chip_write_256(struct flashctx *flash, const uint8_t *buf
 				      unsigned int start, unsigned int len)
 {
 	const struct flashchip *chip = flash->chip;
+	const unsigned int first = start, total = len;
 	/*
 	 * IT8716F only allows maximum of 512 kb SPI chip size for memory
 	 * mapped access. It also can't write more than 1+3+256 bytes at once,
@@ -291,7 +292,7 @@ static int it8716f_spi_chip_write_256(struct flashctx *flash, const uint8_t *buf
 			int ret = it8716f_spi_page_program(flash, buf, start);
 			if (ret)
 				return ret;
-			update_progress(flash, FLASHROM_PROGRESS_WRITE, chip->page_size - len, chip->page_size);
+			update_progress(flash, FLASHROM_PROGRESS_WRITE, start + chip->page_size - first, total);
 			start += chip->page_size;
 			len -= chip->page_size;
 			buf += chip->page_size;
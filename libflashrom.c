@@ -79,19 +79,6 @@ void flashrom_set_progress_callback(struct flashrom_flashctx *flashctx, flashrom
 	flashctx->progress_callback = progress_callback;
 	flashctx->progress_state = progress_state;
 }
-/** @private */
-void update_progress(struct flashrom_flashctx *flashctx, enum flashrom_progress_stage stage, size_t current, size_t total)
-{
-	if (flashctx->progress_callback == NULL)
-		return;
-	if (current > total)
-		current = total;
-
-	flashctx->progress_state->stage = stage;
-	flashctx->progress_state->current = current;
-	flashctx->progress_state->total = total;
-	flashctx->progress_callback(flashctx);
-}
 
 const char *flashrom_version_info(void)
 {
@@ -301,6 +288,7 @@ void flashrom_flash_release(struct flashrom_flashctx *const flashctx)
 	if (!flashctx)
 		return;
 
+	stats_release(flashctx);
 	flashrom_layout_release(flashctx->default_layout);
 	free(flashctx->chip);
 	free(flashctx);
@@ -435,6 +435,8 @@ static const struct opaque_master linux_mtd_opaque_master = {
 	/* max_data_{read,write} don't have any effect for this programmer */
 	.max_data_read	= MAX_DATA_UNSPECIFIED,
 	.max_data_write	= MAX_DATA_UNSPECIFIED,
+	/* linux_mtd_erase() walks the erase blocks itself */
+	.max_data_erase	= MAX_DATA_ERASE_UNLIMITED,
 	.probe		= linux_mtd_probe,
 	.read		= linux_mtd_read,
 	.write		= linux_mtd_write,
@@ -33,16 +33,25 @@ int probe_opaque(struct flashctx *flash)
 
 int read_opaque(struct flashctx *flash, uint8_t *buf, unsigned int start, unsigned int len)
 {
+	if (flash->stats)
+		return stats_read_opaque(flash, buf, start, len);
+
 	return flash->mst->opaque.read(flash, buf, start, len);
 }
 
 int write_opaque(struct flashctx *flash, const uint8_t *buf, unsigned int start, unsigned int len)
 {
+	if (flash->stats)
+		return stats_write_opaque(flash, buf, start, len);
+
 	return flash->mst->opaque.write(flash, buf, start, len);
 }
 
 int erase_opaque(struct flashctx *flash, unsigned int blockaddr, unsigned int blocklen)
 {
+	if (flash->stats)
+		return stats_erase_opaque(flash, blockaddr, blocklen);
+
 	return flash->mst->opaque.erase(flash, blockaddr, blocklen);
 }
 
@@ -80,22 +80,14 @@ typedef struct {
 	uint8_t control;
 } packet_t;
 
-static int parade_lspcon_write_data(int fd, uint16_t addr, void *buf, uint16_t len)
+static void parade_lspcon_batch_write_register(struct i2c_batch *batch, uint8_t i2c_register, uint8_t value)
 {
-	i2c_buffer_t data;
-	if (i2c_buffer_t_fill(&data, buf, len))
-		return SPI_GENERIC_ERROR;
-
-	return i2c_write(fd, addr, &data) == len ? 0 : SPI_GENERIC_ERROR;
+	i2c_batch_write_reg(batch, REGISTER_ADDRESS, i2c_register, &value, 1);
 }
 
-static int parade_lspcon_read_data(int fd, uint16_t addr, void *buf, uint16_t len)
+static int parade_lspcon_batch_submit(int fd, struct i2c_batch *batch)
 {
-	i2c_buffer_t data;
-	if (i2c_buffer_t_fill(&data, buf, len))
-		return SPI_GENERIC_ERROR;
-
-	return i2c_read(fd, addr, &data) == len ? 0 : SPI_GENERIC_ERROR;
+	return i2c_batch_submit(fd, batch) ? SPI_GENERIC_ERROR : 0;
 }
 
 static int get_fd_from_context(const struct flashctx *flash)
@@ -112,36 +104,39 @@ static int get_fd_from_context(const struct flashctx *flash)
 
 static int parade_lspcon_write_register(int fd, uint8_t i2c_register, uint8_t value)
 {
-	uint8_t command[] = { i2c_register, value };
-	return parade_lspcon_write_data(fd, REGISTER_ADDRESS, command, 2);
+	struct i2c_batch batch;
+	i2c_batch_init(&batch);
+	parade_lspcon_batch_write_register(&batch, i2c_register, value);
+
+	return parade_lspcon_batch_submit(fd, &batch);
 }
 
 static int parade_lspcon_read_register(int fd, uint8_t i2c_register, uint8_t *value)
 {
-	uint8_t command[] = { i2c_register };
-	int ret = parade_lspcon_write_data(fd, REGISTER_ADDRESS, command, 1);
-	ret |= parade_lspcon_read_data(fd, REGISTER_ADDRESS, value, 1);
+	struct i2c_batch batch;
+	i2c_batch_init(&batch);
+	i2c_batch_read_reg(&batch, REGISTER_ADDRESS, i2c_register, value, 1);
 
-	return ret ? SPI_GENERIC_ERROR : 0;
+	return parade_lspcon_batch_submit(fd, &batch);
 }
 
 static int parade_lspcon_register_control(int fd, packet_t *packet)
 {
 	int i;
-	int ret = parade_lspcon_write_register(fd, SWSPI_WDATA, packet->command);
-	if (ret)
-		return ret;
+	struct i2c_batch batch;
+	i2c_batch_init(&batch);
+	parade_lspcon_batch_write_register(&batch, SWSPI_WDATA, packet->command);
 
 	/* Higher 4 bits are read size. */
 	int write_size = packet->data_size & 0x0f;
 	for (i = 0; i < write_size; ++i) {
-		ret |= parade_lspcon_write_register(fd, SWSPI_WDATA, packet->data[i]);
+		parade_lspcon_batch_write_register(&batch, SWSPI_WDATA, packet->data[i]);
 	}
 
-	ret |= parade_lspcon_write_register(fd, SWSPI_LEN, packet->data_size);
-	ret |= parade_lspcon_write_register(fd, SWSPICTL, packet->control);
+	parade_lspcon_batch_write_register(&batch, SWSPI_LEN, packet->data_size);
+	parade_lspcon_batch_write_register(&batch, SWSPICTL, packet->control);
 
-	return ret;
+	return parade_lspcon_batch_submit(fd, &batch);
 }
 
 static int parade_lspcon_wait_command_done(int fd, unsigned int offset, int mask)
@@ -285,9 +280,12 @@ static int parade_lspcon_send_command(const struct flashctx *flash,
 	if (ret)
 		return ret;
 
+	struct i2c_batch batch;
+	i2c_batch_init(&batch);
 	for (i = 0; i < readcnt; ++i) {
-		ret |= parade_lspcon_read_register(fd, SWSPI_RDATA, &readarr[i]);
+		i2c_batch_read_reg(&batch, REGISTER_ADDRESS, SWSPI_RDATA, &readarr[i], 1);
 	}
+	ret |= parade_lspcon_batch_submit(fd, &batch);
 
 	ret |= parade_lspcon_wait_rom_free(fd);
 
@@ -296,15 +294,16 @@ static int parade_lspcon_send_command(const struct flashctx *flash,
 
 static int parade_lspcon_enable_hw_write(int fd)
 {
-	int ret = 0;
-	ret |= parade_lspcon_write_register(fd, PAGE_HW_WRITE, PAGE_HW_COFIG_REGISTER);
-	ret |= parade_lspcon_write_register(fd, PAGE_HW_WRITE, PAGE_HW_WRITE_ENABLE);
-	ret |= parade_lspcon_write_register(fd, PAGE_HW_WRITE, 0x50);
-	ret |= parade_lspcon_write_register(fd, PAGE_HW_WRITE, 0x41);
-	ret |= parade_lspcon_write_register(fd, PAGE_HW_WRITE, 0x52);
-	ret |= parade_lspcon_write_register(fd, PAGE_HW_WRITE, 0x44);
-
-	return ret;
+	struct i2c_batch batch;
+	i2c_batch_init(&batch);
+	parade_lspcon_batch_write_register(&batch, PAGE_HW_WRITE, PAGE_HW_COFIG_REGISTER);
+	parade_lspcon_batch_write_register(&batch, PAGE_HW_WRITE, PAGE_HW_WRITE_ENABLE);
+	parade_lspcon_batch_write_register(&batch, PAGE_HW_WRITE, 0x50);
+	parade_lspcon_batch_write_register(&batch, PAGE_HW_WRITE, 0x41);
+	parade_lspcon_batch_write_register(&batch, PAGE_HW_WRITE, 0x52);
+	parade_lspcon_batch_write_register(&batch, PAGE_HW_WRITE, 0x44);
+
+	return parade_lspcon_batch_submit(fd, &batch);
 }
 
 static int parade_lspcon_i2c_clt2_spi_reset(int fd)
@@ -329,14 +328,11 @@ static int parade_lspcon_set_mpu_active(int fd, int running)
 	return ret;
 }
 
-static int parade_lspcon_map_page(int fd, unsigned int offset)
+static void parade_lspcon_batch_map_page(struct i2c_batch *batch, unsigned int offset)
 {
-	int ret = 0;
 	/* Page number byte, need to / TUNNEL_PAGE_SIZE. */
-	ret |= parade_lspcon_write_register(fd, ROMADDR_BYTE1, (offset >> 8) & 0xff);
-	ret |= parade_lspcon_write_register(fd, ROMADDR_BYTE2, (offset >> 16));
-
-	return ret ? SPI_GENERIC_ERROR : 0;
+	parade_lspcon_batch_write_register(batch, ROMADDR_BYTE1, (offset >> 8) & 0xff);
+	parade_lspcon_batch_write_register(batch, ROMADDR_BYTE2, (offset >> 16));
 }
 
 static int parade_lspcon_read(struct flashctx *flash, uint8_t *buf,
@@ -351,31 +347,19 @@ static int parade_lspcon_read(struct flashctx *flash, uint8_t *buf,
 	if (fd < 0)
 		return SPI_GENERIC_ERROR;
 
+	struct i2c_batch batch;
+	i2c_batch_init(&batch);
 	for (i = 0; i < len; i += TUNNEL_PAGE_SIZE) {
-		ret |= parade_lspcon_map_page(fd, start + i);
-		ret |= parade_lspcon_read_data(fd, PAGE_ADDRESS, buf + i, min(len - i, TUNNEL_PAGE_SIZE));
+		/* Map and read each page in a single transaction. */
+		parade_lspcon_batch_map_page(&batch, start + i);
+		i2c_batch_read(&batch, PAGE_ADDRESS, buf + i, min(len - i, TUNNEL_PAGE_SIZE));
+		ret |= parade_lspcon_batch_submit(fd, &batch);
 		update_progress(flash, FLASHROM_PROGRESS_READ, i + TUNNEL_PAGE_SIZE, len);
 	}
 
 	return ret;
 }
 
-static int parade_lspcon_write_page(int fd, const uint8_t *buf, unsigned int len)
-{
-	/**
-         * Using static buffer with maximum possible size,
-         * extra byte is needed for prefixing zero at index 0.
-         */
-	uint8_t write_buffer[TUNNEL_PAGE_SIZE + 1] = { 0 };
-	if (len > TUNNEL_PAGE_SIZE)
-		return SPI_GENERIC_ERROR;
-
-	/* First byte represents the writing offset and should always be zero. */
-	memcpy(&write_buffer[1], buf, len);
-
-	return parade_lspcon_write_data(fd, PAGE_ADDRESS, write_buffer, len + 1);
-}
-
 static int parade_lspcon_write_256(struct flashctx *flash, const uint8_t *buf,
 				unsigned int start, unsigned int len)
 {
@@ -392,9 +376,13 @@ static int parade_lspcon_write_256(struct flashctx *flash, const uint8_t *buf,
 	ret |= parade_lspcon_enable_hw_write(fd);
 	ret |= parade_lspcon_i2c_clt2_spi_reset(fd);
 
+	struct i2c_batch batch;
+	i2c_batch_init(&batch);
 	for (unsigned int i = 0; i < len; i += TUNNEL_PAGE_SIZE) {
-		ret |= parade_lspcon_map_page(fd, start + i);
-		ret |= parade_lspcon_write_page(fd, buf + i, min(len - i, TUNNEL_PAGE_SIZE));
+		parade_lspcon_batch_map_page(&batch, start + i);
+		/* First byte represents the writing offset and should always be zero. */
+		i2c_batch_write_reg(&batch, PAGE_ADDRESS, 0, buf + i, min(len - i, TUNNEL_PAGE_SIZE));
+		ret |= parade_lspcon_batch_submit(fd, &batch);
 		update_progress(flash, FLASHROM_PROGRESS_WRITE, i + TUNNEL_PAGE_SIZE, len);
 	}
 
@@ -80,8 +80,6 @@ void fallback_chip_readn(const struct flashctx *flash, uint8_t *buf,
 	return;
 }
 
-/* The limit of 4 is totally arbitrary. */
-#define MASTERS_MAX 4
 struct registered_master registered_masters[MASTERS_MAX];
 int registered_master_count = 0;
 
@@ -94,6 +92,7 @@ int register_master(const struct registered_master *mst)
 		return ERROR_FLASHROM_LIMIT;
 	}
 	registered_masters[registered_master_count] = *mst;
+	record_register_master(&registered_masters[registered_master_count], registered_master_count);
 	registered_master_count++;
 
 	return 0;
@@ -24,6 +24,10 @@ const struct programmer_entry *const programmer_table[] = {
     &programmer_dummy,
 #endif
 
+#if CONFIG_REPLAY == 1
+    &programmer_replay,
+#endif
+
 #if CONFIG_NIC3COM == 1
     &programmer_nic3com,
 #endif
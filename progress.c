@@ -0,0 +1,267 @@
+/*
+ * This file is part of the flashrom project.
+ *
+ * Copyright 2026 Google LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Progress reporting.
+ *
+ * The image operations in flashrom.c plan the bytes of each stage with
+ * progress_add_total() and wrap every chip access in progress_call_begin()
+ * and progress_call_end(). The chip drivers report their progress within
+ * such an access with update_progress(), which is scaled to the length of
+ * the access, so that drivers with odd units still add up to the totals.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "flash.h"
+#include "programmer.h"
+
+/* Period of the throughput samples and time constant of their smoothing. */
+#define PROGRESS_SAMPLE_NS	(100ull * 1000 * 1000)
+#define PROGRESS_SMOOTHING_NS	(2000ull * 1000 * 1000)
+
+static size_t progress_sum(const size_t *bytes)
+{
+	size_t sum = 0;
+	enum flashrom_progress_stage stage;
+
+	for (stage = 0; stage < FLASHROM_PROGRESS_NR; stage++)
+		sum += bytes[stage];
+	return sum;
+}
+
+static void progress_sample(struct progress_engine *p, uint64_t now, size_t op_current)
+{
+	const uint64_t dt = now - p->sample_ns;
+
+	if (dt < PROGRESS_SAMPLE_NS || op_current < p->sample_bytes)
+		return;
+
+	const double rate = (double)(op_current - p->sample_bytes) * 1e9 / dt;
+	if (p->rate == 0)
+		p->rate = rate;
+	else
+		p->rate += (rate - p->rate) * dt / (dt + PROGRESS_SMOOTHING_NS);
+	p->sample_ns = now;
+	p->sample_bytes = op_current;
+}
+
+static double progress_stage_rate(const struct progress_engine *p, enum flashrom_progress_stage stage,
+				  uint64_t now)
+{
+	size_t bytes = p->stage_done[stage];
+	uint64_t ns = p->stage_ns[stage];
+
+	if (p->depth && p->stage == stage) {
+		bytes += p->call_done;
+		ns += now - p->call_start_ns;
+	}
+	return bytes && ns ? (double)bytes * 1e9 / ns : 0;
+}
+
+/*
+ * Stages run at very different speeds, so the time left is estimated from
+ * the rate of each stage so far. A verify is about as fast as a read.
+ */
+static uint64_t progress_eta_ms(const struct progress_engine *p, uint64_t now)
+{
+	double eta_ms = 0;
+	enum flashrom_progress_stage stage;
+
+	for (stage = 0; stage < FLASHROM_PROGRESS_NR; stage++) {
+		size_t left = p->stage_total[stage] - p->stage_done[stage];
+		if (p->depth && p->stage == stage)
+			left -= p->call_done;
+		if (!left)
+			continue;
+
+		double rate = progress_stage_rate(p, stage, now);
+		if (rate == 0 && stage == FLASHROM_PROGRESS_VERIFY)
+			rate = progress_stage_rate(p, FLASHROM_PROGRESS_READ, now);
+		if (rate == 0)
+			rate = p->rate;
+		if (rate == 0)
+			return UINT64_MAX;
+		eta_ms += left * 1000.0 / rate;
+	}
+	return eta_ms;
+}
+
+/* Whether the callback is due, the first and the last update of a stage always are. */
+static bool progress_due(struct progress_engine *p, const struct flashrom_progress *state,
+			 enum flashrom_progress_stage stage, size_t current, size_t total, uint64_t now)
+{
+	if (state->interval_ms && (p->reported_stages & (1u << stage)) && current < total &&
+	    now - p->last_report_ns < (uint64_t)state->interval_ms * 1000 * 1000)
+		return false;
+
+	p->reported_stages |= 1u << stage;
+	p->last_report_ns = now;
+	return true;
+}
+
+static void progress_report(struct flashctx *flash, bool force)
+{
+	struct progress_engine *p = &flash->progress;
+	struct flashrom_progress *state = flash->progress_state;
+	const uint64_t now = internal_clock_ns();
+	const size_t current = p->stage_done[p->stage] + p->call_done;
+	const size_t total = p->stage_total[p->stage];
+	const size_t op_current = progress_sum(p->stage_done) + p->call_done;
+	const size_t op_total = progress_sum(p->stage_total);
+
+	progress_sample(p, now, op_current);
+	if (!progress_due(p, state, p->stage, current, total, now) && !force)
+		return;
+
+	state->stage = p->stage;
+	state->current = current;
+	state->total = total;
+	state->op_current = op_current;
+	state->op_total = op_total;
+	state->rate = p->rate;
+	state->elapsed_ms = (now - p->start_ns) / (1000 * 1000);
+	state->eta_ms = progress_eta_ms(p, now);
+	flash->progress_callback(flash);
+}
+
+/** @private */
+void update_progress(struct flashctx *flash, enum flashrom_progress_stage stage, size_t current, size_t total)
+{
+	struct progress_engine *p = &flash->progress;
+
+	if (flash->progress_callback == NULL)
+		return;
+	if (current > total)
+		current = total;
+	if (p->segment_total && total) {
+		current = p->segment_offset + (uint64_t)p->segment_len * current / total;
+		total = p->segment_total;
+	}
+
+	if (p->active) {
+		/* Nested accesses, e.g. paranoid verifies while writing, are not planned. */
+		if (p->depth != 1 || !total)
+			return;
+		const size_t done = (uint64_t)p->call_len * current / total;
+		if (done > p->call_done)
+			p->call_done = done;
+		progress_report(flash, false);
+		return;
+	}
+
+	/* A single chip access outside of an image operation. */
+	struct flashrom_progress *state = flash->progress_state;
+	if (!progress_due(p, state, stage, current, total, internal_clock_ns()))
+		return;
+	state->stage = stage;
+	state->current = current;
+	state->total = total;
+	state->op_current = current;
+	state->op_total = total;
+	state->rate = 0;
+	state->elapsed_ms = 0;
+	state->eta_ms = current == total ? 0 : UINT64_MAX;
+	flash->progress_callback(flash);
+}
+
+void progress_start(struct flashctx *flash)
+{
+	struct progress_engine *p = &flash->progress;
+
+	memset(p, 0, sizeof(*p));
+	if (flash->progress_callback == NULL)
+		return;
+	p->active = true;
+	p->start_ns = internal_clock_ns();
+	p->sample_ns = p->start_ns;
+}
+
+void progress_add_total(struct flashctx *flash, enum flashrom_progress_stage stage, size_t bytes)
+{
+	flash->progress.stage_total[stage] += bytes;
+}
+
+void progress_call_begin(struct flashctx *flash, enum flashrom_progress_stage stage, size_t len)
+{
+	struct progress_engine *p = &flash->progress;
+
+	if (!p->active || p->depth++)
+		return;
+
+	p->stage = stage;
+	p->call_len = len;
+	p->call_done = 0;
+	p->call_start_ns = internal_clock_ns();
+	/* Work which was not planned, e.g. retries, grows the total. */
+	if (p->stage_done[stage] + len > p->stage_total[stage])
+		p->stage_total[stage] = p->stage_done[stage] + len;
+	progress_report(flash, false);
+}
+
+void progress_call_end(struct flashctx *flash)
+{
+	struct progress_engine *p = &flash->progress;
+
+	if (!p->active || --p->depth)
+		return;
+
+	/* Drivers which don't report progress themselves complete here. */
+	p->stage_done[p->stage] += p->call_len;
+	p->stage_ns[p->stage] += internal_clock_ns() - p->call_start_ns;
+	p->call_done = 0;
+	progress_report(flash, false);
+}
+
+/*
+ * Drivers which split an access into parts, e.g. spi_chip_read(), report the
+ * progress of each part with the part's own total. In between these calls,
+ * update_progress() maps such reports to bytes offset to offset + len of the
+ * total bytes of the whole access.
+ */
+void progress_segment_begin(struct flashctx *flash, size_t offset, size_t len, size_t total)
+{
+	struct progress_engine *p = &flash->progress;
+
+	p->segment_offset = offset;
+	p->segment_len = len;
+	p->segment_total = total;
+}
+
+void progress_segment_end(struct flashctx *flash)
+{
+	flash->progress.segment_total = 0;
+}
+
+void progress_finish(struct flashctx *flash)
+{
+	struct progress_engine *p = &flash->progress;
+	enum flashrom_progress_stage stage;
+
+	if (!p->active)
+		return;
+
+	/* Planned work which turned out to be unnecessary, e.g. a skipped verify, is dropped. */
+	for (stage = 0; stage < FLASHROM_PROGRESS_NR; stage++)
+		p->stage_total[stage] = p->stage_done[stage];
+	if (p->rate == 0) {
+		const uint64_t elapsed = internal_clock_ns() - p->start_ns;
+		if (elapsed)
+			p->rate = (double)progress_sum(p->stage_done) * 1e9 / elapsed;
+	}
+	progress_report(flash, true);
+	p->active = false;
+}
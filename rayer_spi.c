@@ -221,6 +221,53 @@ static int rayer_bitbang_get_miso(void *spi_data)
 	return tmp;
 }
 
+/* Shift whole bytes without going through the per-bit callbacks. */
+static void rayer_bitbang_shift_out_bytes(const uint8_t *buf, unsigned int len, void *spi_data)
+{
+	struct rayer_spi_data *data = spi_data;
+	const uint8_t sck = 1 << data->pinout->sck_bit;
+	const uint8_t mosi = 1 << data->pinout->mosi_bit;
+	uint8_t outbyte = data->lpt_outbyte;
+	unsigned int i;
+	int bit;
+
+	for (i = 0; i < len; i++) {
+		for (bit = 7; bit >= 0; bit--) {
+			/* Set up MOSI together with the falling edge of SCK. */
+			outbyte &= ~(sck | mosi);
+			if ((buf[i] >> bit) & 1)
+				outbyte |= mosi;
+			OUTB(outbyte, data->lpt_iobase);
+			outbyte |= sck;
+			OUTB(outbyte, data->lpt_iobase);
+		}
+	}
+	data->lpt_outbyte = outbyte;
+}
+
+static void rayer_bitbang_shift_in_bytes(uint8_t *buf, unsigned int len, void *spi_data)
+{
+	struct rayer_spi_data *data = spi_data;
+	const uint8_t sck = 1 << data->pinout->sck_bit;
+	const uint8_t mosi = 1 << data->pinout->mosi_bit;
+	uint8_t outbyte = data->lpt_outbyte & ~mosi;
+	unsigned int i;
+	int bit;
+
+	for (i = 0; i < len; i++) {
+		uint8_t val = 0;
+		for (bit = 7; bit >= 0; bit--) {
+			OUTB(outbyte & ~sck, data->lpt_iobase);
+			OUTB(outbyte | sck, data->lpt_iobase);
+			val <<= 1;
+			val |= ((INB(data->lpt_iobase + 1) ^ 0x80) >> data->pinout->miso_bit) & 0x1;
+		}
+		buf[i] = val;
+	}
+	if (len)
+		data->lpt_outbyte = outbyte | sck;
+}
+
 static int rayer_shutdown(void *spi_data)
 {
 	free(spi_data);
@@ -232,6 +279,8 @@ static const struct bitbang_spi_master bitbang_spi_master_rayer = {
 	.set_sck	= rayer_bitbang_set_sck,
 	.set_mosi	= rayer_bitbang_set_mosi,
 	.get_miso	= rayer_bitbang_get_miso,
+	.shift_out_bytes	= rayer_bitbang_shift_out_bytes,
+	.shift_in_bytes		= rayer_bitbang_shift_in_bytes,
 	.half_period	= 0,
 };
 
@@ -54,22 +54,14 @@ struct realtek_mst_i2c_spi_data {
 	bool reset;
 };
 
-static int realtek_mst_i2c_spi_write_data(int fd, uint16_t addr, void *buf, uint16_t len)
+static void realtek_mst_i2c_spi_batch_write_register(struct i2c_batch *batch, uint8_t reg, uint8_t value)
 {
-	i2c_buffer_t data;
-	if (i2c_buffer_t_fill(&data, buf, len))
-		return SPI_GENERIC_ERROR;
-
-	return i2c_write(fd, addr, &data) == len ? 0 : SPI_GENERIC_ERROR;
+	i2c_batch_write_reg(batch, REGISTER_ADDRESS, reg, &value, 1);
 }
 
-static int realtek_mst_i2c_spi_read_data(int fd, uint16_t addr, void *buf, uint16_t len)
+static int realtek_mst_i2c_spi_batch_submit(int fd, struct i2c_batch *batch)
 {
-	i2c_buffer_t data;
-	if (i2c_buffer_t_fill(&data, buf, len))
-		return SPI_GENERIC_ERROR;
-
-	return i2c_read(fd, addr, &data) == len ? 0 : SPI_GENERIC_ERROR;
+	return i2c_batch_submit(fd, batch) ? SPI_GENERIC_ERROR : 0;
 }
 
 static int get_fd_from_context(const struct flashctx *flash)
@@ -86,17 +78,20 @@ static int get_fd_from_context(const struct flashctx *flash)
 
 static int realtek_mst_i2c_spi_write_register(int fd, uint8_t reg, uint8_t value)
 {
-	uint8_t command[] = { reg, value };
-	return realtek_mst_i2c_spi_write_data(fd, REGISTER_ADDRESS, command, 2);
+	struct i2c_batch batch;
+	i2c_batch_init(&batch);
+	realtek_mst_i2c_spi_batch_write_register(&batch, reg, value);
+
+	return realtek_mst_i2c_spi_batch_submit(fd, &batch);
 }
 
 static int realtek_mst_i2c_spi_read_register(int fd, uint8_t reg, uint8_t *value)
 {
-	uint8_t command[] = { reg };
-	int ret = realtek_mst_i2c_spi_write_data(fd, REGISTER_ADDRESS, command, 1);
-	ret |= realtek_mst_i2c_spi_read_data(fd, REGISTER_ADDRESS, value, 1);
+	struct i2c_batch batch;
+	i2c_batch_init(&batch);
+	i2c_batch_read_reg(&batch, REGISTER_ADDRESS, reg, value, 1);
 
-	return ret ? SPI_GENERIC_ERROR : 0;
+	return realtek_mst_i2c_spi_batch_submit(fd, &batch);
 }
 
 static int realtek_mst_i2c_spi_wait_command_done(int fd, unsigned int offset, int mask,
@@ -136,13 +131,6 @@ static int realtek_mst_i2c_spi_enter_isp_mode(int fd)
 	return ret;
 }
 
-static int realtek_mst_i2c_execute_write(int fd)
-{
-	int ret = realtek_mst_i2c_spi_write_register(fd, MCU_MODE, START_WRITE_XFER);
-	ret |= realtek_mst_i2c_spi_wait_command_done(fd, MCU_MODE, WRITE_XFER_STATUS_MASK, 0, 1);
-	return ret;
-}
-
 static int realtek_mst_i2c_spi_reset_mpu(int fd)
 {
 	uint8_t mcu_mode_val;
@@ -269,12 +257,15 @@ static int realtek_mst_i2c_spi_send_command(const struct flashctx *flash,
 		/* Otherwise things like RDID,REMS,READ require BIT6 */
 		ctrl_reg_val |= (2 << 5);
 	}
-	ret |= realtek_mst_i2c_spi_write_register(fd, 0x60, ctrl_reg_val);
-	ret |= realtek_mst_i2c_spi_write_register(fd, 0x61, writearr[0]); /* opcode */
+	struct i2c_batch batch;
+	i2c_batch_init(&batch);
+	realtek_mst_i2c_spi_batch_write_register(&batch, 0x60, ctrl_reg_val);
+	realtek_mst_i2c_spi_batch_write_register(&batch, 0x61, writearr[0]); /* opcode */
 
 	for (i = 0; i < writecnt; ++i)
-		ret |= realtek_mst_i2c_spi_write_register(fd, 0x64 + i, writearr[i + 1]);
-	ret |= realtek_mst_i2c_spi_write_register(fd, 0x60, ctrl_reg_val | 0x1);
+		realtek_mst_i2c_spi_batch_write_register(&batch, 0x64 + i, writearr[i + 1]);
+	realtek_mst_i2c_spi_batch_write_register(&batch, 0x60, ctrl_reg_val | 0x1);
+	ret = realtek_mst_i2c_spi_batch_submit(fd, &batch);
 	if (ret)
 		return ret;
 
@@ -283,39 +274,20 @@ static int realtek_mst_i2c_spi_send_command(const struct flashctx *flash,
 		return ret;
 
 	for (i = 0; i < readcnt; ++i)
-		ret |= realtek_mst_i2c_spi_read_register(fd, 0x67 + i, &readarr[i]);
+		i2c_batch_read_reg(&batch, REGISTER_ADDRESS, 0x67 + i, &readarr[i], 1);
 
-	return ret;
+	return realtek_mst_i2c_spi_batch_submit(fd, &batch);
 }
 
-static int realtek_mst_i2c_spi_map_page(int fd, uint32_t addr)
+static void realtek_mst_i2c_spi_batch_map_page(struct i2c_batch *batch, uint32_t addr)
 {
-	int ret = 0;
-
 	uint8_t block_idx = (addr >> 16) & 0xff;
 	uint8_t page_idx  = (addr >>  8) & 0xff;
 	uint8_t byte_idx  =  addr        & 0xff;
 
-	ret |= realtek_mst_i2c_spi_write_register(fd, MAP_PAGE_BYTE2, block_idx);
-	ret |= realtek_mst_i2c_spi_write_register(fd, MAP_PAGE_BYTE1, page_idx);
-	ret |= realtek_mst_i2c_spi_write_register(fd, MAP_PAGE_BYTE0, byte_idx);
-
-	return ret ? SPI_GENERIC_ERROR : 0;
-}
-
-static int realtek_mst_i2c_spi_write_page(int fd, uint8_t reg, const uint8_t *buf, unsigned int len)
-{
-	/**
-	 * Using static buffer with maximum possible size,
-	 * extra byte is needed for prefixing the data port register at index 0.
-	 */
-	uint8_t wbuf[RTK_PAGE_SIZE + 1] = { MCU_DATA_PORT };
-	if (len > RTK_PAGE_SIZE)
-		return SPI_GENERIC_ERROR;
-
-	memcpy(&wbuf[1], buf, len);
-
-	return realtek_mst_i2c_spi_write_data(fd, REGISTER_ADDRESS, wbuf, len + 1);
+	realtek_mst_i2c_spi_batch_write_register(batch, MAP_PAGE_BYTE2, block_idx);
+	realtek_mst_i2c_spi_batch_write_register(batch, MAP_PAGE_BYTE1, page_idx);
+	realtek_mst_i2c_spi_batch_write_register(batch, MAP_PAGE_BYTE0, byte_idx);
 }
 
 static int realtek_mst_i2c_spi_read(struct flashctx *flash, uint8_t *buf,
@@ -332,11 +304,14 @@ static int realtek_mst_i2c_spi_read(struct flashctx *flash, uint8_t *buf,
 		return SPI_GENERIC_ERROR;
 
 	start--;
-	ret |= realtek_mst_i2c_spi_write_register(fd, 0x60, 0x46); // **
-	ret |= realtek_mst_i2c_spi_write_register(fd, 0x61, OPCODE_READ);
-	ret |= realtek_mst_i2c_spi_map_page(fd, start);
-	ret |= realtek_mst_i2c_spi_write_register(fd, 0x6a, 0x03);
-	ret |= realtek_mst_i2c_spi_write_register(fd, 0x60, 0x47); // **
+	struct i2c_batch batch;
+	i2c_batch_init(&batch);
+	realtek_mst_i2c_spi_batch_write_register(&batch, 0x60, 0x46); // **
+	realtek_mst_i2c_spi_batch_write_register(&batch, 0x61, OPCODE_READ);
+	realtek_mst_i2c_spi_batch_map_page(&batch, start);
+	realtek_mst_i2c_spi_batch_write_register(&batch, 0x6a, 0x03);
+	realtek_mst_i2c_spi_batch_write_register(&batch, 0x60, 0x47); // **
+	ret = realtek_mst_i2c_spi_batch_submit(fd, &batch);
 	if (ret)
 		return ret;
 
@@ -352,8 +327,8 @@ static int realtek_mst_i2c_spi_read(struct flashctx *flash, uint8_t *buf,
 	realtek_mst_i2c_spi_read_register(fd, MCU_DATA_PORT, &dummy);
 
 	for (i = 0; i < len; i += RTK_PAGE_SIZE) {
-		ret |= realtek_mst_i2c_spi_read_data(fd, REGISTER_ADDRESS,
-				buf + i, min(len - i, RTK_PAGE_SIZE));
+		i2c_batch_read(&batch, REGISTER_ADDRESS, buf + i, min(len - i, RTK_PAGE_SIZE));
+		ret |= realtek_mst_i2c_spi_batch_submit(fd, &batch);
 		if (ret)
 			return ret;
 	}
@@ -374,14 +349,17 @@ static int realtek_mst_i2c_spi_write_256(struct flashctx *flash, const uint8_t *
 	if (fd < 0)
 		return SPI_GENERIC_ERROR;
 
-	ret |= realtek_mst_i2c_spi_write_register(fd, 0x6D, 0x02); /* write opcode */
-	ret |= realtek_mst_i2c_spi_write_register(fd, 0x71, (RTK_PAGE_SIZE - 1)); /* fit len=256 */
+	struct i2c_batch batch;
+	i2c_batch_init(&batch);
+	realtek_mst_i2c_spi_batch_write_register(&batch, 0x6D, 0x02); /* write opcode */
+	realtek_mst_i2c_spi_batch_write_register(&batch, 0x71, (RTK_PAGE_SIZE - 1)); /* fit len=256 */
 
 	for (i = 0; i < len; i += RTK_PAGE_SIZE) {
 		uint16_t page_len = min(len - i, RTK_PAGE_SIZE);
 		if (len - i < RTK_PAGE_SIZE)
-			ret |= realtek_mst_i2c_spi_write_register(fd, 0x71, page_len-1);
-		ret |= realtek_mst_i2c_spi_map_page(fd, start + i);
+			realtek_mst_i2c_spi_batch_write_register(&batch, 0x71, page_len-1);
+		realtek_mst_i2c_spi_batch_map_page(&batch, start + i);
+		ret |= realtek_mst_i2c_spi_batch_submit(fd, &batch);
 		if (ret)
 			break;
 
@@ -390,11 +368,13 @@ static int realtek_mst_i2c_spi_write_256(struct flashctx *flash, const uint8_t *
 		if (ret)
 			break;
 
-		ret |= realtek_mst_i2c_spi_write_page(fd, MCU_DATA_PORT,
-				buf + i, page_len);
+		/* Send the page and kick off its write in one transaction. */
+		i2c_batch_write_reg(&batch, REGISTER_ADDRESS, MCU_DATA_PORT, buf + i, page_len);
+		realtek_mst_i2c_spi_batch_write_register(&batch, MCU_MODE, START_WRITE_XFER);
+		ret |= realtek_mst_i2c_spi_batch_submit(fd, &batch);
 		if (ret)
 			break;
-		ret |= realtek_mst_i2c_execute_write(fd);
+		ret |= realtek_mst_i2c_spi_wait_command_done(fd, MCU_MODE, WRITE_XFER_STATUS_MASK, 0, 1);
 		if (ret)
 			break;
 		update_progress(flash, FLASHROM_PROGRESS_WRITE, i + RTK_PAGE_SIZE, len);
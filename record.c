@@ -0,0 +1,288 @@
+/*
+ * This file is part of the flashrom project.
+ *
+ * Copyright 2026 Google LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Recording of programmer sessions, for playback by the replay programmer.
+ *
+ * While recording, register_master() hands every new master to
+ * record_register_master(), which swaps its callbacks for the shims below.
+ * They call the original callback and write a record with the payloads.
+ * Operations a master implements on top of its own callbacks, e.g.
+ * default_spi_read() sending READ commands, are only recorded once, at the
+ * outermost level.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "flash.h"
+#include "programmer.h"
+#include "spi.h"
+
+static struct {
+	FILE *file;
+	uint64_t start_ns;
+	bool error;
+	/* Operations issued by an outer, already recorded operation are not recorded again. */
+	unsigned int depth;
+	/* The callbacks the masters were registered with. */
+	struct registered_master masters[MASTERS_MAX];
+} recording;
+
+static const struct registered_master *original(const struct flashctx *flash)
+{
+	return &recording.masters[flash->mst - registered_masters];
+}
+
+static void record_write(const struct flashctx *flash, enum flashrom_trace_type type, uint8_t opcode,
+			 int result, unsigned int addr, const void *out, unsigned int bytes_out,
+			 const void *in, unsigned int bytes_in, uint64_t start_ns, uint64_t duration_ns)
+{
+	if (!recording.file || recording.error)
+		return;
+
+	const struct flashrom_trace_record record = {
+		.timestamp_ns	= start_ns - recording.start_ns,
+		.duration_ns	= duration_ns,
+		.type		= type,
+		.opcode		= opcode,
+		.result		= result < INT16_MIN ? INT16_MIN : result > INT16_MAX ? INT16_MAX : result,
+		.addr		= addr,
+		.bytes_out	= bytes_out,
+		.bytes_in	= bytes_in,
+		.master		= flash->mst - registered_masters,
+	};
+	if (fwrite(&record, sizeof(record), 1, recording.file) != 1 ||
+	    (bytes_out && fwrite(out, bytes_out, 1, recording.file) != 1) ||
+	    (bytes_in && fwrite(in, bytes_in, 1, recording.file) != 1)) {
+		msg_gerr("Writing the recording failed, recording stopped.\n");
+		recording.error = true;
+	}
+}
+
+static int record_spi_send_command(const struct flashctx *flash, unsigned int writecnt, unsigned int readcnt,
+				   const unsigned char *writearr, unsigned char *readarr)
+{
+	const struct spi_master *const mst = &original(flash)->spi;
+
+	if (!recording.file || recording.depth)
+		return mst->command(flash, writecnt, readcnt, writearr, readarr);
+
+	recording.depth++;
+	const uint64_t start = internal_clock_ns();
+	const int ret = mst->command(flash, writecnt, readcnt, writearr, readarr);
+	const uint64_t duration = internal_clock_ns() - start;
+	recording.depth--;
+
+	record_write(flash, FLASHROM_TRACE_SPI, writecnt ? writearr[0] : 0, ret, 0,
+		     writearr, writecnt, readarr, readcnt, start, duration);
+	return ret;
+}
+
+/* Recorded as single commands, the duration is accounted to the last one. */
+static int record_spi_send_multicommand(const struct flashctx *flash, struct spi_command *cmds)
+{
+	const struct spi_master *const mst = &original(flash)->spi;
+	struct spi_command *cmd;
+
+	if (!recording.file || recording.depth)
+		return mst->multicommand(flash, cmds);
+
+	recording.depth++;
+	const uint64_t start = internal_clock_ns();
+	const int ret = mst->multicommand(flash, cmds);
+	const uint64_t duration = internal_clock_ns() - start;
+	recording.depth--;
+
+	for (cmd = cmds; cmd->writecnt || cmd->readcnt; cmd++) {
+		const bool last = !cmd[1].writecnt && !cmd[1].readcnt;
+		record_write(flash, FLASHROM_TRACE_SPI, cmd->writecnt ? cmd->writearr[0] : 0, ret, 0,
+			     cmd->writearr, cmd->writecnt, cmd->readarr, cmd->readcnt,
+			     start, last ? duration : 0);
+	}
+	return ret;
+}
+
+static int record_spi_read(struct flashctx *flash, uint8_t *buf, unsigned int start, unsigned int len)
+{
+	const struct spi_master *const mst = &original(flash)->spi;
+
+	if (!recording.file || recording.depth)
+		return mst->read(flash, buf, start, len);
+
+	recording.depth++;
+	const uint64_t start_ns = internal_clock_ns();
+	const int ret = mst->read(flash, buf, start, len);
+	const uint64_t duration = internal_clock_ns() - start_ns;
+	recording.depth--;
+
+	record_write(flash, FLASHROM_TRACE_SPI_READ, 0, ret, start, NULL, 0, buf, len, start_ns, duration);
+	return ret;
+}
+
+static int record_spi_write(struct flashctx *flash, enum flashrom_trace_type type,
+			    int (*write)(struct flashctx *, const uint8_t *, unsigned int, unsigned int),
+			    const uint8_t *buf, unsigned int start, unsigned int len)
+{
+	if (!recording.file || recording.depth)
+		return write(flash, buf, start, len);
+
+	recording.depth++;
+	const uint64_t start_ns = internal_clock_ns();
+	const int ret = write(flash, buf, start, len);
+	const uint64_t duration = internal_clock_ns() - start_ns;
+	recording.depth--;
+
+	record_write(flash, type, 0, ret, start, buf, len, NULL, 0, start_ns, duration);
+	return ret;
+}
+
+static int record_spi_write_256(struct flashctx *flash, const uint8_t *buf, unsigned int start, unsigned int len)
+{
+	return record_spi_write(flash, FLASHROM_TRACE_SPI_WRITE_256, original(flash)->spi.write_256,
+				buf, start, len);
+}
+
+static int record_spi_write_aai(struct flashctx *flash, const uint8_t *buf, unsigned int start, unsigned int len)
+{
+	return record_spi_write(flash, FLASHROM_TRACE_SPI_WRITE_AAI, original(flash)->spi.write_aai,
+				buf, start, len);
+}
+
+static bool record_spi_probe_opcode(struct flashctx *flash, uint8_t opcode)
+{
+	const bool ret = original(flash)->spi.probe_opcode(flash, opcode);
+
+	if (!recording.depth)
+		record_write(flash, FLASHROM_TRACE_SPI_PROBE_OPCODE, opcode, ret, 0, NULL, 0, NULL, 0,
+			     internal_clock_ns(), 0);
+	return ret;
+}
+
+static int record_opaque_probe(struct flashctx *flash)
+{
+	const uint64_t start = internal_clock_ns();
+	const int ret = original(flash)->opaque.probe(flash);
+	const uint64_t duration = internal_clock_ns() - start;
+	struct record_opaque_chip chip = {
+		.total_size	= flash->chip->total_size,
+		.page_size	= flash->chip->page_size,
+		.feature_bits	= flash->chip->feature_bits,
+	};
+	unsigned int i;
+
+	for (i = 0; i < NUM_ERASEREGIONS; i++) {
+		chip.eraseblocks[i][0] = flash->chip->block_erasers[0].eraseblocks[i].size;
+		chip.eraseblocks[i][1] = flash->chip->block_erasers[0].eraseblocks[i].count;
+	}
+	record_write(flash, FLASHROM_TRACE_OPAQUE_PROBE, 0, ret, 0, NULL, 0, &chip, sizeof(chip), start, duration);
+	return ret;
+}
+
+static int record_opaque_read(struct flashctx *flash, uint8_t *buf, unsigned int start, unsigned int len)
+{
+	const uint64_t start_ns = internal_clock_ns();
+	const int ret = original(flash)->opaque.read(flash, buf, start, len);
+	record_write(flash, FLASHROM_TRACE_OPAQUE_READ, 0, ret, start, NULL, 0, buf, len,
+		     start_ns, internal_clock_ns() - start_ns);
+	return ret;
+}
+
+static int record_opaque_write(struct flashctx *flash, const uint8_t *buf, unsigned int start, unsigned int len)
+{
+	const uint64_t start_ns = internal_clock_ns();
+	const int ret = original(flash)->opaque.write(flash, buf, start, len);
+	record_write(flash, FLASHROM_TRACE_OPAQUE_WRITE, 0, ret, start, buf, len, NULL, 0,
+		     start_ns, internal_clock_ns() - start_ns);
+	return ret;
+}
+
+static int record_opaque_erase(struct flashctx *flash, unsigned int blockaddr, unsigned int blocklen)
+{
+	const uint64_t start_ns = internal_clock_ns();
+	const int ret = original(flash)->opaque.erase(flash, blockaddr, blocklen);
+	/* The payload is the length of the erased block. */
+	const uint32_t len = blocklen;
+	record_write(flash, FLASHROM_TRACE_OPAQUE_ERASE, 0, ret, blockaddr, &len, sizeof(len), NULL, 0,
+		     start_ns, internal_clock_ns() - start_ns);
+	return ret;
+}
+
+void record_register_master(struct registered_master *mst, unsigned int index)
+{
+	if (!recording.file)
+		return;
+
+	recording.masters[index] = *mst;
+
+	const struct record_master info = {
+		.buses_supported	= mst->buses_supported,
+		.spi_features		= mst->spi.features,
+		.spi_max_data_read	= mst->spi.max_data_read,
+		.spi_max_data_write	= mst->spi.max_data_write,
+		.opaque_max_data_read	= mst->opaque.max_data_read,
+		.opaque_max_data_write	= mst->opaque.max_data_write,
+		.opaque_max_data_erase	= mst->opaque.max_data_erase,
+	};
+	const struct flashctx flash = { .mst = mst };
+	record_write(&flash, FLASHROM_TRACE_REGISTER_MASTER, 0, 0, 0, &info, sizeof(info), NULL, 0,
+		     internal_clock_ns(), 0);
+
+	if (mst->buses_supported & BUS_SPI) {
+		mst->spi.command	= record_spi_send_command;
+		mst->spi.multicommand	= record_spi_send_multicommand;
+		mst->spi.read		= record_spi_read;
+		mst->spi.write_256	= record_spi_write_256;
+		mst->spi.write_aai	= record_spi_write_aai;
+		mst->spi.probe_opcode	= record_spi_probe_opcode;
+	}
+	if (mst->buses_supported & BUS_PROG) {
+		mst->opaque.probe	= record_opaque_probe;
+		mst->opaque.read	= record_opaque_read;
+		mst->opaque.write	= record_opaque_write;
+		mst->opaque.erase	= record_opaque_erase;
+	}
+	if (mst->buses_supported & BUS_NONSPI)
+		msg_gwarn("Parallel, LPC and FWH accesses are not recorded.\n");
+}
+
+int flashrom_record_start(const char *const path)
+{
+	flashrom_record_stop();
+
+	recording.file = fopen(path, "wb");
+	if (!recording.file) {
+		msg_gerr("Opening recording \"%s\" failed: %s\n", path, strerror(errno));
+		return 1;
+	}
+	recording.error = fwrite(FLASHROM_RECORD_MAGIC, strlen(FLASHROM_RECORD_MAGIC), 1, recording.file) != 1;
+	recording.start_ns = internal_clock_ns();
+	return 0;
+}
+
+int flashrom_record_stop(void)
+{
+	int ret = 0;
+
+	if (!recording.file)
+		return 0;
+
+	if (fclose(recording.file) || recording.error)
+		ret = 1;
+	recording.file = NULL;
+	recording.error = false;
+	return ret;
+}
@@ -0,0 +1,406 @@
+/*
+ * This file is part of the flashrom project.
+ *
+ * Copyright 2026 Google LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Plays back a session recorded with flashrom_record_start(). The masters of
+ * the recording are registered again, and every operation on them has to
+ * match the next record: its payload is returned after waiting for the
+ * recorded duration. Anything else means flashrom diverged from the
+ * recorded session, which is reported as an error.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flash.h"
+#include "programmer.h"
+#include "spi.h"
+
+struct replay_data;
+
+struct replay_master {
+	struct replay_data *replay;
+	unsigned int index;
+};
+
+struct replay_data {
+	uint8_t *buf;
+	size_t len;
+	/* Offset and number of the next record. */
+	size_t pos;
+	unsigned int record;
+	/* Wait for the recorded duration of each operation. */
+	bool latency;
+	struct replay_master masters[MASTERS_MAX];
+};
+
+static int replay_load(struct replay_data *data, const char *path)
+{
+	size_t size = 0, got;
+
+	FILE *file = fopen(path, "rb");
+	if (!file) {
+		msg_perr("Opening recording \"%s\" failed: %s\n", path, strerror(errno));
+		return 1;
+	}
+	/* The buffer doubles, so loading takes linear time also for long recordings. */
+	do {
+		size = size ? 2 * size : 64 * KiB;
+		uint8_t *const buf = realloc(data->buf, size);
+		if (!buf) {
+			msg_perr("Out of memory!\n");
+			fclose(file);
+			return 1;
+		}
+		data->buf = buf;
+		got = fread(data->buf + data->len, 1, size - data->len, file);
+		data->len += got;
+	} while (data->len == size);
+	fclose(file);
+
+	if (data->len < strlen(FLASHROM_RECORD_MAGIC) ||
+	    memcmp(data->buf, FLASHROM_RECORD_MAGIC, strlen(FLASHROM_RECORD_MAGIC))) {
+		msg_perr("\"%s\" is not a flashrom recording.\n", path);
+		return 1;
+	}
+	return 0;
+}
+
+/* Reads the record at `pos`, returns the offset of the one after it or 0 if it is truncated. */
+static size_t replay_read_record(const struct replay_data *data, size_t pos, struct flashrom_trace_record *record)
+{
+	if (data->len - pos < sizeof(*record))
+		return 0;
+	memcpy(record, data->buf + pos, sizeof(*record));
+	pos += sizeof(*record);
+
+	if (data->len - pos < (uint64_t)record->bytes_out + record->bytes_in)
+		return 0;
+	return pos + record->bytes_out + record->bytes_in;
+}
+
+/*
+ * Matches an operation against the next record. On success, points `in` to
+ * the recorded response and returns the recorded result in `result`.
+ */
+static int replay_expect(const struct flashctx *flash, struct replay_master *mst, enum flashrom_trace_type type,
+			 uint8_t opcode, unsigned int addr, const void *out, unsigned int bytes_out,
+			 unsigned int bytes_in, const uint8_t **in, int *result)
+{
+	struct replay_data *const data = mst->replay;
+	struct flashrom_trace_record record;
+	size_t next;
+
+	do {
+		next = replay_read_record(data, data->pos, &record);
+		if (!next) {
+			msg_perr("Replay: the recording ended, but flashrom sent another operation "
+				 "(type %d, opcode 0x%02x, address 0x%x).\n", type, opcode, addr);
+			return 1;
+		}
+		if (record.type == FLASHROM_TRACE_REGISTER_MASTER) {
+			data->pos = next;
+			data->record++;
+		}
+	} while (record.type == FLASHROM_TRACE_REGISTER_MASTER);
+
+	const uint8_t *const payload = data->buf + data->pos + sizeof(record);
+	if (record.type != type || record.master != mst->index || record.opcode != opcode ||
+	    record.addr != addr || record.bytes_out != bytes_out || record.bytes_in != bytes_in ||
+	    (bytes_out && memcmp(payload, out, bytes_out))) {
+		msg_perr("Replay diverged from the recording at record %u.\n", data->record);
+		msg_pdbg("Recorded type %d, opcode 0x%02x, address 0x%x, %u bytes out, %u bytes in.\n",
+			 record.type, record.opcode, record.addr, record.bytes_out, record.bytes_in);
+		msg_pdbg("Replayed type %d, opcode 0x%02x, address 0x%x, %u bytes out, %u bytes in.\n",
+			 type, opcode, addr, bytes_out, bytes_in);
+		return 1;
+	}
+
+	data->pos = next;
+	data->record++;
+	if (data->latency)
+		programmer_delay(record.duration_ns / 1000);
+
+	*in = payload + bytes_out;
+	*result = record.result;
+	return 0;
+}
+
+static int replay_spi_send_command(const struct flashctx *flash, unsigned int writecnt, unsigned int readcnt,
+				   const unsigned char *writearr, unsigned char *readarr)
+{
+	const uint8_t *in;
+	int result;
+
+	if (replay_expect(flash, flash->mst->spi.data, FLASHROM_TRACE_SPI, writecnt ? writearr[0] : 0, 0,
+			  writearr, writecnt, readcnt, &in, &result))
+		return SPI_GENERIC_ERROR;
+
+	memcpy(readarr, in, readcnt);
+	return result;
+}
+
+static int replay_spi_read(struct flashctx *flash, uint8_t *buf, unsigned int start, unsigned int len)
+{
+	const uint8_t *in;
+	int result;
+
+	if (replay_expect(flash, flash->mst->spi.data, FLASHROM_TRACE_SPI_READ, 0, start,
+			  NULL, 0, len, &in, &result))
+		return SPI_GENERIC_ERROR;
+
+	memcpy(buf, in, len);
+	return result;
+}
+
+static int replay_spi_write_256(struct flashctx *flash, const uint8_t *buf, unsigned int start, unsigned int len)
+{
+	const uint8_t *in;
+	int result;
+
+	if (replay_expect(flash, flash->mst->spi.data, FLASHROM_TRACE_SPI_WRITE_256, 0, start,
+			  buf, len, 0, &in, &result))
+		return SPI_GENERIC_ERROR;
+	return result;
+}
+
+static int replay_spi_write_aai(struct flashctx *flash, const uint8_t *buf, unsigned int start, unsigned int len)
+{
+	const uint8_t *in;
+	int result;
+
+	if (replay_expect(flash, flash->mst->spi.data, FLASHROM_TRACE_SPI_WRITE_AAI, 0, start,
+			  buf, len, 0, &in, &result))
+		return SPI_GENERIC_ERROR;
+	return result;
+}
+
+static bool replay_spi_probe_opcode(struct flashctx *flash, uint8_t opcode)
+{
+	const uint8_t *in;
+	int result;
+
+	if (replay_expect(flash, flash->mst->spi.data, FLASHROM_TRACE_SPI_PROBE_OPCODE, opcode, 0,
+			  NULL, 0, 0, &in, &result))
+		return false;
+	return result;
+}
+
+static int replay_opaque_probe(struct flashctx *flash)
+{
+	struct record_opaque_chip chip;
+	const uint8_t *in;
+	unsigned int i;
+	int result;
+
+	if (replay_expect(flash, flash->mst->opaque.data, FLASHROM_TRACE_OPAQUE_PROBE, 0, 0,
+			  NULL, 0, sizeof(chip), &in, &result))
+		return 0;
+
+	memcpy(&chip, in, sizeof(chip));
+	flash->chip->total_size = chip.total_size;
+	flash->chip->page_size = chip.page_size;
+	flash->chip->feature_bits = chip.feature_bits;
+	flash->chip->tested = TEST_OK_PREW;
+	for (i = 0; i < NUM_ERASEREGIONS; i++) {
+		flash->chip->block_erasers[0].eraseblocks[i].size = chip.eraseblocks[i][0];
+		flash->chip->block_erasers[0].eraseblocks[i].count = chip.eraseblocks[i][1];
+	}
+	return result;
+}
+
+static int replay_opaque_read(struct flashctx *flash, uint8_t *buf, unsigned int start, unsigned int len)
+{
+	const uint8_t *in;
+	int result;
+
+	if (replay_expect(flash, flash->mst->opaque.data, FLASHROM_TRACE_OPAQUE_READ, 0, start,
+			  NULL, 0, len, &in, &result))
+		return 1;
+
+	memcpy(buf, in, len);
+	return result;
+}
+
+static int replay_opaque_write(struct flashctx *flash, const uint8_t *buf, unsigned int start, unsigned int len)
+{
+	const uint8_t *in;
+	int result;
+
+	if (replay_expect(flash, flash->mst->opaque.data, FLASHROM_TRACE_OPAQUE_WRITE, 0, start,
+			  buf, len, 0, &in, &result))
+		return 1;
+	return result;
+}
+
+static int replay_opaque_erase(struct flashctx *flash, unsigned int blockaddr, unsigned int blocklen)
+{
+	const uint32_t len = blocklen;
+	const uint8_t *in;
+	int result;
+
+	if (replay_expect(flash, flash->mst->opaque.data, FLASHROM_TRACE_OPAQUE_ERASE, 0, blockaddr,
+			  &len, sizeof(len), 0, &in, &result))
+		return 1;
+	return result;
+}
+
+static int replay_shutdown(void *data)
+{
+	struct replay_data *const replay = data;
+	struct flashrom_trace_record record;
+	unsigned int left = 0;
+	size_t pos;
+
+	for (pos = replay->pos; (pos = replay_read_record(replay, pos, &record)); left++)
+		;
+	if (left)
+		msg_pwarn("Replay: %u recorded operations were not replayed.\n", left);
+
+	free(replay->buf);
+	free(replay);
+	return 0;
+}
+
+static const struct spi_master spi_master_replay = {
+	.command	= replay_spi_send_command,
+	.multicommand	= default_spi_send_multicommand,
+	.read		= replay_spi_read,
+	.write_256	= replay_spi_write_256,
+	.write_aai	= replay_spi_write_aai,
+	.probe_opcode	= replay_spi_probe_opcode,
+};
+
+static const struct opaque_master opaque_master_replay = {
+	.probe	= replay_opaque_probe,
+	.read	= replay_opaque_read,
+	.write	= replay_opaque_write,
+	.erase	= replay_opaque_erase,
+};
+
+/* Registers the masters of the recording in their original order. */
+static int replay_register_masters(struct replay_data *data)
+{
+	struct flashrom_trace_record record;
+	struct record_master info;
+	unsigned int count = 0, registered = 0;
+	size_t pos, next;
+
+	for (pos = data->pos; (next = replay_read_record(data, pos, &record)); pos = next) {
+		if (record.type != FLASHROM_TRACE_REGISTER_MASTER)
+			continue;
+		if (record.bytes_out != sizeof(info) || record.master != count || count >= MASTERS_MAX) {
+			msg_perr("Replay: invalid master registration in the recording.\n");
+			return 1;
+		}
+		memcpy(&info, data->buf + pos + sizeof(record), sizeof(info));
+
+		data->masters[count].replay = data;
+		data->masters[count].index = count;
+
+		if (info.buses_supported == BUS_SPI) {
+			struct spi_master mst = spi_master_replay;
+			mst.features = info.spi_features;
+			mst.max_data_read = info.spi_max_data_read;
+			mst.max_data_write = info.spi_max_data_write;
+			if (register_spi_master(&mst, &data->masters[count]))
+				return 1;
+			registered++;
+		} else if (info.buses_supported == BUS_PROG) {
+			struct opaque_master mst = opaque_master_replay;
+			mst.max_data_read = info.opaque_max_data_read;
+			mst.max_data_write = info.opaque_max_data_write;
+			mst.max_data_erase = info.opaque_max_data_erase;
+			if (register_opaque_master(&mst, &data->masters[count]))
+				return 1;
+			registered++;
+		} else {
+			msg_pwarn("Replay: skipping master %u, only SPI and opaque masters can be replayed.\n",
+				  count);
+		}
+		count++;
+	}
+	if (!registered) {
+		msg_perr("Replay: the recording has no SPI or opaque master.\n");
+		return 1;
+	}
+	if (pos != data->len) {
+		msg_perr("Replay: the recording is truncated.\n");
+		return 1;
+	}
+	return 0;
+}
+
+static int replay_init(void)
+{
+	char *file, *latency;
+
+	struct replay_data *data = calloc(1, sizeof(*data));
+	if (!data) {
+		msg_perr("Out of memory!\n");
+		return 1;
+	}
+	data->latency = true;
+
+	file = extract_programmer_param_str("file");
+	if (!file) {
+		msg_perr("Replay: the file parameter is missing.\n");
+		free(data);
+		return 1;
+	}
+
+	latency = extract_programmer_param_str("latency");
+	if (latency) {
+		if (!strcmp(latency, "no")) {
+			data->latency = false;
+		} else if (strcmp(latency, "yes")) {
+			msg_perr("latency can be \"yes\" or \"no\"\n");
+			free(latency);
+			free(file);
+			free(data);
+			return 1;
+		}
+	}
+	free(latency);
+
+	if (replay_load(data, file)) {
+		free(file);
+		free(data->buf);
+		free(data);
+		return 1;
+	}
+	free(file);
+	data->pos = strlen(FLASHROM_RECORD_MAGIC);
+
+	if (register_shutdown(replay_shutdown, data)) {
+		free(data->buf);
+		free(data);
+		return 1;
+	}
+	return replay_register_masters(data);
+}
+
+const struct programmer_entry programmer_replay = {
+	.name			= "replay",
+	.type			= OTHER,
+				/* FIXME */
+	.devs.note		= "Replays a recorded programmer session\n",
+	.init			= replay_init,
+	.map_flash_region	= fallback_map,
+	.unmap_flash_region	= fallback_unmap,
+	.delay			= internal_delay,
+};
@@ -29,15 +29,45 @@
 #else
 #include <termios.h>
 #include <unistd.h>
+#include <poll.h>
 #include <sys/types.h>
 #include <sys/ioctl.h>
 #endif
+#ifdef __linux__
+#include <linux/serial.h>
+#endif
 #include "flash.h"
 #include "programmer.h"
 #include "custom_baud.h"
 
 fdtype sp_fd = SER_INV_FD;
 
+/* Size of the transmit and receive buffers below. Bigger transfers bypass them. */
+#define SER_BUF_SIZE		4096
+/* Maximum time to wait for any data from the device before giving up. */
+#define SER_READ_TIMEOUT_MS	10000
+
+/* Data queued by serialport_write_buffered(), sent with the next unbuffered
+ * write or before the next read, so that small writes end up in one syscall. */
+static unsigned char sp_txbuf[SER_BUF_SIZE];
+static unsigned int sp_txbuf_len = 0;
+
+#if !IS_WINDOWS
+/* Data received from the device, but not consumed by any read yet. Every read
+ * syscall fetches as much as is available, so that a burst of small answers
+ * does not need a syscall per answer. */
+static unsigned char sp_rxbuf[SER_BUF_SIZE];
+static unsigned int sp_rxbuf_start = 0;
+static unsigned int sp_rxbuf_end = 0;
+#endif
+
+#ifdef __linux__
+/* The flags of the serial port before serialport_config() set low latency mode,
+ * restored by serialport_shutdown(). */
+static int sp_orig_serial_flags;
+static bool sp_restore_serial_flags = false;
+#endif
+
 /* There is no way defined by POSIX to use arbitrary baud rates. It only defines some macros that can be used to
  * specify respective baud rates and many implementations extend this list with further macros, cf. TERMIOS(3)
  * and http://git.kernel.org/?p=linux/kernel/git/torvalds/linux.git;a=blob;f=include/uapi/asm-generic/termbits.h
@@ -212,6 +242,9 @@ int serialport_config(fdtype fd, int baud)
 	wanted.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG | IEXTEN);
 	wanted.c_iflag &= ~(IXON | IXOFF | IXANY | ICRNL | IGNCR | INLCR);
 	wanted.c_oflag &= ~OPOST;
+	/* Return from read() as soon as at least one byte is available. */
+	wanted.c_cc[VMIN] = 1;
+	wanted.c_cc[VTIME] = 0;
 	if (tcsetattr(fd, TCSANOW, &wanted) != 0) {
 		msg_perr_strerror("Could not change serial port configuration: ");
 		return 1;
@@ -243,6 +276,21 @@ int serialport_config(fdtype fd, int baud)
 			  (long)cfgetispeed(&observed), (long)cfgetospeed(&observed));
 	}
 	// FIXME: display actual baud rate - at least if none was specified by the user.
+#ifdef __linux__
+	/* USB serial converters hold back received data for up to 16 ms by default
+	 * to batch it, which would add that much to every command round trip. */
+	struct serial_struct serinfo;
+	if (ioctl(fd, TIOCGSERIAL, &serinfo) == 0 && !(serinfo.flags & ASYNC_LOW_LATENCY)) {
+		const int orig_flags = serinfo.flags;
+		serinfo.flags |= ASYNC_LOW_LATENCY;
+		if (ioctl(fd, TIOCSSERIAL, &serinfo) != 0) {
+			msg_pdbg("Could not set serial port to low latency mode.\n");
+		} else {
+			sp_orig_serial_flags = orig_flags;
+			sp_restore_serial_flags = true;
+		}
+	}
+#endif
 #endif
 	return 0;
 }
@@ -364,12 +412,30 @@ void sp_flush_incoming(void)
 #else
 	/* FIXME: error handling */
 	tcflush(sp_fd, TCIFLUSH);
+	sp_rxbuf_start = sp_rxbuf_end = 0;
 #endif
 	return;
 }
 
+static int serialport_flush(void);
+
 int serialport_shutdown(void *data)
 {
+	if (serialport_flush())
+		msg_pwarn("Could not send remaining data to the serial port.\n");
+	sp_txbuf_len = 0;
+#if !IS_WINDOWS
+	sp_rxbuf_start = sp_rxbuf_end = 0;
+#endif
+#ifdef __linux__
+	struct serial_struct serinfo;
+	if (sp_restore_serial_flags && ioctl(sp_fd, TIOCGSERIAL, &serinfo) == 0) {
+		serinfo.flags = sp_orig_serial_flags;
+		if (ioctl(sp_fd, TIOCSSERIAL, &serinfo) != 0)
+			msg_pdbg("Could not restore the serial port latency mode.\n");
+	}
+	sp_restore_serial_flags = false;
+#endif
 #if IS_WINDOWS
 	CloseHandle(sp_fd);
 #else
@@ -378,7 +444,7 @@ int serialport_shutdown(void *data)
 	return 0;
 }
 
-int serialport_write(const unsigned char *buf, unsigned int writecnt)
+static int serialport_write_unbuffered(const unsigned char *buf, unsigned int writecnt)
 {
 #if IS_WINDOWS
 	DWORD tmp = 0;
@@ -416,6 +482,72 @@ int serialport_write(const unsigned char *buf, unsigned int writecnt)
 	return 0;
 }
 
+/* Sends everything queued by serialport_write_buffered(). */
+static int serialport_flush(void)
+{
+	const unsigned int len = sp_txbuf_len;
+
+	if (!len)
+		return 0;
+	sp_txbuf_len = 0;
+	return serialport_write_unbuffered(sp_txbuf, len);
+}
+
+/* Queues writecnt bytes to be sent together with the next write. Everything
+ * queued is sent at the latest before the next read, so callers expecting an
+ * answer don't need to care. */
+int serialport_write_buffered(const unsigned char *buf, unsigned int writecnt)
+{
+	if (sp_txbuf_len + writecnt > sizeof(sp_txbuf)) {
+		if (serialport_flush())
+			return 1;
+	}
+	if (writecnt > sizeof(sp_txbuf))
+		return serialport_write_unbuffered(buf, writecnt);
+
+	memcpy(sp_txbuf + sp_txbuf_len, buf, writecnt);
+	sp_txbuf_len += writecnt;
+	return 0;
+}
+
+int serialport_write(const unsigned char *buf, unsigned int writecnt)
+{
+	/* Send the data together with anything queued if it fits. */
+	if (sp_txbuf_len && sp_txbuf_len + writecnt <= sizeof(sp_txbuf)) {
+		memcpy(sp_txbuf + sp_txbuf_len, buf, writecnt);
+		sp_txbuf_len += writecnt;
+		return serialport_flush();
+	}
+	if (serialport_flush())
+		return 1;
+	return serialport_write_unbuffered(buf, writecnt);
+}
+
+#if !IS_WINDOWS
+/* Waits until data is available for reading or the device timed out. */
+static int serialport_wait_readable(void)
+{
+	struct pollfd pfd = {
+		.fd = sp_fd,
+		.events = POLLIN,
+	};
+
+	while (1) {
+		const int ret = poll(&pfd, 1, SER_READ_TIMEOUT_MS);
+		if (ret > 0)
+			return 0;
+		if (ret == 0) {
+			msg_perr("Serial port read timeout!\n");
+			return 1;
+		}
+		if (errno != EINTR) {
+			msg_perr_strerror("Serial port poll error: ");
+			return 1;
+		}
+	}
+}
+#endif
+
 int serialport_read(unsigned char *buf, unsigned int readcnt)
 {
 #if IS_WINDOWS
@@ -424,6 +556,9 @@ int serialport_read(unsigned char *buf, unsigned int readcnt)
 	ssize_t tmp = 0;
 #endif
 
+	if (serialport_flush())
+		return 1;
+
 	while (readcnt > 0) {
 #if IS_WINDOWS
 		if (!ReadFile(sp_fd, buf, readcnt, &tmp, NULL)) {
@@ -431,10 +566,32 @@ int serialport_read(unsigned char *buf, unsigned int readcnt)
 			return 1;
 		}
 #else
-		tmp = read(sp_fd, buf, readcnt);
-		if (tmp == -1) {
-			msg_perr("Serial port read error!\n");
-			return 1;
+		if (sp_rxbuf_start == sp_rxbuf_end) {
+			if (serialport_wait_readable())
+				return 1;
+			if (readcnt >= sizeof(sp_rxbuf)) {
+				/* Large reads go directly to the caller's buffer. */
+				tmp = read(sp_fd, buf, readcnt);
+			} else {
+				/* Small ones fetch whatever else is available, too. */
+				tmp = read(sp_fd, sp_rxbuf, sizeof(sp_rxbuf));
+				if (tmp > 0) {
+					sp_rxbuf_start = 0;
+					sp_rxbuf_end = tmp;
+					tmp = 0;
+				}
+			}
+			if (tmp == -1) {
+				if (errno == EAGAIN || errno == EINTR)
+					continue;
+				msg_perr("Serial port read error!\n");
+				return 1;
+			}
+		}
+		if (sp_rxbuf_start != sp_rxbuf_end) {
+			tmp = min(readcnt, sp_rxbuf_end - sp_rxbuf_start);
+			memcpy(buf, sp_rxbuf + sp_rxbuf_start, tmp);
+			sp_rxbuf_start += tmp;
 		}
 #endif
 		if (!tmp)
@@ -452,6 +609,10 @@ int serialport_read(unsigned char *buf, unsigned int readcnt)
 int serialport_read_nonblock(unsigned char *c, unsigned int readcnt, unsigned int timeout, unsigned int *really_read)
 {
 	int ret = 1;
+
+	if (serialport_flush())
+		return -1;
+
 	/* disable blocked i/o and declare platform-specific variables */
 #if IS_WINDOWS
 	DWORD rv;
@@ -486,6 +647,12 @@ int serialport_read_nonblock(unsigned char *c, unsigned int readcnt, unsigned in
 
 	unsigned int i;
 	unsigned int rd_bytes = 0;
+#if !IS_WINDOWS
+	/* Hand out anything that was received already first. */
+	rd_bytes = min(readcnt, sp_rxbuf_end - sp_rxbuf_start);
+	memcpy(c, sp_rxbuf + sp_rxbuf_start, rd_bytes);
+	sp_rxbuf_start += rd_bytes;
+#endif
 	for (i = 0; i < timeout; i++) {
 		msg_pspew("readcnt %u rd_bytes %u\n", readcnt, rd_bytes);
 #if IS_WINDOWS
@@ -536,6 +703,10 @@ int serialport_read_nonblock(unsigned char *c, unsigned int readcnt, unsigned in
 int serialport_write_nonblock(const unsigned char *buf, unsigned int writecnt, unsigned int timeout, unsigned int *really_wrote)
 {
 	int ret = 1;
+
+	if (serialport_flush())
+		return -1;
+
 	/* disable blocked i/o and declare platform-specific variables */
 #if IS_WINDOWS
 	DWORD rv;
@@ -36,6 +36,7 @@
 #include "flash.h"
 #include "programmer.h"
 #include "chipdrivers.h"
+#include "spi.h"
 
 /* According to Serial Flasher Protocol Specification - version 1 */
 #define S_ACK			0x06
@@ -62,6 +63,9 @@
 #define S_CMD_O_SPIOP		0x13	/* Perform SPI operation.			*/
 #define S_CMD_S_SPI_FREQ	0x14	/* Set SPI clock frequency			*/
 #define S_CMD_S_PIN_STATE	0x15	/* Enable/disable output drivers		*/
+#define S_CMD_O_SPIREAD		0x16	/* Perform streamed SPI read operation		*/
+#define S_CMD_O_SPIPOLL		0x17	/* Poll SPI register until it matches		*/
+#define S_CMD_O_SPIOP_SEQ	0x18	/* Perform sequenced SPI operation		*/
 
 #define MSGHEADER "serprog: "
 
@@ -97,6 +101,27 @@ static int sp_opbuf_usage = 0;
 	whether the command is supported before doing it */
 static int sp_check_avail_automatic = 0;
 
+/* Largest chunk read with a single streamed SPI read operation */
+#define SP_SPIREAD_CHUNK_SIZE	(64 * KiB)
+/* Polling interval and timeout for the write-in-progress bit after a page program */
+#define SP_SPIPOLL_INTERVAL_US	10
+#define SP_SPIPOLL_TIMEOUT_US	(100 * 1000)
+
+/* Sequenced SPI operations and SPI polls that were sent to the device
+	but whose answers were not read yet. The device works through them
+	while we are sending the next ones, so as long as they fit into its
+	serial buffer we only pay for one round trip for all of them. */
+#define SP_MAX_PIPELINED_OPS	32
+static struct sp_pipelined_op {
+	uint8_t cmd;
+	uint8_t seq;
+	uint32_t readcnt;
+	unsigned char *readarr;
+} sp_pipelined_ops[SP_MAX_PIPELINED_OPS];
+static unsigned int sp_pipelined_count = 0;
+static unsigned int sp_pipelined_bytes = 0;
+static uint8_t sp_pipeline_seq = 0;
+
 #if ! IS_WINDOWS
 static int sp_opensocket(char *ip, unsigned int port)
 {
@@ -223,13 +248,17 @@ static int sp_automatic_cmdcheck(uint8_t cmd)
 	return 0;
 }
 
+static int sp_pipeline_drain(void);
+
 static int sp_docommand(uint8_t command, uint32_t parmlen,
 			uint8_t *params, uint32_t retlen, void *retparms)
 {
 	unsigned char c;
 	if (sp_automatic_cmdcheck(command))
 		return 1;
-	if (serialport_write(&command, 1) != 0) {
+	if (sp_pipeline_drain())
+		return 1;
+	if (serialport_write_buffered(&command, 1) != 0) {
 		msg_perr("Error: cannot write op code: %s\n", strerror(errno));
 		return 1;
 	}
@@ -281,37 +310,161 @@ static int sp_flush_stream(void)
 
 static int sp_stream_buffer_op(uint8_t cmd, uint32_t parmlen, uint8_t *parms)
 {
-	uint8_t *sp;
 	if (sp_automatic_cmdcheck(cmd))
 		return 1;
 
-	sp = malloc(1 + parmlen);
-	if (!sp) {
-		msg_perr("Error: cannot malloc command buffer\n");
-		return 1;
-	}
-	sp[0] = cmd;
-	if (parms)
-		memcpy(&(sp[1]), parms, parmlen);
-
 	if (sp_streamed_transmit_bytes >= (1 + parmlen + sp_device_serbuf_size)) {
-		if (sp_flush_stream() != 0) {
-			free(sp);
+		if (sp_flush_stream() != 0)
 			return 1;
-		}
 	}
-	if (serialport_write(sp, 1 + parmlen) != 0) {
+	/* Streamed operations are only sent with the next read (or a bigger write),
+	   which coalesces them into a single transfer. */
+	if (serialport_write_buffered(&cmd, 1) != 0 ||
+	    (parms && serialport_write_buffered(parms, parmlen) != 0)) {
 		msg_perr("Error: cannot write command\n");
-		free(sp);
 		return 1;
 	}
 	sp_streamed_transmit_ops += 1;
 	sp_streamed_transmit_bytes += 1 + parmlen;
 
-	free(sp);
 	return 0;
 }
 
+/* Read the answers to all pipelined operations. All answers are consumed even if
+ * one of the operations failed, so that the protocol stays in sync. */
+static int sp_pipeline_drain(void)
+{
+	unsigned int i;
+	int ret = 0;
+
+	for (i = 0; i < sp_pipelined_count; i++) {
+		const struct sp_pipelined_op *op = &sp_pipelined_ops[i];
+		unsigned char c, seq;
+
+		if (serialport_read(&c, 1) != 0) {
+			msg_perr(MSGHEADER "Error: cannot read from device (draining pipeline)\n");
+			ret = 1;
+			goto out;
+		}
+		if (c != S_ACK && c != S_NAK) {
+			msg_perr(MSGHEADER "Error: invalid response 0x%02X from device (to command 0x%02X)\n",
+				 c, op->cmd);
+			ret = 1;
+			goto out;
+		}
+		if (op->cmd == S_CMD_O_SPIOP_SEQ) {
+			if (serialport_read(&seq, 1) != 0) {
+				msg_perr(MSGHEADER "Error: cannot read sequence number\n");
+				ret = 1;
+				goto out;
+			}
+			if (seq != op->seq) {
+				msg_perr(MSGHEADER "Error: out of sequence answer %u, expected %u\n", seq, op->seq);
+				ret = 1;
+				goto out;
+			}
+		}
+		if (c == S_NAK) {
+			if (op->cmd == S_CMD_O_SPIPOLL)
+				msg_perr(MSGHEADER "Error: timeout while polling SPI register\n");
+			else
+				msg_perr(MSGHEADER "Error: NAK to sequenced SPI operation %u\n", op->seq);
+			ret = 1;
+			continue;
+		}
+		if (op->readcnt && serialport_read(op->readarr, op->readcnt) != 0) {
+			msg_perr(MSGHEADER "Error: cannot read return parameters\n");
+			ret = 1;
+			goto out;
+		}
+	}
+out:
+	sp_pipelined_count = 0;
+	sp_pipelined_bytes = 0;
+	return ret;
+}
+
+/* Whether an operation with parmlen bytes of parameters fits into the device's serial buffer at all. */
+static bool sp_pipeline_fits(uint32_t parmlen)
+{
+	return 1 + parmlen <= sp_device_serbuf_size;
+}
+
+/* Send an operation without waiting for its answer. readcnt bytes of the answer
+ * (after the ACK and the sequence number, if any) will be stored in readarr by
+ * sp_pipeline_drain(), so readarr has to stay valid until then. */
+static int sp_pipeline_queue(uint8_t cmd, uint8_t seq, uint32_t parmlen, const uint8_t *parms,
+			     uint32_t readcnt, unsigned char *readarr)
+{
+	if (!sp_pipeline_fits(parmlen)) {
+		msg_perr(MSGHEADER "Error: pipelined command of %u bytes exceeds the serial buffer of %u bytes\n",
+			 1 + parmlen, sp_device_serbuf_size);
+		return 1;
+	}
+	/* Never let the device's serial buffer overflow. */
+	if (sp_pipelined_count == SP_MAX_PIPELINED_OPS ||
+	    sp_pipelined_bytes + 1 + parmlen > sp_device_serbuf_size) {
+		if (sp_pipeline_drain() != 0)
+			return 1;
+	}
+	if (serialport_write_buffered(&cmd, 1) != 0 || serialport_write_buffered(parms, parmlen) != 0) {
+		msg_perr(MSGHEADER "Error: cannot write pipelined command\n");
+		sp_pipelined_count = 0;
+		sp_pipelined_bytes = 0;
+		return 1;
+	}
+	sp_pipelined_ops[sp_pipelined_count++] = (struct sp_pipelined_op) {
+		.cmd = cmd,
+		.seq = seq,
+		.readcnt = readcnt,
+		.readarr = readarr,
+	};
+	sp_pipelined_bytes += 1 + parmlen;
+	return 0;
+}
+
+static int sp_queue_spiop(unsigned int writecnt, unsigned int readcnt,
+			  const unsigned char *writearr, unsigned char *readarr)
+{
+	unsigned char *parmbuf;
+	const uint8_t seq = sp_pipeline_seq++;
+	int ret;
+
+	parmbuf = malloc(writecnt + 7);
+	if (!parmbuf) {
+		msg_perr("Error: could not allocate SPI send param buffer.\n");
+		return 1;
+	}
+	parmbuf[0] = seq;
+	parmbuf[1] = (writecnt >> 0) & 0xFF;
+	parmbuf[2] = (writecnt >> 8) & 0xFF;
+	parmbuf[3] = (writecnt >> 16) & 0xFF;
+	parmbuf[4] = (readcnt >> 0) & 0xFF;
+	parmbuf[5] = (readcnt >> 8) & 0xFF;
+	parmbuf[6] = (readcnt >> 16) & 0xFF;
+	memcpy(parmbuf + 7, writearr, writecnt);
+	ret = sp_pipeline_queue(S_CMD_O_SPIOP_SEQ, seq, writecnt + 7, parmbuf, readcnt, readarr);
+	free(parmbuf);
+	return ret;
+}
+
+static int sp_queue_spipoll(uint8_t opcode, uint8_t mask, uint8_t value,
+			    uint16_t interval_us, uint32_t timeout_us, unsigned char *result)
+{
+	uint8_t parmbuf[9];
+
+	parmbuf[0] = opcode;
+	parmbuf[1] = mask;
+	parmbuf[2] = value;
+	parmbuf[3] = (interval_us >> 0) & 0xFF;
+	parmbuf[4] = (interval_us >> 8) & 0xFF;
+	parmbuf[5] = (timeout_us >> 0) & 0xFF;
+	parmbuf[6] = (timeout_us >> 8) & 0xFF;
+	parmbuf[7] = (timeout_us >> 16) & 0xFF;
+	parmbuf[8] = (timeout_us >> 24) & 0xFF;
+	return sp_pipeline_queue(S_CMD_O_SPIPOLL, 0, sizeof(parmbuf), parmbuf, 1, result);
+}
+
 /* Move an in flashrom buffer existing write-n operation to the on-device operation buffer. */
 static int sp_pass_writen(void)
 {
@@ -341,11 +494,11 @@ static int sp_pass_writen(void)
 	header[4] = (sp_write_n_addr >> 0) & 0xFF;
 	header[5] = (sp_write_n_addr >> 8) & 0xFF;
 	header[6] = (sp_write_n_addr >> 16) & 0xFF;
-	if (serialport_write(header, 7) != 0) {
+	if (serialport_write_buffered(header, 7) != 0) {
 		msg_perr(MSGHEADER "Error: cannot write write-n command\n");
 		return 1;
 	}
-	if (serialport_write(sp_write_n_buf, sp_write_n_bytes) != 0) {
+	if (serialport_write_buffered(sp_write_n_buf, sp_write_n_bytes) != 0) {
 		msg_perr(MSGHEADER "Error: cannot write write-n data");
 		return 1;
 	}
@@ -418,8 +571,138 @@ static int serprog_spi_send_command(const struct flashctx *flash,
 	return ret;
 }
 
+/* Send all commands back-to-back and collect the answers afterwards. */
+static int serprog_spi_send_multicommand(const struct flashctx *flash, struct spi_command *cmds)
+{
+	struct spi_command *cmd;
+
+	if (!sp_check_commandavail(S_CMD_O_SPIOP_SEQ))
+		return default_spi_send_multicommand(flash, cmds);
+	for (cmd = cmds; (cmd->writecnt || cmd->readcnt); cmd++) {
+		if (!sp_pipeline_fits(7 + cmd->writecnt))
+			return default_spi_send_multicommand(flash, cmds);
+	}
+
+	if ((sp_opbuf_usage) || (sp_max_write_n && sp_write_n_bytes)) {
+		if (sp_execute_opbuf() != 0) {
+			msg_perr("Error: could not execute command buffer before sending SPI commands.\n");
+			return 1;
+		}
+	}
+
+	for (; (cmds->writecnt || cmds->readcnt); cmds++) {
+		if (sp_queue_spiop(cmds->writecnt, cmds->readcnt, cmds->writearr, cmds->readarr)) {
+			sp_pipeline_drain();
+			return 1;
+		}
+	}
+	return sp_pipeline_drain();
+}
+
+/* Read with streamed SPI reads, which are not limited by the read-n maximum length. */
+static int serprog_spi_read(struct flashctx *flash, uint8_t *buf, unsigned int start, unsigned int len)
+{
+	unsigned int i;
+
+	if (!sp_check_commandavail(S_CMD_O_SPIREAD))
+		return default_spi_read(flash, buf, start, len);
+
+	for (i = 0; i < len; ) {
+		uint8_t parmbuf[6 + JEDEC_MAX_READ_CMD_LEN];
+		const unsigned int toread = min(SP_SPIREAD_CHUNK_SIZE, len - i);
+
+		/* This may send commands to set up the extended address register. */
+		const int cmd_len = spi_prepare_read_cmd(flash, parmbuf + 6, start + i, false);
+		if (cmd_len < 0)
+			return SPI_GENERIC_ERROR;
+
+		parmbuf[0] = (cmd_len >> 0) & 0xFF;
+		parmbuf[1] = (cmd_len >> 8) & 0xFF;
+		parmbuf[2] = (cmd_len >> 16) & 0xFF;
+		parmbuf[3] = (toread >> 0) & 0xFF;
+		parmbuf[4] = (toread >> 8) & 0xFF;
+		parmbuf[5] = (toread >> 16) & 0xFF;
+		if (sp_docommand(S_CMD_O_SPIREAD, 6 + cmd_len, parmbuf, toread, buf + i)) {
+			msg_perr(MSGHEADER "Error: streamed SPI read at 0x%06x failed\n", start + i);
+			return 1;
+		}
+		i += toread;
+		/* spi_chip_read() reports the completion of the whole call. */
+		if (i < len)
+			update_progress(flash, FLASHROM_PROGRESS_READ, i, len);
+	}
+	return 0;
+}
+
+/* Pipeline write enable, page program and waiting for the write to finish for
+ * all pages. The device polls the status register itself, so no round trip
+ * is needed between two pages. */
+static int serprog_spi_write_256(struct flashctx *flash, const uint8_t *buf, unsigned int start, unsigned int len)
+{
+	const unsigned int page_size = flash->chip->page_size;
+	const unsigned int chunksize = min(page_size, flash->mst->spi.max_data_write);
+	const uint8_t wren = JEDEC_WREN;
+	unsigned int i, j;
+	uint8_t *cmd, status;
+	int ret = 0;
+
+	/* A page program has to fit into the serial buffer of the device in one piece. */
+	if (!sp_check_commandavail(S_CMD_O_SPIOP_SEQ) || !sp_check_commandavail(S_CMD_O_SPIPOLL) ||
+	    !sp_pipeline_fits(7 + 1 + JEDEC_MAX_ADDR_LEN + chunksize))
+		return default_spi_write_256(flash, buf, start, len);
+
+	if ((sp_opbuf_usage) || (sp_max_write_n && sp_write_n_bytes)) {
+		if (sp_execute_opbuf() != 0) {
+			msg_perr("Error: could not execute command buffer before sending SPI commands.\n");
+			return 1;
+		}
+	}
+
+	cmd = malloc(1 + JEDEC_MAX_ADDR_LEN + chunksize);
+	if (!cmd) {
+		msg_perr("Error: could not allocate SPI program buffer.\n");
+		return 1;
+	}
+
+	/* Same page walk as in spi_write_chunked(). */
+	for (i = start / page_size; i <= (start + len - 1) / page_size; i++) {
+		const unsigned int starthere = max(start, i * page_size);
+		const unsigned int lenhere = min(start + len, (i + 1) * page_size) - starthere;
+
+		for (j = 0; j < lenhere; j += chunksize) {
+			const unsigned int towrite = min(chunksize, lenhere - j);
+
+			/* This may send commands to set up the extended address register,
+			   which also drains the pipeline before. */
+			const int cmd_len = spi_prepare_program_cmd(flash, cmd, starthere + j);
+			if (cmd_len < 0) {
+				ret = SPI_GENERIC_ERROR;
+				goto out;
+			}
+			memcpy(cmd + cmd_len, buf + starthere - start + j, towrite);
+
+			if (sp_queue_spiop(1, 0, &wren, NULL) ||
+			    sp_queue_spiop(cmd_len + towrite, 0, cmd, NULL) ||
+			    sp_queue_spipoll(JEDEC_RDSR, SPI_SR_WIP, 0, SP_SPIPOLL_INTERVAL_US,
+					     SP_SPIPOLL_TIMEOUT_US, &status)) {
+				ret = 1;
+				goto out;
+			}
+		}
+		update_progress(flash, FLASHROM_PROGRESS_WRITE, starthere - start + lenhere, len);
+	}
+
+out:
+	if (sp_pipeline_drain())
+		ret = ret ? ret : 1;
+	free(cmd);
+	return ret;
+}
+
 static int serprog_shutdown(void *data)
 {
+	if (sp_pipeline_drain() != 0)
+		msg_pwarn("Could not drain pipelined commands.\n");
 	if ((sp_opbuf_usage) || (sp_max_write_n && sp_write_n_bytes))
 	if (sp_execute_opbuf() != 0)
 		msg_pwarn("Could not flush command buffer.\n");
@@ -442,9 +725,9 @@ static struct spi_master spi_master_serprog = {
 	.max_data_read	= MAX_DATA_READ_UNLIMITED,
 	.max_data_write	= MAX_DATA_WRITE_UNLIMITED,
 	.command	= serprog_spi_send_command,
-	.multicommand	= default_spi_send_multicommand,
-	.read		= default_spi_read,
-	.write_256	= default_spi_write_256,
+	.multicommand	= serprog_spi_send_multicommand,
+	.read		= serprog_spi_read,
+	.write_256	= serprog_spi_write_256,
 	.write_aai	= default_spi_write_aai,
 	.probe_opcode	= default_spi_probe_opcode,
 };
@@ -905,10 +1188,20 @@ static int serprog_init(void)
 		msg_pdbg(MSGHEADER "Warning: Programmer does not support toggling its output drivers\n");
 	}
 
+	if (serprog_buses_supported & BUS_SPI) {
+		msg_pdbg(MSGHEADER "Streamed SPI read %ssupported, sequenced SPI operations %ssupported, "
+			 "SPI polling %ssupported\n",
+			 sp_check_commandavail(S_CMD_O_SPIREAD) ? "" : "not ",
+			 sp_check_commandavail(S_CMD_O_SPIOP_SEQ) ? "" : "not ",
+			 sp_check_commandavail(S_CMD_O_SPIPOLL) ? "" : "not ");
+	}
+
 	sp_prev_was_write = 0;
 	sp_streamed_transmit_ops = 0;
 	sp_streamed_transmit_bytes = 0;
 	sp_opbuf_usage = 0;
+	sp_pipelined_count = 0;
+	sp_pipelined_bytes = 0;
 
 	if (register_shutdown(serprog_shutdown, NULL))
 		goto init_err_cleanup_exit;
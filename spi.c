@@ -30,12 +30,18 @@ int spi_send_command(const struct flashctx *flash, unsigned int writecnt,
 		     unsigned int readcnt, const unsigned char *writearr,
 		     unsigned char *readarr)
 {
+	if (flash->stats)
+		return stats_spi_send_command(flash, writecnt, readcnt, writearr, readarr);
+
 	return flash->mst->spi.command(flash, writecnt, readcnt, writearr,
 				       readarr);
 }
 
 int spi_send_multicommand(const struct flashctx *flash, struct spi_command *cmds)
 {
+	if (flash->stats)
+		return stats_spi_send_multicommand(flash, cmds);
+
 	return flash->mst->spi.multicommand(flash, cmds);
 }
 
@@ -101,18 +107,21 @@ int spi_chip_read(struct flashctx *flash, uint8_t *buf, unsigned int start,
 {
 	int ret;
 	size_t to_read;
-	size_t start_address = start;
-	size_t end_address = len - start;
+	const size_t start_address = start;
+	const size_t total = len;
 	for (; len; len -= to_read, buf += to_read, start += to_read) {
 		/* Do not cross 16MiB boundaries in a single transfer.
 		   This helps with
 		   o multi-die 4-byte-addressing chips,
 		   o dediprog that has a protocol limit of 32MiB-512B. */
 		to_read = min(ALIGN_DOWN(start + 16*MiB, 16*MiB) - start, len);
+		/* Masters which report progress themselves do so per segment. */
+		progress_segment_begin(flash, start - start_address, to_read, total);
 		ret = flash->mst->spi.read(flash, buf, start, to_read);
+		progress_segment_end(flash);
 		if (ret)
 			return ret;
-		update_progress(flash, FLASHROM_PROGRESS_READ, start - start_address + to_read, end_address);
+		update_progress(flash, FLASHROM_PROGRESS_READ, start - start_address + to_read, total);
 	}
 	return 0;
 }
@@ -663,6 +663,28 @@ uint8_t spi_get_opcode_from_erasefn(erasefunc_t *func)
 	return 0x00; //Assuming 0x00 is not a erase function opcode
 }
 
+/**
+ * Prepare the instruction bytes to program at `address`.
+ *
+ * Like spi_prepare_read_cmd() but for the (page) program instruction,
+ * the data to program has to be appended by the caller.
+ *
+ * @param flash    the flash chip's context
+ * @param cmd      output buffer of at least 1 + JEDEC_MAX_ADDR_LEN bytes
+ * @param address  the address to program at
+ * @return the number of bytes to send, negative on error
+ */
+int spi_prepare_program_cmd(struct flashctx *flash, uint8_t cmd[], unsigned int address)
+{
+	const bool native_4ba = flash->chip->feature_bits & FEATURE_4BA_WRITE && spi_master_4ba(flash);
+
+	cmd[0] = native_4ba ? JEDEC_BYTE_PROGRAM_4BA : JEDEC_BYTE_PROGRAM;
+	const int addr_len = spi_prepare_address(flash, cmd, native_4ba, address);
+	if (addr_len < 0)
+		return addr_len;
+	return 1 + addr_len;
+}
+
 static int spi_nbyte_program(struct flashctx *flash, unsigned int addr, const uint8_t *bytes, unsigned int len)
 {
 	const bool native_4ba = flash->chip->feature_bits & FEATURE_4BA_WRITE && spi_master_4ba(flash);
@@ -670,18 +692,52 @@ static int spi_nbyte_program(struct flashctx *flash, unsigned int addr, const ui
 	return spi_write_cmd(flash, op, native_4ba, addr, bytes, len, 10);
 }
 
-int spi_nbyte_read(struct flashctx *flash, unsigned int address, uint8_t *bytes,
-		   unsigned int len)
+/**
+ * Prepare the instruction bytes to read from `address`.
+ *
+ * This selects the native 4BA instruction if both chip and master support
+ * it and otherwise sets up the address according to the current addressing
+ * mode, which may update the extended address register of the chip.
+ *
+ * @param flash    the flash chip's context
+ * @param cmd      output buffer of at least JEDEC_MAX_READ_CMD_LEN bytes
+ * @param address  the address to read from
+ * @param fast     whether to use the fast read instruction, which is
+ *                 followed by one dummy byte
+ * @return the number of bytes to send, negative on error
+ */
+int spi_prepare_read_cmd(struct flashctx *flash, uint8_t cmd[], unsigned int address, bool fast)
 {
-	const bool native_4ba = flash->chip->feature_bits & FEATURE_4BA_READ && spi_master_4ba(flash);
-	uint8_t cmd[1 + JEDEC_MAX_ADDR_LEN] = { native_4ba ? JEDEC_READ_4BA : JEDEC_READ, };
+	const bool native_4ba = flash->chip->feature_bits & (fast ? FEATURE_4BA_FAST_READ : FEATURE_4BA_READ)
+				&& spi_master_4ba(flash);
+
+	if (fast)
+		cmd[0] = native_4ba ? JEDEC_READ_4BA_FAST : JEDEC_READ_FAST;
+	else
+		cmd[0] = native_4ba ? JEDEC_READ_4BA : JEDEC_READ;
 
 	const int addr_len = spi_prepare_address(flash, cmd, native_4ba, address);
 	if (addr_len < 0)
+		return addr_len;
+
+	if (!fast)
+		return 1 + addr_len;
+
+	cmd[1 + addr_len] = 0xff; /* dummy byte */
+	return 1 + addr_len + 1;
+}
+
+int spi_nbyte_read(struct flashctx *flash, unsigned int address, uint8_t *bytes,
+		   unsigned int len)
+{
+	uint8_t cmd[JEDEC_MAX_READ_CMD_LEN];
+
+	const int cmd_len = spi_prepare_read_cmd(flash, cmd, address, false);
+	if (cmd_len < 0)
 		return 1;
 
 	/* Send Read */
-	return spi_send_command(flash, 1 + addr_len, len, cmd, bytes);
+	return spi_send_command(flash, cmd_len, len, cmd, bytes);
 }
 
 /*
@@ -693,8 +749,8 @@ int spi_read_chunked(struct flashctx *flash, uint8_t *buf, unsigned int start,
 {
 	int ret, rc = 0;
 	size_t to_read;
-	size_t start_address = start;
-	size_t end_address = len - start;
+	const size_t start_address = start;
+	const size_t total = len;
 	for (; len; len -= to_read, buf += to_read, start += to_read) {
 		to_read = min(chunksize, len);
 		ret = spi_nbyte_read(flash, start, buf, to_read);
@@ -705,7 +761,7 @@ int spi_read_chunked(struct flashctx *flash, uint8_t *buf, unsigned int start,
 			rc = ret;
 		} else if (ret)
 			return ret;
-		update_progress(flash, FLASHROM_PROGRESS_READ, start - start_address + to_read, end_address);
+		update_progress(flash, FLASHROM_PROGRESS_READ, start - start_address + to_read, total);
 	}
 	return rc;
 }
@@ -725,8 +781,6 @@ int spi_write_chunked(struct flashctx *flash, const uint8_t *buf, unsigned int s
 	 * we're OK for now.
 	 */
 	unsigned int page_size = flash->chip->page_size;
-	size_t start_address = start;
-	size_t end_address = len - start;
 
 	/* Warning: This loop has a very unusual condition and body.
 	 * The loop needs to go through each page with at least one affected
@@ -751,7 +805,7 @@ int spi_write_chunked(struct flashctx *flash, const uint8_t *buf, unsigned int s
 			if (rc)
 				return rc;
 		}
-		update_progress(flash, FLASHROM_PROGRESS_WRITE, start - start_address + lenhere, end_address);
+		update_progress(flash, FLASHROM_PROGRESS_WRITE, starthere - start + lenhere, len);
 	}
 
 	return 0;
@@ -771,7 +825,7 @@ int spi_chip_write_1(struct flashctx *flash, const uint8_t *buf, unsigned int st
 	for (i = start; i < start + len; i++) {
 		if (spi_nbyte_program(flash, i, buf + i - start, 1))
 			return 1;
-		update_progress(flash, FLASHROM_PROGRESS_WRITE, i - start, len - start);
+		update_progress(flash, FLASHROM_PROGRESS_WRITE, i - start + 1, len);
 	}
 	return 0;
 }
@@ -0,0 +1,303 @@
+/*
+ * This file is part of the flashrom project.
+ *
+ * Copyright 2026 Google LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Statistics and tracing of the operations sent to the programmer.
+ *
+ * The hooks in spi.c and opaque.c only call in here when a flash context
+ * has statistics or tracing enabled.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flash.h"
+#include "programmer.h"
+#include "spi.h"
+
+struct stats_state {
+	bool enabled;
+	struct flashrom_stats stats;
+	/* Commands issued by an outer, already accounted operation are not accounted again. */
+	unsigned int depth;
+	FILE *trace;
+	uint64_t trace_start_ns;
+	bool trace_error;
+};
+
+static void stats_count(struct flashrom_stats_counter *counter, unsigned int bytes_out, unsigned int bytes_in)
+{
+	counter->count++;
+	counter->bytes_out += bytes_out;
+	counter->bytes_in += bytes_in;
+}
+
+static void stats_time(struct flashrom_stats_counter *counter, uint64_t duration_ns)
+{
+	const uint64_t us = duration_ns / 1000;
+	unsigned int bucket = 0;
+
+	while (bucket < FLASHROM_STATS_LATENCY_BUCKETS - 1 && us >> (bucket + 1))
+		bucket++;
+
+	counter->timed++;
+	counter->total_us += us;
+	if (us > counter->max_us)
+		counter->max_us = us;
+	counter->latency[bucket]++;
+}
+
+static void stats_trace(struct stats_state *state, enum flashrom_trace_type type, uint8_t opcode,
+			int result, unsigned int addr, unsigned int bytes_out, unsigned int bytes_in,
+			uint64_t start_ns, uint64_t duration_ns)
+{
+	if (!state->trace || state->trace_error)
+		return;
+
+	const struct flashrom_trace_record record = {
+		.timestamp_ns	= start_ns - state->trace_start_ns,
+		.duration_ns	= duration_ns,
+		.type		= type,
+		.opcode		= opcode,
+		.result		= result < INT16_MIN ? INT16_MIN : result > INT16_MAX ? INT16_MAX : result,
+		.addr		= addr,
+		.bytes_out	= bytes_out,
+		.bytes_in	= bytes_in,
+	};
+	if (fwrite(&record, sizeof(record), 1, state->trace) != 1) {
+		msg_gerr("Writing the trace failed, tracing stopped.\n");
+		state->trace_error = true;
+	}
+}
+
+static void stats_spi(struct stats_state *state, unsigned int writecnt, unsigned int readcnt,
+		      const unsigned char *writearr, bool timed, int result,
+		      uint64_t start_ns, uint64_t duration_ns)
+{
+	const uint8_t opcode = writecnt ? writearr[0] : 0;
+
+	if (state->enabled) {
+		stats_count(&state->stats.spi[opcode], writecnt, readcnt);
+		if (timed)
+			stats_time(&state->stats.spi[opcode], duration_ns);
+	}
+	stats_trace(state, FLASHROM_TRACE_SPI, opcode, result, 0, writecnt, readcnt,
+		    start_ns, timed ? duration_ns : 0);
+}
+
+int stats_spi_send_command(const struct flashctx *flash, unsigned int writecnt, unsigned int readcnt,
+			   const unsigned char *writearr, unsigned char *readarr)
+{
+	struct stats_state *const state = flash->stats;
+
+	if (state->depth)
+		return flash->mst->spi.command(flash, writecnt, readcnt, writearr, readarr);
+
+	state->depth++;
+	const uint64_t start = internal_clock_ns();
+	const int ret = flash->mst->spi.command(flash, writecnt, readcnt, writearr, readarr);
+	const uint64_t duration = internal_clock_ns() - start;
+	state->depth--;
+
+	stats_spi(state, writecnt, readcnt, writearr, true, ret, start, duration);
+	return ret;
+}
+
+int stats_spi_send_multicommand(const struct flashctx *flash, struct spi_command *cmds)
+{
+	struct stats_state *const state = flash->stats;
+	struct spi_command *cmd;
+
+	if (state->depth)
+		return flash->mst->spi.multicommand(flash, cmds);
+
+	state->depth++;
+	const uint64_t start = internal_clock_ns();
+	const int ret = flash->mst->spi.multicommand(flash, cmds);
+	const uint64_t duration = internal_clock_ns() - start;
+	state->depth--;
+
+	for (cmd = cmds; cmd->writecnt || cmd->readcnt; cmd++) {
+		const bool last = !cmd[1].writecnt && !cmd[1].readcnt;
+		stats_spi(state, cmd->writecnt, cmd->readcnt, cmd->writearr, last, ret, start, duration);
+	}
+	return ret;
+}
+
+static void stats_opaque(struct stats_state *state, enum flashrom_stats_opaque_op op,
+			 enum flashrom_trace_type type, int result, unsigned int addr,
+			 unsigned int bytes_out, unsigned int bytes_in, uint64_t start_ns, uint64_t duration_ns)
+{
+	if (state->enabled) {
+		stats_count(&state->stats.opaque[op], bytes_out, bytes_in);
+		stats_time(&state->stats.opaque[op], duration_ns);
+	}
+	stats_trace(state, type, 0, result, addr, bytes_out, bytes_in, start_ns, duration_ns);
+}
+
+int stats_read_opaque(struct flashctx *flash, uint8_t *buf, unsigned int start, unsigned int len)
+{
+	const uint64_t start_ns = internal_clock_ns();
+	const int ret = flash->mst->opaque.read(flash, buf, start, len);
+	stats_opaque(flash->stats, FLASHROM_STATS_OPAQUE_READ, FLASHROM_TRACE_OPAQUE_READ,
+		     ret, start, 0, len, start_ns, internal_clock_ns() - start_ns);
+	return ret;
+}
+
+int stats_write_opaque(struct flashctx *flash, const uint8_t *buf, unsigned int start, unsigned int len)
+{
+	const uint64_t start_ns = internal_clock_ns();
+	const int ret = flash->mst->opaque.write(flash, buf, start, len);
+	stats_opaque(flash->stats, FLASHROM_STATS_OPAQUE_WRITE, FLASHROM_TRACE_OPAQUE_WRITE,
+		     ret, start, len, 0, start_ns, internal_clock_ns() - start_ns);
+	return ret;
+}
+
+int stats_erase_opaque(struct flashctx *flash, unsigned int blockaddr, unsigned int blocklen)
+{
+	const uint64_t start_ns = internal_clock_ns();
+	const int ret = flash->mst->opaque.erase(flash, blockaddr, blocklen);
+	stats_opaque(flash->stats, FLASHROM_STATS_OPAQUE_ERASE, FLASHROM_TRACE_OPAQUE_ERASE,
+		     ret, blockaddr, 0, 0, start_ns, internal_clock_ns() - start_ns);
+	return ret;
+}
+
+uint64_t stats_phase_start(const struct flashctx *flash)
+{
+	if (!flash->stats || !flash->stats->enabled)
+		return 0;
+
+	return internal_clock_ns();
+}
+
+/* `start` is the value returned by stats_phase_start(), nothing is accounted for 0. */
+void stats_phase_end(struct flashctx *flash, enum flashrom_stats_phase phase, uint64_t start, unsigned int bytes)
+{
+	if (!start || !flash->stats || !flash->stats->enabled)
+		return;
+
+	flash->stats->stats.phases[phase].total_us += (internal_clock_ns() - start) / 1000;
+	flash->stats->stats.phases[phase].bytes += bytes;
+}
+
+/* Frontends index chip->block_erasers[] with the counters, so there must not be more of them. */
+_Static_assert(FLASHROM_STATS_ERASERS == NUM_ERASEFUNCTIONS,
+	       "FLASHROM_STATS_ERASERS must match NUM_ERASEFUNCTIONS");
+
+void stats_eraser_used(struct flashctx *flash, unsigned int eraser, unsigned int len)
+{
+	if (!flash->stats || !flash->stats->enabled || eraser >= FLASHROM_STATS_ERASERS)
+		return;
+
+	flash->stats->stats.erasers[eraser].count++;
+	flash->stats->stats.erasers[eraser].bytes += len;
+}
+
+static struct stats_state *stats_get_state(struct flashctx *flash)
+{
+	if (!flash->stats) {
+		flash->stats = calloc(1, sizeof(*flash->stats));
+		if (!flash->stats)
+			msg_gerr("Out of memory!\n");
+	}
+	return flash->stats;
+}
+
+static void stats_put_state(struct flashctx *flash)
+{
+	if (flash->stats && !flash->stats->enabled && !flash->stats->trace) {
+		free(flash->stats);
+		flash->stats = NULL;
+	}
+}
+
+int flashrom_stats_enable(struct flashrom_flashctx *const flashctx, const bool enable)
+{
+	if (!enable) {
+		if (flashctx->stats)
+			flashctx->stats->enabled = false;
+		stats_put_state(flashctx);
+		return 0;
+	}
+
+	struct stats_state *const state = stats_get_state(flashctx);
+	if (!state)
+		return 1;
+
+	memset(&state->stats, 0, sizeof(state->stats));
+	state->enabled = true;
+	return 0;
+}
+
+const struct flashrom_stats *flashrom_stats_get(const struct flashrom_flashctx *const flashctx)
+{
+	if (!flashctx->stats || !flashctx->stats->enabled)
+		return NULL;
+
+	return &flashctx->stats->stats;
+}
+
+void flashrom_stats_reset(struct flashrom_flashctx *const flashctx)
+{
+	if (flashctx->stats)
+		memset(&flashctx->stats->stats, 0, sizeof(flashctx->stats->stats));
+}
+
+int flashrom_trace_start(struct flashrom_flashctx *const flashctx, const char *const path)
+{
+	flashrom_trace_stop(flashctx);
+
+	struct stats_state *const state = stats_get_state(flashctx);
+	if (!state)
+		return 1;
+
+	state->trace = fopen(path, "wb");
+	if (!state->trace) {
+		msg_gerr("Opening trace file \"%s\" failed: %s\n", path, strerror(errno));
+		stats_put_state(flashctx);
+		return 1;
+	}
+	state->trace_error = fwrite(FLASHROM_TRACE_MAGIC, strlen(FLASHROM_TRACE_MAGIC), 1, state->trace) != 1;
+	state->trace_start_ns = internal_clock_ns();
+	return 0;
+}
+
+int flashrom_trace_stop(struct flashrom_flashctx *const flashctx)
+{
+	struct stats_state *const state = flashctx->stats;
+	int ret = 0;
+
+	if (!state || !state->trace)
+		return 0;
+
+	if (fclose(state->trace) || state->trace_error)
+		ret = 1;
+	state->trace = NULL;
+	state->trace_error = false;
+	stats_put_state(flashctx);
+	return ret;
+}
+
+void stats_release(struct flashctx *flash)
+{
+	if (!flash->stats)
+		return;
+
+	flashrom_trace_stop(flash);
+	free(flash->stats);
+	flash->stats = NULL;
+}
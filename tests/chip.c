@@ -26,6 +26,7 @@
  */
 
 #include <include/test.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -35,15 +36,18 @@
 #include "io_mock.h"
 #include "libflashrom.h"
 #include "programmer.h"
+#include "spi.h"
 
 #define MOCK_CHIP_SIZE (8*MiB)
 #define MOCK_CHIP_CONTENT 0xff
 
 static struct {
 	unsigned int unlock_calls; /* how many times unlock function was called */
+	unsigned int erase_calls; /* how many times block erase function was called */
 	uint8_t buf[MOCK_CHIP_SIZE]; /* buffer of total size of chip, to emulate a chip */
 } g_chip_state = {
 	.unlock_calls = 0,
+	.erase_calls = 0,
 	.buf = { 0 },
 };
 
@@ -98,18 +102,21 @@ static int block_erase_chip(struct flashctx *flash, unsigned int blockaddr, unsi
 
 	assert_in_range(blockaddr + blocklen, 0, MOCK_CHIP_SIZE);
 
+	g_chip_state.erase_calls++;
 	memset(&g_chip_state.buf[blockaddr], 0xff, blocklen);
 	return 0;
 }
 
-static void setup_chip(struct flashrom_flashctx *flashctx, struct flashrom_layout **layout,
-		struct flashchip *chip, const char *programmer_param, const struct io_mock *io)
+static void setup_chip_with_programmer(struct flashrom_flashctx *flashctx, struct flashrom_layout **layout,
+		struct flashchip *chip, const struct programmer_entry *prog,
+		const char *programmer_param, const struct io_mock *io)
 {
 	io_mock_register(io);
 
 	flashctx->chip = chip;
 
 	g_chip_state.unlock_calls = 0;
+	g_chip_state.erase_calls = 0;
 	memset(g_chip_state.buf, MOCK_CHIP_CONTENT, sizeof(g_chip_state.buf));
 
 	printf("Creating layout with one included region... ");
@@ -127,12 +134,18 @@ static void setup_chip(struct flashrom_flashctx *flashctx, struct flashrom_layou
 	 * from a programmer side, and test can focus on working with the chip.
 	 */
 	printf("Dummyflasher initialising with param=\"%s\"... ", programmer_param);
-	assert_int_equal(0, programmer_init(&programmer_dummy, programmer_param));
+	assert_int_equal(0, programmer_init(prog, programmer_param));
 	/* Assignment below normally happens while probing, but this test is not probing. */
 	flashctx->mst = &registered_masters[0];
 	printf("done\n");
 }
 
+static void setup_chip(struct flashrom_flashctx *flashctx, struct flashrom_layout **layout,
+		struct flashchip *chip, const char *programmer_param, const struct io_mock *io)
+{
+	setup_chip_with_programmer(flashctx, layout, chip, &programmer_dummy, programmer_param, io);
+}
+
 static void teardown(struct flashrom_layout **layout)
 {
 	printf("Dummyflasher shutdown... ");
@@ -162,7 +175,7 @@ static const struct flashchip chip_8MiB = {
 };
 
 /* Setup the struct for W25Q128.V, all values come from flashchips.c */
-static const struct flashchip chip_W25Q128_V = {
+const struct flashchip chip_W25Q128_V = {
 	.vendor		= "aklm&dummyflasher",
 	.total_size	= 16 * 1024,
 	.tested		= TEST_OK_PREW,
@@ -249,6 +262,59 @@ void erase_chip_with_dummyflasher_test_success(void **state)
 	free(param_dup);
 }
 
+void erase_chip_with_timing_dummyflasher_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	static struct io_mock_fallback_open_state data = {
+		.noc	= 0,
+		.paths	= { NULL },
+	};
+	const struct io_mock chip_io = {
+		.fallback_open_state = &data,
+	};
+
+	struct flashrom_flashctx flashctx = { 0 };
+	struct flashrom_layout *layout;
+	struct flashchip mock_chip = chip_W25Q128_V;
+	char *param_dup = strdup("bus=spi,emulate=W25Q128FV,timing=typ");
+	uint8_t status;
+
+	setup_chip(&flashctx, &layout, &mock_chip, param_dup, &chip_io);
+
+	/* A sector erase keeps the emulated chip busy for its typical 45 ms. */
+	const unsigned char se[] = { JEDEC_SE, 0x00, 0x10, 0x00 };
+	assert_int_equal(0, spi_write_enable(&flashctx));
+	assert_int_equal(0, spi_send_command(&flashctx, sizeof(se), 0, se, NULL));
+	uint64_t start_ns = internal_clock_ns();
+	assert_int_equal(0, spi_read_register(&flashctx, STATUS1, &status));
+	assert_true(status & SPI_SR_WIP);
+
+	/* Other commands than status reads are ignored and read 0xff while busy. */
+	const unsigned char rdid[] = { JEDEC_RDID };
+	unsigned char id[JEDEC_RDID_INSIZE] = { 0 };
+	assert_int_equal(0, spi_send_command(&flashctx, sizeof(rdid), sizeof(id), rdid, id));
+	assert_int_equal(0xff, id[0]);
+
+	/* WIP clears by itself once the erase is done. */
+	do {
+		programmer_delay(1000);
+		assert_int_equal(0, spi_read_register(&flashctx, STATUS1, &status));
+	} while (status & SPI_SR_WIP);
+	assert_int_equal(45, (internal_clock_ns() - start_ns) / (1000 * 1000));
+
+	/* Erase functions poll WIP until the chip is done. */
+	start_ns = internal_clock_ns();
+	assert_int_equal(0, spi_block_erase_20(&flashctx, 0x2000, 0x1000));
+	assert_int_equal(0, spi_read_register(&flashctx, STATUS1, &status));
+	assert_false(status & SPI_SR_WIP);
+	assert_in_range(internal_clock_ns() - start_ns, 45 * 1000 * 1000, 50 * 1000 * 1000);
+
+	teardown(&layout);
+
+	free(param_dup);
+}
+
 void read_chip_test_success(void **state)
 {
 	(void) state; /* unused */
@@ -320,6 +386,248 @@ void read_chip_with_dummyflasher_test_success(void **state)
 	free(buf);
 }
 
+void read_chip_with_stats_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	static struct io_mock_fallback_open_state data = {
+		.noc	= 0,
+		.paths	= { NULL },
+	};
+	const struct io_mock chip_io = {
+		.fallback_open_state = &data,
+	};
+
+	struct flashrom_flashctx flashctx = { 0 };
+	struct flashrom_layout *layout;
+	struct flashchip mock_chip = chip_W25Q128_V;
+	char *param_dup = strdup("bus=spi,emulate=W25Q128FV");
+
+	setup_chip(&flashctx, &layout, &mock_chip, param_dup, &chip_io);
+
+	const unsigned long size = mock_chip.total_size * 1024;
+	unsigned char *buf = calloc(size, sizeof(unsigned char));
+
+	assert_null(flashrom_stats_get(&flashctx));
+	assert_int_equal(0, flashrom_stats_enable(&flashctx, true));
+
+	printf("Read chip operation started.\n");
+	assert_int_equal(0, flashrom_image_read(&flashctx, buf, size));
+	printf("Read chip operation done.\n");
+
+	const struct flashrom_stats *const stats = flashrom_stats_get(&flashctx);
+	assert_non_null(stats);
+
+	/* The whole chip came in through READ commands, each of them timed. */
+	const struct flashrom_stats_counter *const read = &stats->spi[JEDEC_READ];
+	assert_int_equal(size, read->bytes_in);
+	assert_int_equal(read->count * JEDEC_READ_OUTSIZE, read->bytes_out);
+	assert_int_equal(read->count, read->timed);
+	uint64_t samples = 0;
+	for (unsigned int i = 0; i < FLASHROM_STATS_LATENCY_BUCKETS; i++)
+		samples += read->latency[i];
+	assert_int_equal(read->timed, samples);
+
+	/* All of it was accounted to the read phase. */
+	assert_int_equal(size, stats->phases[FLASHROM_STATS_PHASE_READ].bytes);
+	assert_int_equal(0, stats->phases[FLASHROM_STATS_PHASE_WRITE].bytes);
+
+	flashrom_stats_reset(&flashctx);
+	assert_int_equal(0, stats->spi[JEDEC_READ].count);
+
+	assert_int_equal(0, flashrom_stats_enable(&flashctx, false));
+	assert_null(flashrom_stats_get(&flashctx));
+	assert_null(flashctx.stats);
+
+	teardown(&layout);
+
+	free(param_dup);
+	free(buf);
+}
+
+/*
+ * Budgets of the commands sent to the emulated W25Q128.V. They are about
+ * twice of what the operations take today, so that changes doubling the
+ * transactions fail here and need to update the budget consciously.
+ */
+#define BUDGET_READ_COMMANDS		512
+#define BUDGET_READ_BYTES_OUT		2048
+#define BUDGET_DELTA_WRITE_COMMANDS	640
+#define BUDGET_NOOP_WRITE_COMMANDS	512
+#define BUDGET_ERASE_COMMANDS		512
+#define DELTA_BLOCK			(4 * KiB)
+
+struct command_totals {
+	unsigned int commands;
+	uint64_t bytes_out;
+	uint64_t bytes_in;
+	unsigned int erase_calls;
+	uint64_t erased_bytes;
+};
+
+static void get_command_totals(const struct flashrom_flashctx *flashctx, struct command_totals *totals)
+{
+	const struct flashrom_stats *const stats = flashrom_stats_get(flashctx);
+	unsigned int i;
+
+	assert_non_null(stats);
+	memset(totals, 0, sizeof(*totals));
+	for (i = 0; i < ARRAY_SIZE(stats->spi); i++) {
+		totals->commands += stats->spi[i].count;
+		totals->bytes_out += stats->spi[i].bytes_out;
+		totals->bytes_in += stats->spi[i].bytes_in;
+	}
+	for (i = 0; i < FLASHROM_STATS_ERASERS; i++) {
+		totals->erase_calls += stats->erasers[i].count;
+		totals->erased_bytes += stats->erasers[i].bytes;
+	}
+	printf("%u commands, %"PRIu64" bytes out, %"PRIu64" bytes in, %u erase calls for %"PRIu64" bytes\n",
+	       totals->commands, totals->bytes_out, totals->bytes_in, totals->erase_calls, totals->erased_bytes);
+}
+
+void read_chip_command_budget_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	static struct io_mock_fallback_open_state data = {
+		.noc	= 0,
+		.paths	= { NULL },
+	};
+	const struct io_mock chip_io = {
+		.fallback_open_state = &data,
+	};
+
+	struct flashrom_flashctx flashctx = { 0 };
+	struct flashrom_layout *layout;
+	struct flashchip mock_chip = chip_W25Q128_V;
+	char *param_dup = strdup("bus=spi,emulate=W25Q128FV");
+	struct command_totals totals;
+
+	setup_chip(&flashctx, &layout, &mock_chip, param_dup, &chip_io);
+
+	const unsigned long size = mock_chip.total_size * KiB;
+	uint8_t *const buf = malloc(size);
+
+	assert_int_equal(0, flashrom_stats_enable(&flashctx, true));
+	assert_int_equal(0, flashrom_image_read(&flashctx, buf, size));
+	get_command_totals(&flashctx, &totals);
+
+	/* Every byte is read exactly once, plus a few status register reads. */
+	assert_in_range(totals.bytes_in, size, size + 16);
+	assert_in_range(totals.commands, 1, BUDGET_READ_COMMANDS);
+	assert_in_range(totals.bytes_out, 1, BUDGET_READ_BYTES_OUT);
+	assert_int_equal(0, totals.erase_calls);
+
+	assert_int_equal(0, flashrom_stats_enable(&flashctx, false));
+	teardown(&layout);
+
+	free(param_dup);
+	free(buf);
+}
+
+void write_chip_command_budget_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	static struct io_mock_fallback_open_state data = {
+		.noc	= 0,
+		.paths	= { NULL },
+	};
+	const struct io_mock chip_io = {
+		.fallback_open_state = &data,
+	};
+
+	struct flashrom_flashctx flashctx = { 0 };
+	struct flashrom_layout *layout;
+	struct flashchip mock_chip = chip_W25Q128_V;
+	char *param_dup = strdup("bus=spi,emulate=W25Q128FV");
+	struct command_totals totals;
+
+	setup_chip(&flashctx, &layout, &mock_chip, param_dup, &chip_io);
+
+	const unsigned long size = mock_chip.total_size * KiB;
+	uint8_t *const newcontents = malloc(size);
+	const unsigned int block = 0x10000;
+
+	/* Program one block into the erased chip, this needs no erase. */
+	memset(newcontents, 0xff, size);
+	memset(newcontents + block, 0x00, DELTA_BLOCK);
+	assert_int_equal(0, flashrom_image_write(&flashctx, newcontents, size, NULL));
+
+	/* Changing the block again needs exactly one erase of its size. */
+	memset(newcontents + block, 0x55, DELTA_BLOCK);
+	assert_int_equal(0, flashrom_stats_enable(&flashctx, true));
+	assert_int_equal(0, flashrom_image_write(&flashctx, newcontents, size, NULL));
+	get_command_totals(&flashctx, &totals);
+
+	assert_int_equal(1, totals.erase_calls);
+	assert_int_equal(DELTA_BLOCK, totals.erased_bytes);
+	assert_int_equal(DELTA_BLOCK / mock_chip.page_size,
+			 flashrom_stats_get(&flashctx)->spi[JEDEC_BYTE_PROGRAM].count);
+	assert_in_range(totals.commands, 1, BUDGET_DELTA_WRITE_COMMANDS);
+	/* The old contents are read once, plus the erased block. */
+	assert_in_range(totals.bytes_in, size, size + 2 * DELTA_BLOCK);
+
+	/* Writing the same image again touches nothing. */
+	flashrom_stats_reset(&flashctx);
+	assert_int_equal(0, flashrom_image_write(&flashctx, newcontents, size, NULL));
+	get_command_totals(&flashctx, &totals);
+
+	assert_int_equal(0, totals.erase_calls);
+	assert_int_equal(0, flashrom_stats_get(&flashctx)->spi[JEDEC_BYTE_PROGRAM].count);
+	assert_in_range(totals.commands, 1, BUDGET_NOOP_WRITE_COMMANDS);
+	assert_in_range(totals.bytes_in, size, size + DELTA_BLOCK);
+
+	assert_int_equal(0, flashrom_stats_enable(&flashctx, false));
+	teardown(&layout);
+
+	free(param_dup);
+	free(newcontents);
+}
+
+void erase_chip_command_budget_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	static struct io_mock_fallback_open_state data = {
+		.noc	= 0,
+		.paths	= { NULL },
+	};
+	const struct io_mock chip_io = {
+		.fallback_open_state = &data,
+	};
+
+	struct flashrom_flashctx flashctx = { 0 };
+	struct flashrom_layout *layout;
+	struct flashchip mock_chip = chip_W25Q128_V;
+	char *param_dup = strdup("bus=spi,emulate=W25Q128FV");
+	struct command_totals totals;
+
+	setup_chip(&flashctx, &layout, &mock_chip, param_dup, &chip_io);
+
+	const unsigned long size = mock_chip.total_size * KiB;
+	uint8_t *const newcontents = malloc(size);
+
+	/* Only one block is not erased yet. */
+	memset(newcontents, 0xff, size);
+	memset(newcontents + 0x10000, 0x00, DELTA_BLOCK);
+	assert_int_equal(0, flashrom_image_write(&flashctx, newcontents, size, NULL));
+
+	assert_int_equal(0, flashrom_stats_enable(&flashctx, true));
+	assert_int_equal(0, flashrom_flash_erase(&flashctx));
+	get_command_totals(&flashctx, &totals);
+
+	assert_int_equal(1, totals.erase_calls);
+	assert_int_equal(DELTA_BLOCK, totals.erased_bytes);
+	assert_in_range(totals.commands, 1, BUDGET_ERASE_COMMANDS);
+
+	assert_int_equal(0, flashrom_stats_enable(&flashctx, false));
+	teardown(&layout);
+
+	free(param_dup);
+	free(newcontents);
+}
+
 void write_chip_test_success(void **state)
 {
 	(void) state; /* unused */
@@ -405,6 +713,338 @@ void write_chip_with_dummyflasher_test_success(void **state)
 	free(newcontents);
 }
 
+void write_chip_coalesced_erase_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	static struct io_mock_fallback_open_state data = {
+		.noc	= 0,
+		.paths	= { NULL },
+	};
+	const struct io_mock chip_io = {
+		.fallback_open_state = &data,
+	};
+
+	struct flashrom_flashctx flashctx = { 0 };
+	struct flashrom_layout *layout;
+	struct flashchip mock_chip = chip_8MiB;
+	/* 64 KiB erase blocks, so that a changed range spans many of them. */
+	mock_chip.block_erasers[0].eraseblocks[0].size = 64 * KiB;
+	mock_chip.block_erasers[0].eraseblocks[0].count = MOCK_CHIP_SIZE / (64 * KiB);
+	/* Dummyflasher as an opaque master which can erase any number of blocks at once. */
+	char *param_dup = strdup("bus=prog");
+
+	setup_chip(&flashctx, &layout, &mock_chip, param_dup, &chip_io);
+
+	/* The first 1 MiB needs an erase, the rest of the chip can just be written. */
+	const unsigned long size = mock_chip.total_size * 1024;
+	uint8_t *const newcontents = malloc(size);
+	memset(g_chip_state.buf, 0x00, 1 * MiB);
+	memset(newcontents, 0xa5, size);
+
+	printf("Write chip operation started.\n");
+	assert_int_equal(0, flashrom_image_write(&flashctx, newcontents, size, NULL));
+	printf("Write chip operation done.\n");
+
+	/* All 16 blocks which needed an erase were erased at once. */
+	assert_int_equal(1, g_chip_state.erase_calls);
+	assert_memory_equal(newcontents, g_chip_state.buf, size);
+
+	teardown(&layout);
+
+	free(param_dup);
+	free(newcontents);
+}
+
+/* A write protected 4 KiB region inside the first 64 KiB block of the chip. */
+#define PROTECTED_START	(4 * KiB)
+#define PROTECTED_END	(8 * KiB - 1)
+
+static bool overlaps_protected(unsigned int start, unsigned int len)
+{
+	return start <= PROTECTED_END && start + len > PROTECTED_START;
+}
+
+static int write_chip_protected(struct flashctx *flash, const uint8_t *buf, unsigned int start, unsigned int len)
+{
+	if (overlaps_protected(start, len))
+		return SPI_ACCESS_DENIED;
+	return write_chip(flash, buf, start, len);
+}
+
+static int block_erase_chip_protected(struct flashctx *flash, unsigned int blockaddr, unsigned int blocklen)
+{
+	if (overlaps_protected(blockaddr, blocklen))
+		return SPI_ACCESS_DENIED;
+	return block_erase_chip(flash, blockaddr, blocklen);
+}
+
+void write_chip_mixed_protection_block_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	static struct io_mock_fallback_open_state data = {
+		.noc	= 0,
+		.paths	= { NULL },
+	};
+	const struct io_mock chip_io = {
+		.fallback_open_state = &data,
+	};
+
+	struct flashrom_flashctx flashctx = { 0 };
+	struct flashrom_layout *layout;
+	struct flashchip mock_chip = chip_8MiB;
+	/* Like ichspi with hardware sequencing, which denies blocks reaching into protected regions. */
+	mock_chip.write = write_chip_protected;
+	mock_chip.block_erasers[0] = (struct block_eraser) {
+		.eraseblocks = { {4 * KiB, MOCK_CHIP_SIZE / (4 * KiB)} },
+		.block_erase = block_erase_chip_protected,
+	};
+	mock_chip.block_erasers[1] = (struct block_eraser) {
+		.eraseblocks = { {64 * KiB, MOCK_CHIP_SIZE / (64 * KiB)} },
+		.block_erase = block_erase_chip_protected,
+	};
+
+	setup_chip(&flashctx, &layout, &mock_chip, "", &chip_io);
+
+	/* The whole first 64 KiB block needs an erase. */
+	const unsigned long size = mock_chip.total_size * 1024;
+	uint8_t *const newcontents = malloc(size);
+	memset(g_chip_state.buf, 0x00, 64 * KiB);
+	memset(newcontents, MOCK_CHIP_CONTENT, size);
+	memset(newcontents, 0xa5, 64 * KiB);
+
+	printf("Write chip operation started.\n");
+	assert_int_equal(0, flashrom_image_write(&flashctx, newcontents, size, NULL));
+	printf("Write chip operation done.\n");
+
+	/* The writable 4 KiB blocks around the protected one were erased and written one by one. */
+	assert_memory_equal(newcontents, g_chip_state.buf, PROTECTED_START);
+	assert_memory_equal(newcontents + PROTECTED_END + 1, g_chip_state.buf + PROTECTED_END + 1,
+			    size - PROTECTED_END - 1);
+	for (unsigned int i = PROTECTED_START; i <= PROTECTED_END; i++)
+		assert_int_equal(0x00, g_chip_state.buf[i]);
+	assert_int_equal(15, g_chip_state.erase_calls);
+
+	teardown(&layout);
+
+	free(newcontents);
+}
+
+struct progress_log {
+	unsigned int callbacks;
+	unsigned int stages; /* bitmask of the reported stages */
+	struct flashrom_progress last;
+};
+
+static void progress_log_cb(struct flashrom_flashctx *flashctx)
+{
+	const struct flashrom_progress *progress = flashctx->progress_state;
+	struct progress_log *log = progress->user_data;
+
+	assert_true(progress->current <= progress->total);
+	assert_true(progress->op_current <= progress->op_total);
+	if (log->callbacks) {
+		assert_true(progress->op_current >= log->last.op_current);
+		/* Verifying is the last stage, nothing goes back to erasing or writing. */
+		if (log->last.stage == FLASHROM_PROGRESS_VERIFY)
+			assert_int_equal(FLASHROM_PROGRESS_VERIFY, progress->stage);
+	}
+
+	log->callbacks++;
+	log->stages |= 1 << progress->stage;
+	log->last = *progress;
+}
+
+/* Writes newcontents with progress reporting and checks the final report. */
+static void write_chip_with_progress(struct flashrom_flashctx *flashctx, uint8_t *newcontents,
+				     unsigned long size, unsigned int interval_ms, struct progress_log *log)
+{
+	struct flashrom_progress progress_state = {
+		.user_data = log,
+		.interval_ms = interval_ms,
+	};
+
+	memset(log, 0, sizeof(*log));
+	flashrom_set_progress_callback(flashctx, progress_log_cb, &progress_state);
+	assert_int_equal(0, flashrom_image_write(flashctx, newcontents, size, NULL));
+	flashrom_set_progress_callback(flashctx, NULL, NULL);
+
+	const unsigned int all_stages = 1 << FLASHROM_PROGRESS_READ | 1 << FLASHROM_PROGRESS_ERASE |
+					1 << FLASHROM_PROGRESS_WRITE | 1 << FLASHROM_PROGRESS_VERIFY;
+	assert_int_equal(all_stages, log->stages);
+	assert_int_equal(FLASHROM_PROGRESS_VERIFY, log->last.stage);
+	assert_int_equal(size, log->last.current);
+	assert_int_equal(log->last.total, log->last.current);
+	assert_int_equal(log->last.op_total, log->last.op_current);
+	assert_int_equal(0, log->last.eta_ms);
+	assert_true(log->last.rate > 0);
+	/* Includes the delay before verifying. */
+	assert_true(log->last.elapsed_ms >= 1000);
+}
+
+void write_chip_with_progress_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	static struct io_mock_fallback_open_state data = {
+		.noc	= 0,
+		.paths	= { NULL },
+	};
+	const struct io_mock chip_io = {
+		.fallback_open_state = &data,
+	};
+
+	struct flashrom_flashctx flashctx = { 0 };
+	struct flashrom_layout *layout;
+	struct flashchip mock_chip = chip_W25Q128_V;
+	char *param_dup = strdup("bus=spi,emulate=W25Q128FV,timing=typ");
+	struct progress_log unlimited, limited;
+
+	setup_chip(&flashctx, &layout, &mock_chip, param_dup, &chip_io);
+	flashctx.flags.verify_after_write = true;
+
+	/* The first 64 KiB change on every write, so that they need an erase. */
+	const unsigned long size = mock_chip.total_size * 1024;
+	uint8_t *const newcontents = malloc(size);
+	memset(newcontents, 0xff, size);
+	memset(newcontents, 0x00, 64 * KiB);
+	assert_int_equal(0, flashrom_image_write(&flashctx, newcontents, size, NULL));
+
+	printf("Write chip operation with unlimited progress reports started.\n");
+	memset(newcontents, 0xa5, 64 * KiB);
+	write_chip_with_progress(&flashctx, newcontents, size, 0, &unlimited);
+	printf("Write chip operation done, %u reports.\n", unlimited.callbacks);
+
+	printf("Write chip operation with progress reports every 100 ms started.\n");
+	memset(newcontents, 0x5a, 64 * KiB);
+	write_chip_with_progress(&flashctx, newcontents, size, 100, &limited);
+	printf("Write chip operation done, %u reports.\n", limited.callbacks);
+
+	/* Each page written is reported without a limit. */
+	assert_true(unlimited.callbacks > 64 * KiB / mock_chip.page_size);
+	/* At most the first and the last report of each stage and the final one are extra. */
+	assert_in_range(limited.callbacks, 1, limited.last.elapsed_ms / 100 + 1 + 2 * 4 + 1);
+	assert_true(limited.callbacks < unlimited.callbacks);
+
+	teardown(&layout);
+
+	free(param_dup);
+	free(newcontents);
+}
+
+void write_chip_with_progress_paranoid_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	static struct io_mock_fallback_open_state data = {
+		.noc	= 0,
+		.paths	= { NULL },
+	};
+	const struct io_mock chip_io = {
+		.fallback_open_state = &data,
+	};
+
+	struct flashrom_flashctx flashctx = { 0 };
+	struct flashrom_layout *layout;
+	struct flashchip mock_chip = chip_W25Q128_V;
+	char *param_dup = strdup("bus=spi,emulate=W25Q128FV,timing=typ");
+	/* A paranoid master checks each erase and each write without an erase. */
+	struct programmer_entry paranoid_dummy = programmer_dummy;
+	struct progress_log log;
+
+	paranoid_dummy.paranoid = 1;
+	setup_chip_with_programmer(&flashctx, &layout, &mock_chip, &paranoid_dummy, param_dup, &chip_io);
+	flashctx.flags.verify_after_write = true;
+
+	const unsigned long size = mock_chip.total_size * 1024;
+	uint8_t *const newcontents = malloc(size);
+	memset(newcontents, 0xff, size);
+	memset(newcontents, 0x00, 64 * KiB);
+	assert_int_equal(0, flashrom_image_write(&flashctx, newcontents, size, NULL));
+
+	/* The first 64 KiB need an erase, the next 4 KiB are written without one. */
+	memset(newcontents, 0xa5, 64 * KiB);
+	memset(newcontents + 64 * KiB, 0x00, 4 * KiB);
+	printf("Write chip operation with a paranoid master started.\n");
+	write_chip_with_progress(&flashctx, newcontents, size, 0, &log);
+	printf("Write chip operation done, %u reports.\n", log.callbacks);
+
+	/* Checking the erases and writes added nothing to the planned verify. */
+	assert_int_equal(size, log.last.total);
+
+	teardown(&layout);
+
+	free(param_dup);
+	free(newcontents);
+}
+
+struct read_progress_log {
+	unsigned int reports;
+	unsigned int complete_reports; /* reports with the current at the total */
+	size_t last;
+};
+
+static void read_progress_log_cb(struct flashrom_flashctx *flashctx)
+{
+	const struct flashrom_progress *progress = flashctx->progress_state;
+	struct read_progress_log *log = progress->user_data;
+
+	assert_int_equal(FLASHROM_PROGRESS_READ, progress->stage);
+	assert_true(progress->current >= log->last);
+	if (progress->current == progress->total)
+		log->complete_reports++;
+	log->last = progress->current;
+	log->reports++;
+}
+
+void read_chip_with_progress_32MiB_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	static struct io_mock_fallback_open_state data = {
+		.noc	= 0,
+		.paths	= { NULL },
+	};
+	const struct io_mock chip_io = {
+		.fallback_open_state = &data,
+	};
+
+	struct flashrom_flashctx flashctx = { 0 };
+	struct flashrom_layout *layout;
+	/* spi_chip_read() reads chips above 16 MiB in 16 MiB segments. */
+	struct flashchip mock_chip = chip_W25Q128_V;
+	char *param_dup = strdup("bus=spi,emulate=VARIABLE_SIZE,size=33554432");
+	struct read_progress_log log = { 0 };
+	struct flashrom_progress progress_state = { .user_data = &log };
+
+	mock_chip.total_size = 32 * 1024;
+	mock_chip.feature_bits |= FEATURE_4BA_READ;
+	setup_chip(&flashctx, &layout, &mock_chip, param_dup, &chip_io);
+
+	const unsigned long size = mock_chip.total_size * 1024;
+	uint8_t *const buf = malloc(size);
+
+	printf("Read chip operation with progress reports started.\n");
+	flashrom_set_progress_callback(&flashctx, read_progress_log_cb, &progress_state);
+	assert_int_equal(0, flashrom_image_read(&flashctx, buf, size));
+	flashrom_set_progress_callback(&flashctx, NULL, NULL);
+	printf("Read chip operation done, %u reports, %u complete.\n", log.reports, log.complete_reports);
+
+	/*
+	 * Reading the first segment isn't reported as reading the whole chip.
+	 * Only the last chunk, spi_chip_read(), read_flash() and the end of
+	 * the operation report the read as complete.
+	 */
+	assert_int_equal(size, log.last);
+	assert_in_range(log.complete_reports, 1, 4);
+
+	teardown(&layout);
+
+	free(param_dup);
+	free(buf);
+}
+
 static size_t verify_chip_fread(void *state, void *buf, size_t size, size_t len, FILE *fp)
 {
 	/*
@@ -0,0 +1,227 @@
+/*
+ * This file is part of the flashrom project.
+ *
+ * Copyright 2026 Google LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <include/test.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "tests.h"
+#include "flash.h"
+#include "io_mock.h"
+#include "libflashrom.h"
+
+#define CACHE_CHIP_SIZE		(1 * KiB)
+
+static void set_included_regions(struct flashrom_flashctx *flashctx, struct flashrom_layout **layout,
+				 const char *const names[])
+{
+	flashrom_layout_release(*layout);
+	assert_int_equal(0, flashrom_layout_new(layout));
+	/* Neither of the regions starts or ends at a byte of the bitmap. */
+	assert_int_equal(0, flashrom_layout_add_region(*layout, 0, 4, "low"));
+	assert_int_equal(0, flashrom_layout_add_region(*layout, 5, CACHE_CHIP_SIZE - 6, "mid"));
+	assert_int_equal(0, flashrom_layout_add_region(*layout, CACHE_CHIP_SIZE - 5, CACHE_CHIP_SIZE - 1,
+							"high"));
+	for (; *names; names++)
+		assert_int_equal(0, flashrom_layout_include_region(*layout, *names));
+	flashrom_layout_set(flashctx, *layout);
+}
+
+void cli_daemon_cache_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	struct flashchip chip = {
+		.total_size	= CACHE_CHIP_SIZE / KiB,
+	};
+	struct flashrom_flashctx flashctx = { .chip = &chip };
+	struct flashrom_layout *layout = NULL;
+	uint8_t contents[CACHE_CHIP_SIZE];
+	const uint8_t *cached;
+	unsigned int i;
+
+	for (i = 0; i < sizeof(contents); i++)
+		contents[i] = i * 7;
+
+	assert_int_equal(0, cli_daemon_cache_init(CACHE_CHIP_SIZE));
+	assert_null(cli_daemon_cache_get(&flashctx));
+
+	set_included_regions(&flashctx, &layout, (const char *[]){ "low", "high", NULL });
+	cli_daemon_cache_update(&flashctx, contents);
+	assert_null(cli_daemon_cache_get(&flashctx));
+
+	set_included_regions(&flashctx, &layout, (const char *[]){ "mid", NULL });
+	cli_daemon_cache_erase(&flashctx);
+	cached = cli_daemon_cache_get(&flashctx);
+	assert_non_null(cached);
+	assert_memory_equal(contents, cached, 5);
+	for (i = 5; i < CACHE_CHIP_SIZE - 5; i++)
+		assert_int_equal(ERASED_VALUE(&flashctx), cached[i]);
+	assert_memory_equal(contents + CACHE_CHIP_SIZE - 5, cached + CACHE_CHIP_SIZE - 5, 5);
+
+	/* Knowing only the middle again doesn't mark the bytes around it. */
+	cli_daemon_cache_invalidate();
+	assert_null(cli_daemon_cache_get(&flashctx));
+	cli_daemon_cache_update(&flashctx, contents);
+	assert_null(cli_daemon_cache_get(&flashctx));
+	set_included_regions(&flashctx, &layout, (const char *[]){ "low", NULL });
+	cli_daemon_cache_update(&flashctx, contents);
+	assert_null(cli_daemon_cache_get(&flashctx));
+	set_included_regions(&flashctx, &layout, (const char *[]){ "high", NULL });
+	cli_daemon_cache_update(&flashctx, contents);
+	cached = cli_daemon_cache_get(&flashctx);
+	assert_non_null(cached);
+	assert_memory_equal(contents, cached, sizeof(contents));
+
+	/* Contents of another chip size aren't used. */
+	chip.total_size *= 2;
+	assert_null(cli_daemon_cache_get(&flashctx));
+
+	cli_daemon_cache_release();
+	flashrom_layout_release(layout);
+}
+
+/* The ends of the connection, the client writes to the daemon and vice versa. */
+#define CLIENT_FD	(MOCK_FD + 1)
+#define DAEMON_FD	(MOCK_FD + 2)
+
+struct daemon_pipe {
+	uint8_t data[4096];
+	size_t written, read;
+};
+
+struct daemon_conn {
+	struct daemon_pipe to_daemon, to_client;
+	unsigned int handled;
+	char messages[256];
+};
+
+static struct daemon_pipe *conn_pipe(struct daemon_conn *conn, int fd, bool writing)
+{
+	assert_true(fd == CLIENT_FD || fd == DAEMON_FD);
+	return (fd == CLIENT_FD) == writing ? &conn->to_daemon : &conn->to_client;
+}
+
+static int conn_read(void *state, int fd, void *buf, size_t sz)
+{
+	struct daemon_pipe *const pipe = conn_pipe(state, fd, false);
+	const size_t len = min(sz, pipe->written - pipe->read);
+
+	/* Nothing more to read is the end of the connection. */
+	memcpy(buf, pipe->data + pipe->read, len);
+	pipe->read += len;
+	return len;
+}
+
+static int conn_write(void *state, int fd, const void *buf, size_t sz)
+{
+	struct daemon_pipe *const pipe = conn_pipe(state, fd, true);
+
+	assert_in_range(pipe->written + sz, 0, sizeof(pipe->data));
+	memcpy(pipe->data + pipe->written, buf, sz);
+	pipe->written += sz;
+	return sz;
+}
+
+/* The daemon returns to its directory with the descriptor it opened before. */
+int __real_open(const char *pathname, int flags, ...);
+
+static int conn_open(void *state, const char *pathname, int flags)
+{
+	assert_string_equal(".", pathname);
+	return __real_open(pathname, flags);
+}
+
+static struct daemon_conn g_conn;
+
+static int request_handler(struct flashctx *flash, int argc, char *argv[])
+{
+	g_conn.handled++;
+	assert_int_equal(3, argc);
+	assert_string_equal("flashrom", argv[0]);
+	assert_string_equal("-r", argv[1]);
+	assert_string_equal("image with spaces.bin", argv[2]);
+
+	msg_ginfo("Reading %s.\n", argv[2]);
+	msg_gdbg("Not asked for by the client.\n");
+	return 3;
+}
+
+static int capture_log_cb(enum flashrom_log_level level, const char *fmt, va_list ap)
+{
+	const size_t len = strlen(g_conn.messages);
+
+	return vsnprintf(g_conn.messages + len, sizeof(g_conn.messages) - len, fmt, ap);
+}
+
+static void send_request(void)
+{
+	char prog[] = "flashrom", read[] = "-r", image[] = "image with spaces.bin";
+	char *argv[] = { prog, read, image };
+
+	memset(&g_conn, 0, sizeof(g_conn));
+	assert_int_equal(0, cli_daemon_send_request(CLIENT_FD, ARRAY_SIZE(argv), argv, FLASHROM_MSG_INFO));
+}
+
+void cli_daemon_request_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	const struct io_mock daemon_io = {
+		.state	= &g_conn,
+		.open	= conn_open,
+		.read	= conn_read,
+		.write	= conn_write,
+	};
+
+	io_mock_register(&daemon_io);
+	send_request();
+	cli_daemon_serve_request(DAEMON_FD, NULL, request_handler);
+	assert_int_equal(1, g_conn.handled);
+	assert_int_equal(g_conn.to_daemon.written, g_conn.to_daemon.read);
+
+	flashrom_set_log_callback(capture_log_cb);
+	assert_int_equal(3, cli_daemon_relay_answer(CLIENT_FD));
+	assert_string_equal("Reading image with spaces.bin.\n", g_conn.messages);
+	assert_int_equal(g_conn.to_client.written, g_conn.to_client.read);
+
+	flashrom_set_log_callback(NULL);
+	io_mock_register(NULL);
+}
+
+void cli_daemon_truncated_request_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	const struct io_mock daemon_io = {
+		.state	= &g_conn,
+		.read	= conn_read,
+		.write	= conn_write,
+	};
+
+	io_mock_register(&daemon_io);
+	send_request();
+	/* The client goes away in the middle of its last argument. */
+	g_conn.to_daemon.written -= 3;
+	cli_daemon_serve_request(DAEMON_FD, NULL, request_handler);
+	assert_int_equal(0, g_conn.handled);
+	assert_int_equal(0, g_conn.to_client.written);
+
+	/* The client of a daemon which went away fails. */
+	assert_int_equal(1, cli_daemon_relay_answer(CLIENT_FD));
+
+	flashrom_set_log_callback(NULL);
+	io_mock_register(NULL);
+}
@@ -0,0 +1,216 @@
+/*
+ * This file is part of the flashrom project.
+ *
+ * Copyright 2026 Google LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <include/test.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "tests.h"
+#include "chipdrivers.h"
+#include "flash.h"
+#include "fmap.h"
+#include "io_mock.h"
+#include "libflashrom.h"
+#include "programmer.h"
+#include "../cros_ec.h"
+
+/*
+ * An EC running from its RO copy, which occupies the lower half of the flash.
+ * Erases and writes of the running copy are denied until the EC jumps to RW.
+ */
+#define EMU_EC_FLASH_SIZE	(128 * KiB)
+#define EMU_EC_RO_SIZE		(EMU_EC_FLASH_SIZE / 2)
+#define EMU_EC_BLOCK_SIZE	(4 * KiB)
+#define EMU_EC_WRITE_SIZE	128
+
+static struct {
+	uint8_t flash[EMU_EC_FLASH_SIZE];
+	enum ec_current_image current_image;
+	unsigned int jumps;
+	/* Bytes read since the last jump. */
+	unsigned int read_bytes;
+} g_ec;
+
+static bool emu_ec_in_running_copy(uint32_t offset, uint32_t size)
+{
+	if (g_ec.current_image == EC_IMAGE_RO)
+		return offset < EMU_EC_RO_SIZE;
+	return offset + size > EMU_EC_RO_SIZE;
+}
+
+static int emu_ec_command(int command, int ver, const void *indata, int insize, void *outdata, int outsize)
+{
+	switch (command) {
+	case EC_CMD_GET_VERSION: {
+		struct ec_response_get_version *const r = outdata;
+		memset(r, 0, sizeof(*r));
+		r->current_image = g_ec.current_image;
+		return sizeof(*r);
+	}
+	case EC_CMD_GET_FEATURES:
+	case EC_CMD_FLASH_PROTECT:
+		memset(outdata, 0, outsize);
+		return outsize;
+	case EC_CMD_GET_CMD_VERSIONS: {
+		struct ec_response_get_cmd_versions *const r = outdata;
+		r->version_mask = EC_VER_MASK(1);
+		return sizeof(*r);
+	}
+	case EC_CMD_REBOOT_EC: {
+		const struct ec_params_reboot_ec *const p = indata;
+		assert_int_equal(EC_REBOOT_JUMP_RW, p->cmd);
+		g_ec.current_image = EC_IMAGE_RW;
+		g_ec.jumps++;
+		g_ec.read_bytes = 0;
+		return 0;
+	}
+	case EC_CMD_FLASH_READ: {
+		const struct ec_params_flash_read *const p = indata;
+		assert_in_range(p->offset + p->size, 0, EMU_EC_FLASH_SIZE);
+		memcpy(outdata, g_ec.flash + p->offset, p->size);
+		g_ec.read_bytes += p->size;
+		return p->size;
+	}
+	case EC_CMD_FLASH_ERASE: {
+		const struct ec_params_flash_erase_v1 *const p = indata;
+		assert_int_equal(1, ver);
+		assert_int_equal(FLASH_ERASE_SECTOR, p->cmd);
+		assert_in_range(p->params.offset + p->params.size, 0, EMU_EC_FLASH_SIZE);
+		if (emu_ec_in_running_copy(p->params.offset, p->params.size))
+			return -EC_RES_ACCESS_DENIED;
+		memset(g_ec.flash + p->params.offset, 0xff, p->params.size);
+		return 0;
+	}
+	case EC_CMD_FLASH_WRITE: {
+		const struct ec_params_flash_write *const p = indata;
+		const uint8_t *const data = (const uint8_t *)(p + 1);
+		uint32_t i;
+		assert_in_range(p->offset + p->size, 0, EMU_EC_FLASH_SIZE);
+		if (emu_ec_in_running_copy(p->offset, p->size))
+			return -EC_RES_ACCESS_DENIED;
+		for (i = 0; i < p->size; i++)
+			g_ec.flash[p->offset + i] &= data[i];
+		return 0;
+	}
+	default:
+		fail_msg("Unexpected EC command 0x%x", command);
+		return -EC_RES_INVALID_COMMAND;
+	}
+}
+
+/* Puts an FMAP describing the RO and RW copies at the start of the RW copy. */
+static void put_ec_fmap(uint8_t *image)
+{
+	struct fmap *const fmap = (struct fmap *)(image + EMU_EC_RO_SIZE);
+
+	memset(fmap, 0, sizeof(*fmap) + 2 * sizeof(fmap->areas[0]));
+	memcpy(fmap->signature, FMAP_SIGNATURE, sizeof(fmap->signature));
+	fmap->ver_major = FMAP_VER_MAJOR;
+	fmap->ver_minor = FMAP_VER_MINOR;
+	fmap->size = EMU_EC_FLASH_SIZE;
+	fmap->nareas = 2;
+	fmap->areas[0].offset = 0;
+	fmap->areas[0].size = EMU_EC_RO_SIZE;
+	strcpy((char *)fmap->areas[0].name, "EC_RO");
+	fmap->areas[1].offset = EMU_EC_RO_SIZE;
+	fmap->areas[1].size = EMU_EC_FLASH_SIZE - EMU_EC_RO_SIZE;
+	strcpy((char *)fmap->areas[1].name, "EC_RW");
+}
+
+void cros_ec_2nd_pass_rereads_denied_ranges_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	static struct io_mock_fallback_open_state data = {
+		.noc	= 0,
+		.paths	= { NULL },
+	};
+	const struct io_mock ec_io = {
+		.fallback_open_state = &data,
+	};
+	struct ec_response_flash_region_info regions[] = {
+		[EC_IMAGE_RO] = { .offset = 0, .size = EMU_EC_RO_SIZE },
+		[EC_IMAGE_RW] = { .offset = EMU_EC_RO_SIZE, .size = EMU_EC_FLASH_SIZE - EMU_EC_RO_SIZE },
+	};
+	struct cros_ec_priv ec_priv = {
+		.detected		= 1,
+		.current_image		= EC_IMAGE_RO,
+		.region			= regions,
+		.ec_command		= emu_ec_command,
+		.ideal_write_size	= EMU_EC_WRITE_SIZE,
+	};
+	struct registered_master ec_master = {
+		.buses_supported	= BUS_PROG,
+		.opaque = {
+			.max_data_read	= EMU_EC_WRITE_SIZE,
+			.max_data_write	= EMU_EC_WRITE_SIZE + sizeof(struct ec_params_flash_write),
+			.read		= cros_ec_read,
+			.write		= cros_ec_write,
+			.erase		= cros_ec_block_erase,
+		},
+	};
+	struct flashchip ec_chip = {
+		.vendor		= "Programmer",
+		.name		= "Opaque flash chip",
+		.bustype	= BUS_PROG,
+		.total_size	= EMU_EC_FLASH_SIZE / KiB,
+		.page_size	= EMU_EC_WRITE_SIZE,
+		.tested		= TEST_OK_PREW,
+		.block_erasers	= {
+			{
+				.eraseblocks = { {EMU_EC_BLOCK_SIZE, EMU_EC_FLASH_SIZE / EMU_EC_BLOCK_SIZE} },
+				.block_erase = erase_opaque,
+			}
+		},
+		.write		= write_opaque,
+		.read		= read_opaque,
+	};
+	struct flashrom_flashctx flashctx = { 0 };
+	struct flashrom_layout *layout;
+	static uint8_t image[EMU_EC_FLASH_SIZE];
+	unsigned int i;
+
+	for (i = 0; i < sizeof(image); i++) {
+		g_ec.flash[i] = i;
+		image[i] = i * 3 + (i >> 8);
+	}
+	put_ec_fmap(image);
+	g_ec.current_image = EC_IMAGE_RO;
+	g_ec.jumps = 0;
+
+	io_mock_register(&ec_io);
+	/* Any programmer will do, the EC is accessed through its own master below. */
+	assert_int_equal(0, programmer_init(&programmer_dummy, ""));
+	flashctx.chip = &ec_chip;
+	flashctx.mst = &ec_master;
+	cros_ec_priv = &ec_priv;
+
+	assert_int_equal(0, flashrom_layout_new(&layout));
+	assert_int_equal(0, flashrom_layout_add_region(layout, 0, EMU_EC_FLASH_SIZE - 1, "EC"));
+	assert_int_equal(0, flashrom_layout_include_region(layout, "EC"));
+	flashrom_layout_set(&flashctx, layout);
+
+	assert_int_equal(0, flashrom_image_write(&flashctx, image, sizeof(image), NULL));
+	assert_memory_equal(image, g_ec.flash, sizeof(image));
+
+	/* The 2nd pass only read back what was denied while running from RO. */
+	assert_int_equal(1, g_ec.jumps);
+	assert_int_equal(EMU_EC_RO_SIZE, g_ec.read_bytes);
+
+	cros_ec_priv = NULL;
+	flashrom_layout_release(layout);
+	assert_int_equal(0, programmer_shutdown());
+	io_mock_register(NULL);
+}
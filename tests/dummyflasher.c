@@ -14,6 +14,7 @@
  */
 
 #include "lifecycle.h"
+#include "flash.h"
 
 #if CONFIG_DUMMY == 1
 void dummy_basic_lifecycle_test_success(void **state)
@@ -55,8 +56,58 @@ void dummy_probe_variable_size_test_success(void **state)
 	run_probe_lifecycle(state, &dummy_io, &programmer_dummy, "size=8388608,emulate=VARIABLE_SIZE", "Opaque flash chip");
 }
 
+/* About twice of what probing a known chip takes today. */
+#define BUDGET_PROBE_COMMANDS	4
+#define BUDGET_PROBE_BYTES	16
+
+void dummy_probe_command_budget_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	struct io_mock_fallback_open_state dummy_fallback_open_state = {
+		.noc = 0,
+		.paths = { LOCK_FILE },
+	};
+	const struct io_mock dummy_io = {
+		.fallback_open_state = &dummy_fallback_open_state,
+	};
+	struct flashrom_flashctx flashctx = { 0 };
+	char *param_dup = strdup("bus=spi,emulate=W25Q128FV");
+	unsigned int commands = 0;
+	uint64_t bytes = 0;
+	unsigned int i;
+
+	io_mock_register(&dummy_io);
+	clear_spi_id_cache();
+	assert_int_equal(0, programmer_init(&programmer_dummy, param_dup));
+
+	assert_int_equal(0, flashrom_stats_enable(&flashctx, true));
+	chip_to_probe = "W25Q128.V";
+	assert_true(probe_flash(&registered_masters[0], 0, &flashctx, 0) >= 0);
+	chip_to_probe = NULL;
+	assert_string_equal("W25Q128.V", flashctx.chip->name);
+
+	const struct flashrom_stats *const stats = flashrom_stats_get(&flashctx);
+	for (i = 0; i < ARRAY_SIZE(stats->spi); i++) {
+		commands += stats->spi[i].count;
+		bytes += stats->spi[i].bytes_out + stats->spi[i].bytes_in;
+	}
+	printf("Probing took %u commands with %u bytes\n", commands, (unsigned int)bytes);
+	assert_in_range(commands, 1, BUDGET_PROBE_COMMANDS);
+	assert_in_range(bytes, 1, BUDGET_PROBE_BYTES);
+
+	assert_int_equal(0, flashrom_stats_enable(&flashctx, false));
+	flashrom_layout_release(flashctx.default_layout);
+	free(flashctx.chip);
+	assert_int_equal(0, programmer_shutdown());
+
+	free(param_dup);
+	io_mock_register(NULL);
+}
+
 #else
 	SKIP_TEST(dummy_basic_lifecycle_test_success)
 	SKIP_TEST(dummy_probe_lifecycle_test_success)
 	SKIP_TEST(dummy_probe_variable_size_test_success)
+	SKIP_TEST(dummy_probe_command_budget_test_success)
 #endif /* CONFIG_DUMMY */
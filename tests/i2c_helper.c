@@ -0,0 +1,182 @@
+/*
+ * This file is part of the flashrom project.
+ *
+ * Copyright 2026 Google LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <include/test.h>
+#include <errno.h>
+#include <string.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+#include "tests.h"
+#include "io_mock.h"
+#include "i2c_helper.h"
+
+#define MOCK_I2C_FD	0x1234
+#define TEST_ADDR	0x4a
+#define TEST_PAGE_SIZE	256
+
+struct i2c_io_state {
+	bool rdwr_supported;
+	unsigned int rdwr_calls;
+	unsigned int nmsgs;
+	uint16_t addr;
+	unsigned int writes;
+	unsigned int reads;
+	uint8_t last_write[TEST_PAGE_SIZE + 1];
+};
+
+static int i2c_ioctl(void *state, int fd, unsigned long request, va_list args)
+{
+	struct i2c_io_state *io_state = state;
+	unsigned int i;
+
+	assert_int_equal(fd, MOCK_I2C_FD);
+	if (request == I2C_SLAVE) {
+		io_state->addr = va_arg(args, unsigned long);
+		return 0;
+	}
+
+	assert_int_equal(request, I2C_RDWR);
+	io_state->rdwr_calls++;
+	if (!io_state->rdwr_supported) {
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+
+	struct i2c_rdwr_ioctl_data *data = va_arg(args, struct i2c_rdwr_ioctl_data *);
+	io_state->nmsgs += data->nmsgs;
+	for (i = 0; i < data->nmsgs; i++) {
+		assert_int_equal(data->msgs[i].addr, TEST_ADDR);
+		if (data->msgs[i].flags & I2C_M_RD) {
+			memset(data->msgs[i].buf, 0xa5, data->msgs[i].len);
+			io_state->reads++;
+		} else {
+			memcpy(io_state->last_write, data->msgs[i].buf, data->msgs[i].len);
+			io_state->writes++;
+		}
+	}
+	return data->nmsgs;
+}
+
+static int i2c_read_mock(void *state, int fd, void *buf, size_t sz)
+{
+	struct i2c_io_state *io_state = state;
+
+	assert_int_equal(io_state->addr, TEST_ADDR);
+	memset(buf, 0xa5, sz);
+	io_state->reads++;
+	return sz;
+}
+
+static int i2c_write_mock(void *state, int fd, const void *buf, size_t sz)
+{
+	struct i2c_io_state *io_state = state;
+
+	assert_int_equal(io_state->addr, TEST_ADDR);
+	memcpy(io_state->last_write, buf, sz);
+	io_state->writes++;
+	return sz;
+}
+
+static void build_page_batch(struct i2c_batch *batch, uint8_t *readback, const uint8_t *page)
+{
+	const uint8_t value = 0x55;
+
+	i2c_batch_init(batch);
+	assert_int_equal(0, i2c_batch_write_reg(batch, TEST_ADDR, 0x8e, &value, 1));
+	assert_int_equal(0, i2c_batch_read_reg(batch, TEST_ADDR, 0x9e, readback, 1));
+	assert_int_equal(0, i2c_batch_write_reg(batch, TEST_ADDR, 0x00, page, TEST_PAGE_SIZE));
+}
+
+static void run_page_batch(struct i2c_io_state *io_state)
+{
+	const struct io_mock i2c_io = {
+		.state = io_state,
+		.ioctl = i2c_ioctl,
+		.read = i2c_read_mock,
+		.write = i2c_write_mock,
+	};
+	struct i2c_batch batch;
+	uint8_t page[TEST_PAGE_SIZE];
+	uint8_t readback = 0;
+
+	memset(page, 0x3c, sizeof(page));
+	io_mock_register(&i2c_io);
+
+	build_page_batch(&batch, &readback, page);
+	assert_int_equal(0, i2c_batch_submit(MOCK_I2C_FD, &batch));
+	assert_int_equal(0, batch.count);
+
+	assert_int_equal(0xa5, readback);
+	assert_int_equal(3, io_state->writes);
+	assert_int_equal(1, io_state->reads);
+	assert_int_equal(0x00, io_state->last_write[0]);
+	assert_memory_equal(page, io_state->last_write + 1, TEST_PAGE_SIZE);
+
+	io_mock_register(NULL);
+}
+
+void i2c_batch_single_transaction_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	struct i2c_io_state io_state = { .rdwr_supported = true };
+
+	run_page_batch(&io_state);
+	assert_int_equal(1, io_state.rdwr_calls);
+	assert_int_equal(4, io_state.nmsgs);
+}
+
+void i2c_batch_fallback_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	struct i2c_io_state io_state = { .rdwr_supported = false };
+
+	run_page_batch(&io_state);
+	assert_int_equal(1, io_state.rdwr_calls);
+	assert_int_equal(0, io_state.nmsgs);
+}
+
+void i2c_batch_overflow_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	struct i2c_io_state io_state = { .rdwr_supported = true };
+	const struct io_mock i2c_io = {
+		.state = &io_state,
+		.ioctl = i2c_ioctl,
+	};
+	struct i2c_batch batch;
+	uint8_t page[TEST_PAGE_SIZE] = { 0 };
+
+	io_mock_register(&i2c_io);
+
+	i2c_batch_init(&batch);
+	assert_int_equal(0, i2c_batch_write(&batch, TEST_ADDR, page, TEST_PAGE_SIZE));
+	assert_int_equal(0, i2c_batch_write(&batch, TEST_ADDR, page, TEST_PAGE_SIZE));
+	assert_true(i2c_batch_write(&batch, TEST_ADDR, page, 1) < 0);
+
+	/* The error is latched and nothing is sent. */
+	assert_true(i2c_batch_submit(MOCK_I2C_FD, &batch) < 0);
+	assert_int_equal(0, io_state.rdwr_calls);
+
+	/* The batch is usable again after submission. */
+	assert_int_equal(0, i2c_batch_write(&batch, TEST_ADDR, page, 1));
+	assert_int_equal(0, i2c_batch_submit(MOCK_I2C_FD, &batch));
+	assert_int_equal(1, io_state.rdwr_calls);
+
+	io_mock_register(NULL);
+}
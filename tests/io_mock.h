@@ -34,6 +34,9 @@
 /* Required for `FILE *` */
 #include <stdio.h>
 
+/* Required for `struct timeval` */
+#include <sys/time.h>
+
 #include <stdint.h>
 
 #include "usb_unittests.h"
@@ -54,6 +57,7 @@ struct pci_dev {
 
 /* Linux I2C interface constants, avoiding linux/i2c-dev.h */
 #define I2C_SLAVE 0x0703
+#define I2C_RDWR 0x0707
 
 /* Always return success for tests. */
 #define S_ISREG(x) 0
@@ -99,6 +103,12 @@ struct io_mock {
 						uint8_t config_index,
 						struct libusb_config_descriptor **);
 	void (*libusb_free_config_descriptor)(void *state, struct libusb_config_descriptor *);
+	int (*libusb_submit_transfer)(void *state, struct libusb_transfer *transfer);
+	int (*libusb_cancel_transfer)(void *state, struct libusb_transfer *transfer);
+	int (*libusb_handle_events_timeout_completed)(void *state,
+							libusb_context *ctx,
+							struct timeval *tv,
+							int *completed);
 
 	/* POSIX File I/O */
 	int (*open)(void *state, const char *pathname, int flags);
@@ -110,6 +120,7 @@ struct io_mock {
 	FILE* (*fopen)(void *state, const char *pathname, const char *mode);
 	char* (*fgets)(void *state, char *buf, int len, FILE *fp);
 	size_t (*fread)(void *state, void *buf, size_t size, size_t len, FILE *fp);
+	size_t (*fwrite)(void *state, const void *buf, size_t size, size_t len, FILE *fp);
 	int (*fprintf)(void *state, FILE *fp, const char *fmt, va_list args);
 	int (*fclose)(void *state, FILE *fp);
 
@@ -127,6 +127,30 @@ int __wrap_libusb_control_transfer(libusb_device_handle *devh, uint8_t bmRequest
 	return 0;
 }
 
+int __wrap_libusb_submit_transfer(struct libusb_transfer *transfer)
+{
+	LOG_ME;
+	if (get_io() && get_io()->libusb_submit_transfer)
+		return get_io()->libusb_submit_transfer(get_io()->state, transfer);
+	return 0;
+}
+
+int __wrap_libusb_cancel_transfer(struct libusb_transfer *transfer)
+{
+	LOG_ME;
+	if (get_io() && get_io()->libusb_cancel_transfer)
+		return get_io()->libusb_cancel_transfer(get_io()->state, transfer);
+	return 0;
+}
+
+int __wrap_libusb_handle_events_timeout_completed(libusb_context *ctx, struct timeval *tv, int *completed)
+{
+	LOG_ME;
+	if (get_io() && get_io()->libusb_handle_events_timeout_completed)
+		return get_io()->libusb_handle_events_timeout_completed(get_io()->state, ctx, tv, completed);
+	return 0;
+}
+
 int __wrap_libusb_release_interface(libusb_device_handle *devh, int interface_number)
 {
 	LOG_ME;
@@ -37,6 +37,9 @@ int __wrap_libusb_claim_interface(libusb_device_handle *devh, int interface_numb
 int __wrap_libusb_control_transfer(libusb_device_handle *devh, uint8_t bmRequestType,
 		uint8_t bRequest, uint16_t wValue, uint16_t wIndex, unsigned char *data,
 		uint16_t wLength, unsigned int timeout);
+int __wrap_libusb_submit_transfer(struct libusb_transfer *transfer);
+int __wrap_libusb_cancel_transfer(struct libusb_transfer *transfer);
+int __wrap_libusb_handle_events_timeout_completed(libusb_context *ctx, struct timeval *tv, int *completed);
 int __wrap_libusb_release_interface(libusb_device_handle *devh, int interface_number);
 void __wrap_libusb_close(libusb_device_handle *devh);
 libusb_device *__wrap_libusb_ref_device(libusb_device *dev);
@@ -16,6 +16,8 @@
 #include "lifecycle.h"
 
 #if CONFIG_PARADE_LSPCON == 1
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
 
 /* Same macros as is in parade_lspcon.c programmer. */
 /* FIXME(aklm): should driver register maps be defined in `include/drivers/` for sharing with tests? */
@@ -34,6 +36,9 @@ struct parade_lspcon_io_state {
 	uint8_t reg_buf[MAX_REG_BUF_LEN];	/* Last value written to the register address */
 };
 
+static int parade_lspcon_read(void *state, int fd, void *buf, size_t sz);
+static int parade_lspcon_write(void *state, int fd, const void *buf, size_t sz);
+
 static int parade_lspcon_ioctl(void *state, int fd, unsigned long request, va_list args)
 {
 	struct parade_lspcon_io_state *io_state = state;
@@ -41,6 +46,19 @@ static int parade_lspcon_ioctl(void *state, int fd, unsigned long request, va_li
 		/* Addr is the next (and the only) argument in the parameters list for this ioctl call. */
 		io_state->addr = va_arg(args, unsigned long);
 
+	if (request == I2C_RDWR) {
+		/* Combined transactions are emulated as a sequence of plain reads and writes. */
+		struct i2c_rdwr_ioctl_data *data = va_arg(args, struct i2c_rdwr_ioctl_data *);
+		for (unsigned int i = 0; i < data->nmsgs; i++) {
+			io_state->addr = data->msgs[i].addr;
+			if (data->msgs[i].flags & I2C_M_RD)
+				parade_lspcon_read(state, fd, data->msgs[i].buf, data->msgs[i].len);
+			else
+				parade_lspcon_write(state, fd, data->msgs[i].buf, data->msgs[i].len);
+		}
+		return data->nmsgs;
+	}
+
 	return 0;
 }
 
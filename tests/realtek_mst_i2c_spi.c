@@ -16,9 +16,24 @@
 #include "lifecycle.h"
 
 #if CONFIG_REALTEK_MST_I2C_SPI == 1
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
 static int realtek_mst_ioctl(void *state, int fd, unsigned long request, va_list args)
 {
 	assert_int_equal(fd, MOCK_FD);
+	if (request == I2C_RDWR) {
+		struct i2c_rdwr_ioctl_data *data = va_arg(args, struct i2c_rdwr_ioctl_data *);
+		for (unsigned int i = 0; i < data->nmsgs; i++) {
+			/* Only register reads and writes on I2C address 0x4a are expected */
+			assert_int_equal(data->msgs[i].addr, 0x4a);
+			assert_in_range(data->msgs[i].len, 1, 2);
+			if (data->msgs[i].flags & I2C_M_RD)
+				memset(data->msgs[i].buf, 0, data->msgs[i].len);
+		}
+		return data->nmsgs;
+	}
+
 	assert_int_equal(request, I2C_SLAVE);
 	/* Only access to I2C address 0x4a is expected */
 	unsigned long addr = va_arg(args, unsigned long);
@@ -0,0 +1,188 @@
+/*
+ * This file is part of the flashrom project.
+ *
+ * Copyright 2026 Google LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <include/test.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "tests.h"
+#include "chipdrivers.h"
+#include "flash.h"
+#include "io_mock.h"
+#include "libflashrom.h"
+#include "programmer.h"
+#include "spi.h"
+
+#define RECORDING_SIZE (64 * KiB)
+
+/* The recording file, kept in memory. */
+struct recording_io_state {
+	uint8_t buf[RECORDING_SIZE];
+	size_t len;
+	size_t pos;
+};
+
+static size_t recording_fwrite(void *state, const void *buf, size_t size, size_t len, FILE *fp)
+{
+	struct recording_io_state *io_state = state;
+
+	assert_true(io_state->len + size * len <= sizeof(io_state->buf));
+	memcpy(io_state->buf + io_state->len, buf, size * len);
+	io_state->len += size * len;
+	return len;
+}
+
+static size_t recording_fread(void *state, void *buf, size_t size, size_t len, FILE *fp)
+{
+	struct recording_io_state *io_state = state;
+	const size_t items = (io_state->len - io_state->pos) / size;
+
+	if (len > items)
+		len = items;
+	memcpy(buf, io_state->buf + io_state->pos, size * len);
+	io_state->pos += size * len;
+	return len;
+}
+
+/* Sums up the durations in a recording, which replay waits for. */
+static uint64_t recorded_duration_ns(const struct recording_io_state *io_state, unsigned int *records)
+{
+	size_t pos = strlen(FLASHROM_RECORD_MAGIC);
+	struct flashrom_trace_record record;
+	uint64_t duration_ns = 0;
+
+	*records = 0;
+	while (pos + sizeof(record) <= io_state->len) {
+		memcpy(&record, io_state->buf + pos, sizeof(record));
+		duration_ns += record.duration_ns;
+		pos += sizeof(record) + record.bytes_out + record.bytes_in;
+		(*records)++;
+	}
+	assert_int_equal(io_state->len, pos);
+	return duration_ns;
+}
+
+/* The chip of the chip.c tests, which dummyflasher emulates. */
+extern const struct flashchip chip_W25Q128_V;
+
+#define SESSION_ADDR	0x1000
+#define SESSION_LEN	(4 * KiB)
+
+/* Erases a sector, programs two pages of it and reads it back. */
+static void run_session(struct flashctx *flash, uint8_t *readback)
+{
+	uint8_t pages[512];
+	uint8_t status;
+
+	for (unsigned int i = 0; i < sizeof(pages); i++)
+		pages[i] = i * 7;
+
+	assert_int_equal(0, spi_read_register(flash, STATUS1, &status));
+	assert_int_equal(0, spi_block_erase_20(flash, SESSION_ADDR, SESSION_LEN));
+	assert_int_equal(0, spi_chip_write_256(flash, pages, SESSION_ADDR, sizeof(pages)));
+	assert_int_equal(0, spi_chip_read(flash, readback, SESSION_ADDR, SESSION_LEN));
+
+	assert_memory_equal(pages, readback, sizeof(pages));
+	for (unsigned int i = sizeof(pages); i < SESSION_LEN; i++)
+		assert_int_equal(0xff, readback[i]);
+}
+
+void replay_session_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	static struct io_mock_fallback_open_state data = {
+		.noc	= 0,
+		.paths	= { NULL },
+	};
+	static struct recording_io_state recording_io_state;
+	const struct io_mock recording_io = {
+		.state = &recording_io_state,
+		.fwrite = recording_fwrite,
+		.fread = recording_fread,
+		.fallback_open_state = &data,
+	};
+
+	struct flashrom_flashctx flashctx = { 0 };
+	struct flashchip mock_chip = chip_W25Q128_V;
+	uint8_t recorded[SESSION_LEN], replayed[SESSION_LEN];
+
+	memset(&recording_io_state, 0, sizeof(recording_io_state));
+	io_mock_register(&recording_io);
+	flashctx.chip = &mock_chip;
+
+	printf("Recording a session with the timing dummyflasher... ");
+	/* Every command takes 50us plus 8us per byte on the emulated link. */
+	char *param_dup = strdup("bus=spi,emulate=W25Q128FV,timing=typ,freq=1MHz,latency=50");
+	assert_int_equal(0, flashrom_record_start("recording"));
+	assert_int_equal(0, programmer_init(&programmer_dummy, param_dup));
+	flashctx.mst = &registered_masters[0];
+	uint64_t start_ns = internal_clock_ns();
+	run_session(&flashctx, recorded);
+	const uint64_t recorded_ns = internal_clock_ns() - start_ns;
+	assert_int_equal(0, programmer_shutdown());
+	assert_int_equal(0, flashrom_record_stop());
+	free(param_dup);
+	printf("done\n");
+
+	assert_memory_equal(FLASHROM_RECORD_MAGIC, recording_io_state.buf, strlen(FLASHROM_RECORD_MAGIC));
+	unsigned int records;
+	const uint64_t commands_ns = recorded_duration_ns(&recording_io_state, &records);
+	assert_true(commands_ns >= records * 50 * 1000ULL);
+
+	printf("Replaying the session... ");
+	param_dup = strdup("file=recording");
+	assert_int_equal(0, programmer_init(&programmer_replay, param_dup));
+	flashctx.mst = &registered_masters[0];
+	start_ns = internal_clock_ns();
+	run_session(&flashctx, replayed);
+	/* The erase and program times of the emulated chip are replayed as well. */
+	assert_int_equal(recorded_ns, internal_clock_ns() - start_ns);
+	assert_memory_equal(recorded, replayed, SESSION_LEN);
+	assert_int_equal(0, programmer_shutdown());
+	free(param_dup);
+	printf("done\n");
+
+	printf("Replaying the session without latency... ");
+	recording_io_state.pos = 0;
+	param_dup = strdup("file=recording,latency=no");
+	assert_int_equal(0, programmer_init(&programmer_replay, param_dup));
+	flashctx.mst = &registered_masters[0];
+	start_ns = internal_clock_ns();
+	run_session(&flashctx, replayed);
+	/* Only the delays flashrom issues itself, e.g. while polling, remain. */
+	assert_int_equal(recorded_ns - commands_ns, internal_clock_ns() - start_ns);
+	assert_memory_equal(recorded, replayed, SESSION_LEN);
+	assert_int_equal(0, programmer_shutdown());
+	free(param_dup);
+	printf("done\n");
+
+	printf("Replaying a different session... ");
+	recording_io_state.pos = 0;
+	param_dup = strdup("file=recording,latency=no");
+	assert_int_equal(0, programmer_init(&programmer_replay, param_dup));
+	flashctx.mst = &registered_masters[0];
+	uint8_t status;
+	start_ns = internal_clock_ns();
+	assert_int_equal(0, spi_read_register(&flashctx, STATUS1, &status));
+	assert_int_equal(start_ns, internal_clock_ns());
+	/* The recording continues with an erase, not with a read. */
+	assert_int_not_equal(0, spi_chip_read(&flashctx, replayed, SESSION_ADDR, SESSION_LEN));
+	assert_int_equal(0, programmer_shutdown());
+	free(param_dup);
+	printf("done\n");
+
+	io_mock_register(NULL);
+}
@@ -0,0 +1,441 @@
+/*
+ * This file is part of the flashrom project.
+ *
+ * Copyright 2026 Google LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include "lifecycle.h"
+
+#if CONFIG_SERPROG == 1
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+/*
+ * serprog is connected to a local TCP socket, so that the real socket code is
+ * used, while reads and writes are redirected to a serprog device emulation
+ * below, which is connected to an emulated W25X10.
+ */
+
+#define S_ACK			0x06
+#define S_NAK			0x15
+#define S_CMD_NOP		0x00
+#define S_CMD_Q_IFACE		0x01
+#define S_CMD_Q_CMDMAP		0x02
+#define S_CMD_Q_PGMNAME		0x03
+#define S_CMD_Q_SERBUF		0x04
+#define S_CMD_Q_BUSTYPE		0x05
+#define S_CMD_Q_WRNMAXLEN	0x08
+#define S_CMD_SYNCNOP		0x10
+#define S_CMD_Q_RDNMAXLEN	0x11
+#define S_CMD_S_BUSTYPE		0x12
+#define S_CMD_O_SPIOP		0x13
+#define S_CMD_S_PIN_STATE	0x15
+#define S_CMD_O_SPIREAD		0x16
+#define S_CMD_O_SPIPOLL		0x17
+#define S_CMD_O_SPIOP_SEQ	0x18
+
+#define EMU_SERBUF_SIZE		4096
+#define EMU_RDNMAXLEN		256
+#define EMU_FLASH_SIZE		(128 * KiB)
+#define EMU_PAGE_SIZE		256
+
+static struct {
+	uint8_t flash[EMU_FLASH_SIZE];
+	bool wel;
+
+	uint8_t in[EMU_SERBUF_SIZE];
+	unsigned int in_len;
+	/* Serial buffer size reported to the host, at most EMU_SERBUF_SIZE. */
+	unsigned int serbuf_size;
+	/* Bytes of commands received since the host last read from the device. */
+	unsigned int unread_bytes;
+	uint8_t out[EMU_FLASH_SIZE];
+	unsigned int out_start, out_end;
+
+	/* Commands answered since the host last read from the device. */
+	unsigned int unread_answers;
+	unsigned int max_unread_answers;
+	unsigned int spiread_ops;
+	unsigned int poll_ops;
+	unsigned int write_calls;
+} g_serprog_emu;
+
+static uint32_t get_le24(const uint8_t *buf)
+{
+	return buf[0] | buf[1] << 8 | buf[2] << 16;
+}
+
+static void emu_answer(const void *data, unsigned int len)
+{
+	assert_true(g_serprog_emu.out_end + len <= sizeof(g_serprog_emu.out));
+	memcpy(g_serprog_emu.out + g_serprog_emu.out_end, data, len);
+	g_serprog_emu.out_end += len;
+}
+
+static void emu_answer_byte(uint8_t c)
+{
+	emu_answer(&c, 1);
+}
+
+static void emu_spi(const uint8_t *writearr, unsigned int writecnt, uint8_t *readarr, unsigned int readcnt)
+{
+	const unsigned int addr = writecnt >= 4 ? writearr[1] << 16 | writearr[2] << 8 | writearr[3] : 0;
+	unsigned int i;
+
+	memset(readarr, 0xff, readcnt);
+	switch (writearr[0]) {
+	case JEDEC_RDID:
+		readarr[0] = 0xef; /* WINBOND_NEX_ID */
+		readarr[1] = 0x30; /* WINBOND_NEX_W25X10 left byte */
+		readarr[2] = 0x11; /* WINBOND_NEX_W25X10 right byte */
+		break;
+	case JEDEC_RDSR:
+		for (i = 0; i < readcnt; i++)
+			readarr[i] = g_serprog_emu.wel ? SPI_SR_WEL : 0;
+		break;
+	case JEDEC_WREN:
+		g_serprog_emu.wel = true;
+		break;
+	case JEDEC_WRDI:
+	case JEDEC_WRSR:
+		g_serprog_emu.wel = false;
+		break;
+	case JEDEC_READ:
+		for (i = 0; i < readcnt; i++)
+			readarr[i] = g_serprog_emu.flash[(addr + i) % EMU_FLASH_SIZE];
+		break;
+	case JEDEC_BYTE_PROGRAM:
+		assert_true(g_serprog_emu.wel);
+		for (i = 4; i < writecnt; i++) {
+			const unsigned int pos = (addr & ~(EMU_PAGE_SIZE - 1)) | ((addr + i - 4) % EMU_PAGE_SIZE);
+			g_serprog_emu.flash[pos % EMU_FLASH_SIZE] &= writearr[i];
+		}
+		g_serprog_emu.wel = false;
+		break;
+	case JEDEC_SE:
+		assert_true(g_serprog_emu.wel);
+		memset(g_serprog_emu.flash + (addr & ~(4 * KiB - 1)), 0xff, 4 * KiB);
+		g_serprog_emu.wel = false;
+		break;
+	case JEDEC_BE_D8:
+		assert_true(g_serprog_emu.wel);
+		memset(g_serprog_emu.flash + (addr & ~(64 * KiB - 1)), 0xff, 64 * KiB);
+		g_serprog_emu.wel = false;
+		break;
+	case JEDEC_CE_C7:
+		assert_true(g_serprog_emu.wel);
+		memset(g_serprog_emu.flash, 0xff, EMU_FLASH_SIZE);
+		g_serprog_emu.wel = false;
+		break;
+	}
+}
+
+/* Returns the length of the complete command at the start of the buffer, 0 if incomplete. */
+static unsigned int emu_command_len(const uint8_t *in, unsigned int len)
+{
+	switch (in[0]) {
+	case S_CMD_S_BUSTYPE:
+	case S_CMD_S_PIN_STATE:
+		return len >= 2 ? 2 : 0;
+	case S_CMD_O_SPIOP:
+	case S_CMD_O_SPIREAD:
+		if (len < 7 || len < 7 + get_le24(in + 1))
+			return 0;
+		return 7 + get_le24(in + 1);
+	case S_CMD_O_SPIOP_SEQ:
+		if (len < 8 || len < 8 + get_le24(in + 2))
+			return 0;
+		return 8 + get_le24(in + 2);
+	case S_CMD_O_SPIPOLL:
+		return len >= 10 ? 10 : 0;
+	default:
+		return 1;
+	}
+}
+
+static void emu_command(const uint8_t *in)
+{
+	static uint8_t readbuf[EMU_FLASH_SIZE];
+	const uint8_t cmdmap[32] = {
+		[0] = 1 << S_CMD_NOP | 1 << S_CMD_Q_IFACE | 1 << S_CMD_Q_CMDMAP | 1 << S_CMD_Q_PGMNAME |
+		      1 << S_CMD_Q_SERBUF | 1 << S_CMD_Q_BUSTYPE,
+		[1] = 1 << (S_CMD_Q_WRNMAXLEN - 8),
+		[2] = 1 << (S_CMD_SYNCNOP - 16) | 1 << (S_CMD_Q_RDNMAXLEN - 16) | 1 << (S_CMD_S_BUSTYPE - 16) |
+		      1 << (S_CMD_O_SPIOP - 16) | 1 << (S_CMD_S_PIN_STATE - 16) | 1 << (S_CMD_O_SPIREAD - 16) |
+		      1 << (S_CMD_O_SPIPOLL - 16),
+		[3] = 1 << (S_CMD_O_SPIOP_SEQ - 24),
+	};
+	unsigned int writecnt, readcnt;
+
+	switch (in[0]) {
+	case S_CMD_NOP:
+	case S_CMD_S_BUSTYPE:
+	case S_CMD_S_PIN_STATE:
+		emu_answer_byte(S_ACK);
+		break;
+	case S_CMD_SYNCNOP:
+		emu_answer_byte(S_NAK);
+		emu_answer_byte(S_ACK);
+		break;
+	case S_CMD_Q_IFACE:
+		emu_answer(&(const uint8_t[]){ S_ACK, 0x01, 0x00 }, 3);
+		break;
+	case S_CMD_Q_CMDMAP:
+		emu_answer_byte(S_ACK);
+		emu_answer(cmdmap, sizeof(cmdmap));
+		break;
+	case S_CMD_Q_PGMNAME:
+		emu_answer_byte(S_ACK);
+		emu_answer("serprog-emu\0\0\0\0\0", 16);
+		break;
+	case S_CMD_Q_SERBUF:
+		emu_answer(&(const uint8_t[]){ S_ACK, g_serprog_emu.serbuf_size & 0xff,
+					       g_serprog_emu.serbuf_size >> 8 }, 3);
+		break;
+	case S_CMD_Q_BUSTYPE:
+		emu_answer(&(const uint8_t[]){ S_ACK, BUS_SPI }, 2);
+		break;
+	case S_CMD_Q_WRNMAXLEN:
+		emu_answer(&(const uint8_t[]){ S_ACK, 0x00, 0x04, 0x00 }, 4);
+		break;
+	case S_CMD_Q_RDNMAXLEN:
+		emu_answer(&(const uint8_t[]){ S_ACK, EMU_RDNMAXLEN & 0xff, EMU_RDNMAXLEN >> 8, 0x00 }, 4);
+		break;
+	case S_CMD_O_SPIOP:
+	case S_CMD_O_SPIREAD:
+		writecnt = get_le24(in + 1);
+		readcnt = get_le24(in + 4);
+		if (in[0] == S_CMD_O_SPIOP)
+			assert_in_range(readcnt, 0, EMU_RDNMAXLEN);
+		else
+			g_serprog_emu.spiread_ops++;
+		emu_spi(in + 7, writecnt, readbuf, readcnt);
+		emu_answer_byte(S_ACK);
+		emu_answer(readbuf, readcnt);
+		break;
+	case S_CMD_O_SPIOP_SEQ:
+		writecnt = get_le24(in + 2);
+		readcnt = get_le24(in + 5);
+		assert_in_range(readcnt, 0, EMU_RDNMAXLEN);
+		emu_spi(in + 8, writecnt, readbuf, readcnt);
+		emu_answer(&(const uint8_t[]){ S_ACK, in[1] }, 2);
+		emu_answer(readbuf, readcnt);
+		break;
+	case S_CMD_O_SPIPOLL:
+		g_serprog_emu.poll_ops++;
+		emu_spi(in + 1, 1, readbuf, 1);
+		if ((readbuf[0] & in[2]) == in[3]) {
+			emu_answer_byte(S_ACK);
+			emu_answer_byte(readbuf[0]);
+		} else {
+			emu_answer_byte(S_NAK);
+		}
+		break;
+	default:
+		emu_answer_byte(S_NAK);
+		break;
+	}
+	g_serprog_emu.unread_answers++;
+}
+
+static int serprog_write(void *state, int fd, const void *buf, size_t sz)
+{
+	unsigned int len;
+
+	if (fd != sp_fd)
+		return sz;
+
+	g_serprog_emu.write_calls++;
+	assert_true(g_serprog_emu.in_len + sz <= sizeof(g_serprog_emu.in));
+	memcpy(g_serprog_emu.in + g_serprog_emu.in_len, buf, sz);
+	g_serprog_emu.in_len += sz;
+
+	while (g_serprog_emu.in_len && (len = emu_command_len(g_serprog_emu.in, g_serprog_emu.in_len))) {
+		/*
+		 * A single command is consumed while it arrives, but commands sent ahead
+		 * of unread answers must never overflow the serial buffer of the device.
+		 */
+		g_serprog_emu.unread_bytes += len;
+		if (g_serprog_emu.unread_answers)
+			assert_in_range(g_serprog_emu.unread_bytes, 0, g_serprog_emu.serbuf_size);
+		emu_command(g_serprog_emu.in);
+		g_serprog_emu.in_len -= len;
+		memmove(g_serprog_emu.in, g_serprog_emu.in + len, g_serprog_emu.in_len);
+	}
+	return sz;
+}
+
+static int serprog_read(void *state, int fd, void *buf, size_t sz)
+{
+	if (fd != sp_fd)
+		return sz;
+
+	g_serprog_emu.max_unread_answers = max(g_serprog_emu.max_unread_answers, g_serprog_emu.unread_answers);
+	g_serprog_emu.unread_answers = 0;
+	g_serprog_emu.unread_bytes = 0;
+
+	if (g_serprog_emu.out_start == g_serprog_emu.out_end) {
+		errno = EAGAIN;
+		return -1;
+	}
+	sz = min(sz, g_serprog_emu.out_end - g_serprog_emu.out_start);
+	memcpy(buf, g_serprog_emu.out + g_serprog_emu.out_start, sz);
+	g_serprog_emu.out_start += sz;
+	if (g_serprog_emu.out_start == g_serprog_emu.out_end)
+		g_serprog_emu.out_start = g_serprog_emu.out_end = 0;
+	return sz;
+}
+
+static int serprog_listen(char *param, size_t len)
+{
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	socklen_t addrlen = sizeof(addr);
+
+	const int sock = socket(AF_INET, SOCK_STREAM, 0);
+	assert_true(sock >= 0);
+	assert_int_equal(0, bind(sock, (struct sockaddr *)&addr, sizeof(addr)));
+	assert_int_equal(0, listen(sock, 1));
+	assert_int_equal(0, getsockname(sock, (struct sockaddr *)&addr, &addrlen));
+	snprintf(param, len, "ip=127.0.0.1:%u", ntohs(addr.sin_port));
+
+	memset(&g_serprog_emu, 0, sizeof(g_serprog_emu));
+	memset(g_serprog_emu.flash, 0xff, sizeof(g_serprog_emu.flash));
+	g_serprog_emu.serbuf_size = EMU_SERBUF_SIZE;
+	return sock;
+}
+
+void serprog_probe_lifecycle_test_success(void **state)
+{
+	struct io_mock_fallback_open_state serprog_fallback_open_state = {
+		.noc = 0,
+		.paths = { LOCK_FILE },
+	};
+	const struct io_mock serprog_io = {
+		.read = serprog_read,
+		.write = serprog_write,
+		.fallback_open_state = &serprog_fallback_open_state,
+	};
+	char param[32];
+
+	const int sock = serprog_listen(param, sizeof(param));
+	run_probe_lifecycle(state, &serprog_io, &programmer_serprog, param, "W25X10");
+	close(sock);
+}
+
+void serprog_pipelined_write_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	struct io_mock_fallback_open_state serprog_fallback_open_state = {
+		.noc = 0,
+		.paths = { LOCK_FILE },
+	};
+	const struct io_mock serprog_io = {
+		.read = serprog_read,
+		.write = serprog_write,
+		.fallback_open_state = &serprog_fallback_open_state,
+	};
+	struct flashrom_programmer *flashprog;
+	struct flashrom_flashctx *flashctx;
+	static uint8_t image[EMU_FLASH_SIZE], readback[EMU_FLASH_SIZE];
+	char param[32];
+	unsigned int i;
+
+	const int sock = serprog_listen(param, sizeof(param));
+	for (i = 0; i < sizeof(image); i++)
+		image[i] = i * 7 + (i >> 8);
+
+	io_mock_register(&serprog_io);
+	assert_int_equal(0, flashrom_programmer_init(&flashprog, "serprog", param));
+	clear_spi_id_cache();
+	assert_int_equal(0, flashrom_flash_probe(&flashctx, flashprog, "W25X10"));
+	flashrom_flag_set(flashctx, FLASHROM_FLAG_VERIFY_AFTER_WRITE, true);
+
+	g_serprog_emu.max_unread_answers = 0;
+	g_serprog_emu.write_calls = 0;
+	assert_int_equal(0, flashrom_image_write(flashctx, image, sizeof(image), NULL));
+	assert_memory_equal(image, g_serprog_emu.flash, sizeof(image));
+	/* Pages were programmed without waiting for each answer. */
+	assert_true(g_serprog_emu.max_unread_answers > 3);
+	/* Commands were coalesced into few writes, not one or more per page. */
+	assert_in_range(g_serprog_emu.write_calls, 1, EMU_FLASH_SIZE / EMU_PAGE_SIZE / 4);
+	assert_int_equal(EMU_FLASH_SIZE / EMU_PAGE_SIZE, g_serprog_emu.poll_ops);
+
+	g_serprog_emu.spiread_ops = 0;
+	assert_int_equal(0, flashrom_image_read(flashctx, readback, sizeof(readback)));
+	assert_memory_equal(image, readback, sizeof(readback));
+	/* The whole chip fits into two streamed reads, even though read-n is limited. */
+	assert_int_equal(2, g_serprog_emu.spiread_ops);
+
+	flashrom_flash_release(flashctx);
+	assert_int_equal(0, flashrom_programmer_shutdown(flashprog));
+	io_mock_register(NULL);
+	close(sock);
+}
+
+void serprog_small_serbuf_write_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	struct io_mock_fallback_open_state serprog_fallback_open_state = {
+		.noc = 0,
+		.paths = { LOCK_FILE },
+	};
+	const struct io_mock serprog_io = {
+		.read = serprog_read,
+		.write = serprog_write,
+		.fallback_open_state = &serprog_fallback_open_state,
+	};
+	struct flashrom_programmer *flashprog;
+	struct flashrom_flashctx *flashctx;
+	static uint8_t image[EMU_FLASH_SIZE], readback[EMU_FLASH_SIZE];
+	char param[32];
+	unsigned int i;
+
+	const int sock = serprog_listen(param, sizeof(param));
+	/* A page program does not fit into the serial buffer in one piece. */
+	g_serprog_emu.serbuf_size = 128;
+	for (i = 0; i < sizeof(image); i++)
+		image[i] = i * 13 + (i >> 8);
+
+	io_mock_register(&serprog_io);
+	assert_int_equal(0, flashrom_programmer_init(&flashprog, "serprog", param));
+	clear_spi_id_cache();
+	assert_int_equal(0, flashrom_flash_probe(&flashctx, flashprog, "W25X10"));
+	flashrom_flag_set(flashctx, FLASHROM_FLAG_VERIFY_AFTER_WRITE, true);
+
+	assert_int_equal(0, flashrom_image_write(flashctx, image, sizeof(image), NULL));
+	assert_memory_equal(image, g_serprog_emu.flash, sizeof(image));
+	/* Pages were programmed one command at a time instead of pipelined. */
+	assert_int_equal(0, g_serprog_emu.poll_ops);
+
+	assert_int_equal(0, flashrom_image_read(flashctx, readback, sizeof(readback)));
+	assert_memory_equal(image, readback, sizeof(readback));
+
+	flashrom_flash_release(flashctx);
+	assert_int_equal(0, flashrom_programmer_shutdown(flashprog));
+	io_mock_register(NULL);
+	close(sock);
+}
+#else
+	SKIP_TEST(serprog_probe_lifecycle_test_success)
+	SKIP_TEST(serprog_pipelined_write_test_success)
+	SKIP_TEST(serprog_small_serbuf_write_test_success)
+#endif /* CONFIG_SERPROG */
@@ -71,7 +71,7 @@ static void spi_read_progress_cb(struct flashrom_flashctx *flashctx)
 {
 	struct flashrom_progress *progress_state = flashctx->progress_state;
 	uint32_t *cnt = (uint32_t *) progress_state->user_data;
-	assert_int_equal(0x300, progress_state->total);
+	assert_int_equal(0x400, progress_state->total);
 	switch (*cnt) {
 		case 0:
 			assert_int_equal(0x100, progress_state->current);
@@ -83,10 +83,10 @@ static void spi_read_progress_cb(struct flashrom_flashctx *flashctx)
 			assert_int_equal(0x300, progress_state->current);
 			break;
 		case 3:
-			assert_int_equal(0x300, progress_state->current);
+			assert_int_equal(0x400, progress_state->current);
 			break;
 		case 4:
-			assert_int_equal(0x300, progress_state->current);
+			assert_int_equal(0x400, progress_state->current);
 			break;
 		default:
 			fail();
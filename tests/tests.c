@@ -75,6 +75,32 @@ uint8_t __wrap_sio_read(uint16_t port, uint8_t reg)
 	return (uint8_t)mock();
 }
 
+/*
+ * Virtual clock: delays advance it instantly instead of spending real time.
+ * It starts at 1 s, because a zero timestamp means "not measured" to stats.c.
+ */
+static uint64_t virtual_clock_ns = 1000 * 1000 * 1000;
+
+void __wrap_internal_delay(unsigned int usecs)
+{
+	virtual_clock_ns += (uint64_t)usecs * 1000;
+}
+
+void __wrap_internal_sleep(unsigned int usecs)
+{
+	virtual_clock_ns += (uint64_t)usecs * 1000;
+}
+
+uint64_t __wrap_internal_clock_ns(void)
+{
+	return virtual_clock_ns;
+}
+
+void __wrap_myusec_calibrate_delay(void)
+{
+	LOG_ME;
+}
+
 static int mock_open(const char *pathname, int flags)
 {
 	if (get_io() && get_io()->open)
@@ -144,6 +170,15 @@ int __wrap_read(int fd, void *buf, size_t sz)
 	return sz;
 }
 
+int __wrap_poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+	LOG_ME;
+	/* Mocked reads never block, so everything is always ready. */
+	for (nfds_t i = 0; i < nfds; i++)
+		fds[i].revents = fds[i].events;
+	return nfds;
+}
+
 FILE *__wrap_fopen(const char *pathname, const char *mode)
 {
 	LOG_ME;
@@ -241,6 +276,8 @@ size_t __wrap_fread(void *ptr, size_t size, size_t nmemb, FILE *fp)
 size_t __wrap_fwrite(const void *ptr, size_t size, size_t nmemb, FILE *fp)
 {
 	LOG_ME;
+	if (get_io() && get_io()->fwrite)
+		return get_io()->fwrite(get_io()->state, ptr, size, nmemb, fp);
 	return nmemb;
 }
 
@@ -423,6 +460,7 @@ int main(int argc, char *argv[])
 		cmocka_unit_test(dummy_basic_lifecycle_test_success),
 		cmocka_unit_test(dummy_probe_lifecycle_test_success),
 		cmocka_unit_test(dummy_probe_variable_size_test_success),
+		cmocka_unit_test(dummy_probe_command_budget_test_success),
 		cmocka_unit_test(nicrealtek_basic_lifecycle_test_success),
 		cmocka_unit_test(raiden_debug_basic_lifecycle_test_success),
 		cmocka_unit_test(dediprog_basic_lifecycle_test_success),
@@ -431,6 +469,9 @@ int main(int argc, char *argv[])
 		cmocka_unit_test(parade_lspcon_basic_lifecycle_test_success),
 		cmocka_unit_test(mediatek_i2c_spi_basic_lifecycle_test_success),
 		cmocka_unit_test(realtek_mst_basic_lifecycle_test_success),
+		cmocka_unit_test(serprog_probe_lifecycle_test_success),
+		cmocka_unit_test(serprog_pipelined_write_test_success),
+		cmocka_unit_test(serprog_small_serbuf_write_test_success),
 	};
 	ret |= cmocka_run_group_tests_name("lifecycle.c tests", lifecycle_tests, NULL, NULL);
 
@@ -447,10 +488,20 @@ int main(int argc, char *argv[])
 	const struct CMUnitTest chip_tests[] = {
 		cmocka_unit_test(erase_chip_test_success),
 		cmocka_unit_test(erase_chip_with_dummyflasher_test_success),
+		cmocka_unit_test(erase_chip_with_timing_dummyflasher_test_success),
 		cmocka_unit_test(read_chip_test_success),
 		cmocka_unit_test(read_chip_with_dummyflasher_test_success),
+		cmocka_unit_test(read_chip_with_stats_test_success),
 		cmocka_unit_test(write_chip_test_success),
 		cmocka_unit_test(write_chip_with_dummyflasher_test_success),
+		cmocka_unit_test(read_chip_command_budget_test_success),
+		cmocka_unit_test(write_chip_command_budget_test_success),
+		cmocka_unit_test(erase_chip_command_budget_test_success),
+		cmocka_unit_test(write_chip_coalesced_erase_test_success),
+		cmocka_unit_test(write_chip_mixed_protection_block_test_success),
+		cmocka_unit_test(write_chip_with_progress_test_success),
+		cmocka_unit_test(write_chip_with_progress_paranoid_test_success),
+		cmocka_unit_test(read_chip_with_progress_32MiB_test_success),
 		cmocka_unit_test(verify_chip_test_success),
 		cmocka_unit_test(verify_chip_with_dummyflasher_test_success),
 	};
@@ -466,5 +517,37 @@ int main(int argc, char *argv[])
 	};
 	ret |= cmocka_run_group_tests_name("chip_wp.c tests", chip_wp_tests, NULL, NULL);
 
+	const struct CMUnitTest cros_ec_tests[] = {
+		cmocka_unit_test(cros_ec_2nd_pass_rereads_denied_ranges_test_success),
+	};
+	ret |= cmocka_run_group_tests_name("cros_ec.c tests", cros_ec_tests, NULL, NULL);
+
+	const struct CMUnitTest replay_tests[] = {
+		cmocka_unit_test(replay_session_test_success),
+	};
+	ret |= cmocka_run_group_tests_name("replay.c tests", replay_tests, NULL, NULL);
+
+	const struct CMUnitTest cli_daemon_tests[] = {
+		cmocka_unit_test(cli_daemon_cache_test_success),
+		cmocka_unit_test(cli_daemon_request_test_success),
+		cmocka_unit_test(cli_daemon_truncated_request_test_success),
+	};
+	ret |= cmocka_run_group_tests_name("cli_daemon.c tests", cli_daemon_tests, NULL, NULL);
+
+	const struct CMUnitTest usb_device_tests[] = {
+		cmocka_unit_test(usb_async_queue_in_order_test_success),
+		cmocka_unit_test(usb_async_queue_transfer_error_test_success),
+		cmocka_unit_test(usb_async_queue_cancel_test_success),
+		cmocka_unit_test(usb_async_queue_owned_buffers_test_success),
+	};
+	ret |= cmocka_run_group_tests_name("usb_device.c tests", usb_device_tests, NULL, NULL);
+
+	const struct CMUnitTest i2c_helper_tests[] = {
+		cmocka_unit_test(i2c_batch_single_transaction_test_success),
+		cmocka_unit_test(i2c_batch_fallback_test_success),
+		cmocka_unit_test(i2c_batch_overflow_test_success),
+	};
+	ret |= cmocka_run_group_tests_name("i2c_helper.c tests", i2c_helper_tests, NULL, NULL);
+
 	return ret;
 }
@@ -45,6 +45,7 @@ void probe_spi_st95_test_success(void **state); /* spi95.c */
 void dummy_basic_lifecycle_test_success(void **state);
 void dummy_probe_lifecycle_test_success(void **state);
 void dummy_probe_variable_size_test_success(void **state);
+void dummy_probe_command_budget_test_success(void **state);
 void nicrealtek_basic_lifecycle_test_success(void **state);
 void raiden_debug_basic_lifecycle_test_success(void **state);
 void dediprog_basic_lifecycle_test_success(void **state);
@@ -53,6 +54,9 @@ void linux_spi_probe_lifecycle_test_success(void **state);
 void parade_lspcon_basic_lifecycle_test_success(void **state);
 void mediatek_i2c_spi_basic_lifecycle_test_success(void **state);
 void realtek_mst_basic_lifecycle_test_success(void **state);
+void serprog_probe_lifecycle_test_success(void **state);
+void serprog_pipelined_write_test_success(void **state);
+void serprog_small_serbuf_write_test_success(void **state);
 
 /* layout.c */
 void included_regions_dont_overlap_test_success(void **state);
@@ -65,10 +69,20 @@ void layout_region_invalid_range_test_success(void **state);
 /* chip.c */
 void erase_chip_test_success(void **state);
 void erase_chip_with_dummyflasher_test_success(void **state);
+void erase_chip_with_timing_dummyflasher_test_success(void **state);
 void read_chip_test_success(void **state);
 void read_chip_with_dummyflasher_test_success(void **state);
+void read_chip_with_stats_test_success(void **state);
 void write_chip_test_success(void **state);
 void write_chip_with_dummyflasher_test_success(void **state);
+void read_chip_command_budget_test_success(void **state);
+void write_chip_command_budget_test_success(void **state);
+void erase_chip_command_budget_test_success(void **state);
+void write_chip_coalesced_erase_test_success(void **state);
+void write_chip_mixed_protection_block_test_success(void **state);
+void write_chip_with_progress_test_success(void **state);
+void write_chip_with_progress_paranoid_test_success(void **state);
+void read_chip_with_progress_32MiB_test_success(void **state);
 void verify_chip_test_success(void **state);
 void verify_chip_with_dummyflasher_test_success(void **state);
 
@@ -80,4 +94,26 @@ void wp_init_from_status_dummyflasher_test_success(void **state);
 void full_chip_erase_with_wp_dummyflasher_test_success(void **state);
 void partial_chip_erase_with_wp_dummyflasher_test_success(void **state);
 
+/* cros_ec.c */
+void cros_ec_2nd_pass_rereads_denied_ranges_test_success(void **state);
+
+/* replay.c */
+void replay_session_test_success(void **state);
+
+/* cli_daemon.c */
+void cli_daemon_cache_test_success(void **state);
+void cli_daemon_request_test_success(void **state);
+void cli_daemon_truncated_request_test_success(void **state);
+
+/* usb_device.c */
+void usb_async_queue_in_order_test_success(void **state);
+void usb_async_queue_transfer_error_test_success(void **state);
+void usb_async_queue_cancel_test_success(void **state);
+void usb_async_queue_owned_buffers_test_success(void **state);
+
+/* i2c_helper.c */
+void i2c_batch_single_transaction_test_success(void **state);
+void i2c_batch_fallback_test_success(void **state);
+void i2c_batch_overflow_test_success(void **state);
+
 #endif /* TESTS_H */
@@ -0,0 +1,225 @@
+/*
+ * This file is part of the flashrom project.
+ *
+ * Copyright 2026 Google LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <include/test.h>
+#include <string.h>
+
+#include "tests.h"
+#include "io_mock.h"
+
+#if CONFIG_RAIDEN_DEBUG_SPI == 1 || CONFIG_DEDIPROG == 1
+#include "flash.h"
+#include "usb_device.h"
+
+#define QUEUE_DEPTH	4
+#define CHUNK_SIZE	64
+#define MAX_TRANSFERS	16
+#define NO_FAILURE	MAX_TRANSFERS
+
+/*
+ * Emulates libusb completing bulk transfers in submission order, one per
+ * call to libusb_handle_events_timeout_completed().
+ */
+struct async_io_state {
+	struct libusb_transfer *transfers[MAX_TRANSFERS];
+	bool cancelled[MAX_TRANSFERS];
+	unsigned int submitted;
+	unsigned int completed;
+	unsigned int max_in_flight;
+	unsigned int fail_idx;
+};
+
+static int async_submit_transfer(void *state, struct libusb_transfer *transfer)
+{
+	struct async_io_state *io_state = state;
+
+	assert_in_range(io_state->submitted, 0, MAX_TRANSFERS - 1);
+	io_state->transfers[io_state->submitted++] = transfer;
+	io_state->max_in_flight = max(io_state->max_in_flight, io_state->submitted - io_state->completed);
+	return 0;
+}
+
+static int async_cancel_transfer(void *state, struct libusb_transfer *transfer)
+{
+	struct async_io_state *io_state = state;
+	unsigned int i;
+
+	for (i = io_state->completed; i < io_state->submitted; i++) {
+		if (io_state->transfers[i] == transfer) {
+			io_state->cancelled[i] = true;
+			return 0;
+		}
+	}
+	return LIBUSB_ERROR_NOT_FOUND;
+}
+
+static int async_handle_events(void *state, libusb_context *ctx, struct timeval *tv, int *completed)
+{
+	struct async_io_state *io_state = state;
+	const unsigned int idx = io_state->completed;
+
+	/* Nothing to complete would mean the caller waits forever. */
+	assert_true(idx < io_state->submitted);
+
+	struct libusb_transfer *transfer = io_state->transfers[idx];
+	if (io_state->cancelled[idx]) {
+		transfer->status = LIBUSB_TRANSFER_CANCELLED;
+		transfer->actual_length = 0;
+	} else if (idx == io_state->fail_idx) {
+		transfer->status = LIBUSB_TRANSFER_STALL;
+		transfer->actual_length = 0;
+	} else {
+		memset(transfer->buffer, idx, transfer->length);
+		transfer->status = LIBUSB_TRANSFER_COMPLETED;
+		transfer->actual_length = transfer->length;
+	}
+	io_state->completed++;
+	transfer->callback(transfer);
+	return 0;
+}
+
+static struct usb_async_queue *setup_queue(struct async_io_state *io_state, struct io_mock *io,
+					   unsigned int buffer_size)
+{
+	memset(io_state, 0, sizeof(*io_state));
+	io_state->fail_idx = NO_FAILURE;
+
+	*io = (struct io_mock) {
+		.state = io_state,
+		.libusb_submit_transfer = async_submit_transfer,
+		.libusb_cancel_transfer = async_cancel_transfer,
+		.libusb_handle_events_timeout_completed = async_handle_events,
+	};
+	io_mock_register(io);
+
+	struct usb_async_queue *queue = usb_async_queue_new(NULL, not_null(), 0x81, QUEUE_DEPTH, buffer_size, 1000);
+	assert_non_null(queue);
+	return queue;
+}
+
+void usb_async_queue_in_order_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	struct async_io_state io_state;
+	struct io_mock io;
+	uint8_t buf[10 * CHUNK_SIZE];
+	unsigned int i;
+
+	struct usb_async_queue *queue = setup_queue(&io_state, &io, 0);
+
+	for (i = 0; i < 10; i++)
+		assert_int_equal(0, usb_async_submit(queue, buf + i * CHUNK_SIZE, CHUNK_SIZE, false));
+	assert_int_equal(0, usb_async_wait_all(queue));
+	assert_int_equal(0, usb_async_pending(queue));
+
+	/* Transfers were overlapped up to the queue depth, but never deeper. */
+	assert_int_equal(QUEUE_DEPTH, io_state.max_in_flight);
+	for (i = 0; i < sizeof(buf); i++)
+		assert_int_equal(i / CHUNK_SIZE, buf[i]);
+
+	usb_async_queue_free(queue);
+	io_mock_register(NULL);
+}
+
+void usb_async_queue_transfer_error_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	struct async_io_state io_state;
+	struct io_mock io;
+	uint8_t buf[QUEUE_DEPTH * CHUNK_SIZE];
+	unsigned int i;
+
+	struct usb_async_queue *queue = setup_queue(&io_state, &io, 0);
+	io_state.fail_idx = 1;
+
+	for (i = 0; i < QUEUE_DEPTH; i++)
+		assert_int_equal(0, usb_async_submit(queue, buf + i * CHUNK_SIZE, CHUNK_SIZE, false));
+	assert_int_equal(0, usb_async_wait(queue, NULL));
+	assert_int_equal(LIBUSB_ERROR(LIBUSB_ERROR_PIPE), usb_async_wait(queue, NULL));
+
+	/* The remaining transfers are still reaped. */
+	assert_int_equal(0, usb_async_wait_all(queue));
+	assert_int_equal(0, usb_async_pending(queue));
+	assert_int_equal(QUEUE_DEPTH, io_state.completed);
+
+	usb_async_queue_free(queue);
+	io_mock_register(NULL);
+}
+
+void usb_async_queue_cancel_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	struct async_io_state io_state;
+	struct io_mock io;
+	uint8_t buf[3 * CHUNK_SIZE];
+	unsigned int i;
+
+	struct usb_async_queue *queue = setup_queue(&io_state, &io, 0);
+
+	for (i = 0; i < 3; i++)
+		assert_int_equal(0, usb_async_submit(queue, buf + i * CHUNK_SIZE, CHUNK_SIZE, false));
+	assert_int_equal(3, usb_async_pending(queue));
+
+	/* Freeing the queue cancels everything in flight and waits for it. */
+	usb_async_queue_free(queue);
+	assert_int_equal(3, io_state.completed);
+	for (i = 0; i < 3; i++)
+		assert_true(io_state.cancelled[i]);
+
+	io_mock_register(NULL);
+}
+
+void usb_async_queue_owned_buffers_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	struct async_io_state io_state;
+	struct io_mock io;
+	unsigned char *bufs[10];
+	unsigned int i, j;
+
+	struct usb_async_queue *queue = setup_queue(&io_state, &io, CHUNK_SIZE);
+
+	for (i = 0; i < 10; i++) {
+		if (usb_async_pending(queue) == QUEUE_DEPTH)
+			assert_int_equal(0, usb_async_wait(queue, NULL));
+		bufs[i] = usb_async_buffer(queue);
+		assert_non_null(bufs[i]);
+		assert_int_equal(0, usb_async_submit(queue, bufs[i], CHUNK_SIZE, false));
+	}
+	assert_int_equal(0, usb_async_wait_all(queue));
+
+	/* Every slot has its own buffer, which the transfer reusing the slot gets again. */
+	for (i = 0; i < QUEUE_DEPTH; i++)
+		for (j = i + 1; j < QUEUE_DEPTH; j++)
+			assert_true(bufs[i] + CHUNK_SIZE <= bufs[j] || bufs[j] + CHUNK_SIZE <= bufs[i]);
+	for (i = QUEUE_DEPTH; i < 10; i++)
+		assert_ptr_equal(bufs[i - QUEUE_DEPTH], bufs[i]);
+	for (i = 10 - QUEUE_DEPTH; i < 10; i++)
+		for (j = 0; j < CHUNK_SIZE; j++)
+			assert_int_equal(i, bufs[i][j]);
+
+	usb_async_queue_free(queue);
+	io_mock_register(NULL);
+}
+#else
+void usb_async_queue_in_order_test_success(void **state) { skip(); }
+void usb_async_queue_transfer_error_test_success(void **state) { skip(); }
+void usb_async_queue_cancel_test_success(void **state) { skip(); }
+void usb_async_queue_owned_buffers_test_success(void **state) { skip(); }
+#endif /* CONFIG_RAIDEN_DEBUG_SPI || CONFIG_DEDIPROG */
@@ -17,6 +17,7 @@
 #define WRAPS_H
 
 #include <stdio.h>
+#include <poll.h>
 #include "flash.h"
 
 char *__wrap_strdup(const char *s);
@@ -26,12 +27,17 @@ struct pci_dev *__wrap_pcidev_init(void *devs, int bar);
 uintptr_t __wrap_pcidev_readbar(void *dev, int bar);
 void __wrap_sio_write(uint16_t port, uint8_t reg, uint8_t data);
 uint8_t __wrap_sio_read(uint16_t port, uint8_t reg);
+void __wrap_internal_delay(unsigned int usecs);
+void __wrap_internal_sleep(unsigned int usecs);
+uint64_t __wrap_internal_clock_ns(void);
+void __wrap_myusec_calibrate_delay(void);
 int __wrap_open(const char *pathname, int flags);
 int __wrap_open64(const char *pathname, int flags);
 int __wrap___open64_2(const char *pathname, int flags);
 int __wrap_ioctl(int fd, unsigned long int request, ...);
 int __wrap_write(int fd, const void *buf, size_t sz);
 int __wrap_read(int fd, void *buf, size_t sz);
+int __wrap_poll(struct pollfd *fds, nfds_t nfds, int timeout);
 FILE *__wrap_fopen(const char *pathname, const char *mode);
 FILE *__wrap_fopen64(const char *pathname, const char *mode);
 FILE *__wrap_fdopen(int fd, const char *mode);
@@ -27,7 +27,12 @@
 #include "flash.h"
 #include "programmer.h"
 
+/* Set when the clock is precise enough for delays of any length. */
 static bool use_clock_gettime = false;
+/* Set when the clock is precise enough for delays of at least CLOCK_COARSE_MIN_DELAY us. */
+static bool use_clock_gettime_coarse = false;
+/* Shorter delays use the calibrated loop, with a coarse clock their error would be above 10%. */
+#define CLOCK_COARSE_MIN_DELAY	10
 
 #if HAVE_CLOCK_GETTIME == 1
 
@@ -37,6 +42,68 @@ static clockid_t clock_id = CLOCK_MONOTONIC;
 static clockid_t clock_id = CLOCK_REALTIME;
 #endif
 
+#ifdef TIMER_ABSTIME
+/* Delays shorter than this are never worth a sleep. */
+#define SLEEP_MIN_DELAY_NS	(100 * 1000L)
+
+/* How much later than requested a sleep ends, measured on first use. */
+static long sleep_slack_ns = -1;
+
+static long timespec_diff_ns(const struct timespec *a, const struct timespec *b)
+{
+	return (a->tv_sec - b->tv_sec) * 1000000000L + (a->tv_nsec - b->tv_nsec);
+}
+
+static long measure_sleep_slack(void)
+{
+	const struct timespec req = { 0, 10 * 1000 };
+	long slack = 0;
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		struct timespec start, end;
+		clock_gettime(clock_id, &start);
+		clock_nanosleep(clock_id, 0, &req, NULL);
+		clock_gettime(clock_id, &end);
+		const long late = timespec_diff_ns(&end, &start) - req.tv_nsec;
+		if (late > slack)
+			slack = late;
+	}
+	msg_pdbg("Sleeps end up to %ld ns late.\n", slack);
+	return slack;
+}
+
+/*
+ * Sleep through most of a longer delay so the CPU is free for others.
+ * Wake up early enough that timer slack can't make us overshoot, the
+ * caller spins for the rest.
+ */
+static void clock_sleep_until(const struct timespec *end, long delay_ns)
+{
+	if (delay_ns < SLEEP_MIN_DELAY_NS)
+		return;
+
+	if (sleep_slack_ns < 0)
+		sleep_slack_ns = measure_sleep_slack();
+
+	const long early_ns = sleep_slack_ns + sleep_slack_ns / 2;
+	if (delay_ns <= early_ns)
+		return;
+
+	struct timespec wake = *end;
+	wake.tv_nsec -= early_ns % 1000000000L;
+	wake.tv_sec -= early_ns / 1000000000L;
+	if (wake.tv_nsec < 0) {
+		wake.tv_nsec += 1000000000L;
+		wake.tv_sec--;
+	}
+	/* An interrupted sleep is fine, we spin for the rest. */
+	clock_nanosleep(clock_id, TIMER_ABSTIME, &wake, NULL);
+}
+#else
+static inline void clock_sleep_until(const struct timespec *end, long delay_ns) {}
+#endif
+
 static void clock_usec_delay(int usecs)
 {
 	struct timespec now;
@@ -47,6 +114,7 @@ static void clock_usec_delay(int usecs)
 		end_nsec / (1000 * 1000 * 1000) + now.tv_sec,
 		end_nsec % (1000 * 1000 * 1000)
 	};
+	clock_sleep_until(&end, usecs * 1000L);
 	do {
 		clock_gettime(clock_id, &now);
 	} while (now.tv_sec < end.tv_sec || (now.tv_sec == end.tv_sec && now.tv_nsec < end.tv_nsec));
@@ -62,6 +130,12 @@ static int clock_check_res(void)
 			use_clock_gettime = true;
 			return 1;
 		}
+		if (res.tv_sec == 0 && res.tv_nsec <= 1000) {
+			msg_pdbg("Using clock_gettime for delays of %d us and more "
+				 "(clk_id: %d, resolution: %ldns).\n",
+				 CLOCK_COARSE_MIN_DELAY, (int)clock_id, res.tv_nsec);
+			use_clock_gettime_coarse = true;
+		}
 	} else if (clock_id != CLOCK_REALTIME && errno == EINVAL) {
 		/* Try again with CLOCK_REALTIME. */
 		clock_id = CLOCK_REALTIME;
@@ -78,8 +152,9 @@ static inline int clock_check_res(void) { return 0; }
 
 /* loops per microsecond */
 static unsigned long micro = 1;
+static bool delay_loop_calibrated = false;
 
-__attribute__ ((noinline)) void myusec_delay(unsigned int usecs)
+__attribute__ ((noinline)) static void delay_loop(unsigned int usecs)
 {
 	unsigned long i;
 	for (i = 0; i < usecs * micro; i++) {
@@ -118,7 +193,7 @@ static unsigned long measure_delay(unsigned int usecs)
 	struct timeval start, end;
 
 	gettimeofday(&start, NULL);
-	myusec_delay(usecs);
+	delay_loop(usecs);
 	gettimeofday(&end, NULL);
 	timeusec = 1000000 * (end.tv_sec - start.tv_sec) +
 		   (end.tv_usec - start.tv_usec);
@@ -133,21 +208,19 @@ static unsigned long measure_delay(unsigned int usecs)
 	return timeusec;
 }
 
-void myusec_calibrate_delay(void)
+static void calibrate_delay_loop(void)
 {
-	if (clock_check_res())
-		return;
-
 	unsigned long count = 1000;
 	unsigned long timeusec, resolution;
 	int i, tries = 0;
 
-	msg_pinfo("Calibrating delay loop... ");
+	/* This runs in the middle of an operation, so it stays out of the way of its output. */
+	msg_pdbg("Calibrating delay loop... ");
 	resolution = measure_os_delay_resolution();
 	if (resolution) {
 		msg_pdbg("OS timer resolution is %lu usecs, ", resolution);
 	} else {
-		msg_pinfo("OS timer resolution is unusable. ");
+		msg_pdbg("OS timer resolution is unusable. ");
 	}
 
 recalibrate:
@@ -157,7 +230,7 @@ recalibrate:
 		if (timeusec > 1000000 / 4)
 			break;
 		if (count >= ULONG_MAX / 2) {
-			msg_pinfo("timer loop overflow, reduced precision. ");
+			msg_pdbg("timer loop overflow, reduced precision. ");
 			break;
 		}
 		count *= 2;
@@ -203,7 +276,7 @@ recalibrate:
 			}
 		}
 	} else {
-		msg_perr("delay loop is unreliable, trying to continue ");
+		msg_perr("\nDelay loop is unreliable, trying to continue.\n");
 	}
 
 	/* We're interested in the actual precision. */
@@ -218,7 +291,39 @@ recalibrate:
 	timeusec = measure_delay(resolution * 4);
 	msg_pdbg("%ld myus = %ld us, ", resolution * 4, timeusec);
 
-	msg_pinfo("OK.\n");
+	msg_pdbg("OK.\n");
+	delay_loop_calibrated = true;
+}
+
+void myusec_delay(unsigned int usecs)
+{
+	/* Calibrating takes a while, only do it once a delay loop is actually needed. */
+	if (!delay_loop_calibrated)
+		calibrate_delay_loop();
+	delay_loop(usecs);
+}
+
+void myusec_calibrate_delay(void)
+{
+	/* With a precise clock the delay loop is never used, otherwise it is calibrated on first use. */
+	clock_check_res();
+}
+
+/*
+ * Monotonic time in ns, the time base of internal_delay(). Everything measuring
+ * durations uses it, so unit tests can replace both with a virtual clock.
+ */
+uint64_t internal_clock_ns(void)
+{
+#if HAVE_CLOCK_GETTIME == 1
+	struct timespec now;
+	clock_gettime(clock_id, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+#else
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_usec * 1000;
+#endif
 }
 
 /* Not very precise sleep. */
@@ -240,7 +345,8 @@ void internal_delay(unsigned int usecs)
 	/* If the delay is >1 s, use internal_sleep because timing does not need to be so precise. */
 	if (usecs > 1000000) {
 		internal_sleep(usecs);
-	} else if (use_clock_gettime) {
+	} else if (use_clock_gettime ||
+		   (use_clock_gettime_coarse && usecs >= CLOCK_COARSE_MIN_DELAY)) {
 		clock_usec_delay(usecs);
 	} else {
 		myusec_delay(usecs);
@@ -259,4 +365,9 @@ void internal_delay(unsigned int usecs)
 {
 	udelay(usecs);
 }
+
+uint64_t internal_clock_ns(void)
+{
+	return timer_us(0) * 1000;
+}
 #endif
@@ -393,3 +393,260 @@ struct usb_device *usb_device_free(struct usb_device *device)
 
 	return next;
 }
+
+/*
+ * One slot per transfer that may be in flight.  Slots are used round-robin, so
+ * slot (n % depth) belongs to the n-th submitted transfer.
+ */
+struct usb_async_slot {
+	struct libusb_transfer *transfer;
+	unsigned char *buffer;
+	int completed;
+	bool short_ok;
+};
+
+struct usb_async_queue {
+	libusb_context       *context;
+	libusb_device_handle *handle;
+	unsigned char         endpoint;
+	unsigned int          timeout;
+	unsigned int          depth;
+	unsigned int          submitted;
+	unsigned int          reaped;
+	struct usb_async_slot slots[];
+};
+
+static void LIBUSB_CALL usb_async_callback(struct libusb_transfer *transfer)
+{
+	struct usb_async_slot *slot = transfer->user_data;
+
+	slot->completed = 1;
+}
+
+/*
+ * Translate the final status of a transfer into a libusb error code.
+ */
+static int usb_async_status(struct usb_async_slot const *slot)
+{
+	struct libusb_transfer const *transfer = slot->transfer;
+
+	switch (transfer->status) {
+	case LIBUSB_TRANSFER_COMPLETED:
+		if (!slot->short_ok && transfer->actual_length != transfer->length)
+			return LIBUSB_ERROR_IO;
+		return LIBUSB_SUCCESS;
+	case LIBUSB_TRANSFER_TIMED_OUT:
+		return LIBUSB_ERROR_TIMEOUT;
+	case LIBUSB_TRANSFER_CANCELLED:
+		return LIBUSB_ERROR_INTERRUPTED;
+	case LIBUSB_TRANSFER_STALL:
+		return LIBUSB_ERROR_PIPE;
+	case LIBUSB_TRANSFER_NO_DEVICE:
+		return LIBUSB_ERROR_NO_DEVICE;
+	case LIBUSB_TRANSFER_OVERFLOW:
+		return LIBUSB_ERROR_OVERFLOW;
+	default:
+		return LIBUSB_ERROR_IO;
+	}
+}
+
+/*
+ * Handle libusb events until the given slot completed.  Every transfer has its
+ * own timeout, so this always terminates unless the device vanished.
+ */
+static int usb_async_complete(struct usb_async_queue *queue,
+			      struct usb_async_slot *slot)
+{
+	while (!slot->completed) {
+		struct timeval timeout = { .tv_sec = 1 };
+		int ret = LIBUSB(libusb_handle_events_timeout_completed(
+				     queue->context,
+				     &timeout,
+				     &slot->completed));
+		if (ret != 0) {
+			msg_perr("USB: Failed to handle transfer events\n");
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+struct usb_async_queue *usb_async_queue_new(libusb_context *context,
+					    libusb_device_handle *handle,
+					    unsigned char endpoint,
+					    unsigned int depth,
+					    unsigned int buffer_size,
+					    unsigned int timeout_ms)
+{
+	struct usb_async_queue *queue;
+	unsigned char *buffers;
+	unsigned int i;
+
+	/* The buffers follow the slots, so they are freed (or leaked) with the queue. */
+	queue = calloc(1, sizeof(*queue) + depth * (sizeof(queue->slots[0]) + buffer_size));
+	if (queue == NULL) {
+		msg_perr("USB: Out of memory!\n");
+		return NULL;
+	}
+
+	queue->context  = context;
+	queue->handle   = handle;
+	queue->endpoint = endpoint;
+	queue->timeout  = timeout_ms;
+	queue->depth    = depth;
+
+	buffers = (unsigned char *)&queue->slots[depth];
+	for (i = 0; i < depth; i++) {
+		if (buffer_size)
+			queue->slots[i].buffer = buffers + i * buffer_size;
+		queue->slots[i].transfer = libusb_alloc_transfer(0);
+		if (queue->slots[i].transfer == NULL) {
+			msg_perr("USB: Failed to allocate transfer\n");
+			usb_async_queue_free(queue);
+			return NULL;
+		}
+	}
+
+	return queue;
+}
+
+unsigned int usb_async_pending(struct usb_async_queue const *queue)
+{
+	return queue->submitted - queue->reaped;
+}
+
+unsigned char *usb_async_buffer(struct usb_async_queue *queue)
+{
+	return queue->slots[queue->submitted % queue->depth].buffer;
+}
+
+int usb_async_submit(struct usb_async_queue *queue, unsigned char *buffer,
+		     int length, bool short_ok)
+{
+	struct usb_async_slot *slot;
+	int ret;
+
+	if (usb_async_pending(queue) == queue->depth) {
+		ret = usb_async_wait(queue, NULL);
+		if (ret != 0)
+			return ret;
+	}
+
+	slot = &queue->slots[queue->submitted % queue->depth];
+	slot->completed = 0;
+	slot->short_ok  = short_ok;
+
+	libusb_fill_bulk_transfer(slot->transfer,
+				  queue->handle,
+				  queue->endpoint,
+				  buffer,
+				  length,
+				  usb_async_callback,
+				  slot,
+				  queue->timeout);
+
+	ret = LIBUSB(libusb_submit_transfer(slot->transfer));
+	if (ret != 0) {
+		msg_perr("USB: Failed to submit transfer\n");
+		return ret;
+	}
+
+	queue->submitted++;
+
+	return 0;
+}
+
+int usb_async_wait(struct usb_async_queue *queue, int *actual_length)
+{
+	struct usb_async_slot *slot;
+	int ret;
+
+	if (usb_async_pending(queue) == 0)
+		return 0;
+
+	slot = &queue->slots[queue->reaped % queue->depth];
+
+	ret = usb_async_complete(queue, slot);
+	if (ret != 0)
+		return ret;
+
+	queue->reaped++;
+
+	if (actual_length != NULL)
+		*actual_length = slot->transfer->actual_length;
+
+	ret = usb_async_status(slot);
+	if (ret != LIBUSB_SUCCESS) {
+		msg_perr("USB: Transfer on endpoint 0x%02x failed (%s), %d of %d bytes done\n",
+			 queue->endpoint,
+			 libusb_error_name(ret),
+			 slot->transfer->actual_length,
+			 slot->transfer->length);
+		return LIBUSB_ERROR(ret);
+	}
+
+	return 0;
+}
+
+int usb_async_wait_all(struct usb_async_queue *queue)
+{
+	int first_error = 0;
+
+	while (usb_async_pending(queue) > 0) {
+		int ret = usb_async_wait(queue, NULL);
+
+		if (ret != 0 && first_error == 0)
+			first_error = ret;
+	}
+
+	return first_error;
+}
+
+void usb_async_cancel(struct usb_async_queue *queue)
+{
+	unsigned int i;
+
+	for (i = queue->reaped; i != queue->submitted; i++) {
+		struct usb_async_slot *slot = &queue->slots[i % queue->depth];
+
+		/*
+		 * Cancellation fails for transfers that already completed,
+		 * which is fine since they are reaped below anyway.
+		 */
+		if (!slot->completed)
+			libusb_cancel_transfer(slot->transfer);
+	}
+
+	for (; queue->reaped != queue->submitted; queue->reaped++) {
+		struct usb_async_slot *slot = &queue->slots[queue->reaped % queue->depth];
+
+		if (usb_async_complete(queue, slot) != 0) {
+			msg_perr("USB: Failed to cancel transfers\n");
+			break;
+		}
+	}
+}
+
+void usb_async_queue_free(struct usb_async_queue *queue)
+{
+	unsigned int i;
+
+	if (queue == NULL)
+		return;
+
+	usb_async_cancel(queue);
+
+	/*
+	 * If cancelling failed, libusb might still complete the remaining
+	 * transfers into the queue, so leak it rather than freeing memory that
+	 * is in use.
+	 */
+	if (queue->reaped != queue->submitted)
+		return;
+
+	for (i = 0; i < queue->depth; i++)
+		libusb_free_transfer(queue->slots[i].transfer);
+
+	free(queue);
+}
@@ -0,0 +1,562 @@
+/*
+ * This file is part of the flashrom project.
+ *
+ * Copyright 2026 Google LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Benchmarks the libflashrom image operations against the dummy programmer
+ * and prints the results as JSON, so that changes to the erase and write
+ * engine can be compared run to run.
+ *
+ * Every iteration fills the emulated chip with a random image, then reads
+ * it, writes an image with some blocks changed, verifies it and erases it.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "flash.h"
+#include "libflashrom.h"
+
+#define MAX_REGIONS 16
+
+enum change_pattern {
+	PATTERN_CONTIGUOUS,	/* The first blocks of the chip. */
+	PATTERN_SCATTERED,	/* Blocks evenly spread over the chip. */
+	PATTERN_RANDOM,		/* Randomly chosen blocks. */
+};
+
+static const char *const pattern_names[] = {
+	[PATTERN_CONTIGUOUS]	= "contiguous",
+	[PATTERN_SCATTERED]	= "scattered",
+	[PATTERN_RANDOM]	= "random",
+};
+
+static const struct {
+	const char *name;
+	enum write_granularity gran;
+} granularities[] = {
+	{ "1bit",	write_gran_1bit },
+	{ "1byte",	write_gran_1byte },
+	{ "implicit",	write_gran_1byte_implicit_erase },
+	{ "128",	write_gran_128bytes },
+	{ "256",	write_gran_256bytes },
+	{ "264",	write_gran_264bytes },
+	{ "512",	write_gran_512bytes },
+	{ "528",	write_gran_528bytes },
+	{ "1024",	write_gran_1024bytes },
+	{ "1056",	write_gran_1056bytes },
+};
+
+struct bench_config {
+	const char *emulate;
+	const char *chip_name;
+	unsigned long size;
+	const char *gran_name;
+	enum write_granularity gran;
+	double changed;
+	enum change_pattern pattern;
+	unsigned long block_size;
+	unsigned int iterations;
+	unsigned int seed;
+	const char *param;
+	struct {
+		unsigned long start, end;
+	} regions[MAX_REGIONS];
+	unsigned int region_count;
+};
+
+static int verbose;
+
+static const char *const phase_names[FLASHROM_STATS_PHASE_NR] = {
+	[FLASHROM_STATS_PHASE_READ]	= "read",
+	[FLASHROM_STATS_PHASE_PRE_READ]	= "pre_read",
+	[FLASHROM_STATS_PHASE_PLANNING]	= "planning",
+	[FLASHROM_STATS_PHASE_ERASE]	= "erase",
+	[FLASHROM_STATS_PHASE_WRITE]	= "write",
+	[FLASHROM_STATS_PHASE_VERIFY]	= "verify",
+};
+
+static int bench_log(enum flashrom_log_level level, const char *fmt, va_list ap)
+{
+	if (level > (verbose ? FLASHROM_MSG_DEBUG : FLASHROM_MSG_WARN))
+		return 0;
+	return vfprintf(stderr, fmt, ap);
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		" -e | --emulate <chip>        chip emulated by the dummy programmer (default W25Q128FV)\n"
+		" -s | --size <bytes>          emulate an opaque chip of this size instead\n"
+		" -c | --chip <name>           chip name to probe for\n"
+		" -g | --gran <granularity>    override the write granularity: 1bit, 1byte, implicit,\n"
+		"                              128, 256, 264, 512, 528, 1024 or 1056\n"
+		" -f | --changed <fraction>    fraction of blocks changed by the write (default 0.25)\n"
+		" -P | --pattern <pattern>     changed blocks: contiguous, scattered (default) or random\n"
+		" -b | --block-size <bytes>    size of the changed blocks (default 4096)\n"
+		" -r | --region <start>:<end>  only operate on this region, may be repeated\n"
+		" -n | --iterations <count>    number of iterations (default 1)\n"
+		" -S | --seed <seed>           seed for the images and random pattern (default 1)\n"
+		" -p | --param <params>        additional dummy programmer parameters\n"
+		" -V | --verbose               print the libflashrom debug output to stderr\n",
+		name);
+}
+
+static int parse_ulong(const char *str, unsigned long *value)
+{
+	char *end;
+
+	errno = 0;
+	*value = strtoul(str, &end, 0);
+	if (errno || end == str)
+		return 1;
+	if (*end == 'K' || *end == 'k') {
+		*value *= KiB;
+		end++;
+	} else if (*end == 'M' || *end == 'm') {
+		*value *= MiB;
+		end++;
+	}
+	return *end != '\0';
+}
+
+static int parse_region(struct bench_config *config, const char *str)
+{
+	char *copy = strdup(str);
+	char *colon = copy ? strchr(copy, ':') : NULL;
+	int ret = 1;
+
+	if (!colon || config->region_count >= MAX_REGIONS)
+		goto out;
+	*colon = '\0';
+	if (parse_ulong(copy, &config->regions[config->region_count].start) ||
+	    parse_ulong(colon + 1, &config->regions[config->region_count].end) ||
+	    config->regions[config->region_count].end < config->regions[config->region_count].start)
+		goto out;
+	config->region_count++;
+	ret = 0;
+out:
+	free(copy);
+	return ret;
+}
+
+static int parse_args(struct bench_config *config, int argc, char *argv[])
+{
+	static const char optstring[] = "e:s:c:g:f:P:b:r:n:S:p:Vh";
+	static const struct option long_options[] = {
+		{"emulate",	1, NULL, 'e'},
+		{"size",	1, NULL, 's'},
+		{"chip",	1, NULL, 'c'},
+		{"gran",	1, NULL, 'g'},
+		{"changed",	1, NULL, 'f'},
+		{"pattern",	1, NULL, 'P'},
+		{"block-size",	1, NULL, 'b'},
+		{"region",	1, NULL, 'r'},
+		{"iterations",	1, NULL, 'n'},
+		{"seed",	1, NULL, 'S'},
+		{"param",	1, NULL, 'p'},
+		{"verbose",	0, NULL, 'V'},
+		{"help",	0, NULL, 'h'},
+		{NULL,		0, NULL, 0},
+	};
+	unsigned long value;
+	unsigned int i;
+	char *end;
+	int opt;
+
+	while ((opt = getopt_long(argc, argv, optstring, long_options, NULL)) != EOF) {
+		switch (opt) {
+		case 'e':
+			config->emulate = optarg;
+			break;
+		case 's':
+			if (parse_ulong(optarg, &config->size) || !config->size || config->size % KiB) {
+				fprintf(stderr, "Error: The size must be a multiple of 1024.\n");
+				return 1;
+			}
+			break;
+		case 'c':
+			config->chip_name = optarg;
+			break;
+		case 'g':
+			for (i = 0; i < ARRAY_SIZE(granularities); i++) {
+				if (!strcmp(optarg, granularities[i].name))
+					break;
+			}
+			if (i == ARRAY_SIZE(granularities)) {
+				fprintf(stderr, "Error: Unknown write granularity \"%s\".\n", optarg);
+				return 1;
+			}
+			config->gran_name = granularities[i].name;
+			config->gran = granularities[i].gran;
+			break;
+		case 'f':
+			config->changed = strtod(optarg, &end);
+			if (*end != '\0' || config->changed < 0 || config->changed > 1) {
+				fprintf(stderr, "Error: The changed fraction must be between 0 and 1.\n");
+				return 1;
+			}
+			break;
+		case 'P':
+			for (i = 0; i < ARRAY_SIZE(pattern_names); i++) {
+				if (!strcmp(optarg, pattern_names[i]))
+					break;
+			}
+			if (i == ARRAY_SIZE(pattern_names)) {
+				fprintf(stderr, "Error: Unknown pattern \"%s\".\n", optarg);
+				return 1;
+			}
+			config->pattern = i;
+			break;
+		case 'b':
+			if (parse_ulong(optarg, &config->block_size) || !config->block_size) {
+				fprintf(stderr, "Error: Invalid block size.\n");
+				return 1;
+			}
+			break;
+		case 'r':
+			if (parse_region(config, optarg)) {
+				fprintf(stderr, "Error: Invalid region \"%s\".\n", optarg);
+				return 1;
+			}
+			break;
+		case 'n':
+			if (parse_ulong(optarg, &value) || !value || value > UINT_MAX) {
+				fprintf(stderr, "Error: Invalid iteration count.\n");
+				return 1;
+			}
+			config->iterations = value;
+			break;
+		case 'S':
+			if (parse_ulong(optarg, &value) || value > UINT_MAX) {
+				fprintf(stderr, "Error: Invalid seed.\n");
+				return 1;
+			}
+			config->seed = value;
+			break;
+		case 'p':
+			config->param = optarg;
+			break;
+		case 'V':
+			verbose = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (optind < argc) {
+		usage(argv[0]);
+		return 1;
+	}
+	return 0;
+}
+
+static uint64_t now_us(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static uint64_t cpu_us(void)
+{
+	struct rusage usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+	return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 +
+	       usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+static void fill_random(uint8_t *buf, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = rand();
+}
+
+/* Replaces config->changed of the image's blocks with random data. */
+static void change_blocks(const struct bench_config *config, uint8_t *image, size_t size)
+{
+	const size_t blocks = size / config->block_size;
+	const size_t changed = blocks * config->changed;
+	size_t i;
+
+	for (i = 0; i < changed; i++) {
+		size_t block;
+
+		switch (config->pattern) {
+		case PATTERN_CONTIGUOUS:
+			block = i;
+			break;
+		case PATTERN_SCATTERED:
+			block = i * blocks / changed;
+			break;
+		default:
+			/* Blocks may be picked twice, which is fine for a benchmark. */
+			block = ((size_t)rand() * RAND_MAX + rand()) % blocks;
+			break;
+		}
+		fill_random(image + block * config->block_size, config->block_size);
+	}
+}
+
+static size_t layout_bytes(const struct bench_config *config, size_t size)
+{
+	size_t bytes = 0;
+	unsigned int i;
+
+	if (!config->region_count)
+		return size;
+	for (i = 0; i < config->region_count; i++)
+		bytes += config->regions[i].end - config->regions[i].start + 1;
+	return bytes;
+}
+
+static void print_op(const char *name, bool first, int ret, uint64_t wall_us, uint64_t cpu,
+		     size_t bytes, const struct flashrom_stats *stats)
+{
+	uint64_t commands = 0;
+	bool first_entry = true;
+	unsigned int i;
+
+	printf("%s\n      \"%s\": {\"result\": %d, \"wall_us\": %" PRIu64 ", \"cpu_us\": %" PRIu64
+	       ", \"bytes\": %zu, \"kib_per_s\": %.1f",
+	       first ? "" : ",", name, ret, wall_us, cpu, bytes,
+	       wall_us ? (double)bytes * 1000000 / KiB / wall_us : 0);
+
+	for (i = 0; i < ARRAY_SIZE(stats->spi); i++)
+		commands += stats->spi[i].count;
+	for (i = 0; i < FLASHROM_STATS_OPAQUE_NR; i++)
+		commands += stats->opaque[i].count;
+	printf(", \"commands\": %" PRIu64 ", \"opcodes\": {", commands);
+	for (i = 0; i < ARRAY_SIZE(stats->spi); i++) {
+		if (!stats->spi[i].count)
+			continue;
+		printf("%s\"0x%02x\": %" PRIu64, first_entry ? "" : ", ", i, stats->spi[i].count);
+		first_entry = false;
+	}
+
+	printf("}, \"phases\": {");
+	first_entry = true;
+	for (i = 0; i < FLASHROM_STATS_PHASE_NR; i++) {
+		if (!stats->phases[i].total_us && !stats->phases[i].bytes)
+			continue;
+		printf("%s\"%s\": {\"us\": %" PRIu64 ", \"bytes\": %" PRIu64 "}", first_entry ? "" : ", ",
+		       phase_names[i], stats->phases[i].total_us, stats->phases[i].bytes);
+		first_entry = false;
+	}
+	printf("}}");
+}
+
+enum bench_op {
+	OP_READ,
+	OP_WRITE,
+	OP_VERIFY,
+	OP_ERASE,
+	OP_NR,
+};
+
+static const char *const op_names[OP_NR] = {
+	[OP_READ]	= "read",
+	[OP_WRITE]	= "write",
+	[OP_VERIFY]	= "verify",
+	[OP_ERASE]	= "erase",
+};
+
+static int run_op(struct flashrom_flashctx *flash, enum bench_op op, uint8_t *buf, uint8_t *image,
+		  size_t size)
+{
+	switch (op) {
+	case OP_READ:
+		return flashrom_image_read(flash, buf, size);
+	case OP_WRITE:
+		return flashrom_image_write(flash, image, size, NULL);
+	case OP_VERIFY:
+		return flashrom_image_verify(flash, image, size);
+	default:
+		return flashrom_flash_erase(flash);
+	}
+}
+
+static int run_iteration(const struct bench_config *config, struct flashrom_flashctx *flash,
+			 const struct flashrom_layout *layout, uint8_t *buf, uint8_t *image,
+			 unsigned int iteration)
+{
+	const size_t size = flashrom_flash_getsize(flash);
+	int ret;
+	enum bench_op op;
+
+	/* Start from a known image, outside of the measurement. */
+	fill_random(image, size);
+	flashrom_layout_set(flash, NULL);
+	flashrom_flag_set(flash, FLASHROM_FLAG_VERIFY_AFTER_WRITE, false);
+	if (flashrom_image_write(flash, image, size, NULL)) {
+		fprintf(stderr, "Error: Writing the initial image failed.\n");
+		return 1;
+	}
+	flashrom_layout_set(flash, layout);
+	change_blocks(config, image, size);
+
+	printf("%s\n    {", iteration ? "," : "");
+	for (op = 0; op < OP_NR; op++) {
+		if (flashrom_stats_enable(flash, true))
+			return 1;
+
+		const uint64_t cpu_start = cpu_us();
+		const uint64_t wall_start = now_us();
+		ret = run_op(flash, op, buf, image, size);
+		const uint64_t wall = now_us() - wall_start;
+		const uint64_t cpu = cpu_us() - cpu_start;
+
+		print_op(op_names[op], op == 0, ret, wall, cpu, layout_bytes(config, size),
+			 flashrom_stats_get(flash));
+		if (ret) {
+			fprintf(stderr, "Error: The %s operation failed.\n", op_names[op]);
+			break;
+		}
+	}
+	printf("\n    }");
+	flashrom_stats_enable(flash, false);
+	return ret;
+}
+
+static void print_config(const struct bench_config *config, size_t size)
+{
+	unsigned int i;
+
+	printf("{\n  \"config\": {\"emulate\": \"%s\", \"size\": %zu, \"gran\": \"%s\", \"changed\": %.3f, "
+	       "\"pattern\": \"%s\", \"block_size\": %lu, \"iterations\": %u, \"seed\": %u, \"regions\": [",
+	       config->size ? "VARIABLE_SIZE" : config->emulate, size,
+	       config->gran_name ? config->gran_name : "chip", config->changed,
+	       pattern_names[config->pattern], config->block_size, config->iterations, config->seed);
+	for (i = 0; i < config->region_count; i++)
+		printf("%s[%lu, %lu]", i ? ", " : "", config->regions[i].start, config->regions[i].end);
+	printf("]},\n  \"runs\": [");
+}
+
+int main(int argc, char *argv[])
+{
+	struct bench_config config = {
+		.emulate	= "W25Q128FV",
+		.changed	= 0.25,
+		.pattern	= PATTERN_SCATTERED,
+		.block_size	= 4 * KiB,
+		.iterations	= 1,
+		.seed		= 1,
+	};
+	struct flashrom_programmer *prog = NULL;
+	struct flashrom_flashctx *flash = NULL;
+	struct flashrom_layout *layout = NULL;
+	uint8_t *buf = NULL, *image = NULL;
+	char param[256];
+	unsigned int i;
+	size_t len;
+	int ret = 1;
+
+	if (parse_args(&config, argc, argv))
+		return 1;
+
+	flashrom_set_log_callback(bench_log);
+	if (flashrom_init(0))
+		return 1;
+
+	/* The opaque VARIABLE_SIZE chip is the only one with a configurable size. */
+	if (config.size)
+		len = snprintf(param, sizeof(param), "bus=prog,emulate=VARIABLE_SIZE,size=%lu", config.size);
+	else
+		len = snprintf(param, sizeof(param), "bus=spi,emulate=%s", config.emulate);
+	if (config.param && len < sizeof(param))
+		len += snprintf(param + len, sizeof(param) - len, ",%s", config.param);
+	if (len >= sizeof(param)) {
+		fprintf(stderr, "Error: The programmer parameters are too long.\n");
+		goto out;
+	}
+
+	if (flashrom_programmer_init(&prog, "dummy", param)) {
+		fprintf(stderr, "Error: Initializing the dummy programmer with \"%s\" failed.\n", param);
+		goto out;
+	}
+	if (flashrom_flash_probe(&flash, prog, config.chip_name)) {
+		fprintf(stderr, "Error: Probing for exactly one chip failed, try --chip.\n");
+		goto out_shutdown;
+	}
+	if (config.gran_name)
+		flash->chip->gran = config.gran;
+
+	const size_t size = flashrom_flash_getsize(flash);
+	if (config.block_size > size) {
+		fprintf(stderr, "Error: The block size exceeds the chip size.\n");
+		goto out_release;
+	}
+
+	if (config.region_count) {
+		if (flashrom_layout_new(&layout))
+			goto out_release;
+		for (i = 0; i < config.region_count; i++) {
+			char name[16];
+
+			snprintf(name, sizeof(name), "region%u", i);
+			if (config.regions[i].end >= size ||
+			    flashrom_layout_add_region(layout, config.regions[i].start,
+						       config.regions[i].end, name) ||
+			    flashrom_layout_include_region(layout, name)) {
+				fprintf(stderr, "Error: Invalid region %u.\n", i);
+				goto out_release;
+			}
+		}
+	}
+
+	buf = malloc(size);
+	image = malloc(size);
+	if (!buf || !image) {
+		fprintf(stderr, "Error: Out of memory.\n");
+		goto out_release;
+	}
+
+	srand(config.seed);
+	print_config(&config, size);
+	for (i = 0; i < config.iterations; i++) {
+		if (run_iteration(&config, flash, layout, buf, image, i))
+			break;
+	}
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	printf("\n  ],\n  \"peak_rss_kib\": %ld\n}\n", usage.ru_maxrss);
+	if (i == config.iterations)
+		ret = 0;
+
+out_release:
+	flashrom_layout_release(layout);
+	flashrom_flash_release(flash);
+out_shutdown:
+	flashrom_programmer_shutdown(prog);
+out:
+	free(image);
+	free(buf);
+	flashrom_shutdown();
+	return ret;
+}
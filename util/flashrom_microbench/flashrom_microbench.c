@@ -0,0 +1,580 @@
+/*
+ * This file is part of the flashrom project.
+ *
+ * Copyright 2026 Google LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Micro-benchmarks of the CPU-bound parts of flashrom: the erase and write
+ * planner, the content scanners and the layout and write protection
+ * helpers. The options and the report follow Google Benchmark, so that the
+ * usual tools for comparing its output work on ours, too.
+ *
+ * Each benchmark runs its loop for an increasing number of iterations until
+ * the loop takes at least --benchmark_min_time seconds, then reports the
+ * wall and CPU time per iteration.
+ */
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <regex.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "action_descriptor.h"
+#include "flash.h"
+#include "fmap.h"
+#include "ich_descriptors.h"
+#include "layout.h"
+#include "libflashrom.h"
+
+#define MAX_ITERATIONS 1000000000ULL
+#define BLOCK_SIZE (64 * KiB)
+
+struct bench_state {
+	/* Set by the runner. */
+	uint64_t iterations;
+	intptr_t arg;
+	/* Set by the benchmark, per iteration. */
+	uint64_t bytes;
+	bool error;
+	/* Kept by bench_keep_running(). */
+	uint64_t done;
+	uint64_t start_ns, start_cpu_ns;
+	uint64_t wall_ns, cpu_ns;
+};
+
+struct benchmark {
+	const char *name;
+	void (*run)(struct bench_state *state);
+	intptr_t arg;
+};
+
+/* Results go here, so that the compiler cannot drop the benchmarked calls. */
+static volatile uintptr_t sink;
+
+static struct flashrom_flashctx *flash;
+
+static uint64_t clock_ns(clockid_t clock)
+{
+	struct timespec now;
+
+	clock_gettime(clock, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/* Loop condition of a benchmark, everything outside of the loop is not timed. */
+static bool bench_keep_running(struct bench_state *state)
+{
+	if (!state->done) {
+		state->start_ns = clock_ns(CLOCK_MONOTONIC);
+		state->start_cpu_ns = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+	}
+	if (state->done == state->iterations) {
+		state->wall_ns = clock_ns(CLOCK_MONOTONIC) - state->start_ns;
+		state->cpu_ns = clock_ns(CLOCK_PROCESS_CPUTIME_ID) - state->start_cpu_ns;
+		return false;
+	}
+	state->done++;
+	return true;
+}
+
+static void bench_error(struct bench_state *state, const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	vfprintf(stderr, fmt, ap);
+	va_end(ap);
+	state->error = true;
+}
+
+static void fill_random(uint8_t *buf, size_t len)
+{
+	size_t i;
+
+	srand(1);
+	for (i = 0; i < len; i++)
+		buf[i] = rand();
+}
+
+static const struct {
+	const char *name;
+	enum write_granularity gran;
+} granularities[] = {
+	{ "1bit",	write_gran_1bit },
+	{ "1byte",	write_gran_1byte },
+	{ "implicit",	write_gran_1byte_implicit_erase },
+	{ "128",	write_gran_128bytes },
+	{ "256",	write_gran_256bytes },
+	{ "264",	write_gran_264bytes },
+	{ "512",	write_gran_512bytes },
+	{ "528",	write_gran_528bytes },
+	{ "1024",	write_gran_1024bytes },
+	{ "1056",	write_gran_1056bytes },
+};
+
+/* Synthetic differences between the old and the new image. */
+enum diff_pattern {
+	DIFF_SPARSE,	/* One byte in every 64th 4 KiB block. */
+	DIFF_DENSE,	/* One byte in every 4 KiB block. */
+	DIFF_STRIPED,	/* Every other 64 KiB block entirely. */
+	DIFF_ALL,	/* Every byte. */
+};
+
+static void apply_diff(uint8_t *image, size_t size, enum diff_pattern pattern)
+{
+	size_t i;
+
+	for (i = 0; i < size; i++) {
+		bool changed;
+
+		switch (pattern) {
+		case DIFF_SPARSE:
+			changed = i % (64 * 4 * KiB) == 0;
+			break;
+		case DIFF_DENSE:
+			changed = i % (4 * KiB) == 0;
+			break;
+		case DIFF_STRIPED:
+			changed = (i / (64 * KiB)) % 2 == 0;
+			break;
+		default:
+			changed = true;
+			break;
+		}
+		if (changed)
+			image[i] ^= 0x5a;
+	}
+}
+
+static void bm_prepare_action_descriptor(struct bench_state *state)
+{
+	const size_t size = flashrom_flash_getsize(flash);
+	uint8_t *const oldcontents = malloc(size);
+	uint8_t *const newcontents = malloc(size);
+
+	if (!oldcontents || !newcontents) {
+		bench_error(state, "Out of memory.\n");
+		goto out;
+	}
+	fill_random(oldcontents, size);
+	memcpy(newcontents, oldcontents, size);
+	apply_diff(newcontents, size, state->arg);
+
+	while (bench_keep_running(state)) {
+		struct action_descriptor *const descriptor =
+			prepare_action_descriptor(flash, oldcontents, newcontents);
+		sink = descriptor->processing_units[0].num_blocks;
+		free(descriptor);
+	}
+	state->bytes = size;
+out:
+	free(oldcontents);
+	free(newcontents);
+}
+
+/* The whole block is scanned: it is erased and every chunk changes. */
+static void bm_need_erase(struct bench_state *state)
+{
+	static uint8_t have[BLOCK_SIZE], want[BLOCK_SIZE];
+
+	memset(have, 0xff, sizeof(have));
+	fill_random(want, sizeof(want));
+
+	while (bench_keep_running(state))
+		sink = need_erase(have, want, sizeof(have), granularities[state->arg].gran, 0xff);
+	state->bytes = sizeof(have);
+}
+
+/* Finds all writes in a block where every other 4 KiB changed, like erase_write() does. */
+static void bm_get_next_write(struct bench_state *state)
+{
+	static uint8_t have[BLOCK_SIZE], want[BLOCK_SIZE];
+	size_t i;
+
+	fill_random(have, sizeof(have));
+	memcpy(want, have, sizeof(want));
+	for (i = 0; i < sizeof(want); i++)
+		if ((i / (4 * KiB)) % 2 == 0)
+			want[i] ^= 0x5a;
+
+	while (bench_keep_running(state)) {
+		unsigned int starthere = 0, lenhere, writes = 0;
+
+		while ((lenhere = get_next_write(have + starthere, want + starthere, sizeof(have) - starthere,
+						 &starthere, granularities[state->arg].gran))) {
+			starthere += lenhere;
+			writes++;
+		}
+		sink = writes;
+	}
+	state->bytes = sizeof(have);
+}
+
+#define FMAP_AREAS 64
+
+/* With `arg`, an fmap is put into the last 4 KiB of the image, without it the whole image is searched. */
+static void bm_fmap_read_from_buffer(struct bench_state *state)
+{
+	const size_t size = flashrom_flash_getsize(flash);
+	uint8_t *const image = malloc(size);
+	struct fmap *fmap;
+	unsigned int i;
+
+	if (!image) {
+		bench_error(state, "Out of memory.\n");
+		return;
+	}
+	fill_random(image, size);
+
+	if (state->arg) {
+		fmap = (struct fmap *)(image + size - 4 * KiB);
+		memset(fmap, 0, sizeof(*fmap) + FMAP_AREAS * sizeof(struct fmap_area));
+		memcpy(fmap->signature, FMAP_SIGNATURE, strlen(FMAP_SIGNATURE));
+		fmap->ver_major = FMAP_VER_MAJOR;
+		fmap->ver_minor = FMAP_VER_MINOR;
+		fmap->size = size;
+		strcpy((char *)fmap->name, "FLASH");
+		fmap->nareas = FMAP_AREAS;
+		for (i = 0; i < FMAP_AREAS; i++) {
+			struct fmap_area *const area = &fmap->areas[i];
+
+			area->offset = i * (size / FMAP_AREAS);
+			area->size = size / FMAP_AREAS;
+			snprintf((char *)area->name, sizeof(area->name), "AREA%u", i);
+		}
+	}
+
+	while (bench_keep_running(state)) {
+		const int ret = fmap_read_from_buffer(&fmap, image, size);
+
+		if (ret != (state->arg ? 0 : 2)) {
+			bench_error(state, "fmap_read_from_buffer() returned %d.\n", ret);
+			break;
+		}
+		if (!ret)
+			free(fmap);
+		sink = ret;
+	}
+	state->bytes = size;
+	free(image);
+}
+
+/* A descriptor of a Sunrise Point PCH, with an offset of 16 bytes like on all PCHs. */
+static void bm_read_ich_descriptors_from_dump(struct bench_state *state)
+{
+	static uint32_t dump[4 * KiB / 4];
+	struct ich_descriptors desc;
+	unsigned int i;
+
+	dump[4] = 0x0ff0a55a;		/* Descriptor mode signature */
+	dump[5] = 0x00040003;		/* FLMAP0: FCBA 0x30, FRBA 0x40 */
+	dump[6] = 0x58100208;		/* FLMAP1: FMBA 0x80, 2 masters, FISBA 0x100, ISL 0x58 */
+	dump[7] = 0x00310330;		/* FLMAP2: FMSBA 0x300, MSL 3 */
+	dump[0x30 / 4] = 0x000c0066;	/* FLCOMP: 17 MHz reads, two 16 MiB components */
+	for (i = 0; i < 16; i++)	/* FLREGs, all unused */
+		dump[0x40 / 4 + i] = 0x00007fff;
+	/* FLUMAP1 at the end of the descriptor stays 0, for an empty VSCC table. */
+
+	while (bench_keep_running(state)) {
+		enum ich_chipset cs = CHIPSET_ICH_UNKNOWN;
+		const int ret = read_ich_descriptors_from_dump(dump, sizeof(dump), &cs, &desc);
+
+		if (ret != ICH_RET_OK) {
+			bench_error(state, "read_ich_descriptors_from_dump() returned %d.\n", ret);
+			break;
+		}
+		sink = cs;
+	}
+	state->bytes = sizeof(dump);
+}
+
+/* `arg` included regions which do not overlap, so that every pair is compared. */
+static void bm_included_regions_overlap(struct bench_state *state)
+{
+	struct flashrom_layout *layout;
+	char name[32];
+	intptr_t i;
+
+	if (flashrom_layout_new(&layout)) {
+		bench_error(state, "Creating the layout failed.\n");
+		return;
+	}
+	for (i = 0; i < state->arg; i++) {
+		snprintf(name, sizeof(name), "region%"PRIdPTR, i);
+		if (flashrom_layout_add_region(layout, i * 4 * KiB, (i + 1) * 4 * KiB - 1, name) ||
+		    flashrom_layout_include_region(layout, name)) {
+			bench_error(state, "Adding region %"PRIdPTR" failed.\n", i);
+			goto out;
+		}
+	}
+
+	while (bench_keep_running(state))
+		sink = included_regions_overlap(layout);
+out:
+	flashrom_layout_release(layout);
+}
+
+/* Includes reading the status registers of the emulated chip. */
+static void bm_get_ranges_and_wp_bits(struct bench_state *state)
+{
+	struct flashrom_wp_ranges *ranges;
+
+	while (bench_keep_running(state)) {
+		const enum flashrom_wp_result ret = flashrom_wp_get_available_ranges(&ranges, flash);
+
+		if (ret != FLASHROM_WP_OK) {
+			bench_error(state, "flashrom_wp_get_available_ranges() returned %d.\n", ret);
+			break;
+		}
+		sink = flashrom_wp_ranges_get_count(ranges);
+		flashrom_wp_ranges_release(ranges);
+	}
+}
+
+#define GRAN_BENCHMARKS(name, run) \
+	{ name "/1bit", run, 0 }, { name "/1byte", run, 1 }, { name "/implicit", run, 2 }, \
+	{ name "/128", run, 3 }, { name "/256", run, 4 }, { name "/264", run, 5 }, \
+	{ name "/512", run, 6 }, { name "/528", run, 7 }, { name "/1024", run, 8 }, \
+	{ name "/1056", run, 9 }
+
+static const struct benchmark benchmarks[] = {
+	{ "prepare_action_descriptor/sparse",	bm_prepare_action_descriptor,	DIFF_SPARSE },
+	{ "prepare_action_descriptor/dense",	bm_prepare_action_descriptor,	DIFF_DENSE },
+	{ "prepare_action_descriptor/striped",	bm_prepare_action_descriptor,	DIFF_STRIPED },
+	{ "prepare_action_descriptor/all",	bm_prepare_action_descriptor,	DIFF_ALL },
+	GRAN_BENCHMARKS("need_erase", bm_need_erase),
+	GRAN_BENCHMARKS("get_next_write", bm_get_next_write),
+	{ "fmap_lsearch/miss",			bm_fmap_read_from_buffer,	0 },
+	{ "fmap_read_from_buffer/end",		bm_fmap_read_from_buffer,	1 },
+	{ "read_ich_descriptors_from_dump",	bm_read_ich_descriptors_from_dump, 0 },
+	{ "included_regions_overlap/16",	bm_included_regions_overlap,	16 },
+	{ "included_regions_overlap/256",	bm_included_regions_overlap,	256 },
+	{ "included_regions_overlap/1024",	bm_included_regions_overlap,	1024 },
+	{ "get_ranges_and_wp_bits/W25Q128.V",	bm_get_ranges_and_wp_bits,	0 },
+};
+
+/* Runs the benchmark with more iterations until it takes min_time, like Google Benchmark. */
+static int run_benchmark(const struct benchmark *bm, double min_time, struct bench_state *state)
+{
+	uint64_t iterations = 1;
+
+	for (;;) {
+		memset(state, 0, sizeof(*state));
+		state->iterations = iterations;
+		state->arg = bm->arg;
+		bm->run(state);
+		if (state->error)
+			return 1;
+
+		const double seconds = state->wall_ns / 1e9;
+		if (seconds >= min_time || iterations >= MAX_ITERATIONS)
+			return 0;
+
+		double multiplier = min_time * 1.4 / (seconds > 1e-9 ? seconds : 1e-9);
+		if (seconds / min_time <= 0.1 && multiplier > 10)
+			multiplier = 10;
+		const double next = iterations * multiplier;
+		iterations = next <= iterations ? iterations + 1 :
+			     next >= MAX_ITERATIONS ? MAX_ITERATIONS : (uint64_t)next;
+	}
+}
+
+static void format_rate(char *buf, size_t len, double rate)
+{
+	static const char *const units[] = { "", "k", "M", "G", "T" };
+	unsigned int i = 0;
+
+	while (rate >= 1024 && i < ARRAY_SIZE(units) - 1) {
+		rate /= 1024;
+		i++;
+	}
+	snprintf(buf, len, "%.5g%s/s", rate, units[i]);
+}
+
+enum output_format {
+	FORMAT_CONSOLE,
+	FORMAT_JSON,
+};
+
+static void print_header(enum output_format format, double min_time)
+{
+	char date[64];
+	const time_t now = time(NULL);
+
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+	if (format == FORMAT_JSON) {
+		printf("{\n  \"context\": {\n");
+		printf("    \"date\": \"%s\",\n", date);
+		printf("    \"library_version\": \"%s\",\n", flashrom_version_info());
+		printf("    \"min_time\": %g\n", min_time);
+		printf("  },\n  \"benchmarks\": [");
+		return;
+	}
+	printf("%s\nflashrom %s\n", date, flashrom_version_info());
+	printf("%-46s %15s %15s %12s\n", "Benchmark", "Time", "CPU", "Iterations");
+	printf("--------------------------------------------------------------------------------------------\n");
+}
+
+static void print_result(enum output_format format, bool first, const char *name,
+			 const struct bench_state *state)
+{
+	const double wall = (double)state->wall_ns / state->iterations;
+	const double cpu = (double)state->cpu_ns / state->iterations;
+	const double rate = state->bytes && state->cpu_ns ? state->bytes * 1e9 / cpu : 0;
+
+	if (format == FORMAT_JSON) {
+		printf("%s\n    {\n", first ? "" : ",");
+		printf("      \"name\": \"%s\",\n", name);
+		printf("      \"iterations\": %"PRIu64",\n", state->iterations);
+		printf("      \"real_time\": %.1f,\n", wall);
+		printf("      \"cpu_time\": %.1f,\n", cpu);
+		printf("      \"time_unit\": \"ns\"");
+		if (rate)
+			printf(",\n      \"bytes_per_second\": %.0f", rate);
+		printf("\n    }");
+		return;
+	}
+
+	printf("%-46s %12.0f ns %12.0f ns %12"PRIu64, name, wall, cpu, state->iterations);
+	if (rate) {
+		char buf[32];
+
+		format_rate(buf, sizeof(buf), rate);
+		printf(" bytes_per_second=%s", buf);
+	}
+	printf("\n");
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  --benchmark_filter=<regex>       only run the benchmarks matching <regex>\n"
+		"  --benchmark_min_time=<seconds>   minimum time of each benchmark (default 0.5)\n"
+		"  --benchmark_format=console|json  format of the report (default console)\n"
+		"  --benchmark_list_tests           list the benchmarks instead of running them\n",
+		name);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option long_options[] = {
+		{"benchmark_filter",		1, NULL, 'f'},
+		{"benchmark_min_time",		1, NULL, 't'},
+		{"benchmark_format",		1, NULL, 'F'},
+		{"benchmark_list_tests",	2, NULL, 'l'},
+		{"help",			0, NULL, 'h'},
+		{NULL,				0, NULL, 0},
+	};
+	enum output_format format = FORMAT_CONSOLE;
+	struct flashrom_programmer *prog = NULL;
+	/* The parameters are modified while they are parsed. */
+	char param[] = "bus=spi,emulate=W25Q128FV";
+	const char *filter = NULL;
+	bool list = false, first = true;
+	double min_time = 0.5;
+	regex_t regex;
+	unsigned int i;
+	char *endptr;
+	int opt, ret = 1;
+
+	while ((opt = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+		switch (opt) {
+		case 'f':
+			filter = optarg;
+			break;
+		case 't':
+			min_time = strtod(optarg, &endptr);
+			if (*endptr != '\0' || min_time <= 0) {
+				fprintf(stderr, "Error: Invalid minimum time \"%s\".\n", optarg);
+				return 1;
+			}
+			break;
+		case 'F':
+			if (!strcmp(optarg, "console")) {
+				format = FORMAT_CONSOLE;
+			} else if (!strcmp(optarg, "json")) {
+				format = FORMAT_JSON;
+			} else {
+				fprintf(stderr, "Error: Unknown format \"%s\".\n", optarg);
+				return 1;
+			}
+			break;
+		case 'l':
+			list = !optarg || !strcmp(optarg, "true");
+			break;
+		default:
+			usage(argv[0]);
+			return opt != 'h';
+		}
+	}
+	if (optind < argc) {
+		usage(argv[0]);
+		return 1;
+	}
+	if (filter && regcomp(&regex, filter, REG_EXTENDED | REG_NOSUB)) {
+		fprintf(stderr, "Error: Invalid filter \"%s\".\n", filter);
+		return 1;
+	}
+
+	if (list) {
+		for (i = 0; i < ARRAY_SIZE(benchmarks); i++)
+			if (!filter || !regexec(&regex, benchmarks[i].name, 0, NULL, 0))
+				printf("%s\n", benchmarks[i].name);
+		ret = 0;
+		goto out;
+	}
+
+	/* The planner and write protection need a chip, W25Q128.V emulated by the dummy is a typical one. */
+	if (flashrom_init(0))
+		goto out;
+	if (flashrom_programmer_init(&prog, "dummy", param)) {
+		fprintf(stderr, "Error: Initializing the dummy programmer failed.\n");
+		goto out;
+	}
+	if (flashrom_flash_probe(&flash, prog, "W25Q128.V")) {
+		fprintf(stderr, "Error: Probing for the emulated W25Q128.V failed.\n");
+		goto out_shutdown;
+	}
+
+	print_header(format, min_time);
+	for (i = 0; i < ARRAY_SIZE(benchmarks); i++) {
+		struct bench_state state;
+
+		if (filter && regexec(&regex, benchmarks[i].name, 0, NULL, 0))
+			continue;
+		if (run_benchmark(&benchmarks[i], min_time, &state)) {
+			fprintf(stderr, "Error: Benchmark %s failed.\n", benchmarks[i].name);
+			goto out_release;
+		}
+		print_result(format, first, benchmarks[i].name, &state);
+		fflush(stdout);
+		first = false;
+	}
+	if (format == FORMAT_JSON)
+		printf("\n  ]\n}\n");
+	ret = 0;
+
+out_release:
+	flashrom_flash_release(flash);
+out_shutdown:
+	flashrom_programmer_shutdown(prog);
+out:
+	if (filter)
+		regfree(&regex);
+	return ret;
+}